@@ -17,8 +17,8 @@ if (!oswrapper_audio_init()) {
     // Error handling here
 }
 
-// Allocate an OSWrapper_audio_spec struct
-OSWrapper_audio_spec* audio_spec = (OSWrapper_audio_spec*) malloc(sizeof(OSWrapper_audio_spec));
+// Allocate an OSWrapper_audio_spec struct, with every hint unset
+OSWrapper_audio_spec* audio_spec = (OSWrapper_audio_spec*) calloc(1, sizeof(OSWrapper_audio_spec));
 
 if (audio_spec == NULL) {
     // Error handling here
@@ -73,10 +73,83 @@ or handle setting up callbacks for decoding audio as needed.
 See test_oswrapper_audio for an audio decoding program
 which fully decodes a file to PCM data, and writes it to a new file.
 
+If you just want the whole file in memory, oswrapper_audio_decode_all decodes it in one go,
+with a single allocation when the length is known.
+
+If you only need to know the format and length of a file,
+oswrapper_audio_probe and oswrapper_audio_probe_path fill an OSWrapper_audio_info struct
+by reading just the container header, without creating a decoding context.
+
+Sound files which aren't in memory or on disk (e.g. inside a pack file)
+can be read through user provided read / seek / tell callbacks,
+with oswrapper_audio_load_from_callbacks and oswrapper_audio_probe_callbacks.
+Sound files which are received in pieces (e.g. over a network) can be decoded as they arrive
+with oswrapper_audio_load_push and oswrapper_audio_push_bytes (portable decoder only).
+
+Memory is allocated with OSWRAPPER_AUDIO_MALLOC and OSWRAPPER_AUDIO_FREE by default.
+To use a different allocator for each audio context (e.g. an arena per level or per thread),
+point OSWrapper_audio_spec.allocator at an OSWrapper_audio_allocator before creating the context.
+To avoid allocating at all (e.g. for real-time voices), reserve storage up front
+with the size from oswrapper_audio_context_size (or oswrapper_audio_context_size_from_memory for a given file),
+and load with oswrapper_audio_load_from_memory_inplace.
+
+For real-time playback, define OSWRAPPER_AUDIO_USE_THREADS to use OSWrapper_audio_stream,
+which decodes audio ahead of time on a worker thread into a ring buffer.
+oswrapper_audio_stream_read never allocates, locks, or waits, so it can be called from an audio callback.
+On platforms other than Windows, link with pthreads.
+See demo_oswrapper_audio_sokol_audio for an example.
+OSWRAPPER_AUDIO_USE_THREADS also enables oswrapper_audio_decode_batch,
+which fully decodes many files at once with a pool of threads, into one allocation.
+With threads, oswrapper_audio_decode_all and oswrapper_audio_decode_batch split long FLAC and ALAC files
+into pieces of at least OSWRAPPER_AUDIO_PIECE_MIN_FRAMES frames, which are decoded on different threads.
+
+To play audio with miniaudio, define OSWRAPPER_AUDIO_USE_MINIAUDIO_DATA_SOURCE
+to use OSWrapper_audio_ma_data_source, which wraps an audio context as an ma_data_source.
+Include miniaudio.h before including this file. This works with any decoder.
+See demo_oswrapper_audio_miniaudio for an example.
+
 Platform requirements:
 - On macOS, link with AudioToolbox
 - On Windows, call CoInitialize before using the library,
   and link with mfplat.lib, mfreadwrite.lib, and shlwapi.lib
+- On other platforms, the built in portable decoder is used.
+  It has no dependencies, and currently supports WAVE files
+  (8, 16, 24, and 32 bit integer PCM, 32 and 64 bit floating point PCM),
+  AIFF / AIFC files (big and little-endian integer PCM up to 32 bits,
+  32 and 64 bit floating point PCM, and mu-law / A-law, which are decoded to 16 bit PCM),
+  Sun AU / SND files (the same formats as AIFF), CAF files (the same formats as AIFC,
+  and Apple IMA4 ADPCM, which is decoded to 16 bit PCM),
+  FLAC files (4 to 32 bits, except 32 bit audio with stereo decorrelation),
+  and MP4 / M4A files with Apple Lossless (ALAC) audio (16, 20, 24, and 32 bits, up to 8 channels).
+  CAF files use the packet table for their exact length and priming frames,
+  except when pushed with oswrapper_audio_push_bytes if the packet table is after the audio data.
+  FLAC files seek with the seek table if there is one, and otherwise by searching for frames.
+  If the length isn't in the STREAMINFO block, it's found by decoding the end of the file when loading,
+  or isn't known until the end when pushed with oswrapper_audio_push_bytes.
+  Frames which fail to decode are skipped.
+  M4A files use the first ALAC track, and its sample tables are read into an index when loading,
+  so any packet can be found with a binary search. The movie box can be before or after the audio data,
+  but has to be received before any audio can be decoded when pushed with oswrapper_audio_push_bytes.
+  Edit lists aren't used, and packets which fail to decode are skipped.
+  The audio is converted to the hinted sample rate, channel count, bit depth, audio type, and endianness.
+  8 bit PCM is always output as signed 8 bit PCM.
+  Audio is resampled with a polyphase windowed sinc filter, or linear interpolation,
+  depending on the hinted resample_quality.
+  Define OSWRAPPER_AUDIO_NO_USE_PORTABLE_IMPL to disable it.
+- Alternatively, define OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL on any platform
+  to decode audio with miniaudio's decoders (WAV, FLAC, MP3) instead.
+  Include miniaudio.h before including this file,
+  and link with miniaudio's requirements.
+- The portable and miniaudio decoders remix audio to the hinted channel count.
+  Mono is copied to both stereo channels, and stereo is averaged to mono.
+  Quad, 5.1, and 7.1 are downmixed to stereo (or mono) with the centre and surround channels at -3 dB,
+  normalised so the output can't clip. The LFE channel is dropped.
+  Other channel counts are copied channel by channel, leaving any extra channels silent.
+  A custom matrix can be used instead, by setting channel_matrix on the OSWrapper_audio_spec.
+- The portable and miniaudio decoders use SSE2, AVX2, or NEON for common sample conversions
+  when the compiler targets them. Define OSWRAPPER_AUDIO_NO_SIMD to only use plain C.
+- With the portable and miniaudio decoders, files loaded from a path are memory mapped if possible.
+  Define OSWRAPPER_AUDIO_NO_MMAP to always read the whole file into memory instead.
 
 The latest version of this file can be found at
 https://github.com/NeRdTheNed/OSWrapper/blob/main/oswrapper_audio.h
@@ -106,12 +179,10 @@ https://github.com/NeRdTheNed/OSWrapper/blob/main/oswrapper_audio.h
 #define OSWRAPPER_AUDIO_RESULT_FAILURE 0
 #endif
 
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
-/* Unstable-ish API */
+/* The type used for positions and lengths in frames */
 #ifndef OSWRAPPER_AUDIO_SEEK_TYPE
 #define OSWRAPPER_AUDIO_SEEK_TYPE long long
 #endif
-#endif /* OSWRAPPER_AUDIO_EXPERIMENTAL */
 
 /* Stable-ish API */
 
@@ -129,6 +200,43 @@ typedef enum {
     OSWRAPPER_AUDIO_ENDIANNESS_BIG
 } OSWrapper_audio_endianness_type;
 
+/* How audio is resampled when the hinted sample rate is different to the sample rate of the file.
+Higher quality resampling is slower. Only used by the portable and miniaudio decoders. */
+typedef enum {
+    OSWRAPPER_AUDIO_RESAMPLE_QUALITY_DEFAULT = 0,
+    /* Linear interpolation. Fast, but aliases when downsampling. */
+    OSWRAPPER_AUDIO_RESAMPLE_QUALITY_LINEAR,
+    /* Short windowed sinc filter (the default) */
+    OSWRAPPER_AUDIO_RESAMPLE_QUALITY_MEDIUM,
+    /* Long windowed sinc filter */
+    OSWRAPPER_AUDIO_RESAMPLE_QUALITY_HIGH
+} OSWrapper_audio_resample_quality;
+
+/* A custom matrix for remixing the channels of the audio, for OSWrapper_audio_spec.channel_matrix.
+Each output channel is the sum of every input channel multiplied by its coefficient. */
+typedef struct OSWrapper_audio_channel_matrix {
+    /* Must be the same as the channel count of the file */
+    unsigned int input_channel_count;
+    unsigned int output_channel_count;
+    /* A row of input_channel_count coefficients for each output channel */
+    const float* coefficients;
+} OSWrapper_audio_channel_matrix;
+
+/* A custom allocator for an audio context, for OSWrapper_audio_spec.allocator.
+Every function is called with user_data as the last argument. */
+typedef struct OSWrapper_audio_allocator {
+    /* Allocate size bytes, aligned to at least alignment bytes. Returns NULL on failure. */
+    void* (*alloc_func)(size_t size, size_t alignment, void* user_data);
+    /* Resize an allocation, keeping its contents. Returns NULL on failure, in which case ptr must stay valid.
+    Can be NULL, in which case alloc_func and free_func are used instead. */
+    void* (*realloc_func)(void* ptr, size_t old_size, size_t new_size, size_t alignment, void* user_data);
+    /* Free an allocation made with alloc_func or realloc_func. Never called with NULL. */
+    void (*free_func)(void* ptr, void* user_data);
+    void* user_data;
+    /* The alignment passed to alloc_func and realloc_func, or 0 to use 16 bytes */
+    size_t alignment;
+} OSWrapper_audio_allocator;
+
 /* The created audio context.
 The values can be set before creating an audio context
 with the oswrapper_audio_load_from_ functions,
@@ -143,8 +251,62 @@ typedef struct OSWrapper_audio_spec {
     unsigned int bits_per_channel;
     OSWrapper_audio_type audio_type;
     OSWrapper_audio_endianness_type endianness_type;
+    OSWrapper_audio_resample_quality resample_quality;
+    /* If set, the channels are remixed with this matrix, instead of the standard matrix for the hinted channel count.
+    Only supported by the portable and miniaudio decoders. The matrix is copied once the output format is chosen,
+    which for oswrapper_audio_load_push is when the header has been received. */
+    const OSWrapper_audio_channel_matrix* channel_matrix;
+    /* If set, memory for the audio context is allocated with this allocator, instead of OSWRAPPER_AUDIO_MALLOC and OSWRAPPER_AUDIO_FREE.
+    This includes internal_data, decoding buffers, and the decoding context of the miniaudio decoder,
+    but not memory allocated by OS decoders. It's also used by oswrapper_audio_decode_all, OSWrapper_audio_stream, and oswrapper_audio_decode_batch,
+    which calls it from several threads at once. The allocator must stay valid until the audio context is freed. */
+    const OSWrapper_audio_allocator* allocator;
 } OSWrapper_audio_spec;
 
+/* How accurate the length returned by oswrapper_audio_get_length is. */
+typedef enum {
+    OSWRAPPER_AUDIO_LENGTH_UNKNOWN = 0,
+    OSWRAPPER_AUDIO_LENGTH_EXACT,
+    OSWRAPPER_AUDIO_LENGTH_ESTIMATED
+} OSWrapper_audio_length_type;
+
+/* Information about an audio file, as returned by oswrapper_audio_probe.
+This describes how the audio is stored in the file,
+which may not be the same as the format it would be decoded to. */
+typedef struct OSWrapper_audio_info {
+    unsigned long sample_rate;
+    unsigned int channel_count;
+    /* 0 if the audio is compressed */
+    unsigned int bits_per_channel;
+    OSWrapper_audio_type audio_type;
+    OSWrapper_audio_endianness_type endianness_type;
+    /* The total amount of frames, or -1 if this isn't known */
+    OSWRAPPER_AUDIO_SEEK_TYPE total_frames;
+} OSWrapper_audio_info;
+
+/* A buffer to write decoded audio to, used by oswrapper_audio_get_samples_iov.
+frames is the amount of frames the buffer has space for. */
+typedef struct OSWrapper_audio_iovec {
+    void* buffer;
+    size_t frames;
+} OSWrapper_audio_iovec;
+
+/* Where to seek from, for OSWrapper_audio_seek_callback. */
+typedef enum {
+    OSWRAPPER_AUDIO_SEEK_ORIGIN_START = 0,
+    OSWRAPPER_AUDIO_SEEK_ORIGIN_CURRENT,
+    OSWRAPPER_AUDIO_SEEK_ORIGIN_END
+} OSWrapper_audio_seek_origin;
+
+/* Callbacks for reading a sound file from a custom source, used by oswrapper_audio_load_from_callbacks.
+user_data is the pointer passed to oswrapper_audio_load_from_callbacks.
+The read callback reads up to bytes_to_read bytes into buffer, and returns the amount of bytes read (0 at the end of the file).
+The seek callback seeks to the given offset in bytes relative to the origin, and returns 1 on success, or 0 on failure.
+The tell callback returns the current offset in bytes from the start of the file, or -1 on failure. */
+typedef size_t (*OSWrapper_audio_read_callback)(void* user_data, void* buffer, size_t bytes_to_read);
+typedef OSWRAPPER_AUDIO_RESULT_TYPE (*OSWrapper_audio_seek_callback)(void* user_data, OSWRAPPER_AUDIO_SEEK_TYPE offset, OSWrapper_audio_seek_origin origin);
+typedef OSWRAPPER_AUDIO_SEEK_TYPE (*OSWrapper_audio_tell_callback)(void* user_data);
+
 /* Call oswrapper_audio_init() before using the library,
 and call oswrapper_audio_uninit() after you're done using the library. */
 OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void);
@@ -163,6 +325,26 @@ The initialised audio context is returned in the passed OSWrapper_audio_spec,
 which will also contain information about the output format (channels, sample rate etc.)
 Returns 1 on success, or 0 on failure. */
 OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio);
+/* Get the most storage oswrapper_audio_load_from_memory_inplace can need with the given hints,
+for any sound file with at most max_channel_count channels and a sample rate of at most max_sample_rate
+(or any sample rate if max_sample_rate is 0). This includes everything needed to decode the audio,
+except the index of the sample tables of M4A files, which depends on how many packets the file has,
+so use oswrapper_audio_context_size_from_memory for M4A files.
+Returns 0 if the size can't be known ahead of time, which is the case for every decoder except the portable decoder. */
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size(const OSWrapper_audio_spec* hints, unsigned int max_channel_count, unsigned long max_sample_rate);
+/* Get the most storage oswrapper_audio_load_from_memory_inplace can need to load the given sound file with the given hints.
+This only reads the header, and includes the index of the sample tables of M4A files.
+Returns 0 if the file can't be decoded, or if the size can't be known ahead of time (see oswrapper_audio_context_size). */
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size_from_memory(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints);
+/* Load a sound file from memory, like oswrapper_audio_load_from_memory,
+but allocate the audio context in the given storage instead of allocating memory.
+The allocator member of the passed OSWrapper_audio_spec is set to use the storage,
+so the storage must stay valid until after you call oswrapper_audio_free_context, after which it can be used again.
+The storage doesn't need to be aligned. Use oswrapper_audio_context_size to find how much storage is needed.
+The portable decoder never allocates memory when loading or decoding an audio context created this way.
+The miniaudio decoder also uses the storage, but the OS decoders still allocate memory of their own.
+Returns 1 on success, or 0 on failure (including if the storage is too small). */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory_inplace(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio, void* storage, size_t storage_size);
 #ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
 /* Load a sound file from the given path.
 You can set the values on the passed OSWrapper_audio_spec,
@@ -172,20 +354,207 @@ which will also contain information about the output format (channels, sample ra
 Returns 1 on success, or 0 on failure. */
 OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio);
 #endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+/* Load a sound file which is read through the given callbacks.
+The source must be seekable. The callbacks and user_data must stay valid until after you call oswrapper_audio_free_context,
+and the file is read from as audio is decoded, so only the decoder's working set is kept in memory.
+The Media Foundation decoder reads through an IStream which wraps the callbacks, so they may be called from Media Foundation's own threads,
+although never from more than one thread at a time.
+You can set the values on the passed OSWrapper_audio_spec,
+which will be treated as hints for choosing the output format for decoding.
+Returns 1 on success, or 0 on failure. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_callbacks(OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data, OSWrapper_audio_spec* audio);
+
+/* Returned by oswrapper_audio_get_samples for an audio context created with oswrapper_audio_load_push,
+when no more audio can be decoded until more data is pushed. */
+#define OSWRAPPER_AUDIO_NEED_MORE_DATA ((size_t) -1)
+
+/* Create an audio context for a sound file which is received in pieces (e.g. over a network).
+Pass the data to it as it arrives with oswrapper_audio_push_bytes,
+and call oswrapper_audio_push_end after the last piece.
+Decoding can start as soon as the header has been received.
+The sample_rate of the passed OSWrapper_audio_spec is set to 0 until then,
+after which it contains information about the output format as usual.
+oswrapper_audio_get_samples returns OSWRAPPER_AUDIO_NEED_MORE_DATA when it's waiting for more data.
+Audio which has already been decoded is discarded, so you can only seek within audio which hasn't been decoded yet.
+Currently only supported by the portable decoder.
+Returns 1 on success, or 0 on failure. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_push(OSWrapper_audio_spec* audio);
+/* Pass the next piece of a sound file to an audio context created with oswrapper_audio_load_push.
+The data is copied, so it doesn't need to stay valid after this returns.
+Returns 1 on success, or 0 on failure (e.g. if the header isn't valid). */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_push_bytes(OSWrapper_audio_spec* audio, const unsigned char* data, size_t data_size);
+/* Mark the end of the data for an audio context created with oswrapper_audio_load_push.
+oswrapper_audio_get_samples returns 0 instead of OSWRAPPER_AUDIO_NEED_MORE_DATA after all audio has been decoded. */
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_push_end(OSWrapper_audio_spec* audio);
+
+/* Read information about a sound file in memory, without creating an audio context.
+Only the container header is parsed, so this is much cheaper than loading the file.
+If the format isn't understood by the header parser,
+the file is loaded with the platform decoder instead, and total_frames is set to -1.
+Returns 1 on success, or 0 on failure. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_probe(const unsigned char* data, size_t data_size, OSWrapper_audio_info* info);
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+/* Read information about the sound file at the given path, without creating an audio context.
+Only the parts of the file containing the header are read.
+Returns 1 on success, or 0 on failure. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_probe_path(const char* path, OSWrapper_audio_info* info);
+#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+/* Read information about a sound file which is read through the given callbacks, without creating an audio context.
+See oswrapper_audio_load_from_callbacks for the requirements of the callbacks.
+Returns 1 on success, or 0 on failure. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_probe_callbacks(OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data, OSWrapper_audio_info* info);
 
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
-/* Unstable-ish API */
-/* Sets the value pointed to by pos to the current position.
+/* Sets the value pointed to by frames to the total length of the audio context,
+in frames of the output format (so the same unit oswrapper_audio_get_samples uses).
+The length is exact for PCM containers and lossless formats which store it,
+and is an estimate for formats like VBR MP3 where it can only be guessed from the header.
+Returns OSWRAPPER_AUDIO_LENGTH_EXACT or OSWRAPPER_AUDIO_LENGTH_ESTIMATED on success,
+or OSWRAPPER_AUDIO_LENGTH_UNKNOWN (0) if the length isn't known. */
+OSWRAPPER_AUDIO_DEF OSWrapper_audio_length_type oswrapper_audio_get_length(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* frames);
+
+/* Sets the value pointed to by pos to the current position, in frames of the output format.
 Returns 1 on success, or 0 on failure. */
 OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos);
-/* Seek to the given position. */
-OSWRAPPER_AUDIO_DEF void oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos);
-#endif /* OSWRAPPER_AUDIO_EXPERIMENTAL */
+/* Seek to the given position, in frames of the output format.
+Seeking in uncompressed audio is done in constant time.
+Compressed audio may be decoded from the nearest seek point,
+which may be found by scanning the file the first time you seek.
+Returns 1 on success, or 0 on failure. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos);
 /* Seek to the start of the audio context. */
 OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio);
 
-/* Write decoded audio samples to the given buffer. The return value is the amount of samples written. */
+/* Write decoded audio samples to the given buffer. The return value is the amount of samples written,
+or OSWRAPPER_AUDIO_NEED_MORE_DATA for an audio context created with oswrapper_audio_load_push. */
 OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do);
+/* Write decoded audio samples to a separate buffer for each channel, instead of interleaving them.
+channels is an array of channel_count pointers, each to a buffer with space for frames_to_do samples in the output format.
+The audio is decoded in small pieces, which are split into the channel buffers while they're still in the cache.
+Returns the same as oswrapper_audio_get_samples. */
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples_planar(OSWrapper_audio_spec* audio, void** channels, size_t frames_to_do);
+/* Write decoded audio samples to each of the given buffers in turn, such as both halves of a ring buffer that wraps around.
+The audio is decoded straight into each buffer, without copying it from a temporary buffer.
+Returns the total amount of frames written, which is less than the total size of the buffers at the end of the audio,
+or OSWRAPPER_AUDIO_NEED_MORE_DATA if no frames could be written yet for an audio context created with oswrapper_audio_load_push. */
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples_iov(OSWrapper_audio_spec* audio, const OSWrapper_audio_iovec* iov, int count);
+/* Fully decode a sound file in memory, without creating an audio context which needs to be freed.
+You can set the values on the passed OSWrapper_audio_spec,
+which will be treated as hints for choosing the output format for decoding,
+and are set to the output format's values after decoding (internal_data is set to NULL).
+The value pointed to by pcm is set to the decoded audio, which must be freed with oswrapper_audio_free_pcm,
+and the value pointed to by frames is set to the amount of frames decoded.
+When the exact length is known, the decoded audio is allocated once and decoded into in one go.
+With OSWRAPPER_AUDIO_USE_THREADS, long files which can be decoded in pieces (currently FLAC and ALAC files with the portable decoder,
+when they aren't resampled) are split into pieces which are decoded at the same time by one thread per CPU core.
+Each piece has its own audio context, which is loaded and freed on the calling thread.
+Returns 1 on success, or 0 on failure, in which case the value pointed to by pcm is set to NULL. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_decode_all(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio, void** pcm, size_t* frames);
+/* Free the decoded audio from oswrapper_audio_decode_all, with the audio spec it was decoded with. */
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_free_pcm(const OSWrapper_audio_spec* audio, void* pcm);
+/* Get a read-only pointer to the next decoded audio samples, without copying them.
+This is possible when the decoder already has a block of samples in the output format,
+such as uncompressed audio loaded from memory or a path by the portable decoder,
+when it doesn't need to be converted, resampled, or remixed.
+The value pointed to by samples is set to the start of the block, aligned for the output sample type,
+and the value pointed to by frames is set to the amount of frames in it (0 at the end of the audio).
+The samples stay valid until the next call to any other function with this audio context.
+They aren't consumed, so call oswrapper_audio_consume after using them.
+Returns 1 on success, or 0 if the samples can't be accessed without copying them,
+in which case oswrapper_audio_get_samples should be used instead. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_peek_samples(OSWrapper_audio_spec* audio, const void** samples, size_t* frames);
+/* Skip the given amount of frames, usually ones returned by oswrapper_audio_peek_samples.
+Skipping past the end of the audio stops at the end with the portable decoder.
+Returns 1 on success, or 0 on failure. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_consume(OSWrapper_audio_spec* audio, size_t frames);
+
+#ifdef OSWRAPPER_AUDIO_USE_THREADS
+/* A stream decodes an audio context ahead of time on a worker thread,
+into a ring buffer which can be read from a real-time audio thread.
+The audio context must not be used by anything else until the stream is destroyed. */
+typedef struct OSWrapper_audio_stream OSWrapper_audio_stream;
+
+/* Information about a stream, filled by oswrapper_audio_stream_get_stats. */
+typedef struct OSWrapper_audio_stream_stats {
+    /* Frames which have been decoded but not read yet */
+    size_t buffered_frames;
+    /* The size of the ring buffer, in frames */
+    size_t buffer_frames;
+    /* How many times oswrapper_audio_stream_read couldn't read every requested frame before the end of the audio */
+    unsigned long underruns;
+    /* 1 once every frame has been read, which never happens when looping */
+    OSWRAPPER_AUDIO_RESULT_TYPE ended;
+} OSWrapper_audio_stream_stats;
+
+/* Create a stream which decodes the given audio context on a worker thread.
+The ring buffer holds at least buffer_frames frames in the output format.
+If loop is set, the audio is rewound whenever it ends.
+Returns NULL on failure. */
+OSWRAPPER_AUDIO_DEF OSWrapper_audio_stream* oswrapper_audio_stream_create(OSWrapper_audio_spec* audio, size_t buffer_frames, OSWRAPPER_AUDIO_RESULT_TYPE loop);
+/* Stop the worker thread, and free the stream. The audio context isn't freed. */
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_stream_destroy(OSWrapper_audio_stream* stream);
+/* Copy up to frames decoded frames to the given buffer, and return the amount of frames copied.
+This never allocates, locks, or waits for the worker thread, so it's safe to call from a real-time audio thread.
+Only one thread can read from a stream. Any frames which aren't available yet are counted as an underrun,
+and the rest of the buffer should be filled with silence. */
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_stream_read(OSWrapper_audio_stream* stream, void* buffer, size_t frames);
+/* Fill the given struct with the current buffer fill level and underrun count. Safe to call from any thread. */
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_stream_get_stats(OSWrapper_audio_stream* stream, OSWrapper_audio_stream_stats* stats);
+/* Ask the worker thread to seek to the given position, in frames of the output format.
+Frames which were decoded before the seek are discarded, and no frames are read until the worker has seeked. */
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_stream_seek(OSWrapper_audio_stream* stream, OSWRAPPER_AUDIO_SEEK_TYPE pos);
+/* Set whether the audio is rewound whenever it ends. */
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_stream_set_loop(OSWrapper_audio_stream* stream, OSWRAPPER_AUDIO_RESULT_TYPE loop);
+
+/* The result of decoding one file with oswrapper_audio_decode_batch. */
+typedef struct OSWrapper_audio_batch_result {
+    /* The output format. internal_data is always NULL. */
+    OSWrapper_audio_spec spec;
+    /* The decoded audio, which is inside the allocation shared by every result */
+    void* samples;
+    /* The amount of frames decoded */
+    size_t frames;
+    /* 1 if the file was decoded, or 0 if it couldn't be decoded */
+    OSWRAPPER_AUDIO_RESULT_TYPE decoded;
+} OSWrapper_audio_batch_result;
+
+/* Fully decode each of the count files at the given paths, using the given number of threads
+(or one thread per CPU core if threads is 0). Each thread uses its own audio contexts.
+Long files which can be decoded in pieces (like with oswrapper_audio_decode_all) are split between the threads,
+so even a single file is decoded by every thread.
+The values in spec_hint are used as hints for the output format of every file, like with oswrapper_audio_load_from_path.
+The decoded audio of every file is stored in one allocation, which is freed with oswrapper_audio_free_batch.
+results must have room for count results, and is filled in the same order as paths.
+Returns 1 if every file was decoded, or 0 if any file couldn't be decoded.
+If the allocation fails, every result's samples member is NULL. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_decode_batch(const char* const* paths, size_t count, const OSWrapper_audio_spec* spec_hint, OSWrapper_audio_batch_result* results, unsigned int threads);
+/* Free the decoded audio from oswrapper_audio_decode_batch. */
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_free_batch(OSWrapper_audio_batch_result* results, size_t count);
+#endif /* OSWRAPPER_AUDIO_USE_THREADS */
+
+#ifdef OSWRAPPER_AUDIO_USE_MINIAUDIO_DATA_SOURCE
+#ifndef miniaudio_h
+#include "miniaudio.h"
+#endif
+
+/* A miniaudio data source which reads from an audio context,
+so it can be used with ma_data_source_read_pcm_frames, ma_sound_init_from_data_source, and so on.
+miniaudio reads decoded frames straight into its own buffers, and handles looping by seeking the audio context. */
+typedef struct OSWrapper_audio_ma_data_source {
+    /* Must be the first member */
+    ma_data_source_base base;
+    OSWrapper_audio_spec* audio;
+    ma_format format;
+} OSWrapper_audio_ma_data_source;
+
+/* Initialise a miniaudio data source which reads from the given audio context.
+The output format must be 16, 24, or 32 bit integer PCM, or 32 bit floating point PCM, in the system byte order,
+so hint one of these when creating the audio context.
+The audio context must not be used by anything else until the data source is uninitialised.
+Returns 1 on success, or 0 on failure. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_ma_data_source_init(OSWrapper_audio_spec* audio, OSWrapper_audio_ma_data_source* data_source);
+/* Uninitialise a miniaudio data source. The audio context isn't freed. */
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_ma_data_source_uninit(OSWrapper_audio_ma_data_source* data_source);
+#endif /* OSWRAPPER_AUDIO_USE_MINIAUDIO_DATA_SOURCE */
 
 #ifdef OSWRAPPER_AUDIO_IMPLEMENTATION
 #ifndef OSWRAPPER_AUDIO_NO_INCLUDE_STDLIB
@@ -204,10 +573,88 @@ OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* aud
 #ifndef OSWRAPPER_AUDIO_MEMCPY
 #define OSWRAPPER_AUDIO_MEMCPY(x, y, amount) memcpy(x, y, amount)
 #endif /* OSWRAPPER_AUDIO_MEMCPY */
+#ifndef OSWRAPPER_AUDIO_MEMMOVE
+#define OSWRAPPER_AUDIO_MEMMOVE(x, y, amount) memmove(x, y, amount)
+#endif /* OSWRAPPER_AUDIO_MEMMOVE */
 #ifndef OSWRAPPER_AUDIO_MEMCMP
 #define OSWRAPPER_AUDIO_MEMCMP(ptr1, ptr2, amount) memcmp(ptr1, ptr2, amount)
 #endif /* OSWRAPPER_AUDIO_MEMCMP */
 
+/* Memory for an audio context is allocated with its allocator if it has one,
+otherwise OSWRAPPER_AUDIO_MALLOC and OSWRAPPER_AUDIO_FREE are used */
+#define OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT 16
+
+static void* oswrapper_audio__malloc(const OSWrapper_audio_allocator* allocator, size_t size) {
+    if (allocator != NULL) {
+        return allocator->alloc_func(size, allocator->alignment != 0 ? allocator->alignment : OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT, allocator->user_data);
+    }
+
+    return OSWRAPPER_AUDIO_MALLOC(size);
+}
+
+static void oswrapper_audio__free(const OSWrapper_audio_allocator* allocator, void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    if (allocator != NULL) {
+        allocator->free_func(ptr, allocator->user_data);
+    } else {
+        OSWRAPPER_AUDIO_FREE(ptr);
+    }
+}
+
+/* Resize an allocation, keeping the first old_size bytes. Returns NULL on failure, in which case ptr is still valid. */
+static void* oswrapper_audio__realloc(const OSWrapper_audio_allocator* allocator, void* ptr, size_t old_size, size_t new_size) {
+    void* new_ptr;
+
+    if (allocator != NULL && allocator->realloc_func != NULL) {
+        return allocator->realloc_func(ptr, old_size, new_size, allocator->alignment != 0 ? allocator->alignment : OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT, allocator->user_data);
+    }
+
+    new_ptr = oswrapper_audio__malloc(allocator, new_size);
+
+    if (new_ptr != NULL && ptr != NULL) {
+        OSWRAPPER_AUDIO_MEMCPY(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        oswrapper_audio__free(allocator, ptr);
+    }
+
+    return new_ptr;
+}
+
+/* Caller provided storage for oswrapper_audio_load_from_memory_inplace.
+This is stored at the start of the storage, and the audio context's allocator hands out the memory after it.
+Nothing is freed until the audio context is freed, after which the storage can be used again. */
+typedef struct oswrapper_audio__storage {
+    OSWrapper_audio_allocator allocator;
+    unsigned char* next;
+    unsigned char* end;
+} oswrapper_audio__storage;
+
+/* The most storage which can be lost to aligning the storage, and each of the given amount of allocations */
+#define OSWRAPPER_AUDIO__STORAGE_OVERHEAD(allocations) (sizeof(oswrapper_audio__storage) + (OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT - 1) * ((allocations) + 1))
+
+static void* oswrapper_audio__storage_alloc(size_t size, size_t alignment, void* user_data) {
+    oswrapper_audio__storage* storage = (oswrapper_audio__storage*) user_data;
+    size_t padding = (alignment - ((size_t) storage->next % alignment)) % alignment;
+    unsigned char* ptr;
+
+    if (padding > (size_t) (storage->end - storage->next) || size > (size_t) (storage->end - storage->next) - padding) {
+        return NULL;
+    }
+
+    ptr = storage->next + padding;
+    storage->next = ptr + size;
+    return ptr;
+}
+
+static void oswrapper_audio__storage_free(void* ptr, void* user_data) {
+    (void) ptr;
+    (void) user_data;
+}
+
+/* The miniaudio implementation is opt-in, and replaces the OS audio decoders */
+#ifndef OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL
 #ifdef __APPLE__
 #include <AvailabilityMacros.h>
 #if defined(MAC_OS_X_VERSION_10_4) && MAC_OS_X_VERSION_MIN_REQUIRED >= MAC_OS_X_VERSION_10_4
@@ -223,199 +670,2812 @@ OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* aud
 #endif /* !defined(OSWRAPPER_AUDIO_USE_WIN_MF_IMPL) && !defined(OSWRAPPER_AUDIO_NO_USE_WIN_MF_IMPL) */
 #endif
 
-#ifdef OSWRAPPER_AUDIO_USE_AUDIOTOOLBOX_IMPL
-/* Start macOS AudioToolbox implementation */
-#include <AudioToolbox/AudioConverter.h>
-#if !defined(MAC_OS_X_VERSION_10_6) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_6
-#include <CoreServices/CoreServices.h>
-#endif
-#include <AudioToolbox/ExtendedAudioFile.h>
-
-#include <AvailabilityMacros.h>
+/* Use the built in decoders if there are no OS audio decoders available */
+#if !defined(OSWRAPPER_AUDIO_USE_AUDIOTOOLBOX_IMPL) && !defined(OSWRAPPER_AUDIO_USE_WIN_MF_IMPL)
+#if !defined(OSWRAPPER_AUDIO_USE_PORTABLE_IMPL) && !defined(OSWRAPPER_AUDIO_NO_USE_PORTABLE_IMPL)
+#define OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+#endif /* !defined(OSWRAPPER_AUDIO_USE_PORTABLE_IMPL) && !defined(OSWRAPPER_AUDIO_NO_USE_PORTABLE_IMPL) */
+#endif /* !defined(OSWRAPPER_AUDIO_USE_AUDIOTOOLBOX_IMPL) && !defined(OSWRAPPER_AUDIO_USE_WIN_MF_IMPL) */
+#endif /* OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL */
 
-#if (!defined(MAC_OS_X_VERSION_10_6) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_6) && !defined(kAudioFileReadPermission)
-#define kAudioFileReadPermission 0x01
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+/* Start shared file access */
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+#ifndef COBJMACROS
+#define COBJMACROS
 #endif
-
-#if (!defined(MAC_OS_X_VERSION_10_13) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_13) && !defined(kAudioFormatFLAC)
-#define kAudioFormatFLAC 'flac'
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
 #endif
+#include <windows.h>
 
-typedef struct oswrapper_audio__callback_data_mac {
-    size_t data_size;
-    const unsigned char* data;
-} oswrapper_audio__callback_data_mac;
+/* TODO Ugly hack */
+#ifndef OSWRAPPER_AUDIO_PATH_MAX
+#define OSWRAPPER_AUDIO_PATH_MAX MAX_PATH
+#endif
 
-typedef struct oswrapper_audio__internal_data_mac {
-    AudioFileID audio_file;
-    ExtAudioFileRef audio_file_ext;
-    oswrapper_audio__callback_data_mac* callback_data;
-} oswrapper_audio__internal_data_mac;
+#define OSWRAPPER_AUDIO__FILE_TYPE HANDLE
+#define OSWRAPPER_AUDIO__INVALID_FILE INVALID_HANDLE_VALUE
+#elif defined(__unix__) || defined(__unix) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+
+#define OSWRAPPER_AUDIO__FILE_POSIX
+#define OSWRAPPER_AUDIO__FILE_TYPE int
+#define OSWRAPPER_AUDIO__INVALID_FILE -1
+
+/* off_t can be 32 bits on 32 bit Linux, depending on how the including file was compiled,
+so the explicit 64 bit functions are used there */
+#if defined(__GLIBC__)
+/* glibc only declares lseek64 with _LARGEFILE64_SOURCE, but always has it */
+__BEGIN_DECLS
+extern __off64_t lseek64(int, __off64_t, int) __THROW;
+__END_DECLS
+#define OSWRAPPER_AUDIO__OPEN_FLAGS (O_RDONLY | __O_LARGEFILE)
+#define OSWRAPPER_AUDIO__OFF_T __off64_t
+#define OSWRAPPER_AUDIO__LSEEK lseek64
+#elif defined(__ANDROID__)
+#define OSWRAPPER_AUDIO__OPEN_FLAGS (O_RDONLY | O_LARGEFILE)
+#define OSWRAPPER_AUDIO__OFF_T off64_t
+#define OSWRAPPER_AUDIO__LSEEK lseek64
+#else
+/* off_t is always 64 bits on other platforms */
+#define OSWRAPPER_AUDIO__OPEN_FLAGS O_RDONLY
+#define OSWRAPPER_AUDIO__OFF_T off_t
+#define OSWRAPPER_AUDIO__LSEEK lseek
+#endif
+#else
+#include <stdio.h>
 
-static OSStatus oswrapper_audio__audio_file_read_callback(void* inClientData, SInt64 inPosition, UInt32 requestCount, void* buffer, UInt32* actualCount) {
-    size_t bytes_read;
-    oswrapper_audio__callback_data_mac* callback_data = (oswrapper_audio__callback_data_mac*) inClientData;
+#define OSWRAPPER_AUDIO__FILE_TYPE FILE*
+#define OSWRAPPER_AUDIO__INVALID_FILE NULL
+#endif
 
-    if (inPosition < (SInt64) callback_data->data_size) {
-        size_t bytes_available = callback_data->data_size - inPosition;
-        bytes_read = requestCount <= bytes_available ? requestCount : bytes_available;
-        OSWRAPPER_AUDIO_MEMCPY((buffer), (callback_data->data + inPosition), (bytes_read));
-    } else {
-        bytes_read = 0;
-    }
+/* File functions which avoid the C runtime on Windows, and use 64 bit offsets on POSIX platforms */
+static OSWRAPPER_AUDIO__FILE_TYPE oswrapper_audio__file_open(const char* path) {
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    /* TODO Ugly hack */
+    wchar_t path_buffer[OSWRAPPER_AUDIO_PATH_MAX];
 
-    if (actualCount != NULL) {
-        *actualCount = bytes_read;
+    if (MultiByteToWideChar(CP_UTF8, 0, path, -1, path_buffer, OSWRAPPER_AUDIO_PATH_MAX) == 0) {
+        return INVALID_HANDLE_VALUE;
     }
 
-    return 0;
+    return CreateFileW(path_buffer, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#elif defined(OSWRAPPER_AUDIO__FILE_POSIX)
+    return open(path, OSWRAPPER_AUDIO__OPEN_FLAGS);
+#else
+    return fopen(path, "rb");
+#endif
 }
 
-static SInt64 oswrapper_audio__audio_file_get_size_callback(void* inClientData) {
-    oswrapper_audio__callback_data_mac* callback_data = (oswrapper_audio__callback_data_mac*) inClientData;
-    return callback_data->data_size;
+static void oswrapper_audio__file_close(OSWRAPPER_AUDIO__FILE_TYPE file) {
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    CloseHandle(file);
+#elif defined(OSWRAPPER_AUDIO__FILE_POSIX)
+    close(file);
+#else
+    fclose(file);
+#endif
 }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void) {
-    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
-}
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__file_get_size(OSWRAPPER_AUDIO__FILE_TYPE file, unsigned long long* size) {
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    LARGE_INTEGER file_size;
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_uninit(void) {
-    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
-}
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart >= 0) {
+        *size = (unsigned long long) file_size.QuadPart;
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_free_context(OSWrapper_audio_spec* audio) {
-    OSStatus error;
-    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
-    error = ExtAudioFileDispose(internal_data->audio_file_ext);
+#elif defined(OSWRAPPER_AUDIO__FILE_POSIX)
+    /* fstat fails for large files when off_t is 32 bits */
+    OSWRAPPER_AUDIO__OFF_T file_size = OSWRAPPER_AUDIO__LSEEK(file, 0, SEEK_END);
 
-    if (!error) {
-        error = AudioFileClose(internal_data->audio_file);
+    if (file_size >= 0) {
+        *size = (unsigned long long) file_size;
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
 
-        if (!error) {
-            /* callback_data is only used for in-memory decoding, so this is expected to be NULL when decoding files. */
-#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
-            if (internal_data->callback_data != NULL)
-#endif
-            {
-                OSWRAPPER_AUDIO_FREE(internal_data->callback_data);
-            }
+#else
+    long file_size;
 
-            OSWRAPPER_AUDIO_FREE(audio->internal_data);
-            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
-        }
+    if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) >= 0) {
+        *size = (unsigned long long) file_size;
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
     }
 
+#endif
     return OSWRAPPER_AUDIO_RESULT_FAILURE;
 }
 
-static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__load_from_open(AudioFileID audio_file, oswrapper_audio__callback_data_mac* callback_data, OSWrapper_audio_spec* audio) {
-    OSStatus error;
-    ExtAudioFileRef audio_file_ext;
-    error = ExtAudioFileWrapAudioFileID(audio_file, false, &audio_file_ext);
+/* Read up to size bytes from the given offset. Returns the amount of bytes read. */
+static size_t oswrapper_audio__file_read_at(OSWRAPPER_AUDIO__FILE_TYPE file, unsigned long long offset, void* buffer, size_t size) {
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    LARGE_INTEGER file_offset;
+    size_t bytes_read = 0;
+    file_offset.QuadPart = (LONGLONG) offset;
+
+    if (SetFilePointerEx(file, file_offset, NULL, FILE_BEGIN)) {
+        /* ReadFile can only read up to 4GB at once */
+        while (bytes_read < size) {
+            DWORD to_read = (size - bytes_read) > 0x40000000 ? 0x40000000 : (DWORD) (size - bytes_read);
+            DWORD read_this_time = 0;
+
+            if (!ReadFile(file, (unsigned char*) buffer + bytes_read, to_read, &read_this_time, NULL) || read_this_time == 0) {
+                break;
+            }
 
-    if (!error) {
-        AudioStreamBasicDescription input_file_format;
-        UInt32 property_size = sizeof(AudioStreamBasicDescription);
-        error = ExtAudioFileGetProperty(audio_file_ext, kExtAudioFileProperty_FileDataFormat, &property_size, &input_file_format);
+            bytes_read += read_this_time;
+        }
+    }
 
-        if (!error) {
-            AudioStreamBasicDescription output_format;
-            output_format.mFormatID = kAudioFormatLinearPCM;
+    return bytes_read;
+#elif defined(OSWRAPPER_AUDIO__FILE_POSIX)
+    size_t bytes_read = 0;
 
-            /* Use hinted output format */
-            if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
-                output_format.mFormatFlags = kLinearPCMFormatFlagIsFloat;
-            } else if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) {
-                output_format.mFormatFlags = kLinearPCMFormatFlagIsSignedInteger;
-            } else if (input_file_format.mFormatID == kAudioFormatLinearPCM && input_file_format.mFormatFlags & kLinearPCMFormatFlagIsFloat) {
-                output_format.mFormatFlags = kLinearPCMFormatFlagIsFloat;
-            } else {
-                output_format.mFormatFlags = kLinearPCMFormatFlagIsSignedInteger;
+    if (OSWRAPPER_AUDIO__LSEEK(file, (OSWRAPPER_AUDIO__OFF_T) offset, SEEK_SET) != (OSWRAPPER_AUDIO__OFF_T) -1) {
+        /* read can return less than was asked for */
+        while (bytes_read < size) {
+            size_t to_read = (size - bytes_read) > 0x40000000 ? 0x40000000 : size - bytes_read;
+            ssize_t read_this_time = read(file, (unsigned char*) buffer + bytes_read, to_read);
+
+            if (read_this_time <= 0) {
+                break;
             }
 
-            output_format.mFormatFlags |= kLinearPCMFormatFlagIsPacked;
+            bytes_read += (size_t) read_this_time;
+        }
+    }
 
-            /* Use hinted endianness */
-            if (audio->endianness_type == OSWRAPPER_AUDIO_ENDIANNESS_BIG) {
-                output_format.mFormatFlags |= kAudioFormatFlagIsBigEndian;
-            }
+    return bytes_read;
+#else
 
-#if defined(__ppc64__) || defined(__ppc__)
-            else if (audio->endianness_type == OSWRAPPER_AUDIO_ENDIANNESS_USE_SYSTEM_DEFAULT) {
-                output_format.mFormatFlags |= kAudioFormatFlagIsBigEndian;
-            }
+    if (offset > 0x7FFFFFFFUL && sizeof(long) < 8) {
+        return 0;
+    }
+
+    if (fseek(file, (long) offset, SEEK_SET) != 0) {
+        return 0;
+    }
 
+    return fread(buffer, 1, size, file);
 #endif
-            /* Use hinted sample rate */
-            output_format.mSampleRate = audio->sample_rate == 0 ? input_file_format.mSampleRate : audio->sample_rate;
+}
 
-            /* Sanity check */
-            if (output_format.mSampleRate == 0) {
-                output_format.mSampleRate = 44100;
-            }
+#if defined(OSWRAPPER_AUDIO_USE_PORTABLE_IMPL) || defined(OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL)
+/* Start shared file mapping for non-OS implementations */
+#ifndef OSWRAPPER_AUDIO_NO_MMAP
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+#define OSWRAPPER_AUDIO__MMAP_WIN32
+#elif defined(__unix__) || defined(__unix) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OSWRAPPER_AUDIO__MMAP_POSIX
+#endif
+#endif /* OSWRAPPER_AUDIO_NO_MMAP */
 
-            /* Use hinted bits per channel */
-            output_format.mBitsPerChannel = audio->bits_per_channel == 0 ? input_file_format.mBitsPerChannel : audio->bits_per_channel;
+/* The contents of a file, either mapped into memory or read into a buffer */
+typedef struct oswrapper_audio__mapped_file {
+    const unsigned char* data;
+    size_t size;
+    /* Set if the file was read into a buffer instead of being mapped */
+    unsigned char* buffer;
+    const OSWrapper_audio_allocator* allocator;
+} oswrapper_audio__mapped_file;
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__map_file_mmap(const char* path, oswrapper_audio__mapped_file* file) {
+#if defined(OSWRAPPER_AUDIO__MMAP_POSIX)
+    struct stat file_stat;
+    int fd = open(path, O_RDONLY);
+
+    if (fd != -1) {
+        void* mapping = MAP_FAILED;
+
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0 && (unsigned long long) file_stat.st_size <= (size_t) -1) {
+            mapping = mmap(NULL, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
 
-            /* Get bits per channel for ALAC and FLAC files */
-            if ((output_format.mBitsPerChannel == 0) && (input_file_format.mFormatID == kAudioFormatAppleLossless || input_file_format.mFormatID == kAudioFormatFLAC)) {
-                switch (input_file_format.mFormatFlags) {
-                case kAppleLosslessFormatFlag_16BitSourceData:
-                    output_format.mBitsPerChannel = 16;
-                    break;
+        /* The mapping stays valid after the file is closed */
+        close(fd);
 
-                case kAppleLosslessFormatFlag_20BitSourceData:
-                    output_format.mBitsPerChannel = 20;
-                    break;
+        if (mapping != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            /* Audio is generally decoded from start to end. Failure is harmless. */
+            madvise(mapping, (size_t) file_stat.st_size, MADV_SEQUENTIAL);
+#endif
+            file->data = (const unsigned char*) mapping;
+            file->size = (size_t) file_stat.st_size;
+            file->buffer = NULL;
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
 
-                case kAppleLosslessFormatFlag_24BitSourceData:
-                    output_format.mBitsPerChannel = 24;
-                    break;
+#elif defined(OSWRAPPER_AUDIO__MMAP_WIN32)
+    HANDLE file_handle = oswrapper_audio__file_open(path);
 
-                case kAppleLosslessFormatFlag_32BitSourceData:
-                    output_format.mBitsPerChannel = 32;
-                    break;
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        unsigned long long file_size;
+        void* mapping = NULL;
 
-                default:
-                    break;
-                }
-            }
+        if (oswrapper_audio__file_get_size(file_handle, &file_size) && file_size > 0 && file_size <= (size_t) -1) {
+            HANDLE mapping_handle = CreateFileMappingW(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
 
-            /* Sanity check */
-            if (output_format.mBitsPerChannel == 0) {
-                if (output_format.mFormatFlags & kLinearPCMFormatFlagIsFloat) {
-                    output_format.mBitsPerChannel = 32;
-                } else {
-                    output_format.mBitsPerChannel = 16;
-                }
+            if (mapping_handle != NULL) {
+                mapping = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+                /* The view stays valid after the handles are closed */
+                CloseHandle(mapping_handle);
             }
+        }
 
-            /* Use hinted channels */
-            output_format.mChannelsPerFrame = audio->channel_count == 0 ? input_file_format.mChannelsPerFrame : audio->channel_count;
+        CloseHandle(file_handle);
 
-            /* Sanity check */
-            if (output_format.mChannelsPerFrame == 0) {
-                output_format.mChannelsPerFrame = 2;
-            }
+        if (mapping != NULL) {
+            file->data = (const unsigned char*) mapping;
+            file->size = (size_t) file_size;
+            file->buffer = NULL;
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
 
-            /* kAudioFormatLinearPCM doesn't use packets */
-            output_format.mFramesPerPacket = 1;
-            /* Bytes per channel * channels per frame */
-            output_format.mBytesPerFrame = (output_format.mBitsPerChannel / 8) * output_format.mChannelsPerFrame;
-            /* Bytes per frame * frames per packet */
-            output_format.mBytesPerPacket = output_format.mBytesPerFrame * output_format.mFramesPerPacket;
-            error = ExtAudioFileSetProperty(audio_file_ext, kExtAudioFileProperty_ClientDataFormat, sizeof(AudioStreamBasicDescription), &output_format);
+#else
+    (void) path;
+    (void) file;
+#endif
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
 
-            if (!error) {
-                oswrapper_audio__internal_data_mac* internal_data = NULL;
+/* Map the file at the given path into memory, or read it into a buffer allocated with the given allocator if it can't be mapped */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__map_file(const char* path, oswrapper_audio__mapped_file* file, const OSWrapper_audio_allocator* allocator) {
+    OSWRAPPER_AUDIO__FILE_TYPE file_handle;
+    file->allocator = allocator;
 
-                if (input_file_format.mChannelsPerFrame == 1 && output_format.mChannelsPerFrame == 2) {
-                    /* Try to set up appropriate channel mappings */
-                    AudioConverterRef converter = NULL;
-                    property_size = sizeof(AudioConverterRef);
+    if (oswrapper_audio__map_file_mmap(path, file)) {
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
 
-                    if (!ExtAudioFileGetProperty(audio_file_ext, kExtAudioFileProperty_AudioConverter, &property_size, &converter) && converter != NULL) {
+    /* Fall back to reading the whole file */
+    file_handle = oswrapper_audio__file_open(path);
+
+    if (file_handle != OSWRAPPER_AUDIO__INVALID_FILE) {
+        unsigned long long file_size;
+        unsigned char* buffer = NULL;
+
+        if (oswrapper_audio__file_get_size(file_handle, &file_size) && file_size > 0 && file_size <= (size_t) -1) {
+            buffer = (unsigned char*) oswrapper_audio__malloc(allocator, (size_t) file_size);
+
+            if (buffer != NULL && oswrapper_audio__file_read_at(file_handle, 0, buffer, (size_t) file_size) != (size_t) file_size) {
+                oswrapper_audio__free(allocator, buffer);
+                buffer = NULL;
+            }
+        }
+
+        oswrapper_audio__file_close(file_handle);
+
+        if (buffer != NULL) {
+            file->data = buffer;
+            file->size = (size_t) file_size;
+            file->buffer = buffer;
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+static void oswrapper_audio__unmap_file(oswrapper_audio__mapped_file* file) {
+    if (file->buffer != NULL) {
+        oswrapper_audio__free(file->allocator, file->buffer);
+    } else if (file->data != NULL) {
+#if defined(OSWRAPPER_AUDIO__MMAP_POSIX)
+        munmap((void*) file->data, file->size);
+#elif defined(OSWRAPPER_AUDIO__MMAP_WIN32)
+        UnmapViewOfFile(file->data);
+#endif
+    }
+
+    file->data = NULL;
+    file->size = 0;
+    file->buffer = NULL;
+}
+/* End shared file mapping for non-OS implementations */
+#endif /* defined(OSWRAPPER_AUDIO_USE_PORTABLE_IMPL) || defined(OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL) */
+/* End shared file access */
+#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+
+/* Start shared container parsing */
+/* How the audio data is stored in the file */
+typedef enum {
+    OSWRAPPER_AUDIO__CODEC_PCM_INTEGER = 0,
+    OSWRAPPER_AUDIO__CODEC_PCM_UNSIGNED_8,
+    OSWRAPPER_AUDIO__CODEC_PCM_FLOAT,
+    /* G.711 companded 8 bit samples */
+    OSWRAPPER_AUDIO__CODEC_ULAW,
+    OSWRAPPER_AUDIO__CODEC_ALAW,
+    /* Apple IMA4 ADPCM, with a packet of OSWRAPPER_AUDIO__IMA4_FRAMES_PER_PACKET frames for each channel */
+    OSWRAPPER_AUDIO__CODEC_IMA4,
+    /* FLAC, where each frame (packet) has its own size and block size */
+    OSWRAPPER_AUDIO__CODEC_FLAC,
+    /* Apple Lossless in an MP4 container, where each packet has its own size, found from the sample tables */
+    OSWRAPPER_AUDIO__CODEC_ALAC
+} oswrapper_audio__codec;
+
+/* Each Apple IMA4 packet has a 2 byte header, then 4 bit samples */
+#define OSWRAPPER_AUDIO__IMA4_FRAMES_PER_PACKET 64
+#define OSWRAPPER_AUDIO__IMA4_BYTES_PER_CHANNEL 34
+
+/* Where the sample tables of an MP4 track are, which are read when the decoder is created.
+Each offset is the offset of the first entry of the table. */
+typedef struct oswrapper_audio__mp4_tables {
+    /* Time to sample (stts): runs of packets with the same duration */
+    unsigned long long time_offset;
+    unsigned long time_count;
+    /* Sample to chunk (stsc): runs of chunks with the same amount of packets */
+    unsigned long long chunk_map_offset;
+    unsigned long chunk_map_count;
+    /* Sample size (stsz): the size of every packet, or 0 if each packet has its own size */
+    unsigned long long size_offset;
+    unsigned long sample_size;
+    unsigned long packet_count;
+    /* Chunk offset (stco or co64): where each chunk is in the file, as 4 or 8 byte offsets */
+    unsigned long long chunk_offset_offset;
+    unsigned long chunk_count;
+    unsigned int chunk_offset_size;
+    /* Durations in the time to sample table are in this many units per second */
+    unsigned long timescale;
+    /* Adaptive Rice coding parameters from the ALAC specific config */
+    unsigned int history_mult;
+    unsigned int initial_history;
+    unsigned int rice_limit;
+} oswrapper_audio__mp4_tables;
+
+/* Format information parsed from the container header */
+typedef struct oswrapper_audio__source_info {
+    oswrapper_audio__codec codec;
+    unsigned long sample_rate;
+    unsigned int channel_count;
+    unsigned int bits_per_channel;
+    /* The size of each frame, or of each packet for codecs which decode several frames from each packet.
+    0 when each packet has its own size. */
+    size_t bytes_per_frame;
+    /* 1 for PCM. When every packet is the same size, any frame can be found without reading the ones before it.
+    The most frames in a packet when each packet has its own size. */
+    unsigned int frames_per_packet;
+    /* The fewest frames in any packet except the last, the size of the largest packet (0 if unknown),
+    and where the seek table is (seek_point_count is 0 without one). Only set for FLAC. */
+    unsigned int min_frames_per_packet;
+    unsigned long max_packet_size;
+    unsigned long long seek_table_offset;
+    unsigned long seek_point_count;
+    /* Frames decoded from the start of the first packet which aren't part of the audio */
+    unsigned long long priming_frames;
+    /* Set when the samples are stored in big-endian byte order */
+    OSWRAPPER_AUDIO_RESULT_TYPE big_endian;
+    /* Offset of the audio data from the start of the file */
+    unsigned long long data_offset;
+    /* Size of the audio data in bytes */
+    unsigned long long data_size;
+    /* The amount of frames in the audio data */
+    unsigned long long total_frames;
+    /* Only set for ALAC */
+    oswrapper_audio__mp4_tables mp4;
+} oswrapper_audio__source_info;
+
+/* User provided callbacks for reading a file */
+typedef struct oswrapper_audio__callbacks {
+    OSWrapper_audio_read_callback read;
+    OSWrapper_audio_seek_callback seek;
+    OSWrapper_audio_tell_callback tell;
+    void* user_data;
+    /* Total size of the file in bytes */
+    unsigned long long size;
+    /* Current position in the file, used to avoid seeking when reading sequentially */
+    unsigned long long position;
+} oswrapper_audio__callbacks;
+
+/* Used when the position of the file isn't known, so the next read always seeks */
+#define OSWRAPPER_AUDIO__UNKNOWN_POSITION ((unsigned long long) -1)
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__callbacks_init(oswrapper_audio__callbacks* callbacks, OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data) {
+    OSWRAPPER_AUDIO_SEEK_TYPE size;
+
+    if (read == NULL || seek == NULL || tell == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    callbacks->read = read;
+    callbacks->seek = seek;
+    callbacks->tell = tell;
+    callbacks->user_data = user_data;
+
+    /* Get the size of the file by seeking to the end */
+    if (!seek(user_data, 0, OSWRAPPER_AUDIO_SEEK_ORIGIN_END) || (size = tell(user_data)) < 0 || !seek(user_data, 0, OSWRAPPER_AUDIO_SEEK_ORIGIN_START)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    callbacks->size = (unsigned long long) size;
+    callbacks->position = 0;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Read up to size bytes from the given offset. Returns the amount of bytes read. */
+static size_t oswrapper_audio__callbacks_read_at(oswrapper_audio__callbacks* callbacks, unsigned long long offset, void* buffer, size_t size) {
+    size_t bytes_read = 0;
+
+    if (offset != callbacks->position) {
+        if (!callbacks->seek(callbacks->user_data, (OSWRAPPER_AUDIO_SEEK_TYPE) offset, OSWRAPPER_AUDIO_SEEK_ORIGIN_START)) {
+            callbacks->position = OSWRAPPER_AUDIO__UNKNOWN_POSITION;
+            return 0;
+        }
+
+        callbacks->position = offset;
+    }
+
+    while (bytes_read < size) {
+        size_t read_this_time = callbacks->read(callbacks->user_data, (unsigned char*) buffer + bytes_read, size - bytes_read);
+
+        if (read_this_time == 0) {
+            break;
+        }
+
+        bytes_read += read_this_time;
+    }
+
+    callbacks->position += bytes_read;
+    return bytes_read;
+}
+
+/* Container headers are read through a small window,
+so only the parts of the file which are needed are read. */
+#ifndef OSWRAPPER_AUDIO_READER_WINDOW_SIZE
+#define OSWRAPPER_AUDIO_READER_WINDOW_SIZE 4096
+#endif
+
+/* Random access to a file in memory, a file on disk, or a file read through callbacks */
+typedef struct oswrapper_audio__reader {
+    /* Only used when reading from memory, otherwise expected to be NULL */
+    const unsigned char* data;
+    unsigned long long size;
+    /* Only used when reading from callbacks, otherwise expected to be NULL */
+    oswrapper_audio__callbacks* callbacks;
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+    /* Only used when reading from a path, otherwise expected to be OSWRAPPER_AUDIO__INVALID_FILE */
+    OSWRAPPER_AUDIO__FILE_TYPE file;
+#endif
+    /* Holds the part of the file that was last read, when not reading from memory */
+    unsigned char* window;
+    unsigned long long window_offset;
+    size_t window_size;
+    /* Used to allocate the window */
+    const OSWrapper_audio_allocator* allocator;
+    /* Set when only the start of the file has been received so far.
+    Reads past the end then set need_more_data, instead of treating the file as truncated. */
+    OSWRAPPER_AUDIO_RESULT_TYPE streaming;
+    OSWRAPPER_AUDIO_RESULT_TYPE need_more_data;
+} oswrapper_audio__reader;
+
+static void oswrapper_audio__reader_init_memory(oswrapper_audio__reader* reader, const unsigned char* data, size_t data_size) {
+    reader->data = data;
+    reader->size = data_size;
+    reader->callbacks = NULL;
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+    reader->file = OSWRAPPER_AUDIO__INVALID_FILE;
+#endif
+    reader->window = NULL;
+    reader->window_offset = 0;
+    reader->window_size = 0;
+    reader->allocator = NULL;
+    reader->streaming = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    reader->need_more_data = OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+#ifdef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+/* Reads from the start of a file which is still being received */
+static void oswrapper_audio__reader_init_streaming(oswrapper_audio__reader* reader, const unsigned char* data, size_t data_size) {
+    oswrapper_audio__reader_init_memory(reader, data, data_size);
+    reader->streaming = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+#endif
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__reader_init_callbacks(oswrapper_audio__reader* reader, oswrapper_audio__callbacks* callbacks, const OSWrapper_audio_allocator* allocator) {
+    oswrapper_audio__reader_init_memory(reader, NULL, 0);
+    reader->size = callbacks->size;
+    reader->callbacks = callbacks;
+    reader->allocator = allocator;
+    reader->window = (unsigned char*) oswrapper_audio__malloc(allocator, OSWRAPPER_AUDIO_READER_WINDOW_SIZE);
+    return reader->window != NULL ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+static void oswrapper_audio__reader_uninit(oswrapper_audio__reader* reader);
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__reader_init_path(oswrapper_audio__reader* reader, const char* path, const OSWrapper_audio_allocator* allocator) {
+    oswrapper_audio__reader_init_memory(reader, NULL, 0);
+    reader->file = oswrapper_audio__file_open(path);
+    reader->allocator = allocator;
+
+    if (reader->file != OSWRAPPER_AUDIO__INVALID_FILE && oswrapper_audio__file_get_size(reader->file, &reader->size)) {
+        reader->window = (unsigned char*) oswrapper_audio__malloc(allocator, OSWRAPPER_AUDIO_READER_WINDOW_SIZE);
+
+        if (reader->window != NULL) {
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
+
+    oswrapper_audio__reader_uninit(reader);
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+
+/* Free resources used by the reader. The memory or callbacks it reads from are not freed. */
+static void oswrapper_audio__reader_uninit(oswrapper_audio__reader* reader) {
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+
+    if (reader->file != OSWRAPPER_AUDIO__INVALID_FILE) {
+        oswrapper_audio__file_close(reader->file);
+        reader->file = OSWRAPPER_AUDIO__INVALID_FILE;
+    }
+
+#endif
+
+    if (reader->window != NULL) {
+        oswrapper_audio__free(reader->allocator, reader->window);
+        reader->window = NULL;
+    }
+}
+
+/* Returns a pointer to size bytes at the given offset, or NULL if they can't be read.
+The pointer is only valid until the next call. size must be at most OSWRAPPER_AUDIO_READER_WINDOW_SIZE. */
+static const unsigned char* oswrapper_audio__reader_get(oswrapper_audio__reader* reader, unsigned long long offset, size_t size) {
+    if (offset > reader->size || size > reader->size - offset) {
+        if (reader->streaming) {
+            reader->need_more_data = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        return NULL;
+    }
+
+    if (reader->data != NULL) {
+        return reader->data + (size_t) offset;
+    }
+
+    if (reader->window == NULL || size > OSWRAPPER_AUDIO_READER_WINDOW_SIZE) {
+        return NULL;
+    }
+
+    if (offset < reader->window_offset || offset + size > reader->window_offset + reader->window_size) {
+        reader->window_offset = offset;
+
+        if (reader->callbacks != NULL) {
+            reader->window_size = oswrapper_audio__callbacks_read_at(reader->callbacks, offset, reader->window, OSWRAPPER_AUDIO_READER_WINDOW_SIZE);
+        }
+
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+        else {
+            reader->window_size = oswrapper_audio__file_read_at(reader->file, offset, reader->window, OSWRAPPER_AUDIO_READER_WINDOW_SIZE);
+        }
+
+#endif
+
+        if (reader->window_size < size) {
+            return NULL;
+        }
+    }
+
+    return reader->window + (size_t) (offset - reader->window_offset);
+}
+
+static unsigned int oswrapper_audio__read_u16_le(const unsigned char* data) {
+    return (unsigned int) data[0] | ((unsigned int) data[1] << 8);
+}
+
+static unsigned long oswrapper_audio__read_u32_le(const unsigned char* data) {
+    return (unsigned long) data[0] | ((unsigned long) data[1] << 8) | ((unsigned long) data[2] << 16) | ((unsigned long) data[3] << 24);
+}
+
+static unsigned long long oswrapper_audio__read_u64_le(const unsigned char* data) {
+    return (unsigned long long) oswrapper_audio__read_u32_le(data) | ((unsigned long long) oswrapper_audio__read_u32_le(data + 4) << 32);
+}
+
+static unsigned int oswrapper_audio__read_u16_be(const unsigned char* data) {
+    return ((unsigned int) data[0] << 8) | (unsigned int) data[1];
+}
+
+static unsigned long oswrapper_audio__read_u32_be(const unsigned char* data) {
+    return ((unsigned long) data[0] << 24) | ((unsigned long) data[1] << 16) | ((unsigned long) data[2] << 8) | (unsigned long) data[3];
+}
+
+static unsigned long long oswrapper_audio__read_u64_be(const unsigned char* data) {
+    return ((unsigned long long) oswrapper_audio__read_u32_be(data) << 32) | (unsigned long long) oswrapper_audio__read_u32_be(data + 4);
+}
+
+/* WAVE format tags */
+#define OSWRAPPER_AUDIO__WAVE_FORMAT_PCM 0x0001
+#define OSWRAPPER_AUDIO__WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define OSWRAPPER_AUDIO__WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+/* The part of the KSDATAFORMAT_SUBTYPE GUIDs after the format tag */
+static const unsigned char oswrapper_audio__wave_subformat_guid_tail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_wave_fmt(const unsigned char* chunk, size_t chunk_size, oswrapper_audio__source_info* info) {
+    unsigned int format_tag;
+    size_t block_align;
+
+    if (chunk_size < 16) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    format_tag = oswrapper_audio__read_u16_le(chunk);
+    info->channel_count = oswrapper_audio__read_u16_le(chunk + 2);
+    info->sample_rate = oswrapper_audio__read_u32_le(chunk + 4);
+    block_align = oswrapper_audio__read_u16_le(chunk + 12);
+    info->bits_per_channel = oswrapper_audio__read_u16_le(chunk + 14);
+
+    if (format_tag == OSWRAPPER_AUDIO__WAVE_FORMAT_EXTENSIBLE) {
+        /* The real format tag is stored at the start of the SubFormat GUID */
+        if (chunk_size < 40 || OSWRAPPER_AUDIO_MEMCMP(chunk + 26, oswrapper_audio__wave_subformat_guid_tail, sizeof(oswrapper_audio__wave_subformat_guid_tail)) != 0) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        format_tag = oswrapper_audio__read_u16_le(chunk + 24);
+    }
+
+    if (format_tag == OSWRAPPER_AUDIO__WAVE_FORMAT_PCM) {
+        switch (info->bits_per_channel) {
+        case 8:
+            info->codec = OSWRAPPER_AUDIO__CODEC_PCM_UNSIGNED_8;
+            break;
+
+        case 16:
+        case 24:
+        case 32:
+            info->codec = OSWRAPPER_AUDIO__CODEC_PCM_INTEGER;
+            break;
+
+        default:
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+    } else if (format_tag == OSWRAPPER_AUDIO__WAVE_FORMAT_IEEE_FLOAT) {
+        if (info->bits_per_channel != 32 && info->bits_per_channel != 64) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        info->codec = OSWRAPPER_AUDIO__CODEC_PCM_FLOAT;
+    } else {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->bytes_per_frame = (info->bits_per_channel / 8) * info->channel_count;
+
+    /* Only packed samples are supported */
+    if (info->channel_count == 0 || info->sample_rate == 0 || block_align != info->bytes_per_frame) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Parses a RIFF or RF64 WAVE header. Only the header chunks are read, the audio data is left untouched. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_wave(oswrapper_audio__reader* reader, oswrapper_audio__source_info* info) {
+    OSWRAPPER_AUDIO_RESULT_TYPE found_fmt = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    unsigned long long rf64_data_size = 0;
+    unsigned long long offset = 12;
+    OSWRAPPER_AUDIO_RESULT_TYPE is_rf64;
+    const unsigned char* chunk = oswrapper_audio__reader_get(reader, 0, 12);
+    info->codec = OSWRAPPER_AUDIO__CODEC_PCM_INTEGER;
+    info->sample_rate = 0;
+    info->channel_count = 0;
+    info->bits_per_channel = 0;
+    info->bytes_per_frame = 0;
+    info->big_endian = OSWRAPPER_AUDIO_RESULT_FAILURE;
+
+    if (chunk == NULL || OSWRAPPER_AUDIO_MEMCMP(chunk + 8, "WAVE", 4) != 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (OSWRAPPER_AUDIO_MEMCMP(chunk, "RIFF", 4) == 0) {
+        is_rf64 = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    } else if (OSWRAPPER_AUDIO_MEMCMP(chunk, "RF64", 4) == 0) {
+        is_rf64 = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    } else {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    while ((chunk = oswrapper_audio__reader_get(reader, offset, 8)) != NULL) {
+        unsigned long long chunk_size = oswrapper_audio__read_u32_le(chunk + 4);
+        unsigned long long available = reader->size - offset - 8;
+
+        if (OSWRAPPER_AUDIO_MEMCMP(chunk, "ds64", 4) == 0) {
+            const unsigned char* ds64 = chunk_size >= 24 ? oswrapper_audio__reader_get(reader, offset + 8, 24) : NULL;
+
+            if (is_rf64 && ds64 != NULL) {
+                rf64_data_size = oswrapper_audio__read_u64_le(ds64 + 8);
+            }
+        } else if (OSWRAPPER_AUDIO_MEMCMP(chunk, "fmt ", 4) == 0) {
+            /* Only the first 40 bytes are used */
+            size_t fmt_size = chunk_size < 40 ? (size_t) chunk_size : 40;
+            const unsigned char* fmt = oswrapper_audio__reader_get(reader, offset + 8, fmt_size);
+
+            if (fmt == NULL || !oswrapper_audio__parse_wave_fmt(fmt, fmt_size, info)) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            found_fmt = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(chunk, "data", 4) == 0) {
+            if (!found_fmt) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            if (is_rf64 && chunk_size == 0xFFFFFFFF) {
+                chunk_size = rf64_data_size;
+            }
+
+            /* Files which were not finalised properly may have an incorrect size.
+            When streaming, the rest of the data just hasn't been received yet. */
+            if (chunk_size > available && !reader->streaming) {
+                chunk_size = available;
+            }
+
+            info->data_offset = offset + 8;
+            /* Ignore any incomplete frame at the end of the data */
+            info->data_size = chunk_size - (chunk_size % info->bytes_per_frame);
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        /* Chunks are padded to an even size */
+        chunk_size += chunk_size & 1;
+
+        /* When streaming, the next read will ask for more data instead */
+        if (chunk_size > available && !reader->streaming) {
+            break;
+        }
+
+        offset += 8 + chunk_size;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* Reads the 80 bit extended precision sample rate used by AIFF, without needing floating point maths.
+Returns 0 for rates which aren't positive whole numbers that fit in 32 bits. */
+static unsigned long oswrapper_audio__read_extended_rate(const unsigned char* data) {
+    unsigned int exponent = oswrapper_audio__read_u16_be(data);
+    unsigned long long mantissa = oswrapper_audio__read_u64_be(data + 2);
+
+    /* Negative, or not in the range 1 to 2^32 - 1 */
+    if (exponent < 16383 || exponent > 16383 + 31) {
+        return 0;
+    }
+
+    return (unsigned long) (mantissa >> (63 - (exponent - 16383)));
+}
+
+/* Parses the COMM chunk of an AIFF or AIFC file */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_aiff_comm(const unsigned char* chunk, size_t chunk_size, OSWRAPPER_AUDIO_RESULT_TYPE is_aifc, oswrapper_audio__source_info* info, unsigned long* frame_count) {
+    unsigned int storage_bits;
+
+    if (chunk_size < (is_aifc ? 22u : 18u)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->channel_count = oswrapper_audio__read_u16_be(chunk);
+    *frame_count = oswrapper_audio__read_u32_be(chunk + 2);
+    info->bits_per_channel = oswrapper_audio__read_u16_be(chunk + 6);
+    info->sample_rate = oswrapper_audio__read_extended_rate(chunk + 8);
+    info->codec = OSWRAPPER_AUDIO__CODEC_PCM_INTEGER;
+    info->big_endian = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+
+    if (is_aifc) {
+        const unsigned char* compression = chunk + 18;
+
+        if (OSWRAPPER_AUDIO_MEMCMP(compression, "NONE", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(compression, "twos", 4) == 0) {
+            /* Signed big-endian integers, the same as AIFF */
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "sowt", 4) == 0) {
+            info->big_endian = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "in24", 4) == 0) {
+            info->bits_per_channel = 24;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "in32", 4) == 0) {
+            info->bits_per_channel = 32;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "23ni", 4) == 0) {
+            info->bits_per_channel = 24;
+            info->big_endian = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "42ni", 4) == 0) {
+            info->bits_per_channel = 32;
+            info->big_endian = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "raw ", 4) == 0) {
+            info->codec = OSWRAPPER_AUDIO__CODEC_PCM_UNSIGNED_8;
+            info->bits_per_channel = 8;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "fl32", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(compression, "FL32", 4) == 0) {
+            info->codec = OSWRAPPER_AUDIO__CODEC_PCM_FLOAT;
+            info->bits_per_channel = 32;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "fl64", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(compression, "FL64", 4) == 0) {
+            info->codec = OSWRAPPER_AUDIO__CODEC_PCM_FLOAT;
+            info->bits_per_channel = 64;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "ulaw", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(compression, "ULAW", 4) == 0) {
+            info->codec = OSWRAPPER_AUDIO__CODEC_ULAW;
+            info->bits_per_channel = 8;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(compression, "alaw", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(compression, "ALAW", 4) == 0) {
+            info->codec = OSWRAPPER_AUDIO__CODEC_ALAW;
+            info->bits_per_channel = 8;
+        } else {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+    }
+
+    /* Integer samples are left-justified in whole bytes, so any unused low bits can be decoded as silence */
+    storage_bits = (info->bits_per_channel + 7) & ~7u;
+
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_PCM_INTEGER && (storage_bits == 0 || storage_bits > 32)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->bits_per_channel = storage_bits;
+    info->bytes_per_frame = (storage_bits / 8) * info->channel_count;
+
+    if (info->channel_count == 0 || info->sample_rate == 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Parses an AIFF or AIFC header. The COMM chunk may come before or after the SSND chunk. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_aiff(oswrapper_audio__reader* reader, oswrapper_audio__source_info* info) {
+    OSWRAPPER_AUDIO_RESULT_TYPE found_comm = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    OSWRAPPER_AUDIO_RESULT_TYPE found_ssnd = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    unsigned long frame_count = 0;
+    unsigned long long offset = 12;
+    OSWRAPPER_AUDIO_RESULT_TYPE is_aifc;
+    const unsigned char* chunk = oswrapper_audio__reader_get(reader, 0, 12);
+    info->codec = OSWRAPPER_AUDIO__CODEC_PCM_INTEGER;
+    info->sample_rate = 0;
+    info->channel_count = 0;
+    info->bits_per_channel = 0;
+    info->bytes_per_frame = 0;
+    info->big_endian = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    info->data_offset = 0;
+    info->data_size = 0;
+
+    if (chunk == NULL || OSWRAPPER_AUDIO_MEMCMP(chunk, "FORM", 4) != 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (OSWRAPPER_AUDIO_MEMCMP(chunk + 8, "AIFF", 4) == 0) {
+        is_aifc = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    } else if (OSWRAPPER_AUDIO_MEMCMP(chunk + 8, "AIFC", 4) == 0) {
+        is_aifc = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    } else {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    while ((chunk = oswrapper_audio__reader_get(reader, offset, 8)) != NULL) {
+        unsigned long long chunk_size = oswrapper_audio__read_u32_be(chunk + 4);
+        unsigned long long available = reader->size - offset - 8;
+
+        if (OSWRAPPER_AUDIO_MEMCMP(chunk, "COMM", 4) == 0) {
+            /* Only the first 22 bytes are used */
+            size_t comm_size = chunk_size < 22 ? (size_t) chunk_size : 22;
+            const unsigned char* comm = oswrapper_audio__reader_get(reader, offset + 8, comm_size);
+
+            if (comm == NULL || !oswrapper_audio__parse_aiff_comm(comm, comm_size, is_aifc, info, &frame_count)) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            found_comm = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(chunk, "SSND", 4) == 0) {
+            const unsigned char* ssnd = chunk_size >= 8 ? oswrapper_audio__reader_get(reader, offset + 8, 8) : NULL;
+            unsigned long long data_start;
+
+            if (ssnd == NULL) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            /* The audio data starts after the offset and block size fields, and any extra offset */
+            data_start = 8 + (unsigned long long) oswrapper_audio__read_u32_be(ssnd);
+
+            /* Files which were not finalised properly may have an incorrect size.
+            When streaming, the rest of the data just hasn't been received yet. */
+            if (chunk_size > available && !reader->streaming) {
+                chunk_size = available;
+            }
+
+            if (data_start > chunk_size) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            info->data_offset = offset + 8 + data_start;
+            info->data_size = chunk_size - data_start;
+            found_ssnd = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        if (found_comm && found_ssnd) {
+            unsigned long long frames_size = (unsigned long long) frame_count * info->bytes_per_frame;
+
+            /* The COMM chunk has the exact amount of frames, the SSND chunk may be padded */
+            if (info->data_size > frames_size) {
+                info->data_size = frames_size;
+            }
+
+            /* Ignore any incomplete frame at the end of the data */
+            info->data_size -= info->data_size % info->bytes_per_frame;
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        /* Chunks are padded to an even size */
+        chunk_size += chunk_size & 1;
+
+        /* When streaming, the next read will ask for more data instead */
+        if (chunk_size > available && !reader->streaming) {
+            break;
+        }
+
+        offset += 8 + chunk_size;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* Parses a Sun / NeXT AU header. The header is followed by the audio data, and the size of the data may be unknown. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_au(oswrapper_audio__reader* reader, oswrapper_audio__source_info* info) {
+    const unsigned char* header = oswrapper_audio__reader_get(reader, 0, 24);
+    unsigned long long available;
+
+    if (header == NULL || OSWRAPPER_AUDIO_MEMCMP(header, ".snd", 4) != 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->data_offset = oswrapper_audio__read_u32_be(header + 4);
+    info->data_size = oswrapper_audio__read_u32_be(header + 8);
+    info->sample_rate = oswrapper_audio__read_u32_be(header + 16);
+    info->channel_count = (unsigned int) oswrapper_audio__read_u32_be(header + 20);
+    info->codec = OSWRAPPER_AUDIO__CODEC_PCM_INTEGER;
+    info->big_endian = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+
+    switch (oswrapper_audio__read_u32_be(header + 12)) {
+    case 1:
+        info->codec = OSWRAPPER_AUDIO__CODEC_ULAW;
+        info->bits_per_channel = 8;
+        break;
+
+    case 2:
+        info->bits_per_channel = 8;
+        break;
+
+    case 3:
+        info->bits_per_channel = 16;
+        break;
+
+    case 4:
+        info->bits_per_channel = 24;
+        break;
+
+    case 5:
+        info->bits_per_channel = 32;
+        break;
+
+    case 6:
+        info->codec = OSWRAPPER_AUDIO__CODEC_PCM_FLOAT;
+        info->bits_per_channel = 32;
+        break;
+
+    case 7:
+        info->codec = OSWRAPPER_AUDIO__CODEC_PCM_FLOAT;
+        info->bits_per_channel = 64;
+        break;
+
+    case 27:
+        info->codec = OSWRAPPER_AUDIO__CODEC_ALAW;
+        info->bits_per_channel = 8;
+        break;
+
+    default:
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->bytes_per_frame = (info->bits_per_channel / 8) * info->channel_count;
+
+    if (info->channel_count == 0 || info->channel_count > 0xFFFF || info->sample_rate == 0 || info->data_offset < 24) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* The data goes to the end of the file when the size isn't known */
+    available = reader->size > info->data_offset ? reader->size - info->data_offset : 0;
+
+    if (info->data_size == 0xFFFFFFFF && reader->streaming) {
+        info->data_size = ((unsigned long long) -1) / 2;
+    } else if (info->data_size > available && !reader->streaming) {
+        info->data_size = available;
+    }
+
+    info->data_size -= info->data_size % info->bytes_per_frame;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Reads a big-endian 64 bit floating point number */
+static double oswrapper_audio__read_f64_be(const unsigned char* data) {
+    unsigned long long bits = oswrapper_audio__read_u64_be(data);
+    double value;
+    OSWRAPPER_AUDIO_MEMCPY(&value, &bits, 8);
+    return value;
+}
+
+/* CAF format flags for linear PCM */
+#define OSWRAPPER_AUDIO__CAF_FLAG_FLOAT 1
+#define OSWRAPPER_AUDIO__CAF_FLAG_LITTLE_ENDIAN 2
+
+/* Parses the desc chunk of a CAF file */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_caf_desc(const unsigned char* chunk, oswrapper_audio__source_info* info) {
+    double sample_rate = oswrapper_audio__read_f64_be(chunk);
+    const unsigned char* format_id = chunk + 8;
+    unsigned long format_flags = oswrapper_audio__read_u32_be(chunk + 12);
+    unsigned long bytes_per_packet = oswrapper_audio__read_u32_be(chunk + 16);
+    unsigned long frames_per_packet = oswrapper_audio__read_u32_be(chunk + 20);
+    unsigned long channel_count = oswrapper_audio__read_u32_be(chunk + 24);
+    unsigned long bits_per_channel = oswrapper_audio__read_u32_be(chunk + 28);
+
+    /* Also catches NaN */
+    if (!(sample_rate >= 1.0 && sample_rate < 4294967296.0) || channel_count == 0 || channel_count > 0xFFFF) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->sample_rate = (unsigned long) sample_rate;
+    info->channel_count = (unsigned int) channel_count;
+    info->big_endian = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    info->frames_per_packet = 1;
+
+    if (OSWRAPPER_AUDIO_MEMCMP(format_id, "lpcm", 4) == 0) {
+        if (format_flags & OSWRAPPER_AUDIO__CAF_FLAG_FLOAT) {
+            if (bits_per_channel != 32 && bits_per_channel != 64) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            info->codec = OSWRAPPER_AUDIO__CODEC_PCM_FLOAT;
+        } else {
+            if (bits_per_channel != 8 && bits_per_channel != 16 && bits_per_channel != 24 && bits_per_channel != 32) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            info->codec = OSWRAPPER_AUDIO__CODEC_PCM_INTEGER;
+        }
+
+        info->big_endian = (format_flags & OSWRAPPER_AUDIO__CAF_FLAG_LITTLE_ENDIAN) ? OSWRAPPER_AUDIO_RESULT_FAILURE : OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        info->bits_per_channel = (unsigned int) bits_per_channel;
+    } else if (OSWRAPPER_AUDIO_MEMCMP(format_id, "ulaw", 4) == 0) {
+        info->codec = OSWRAPPER_AUDIO__CODEC_ULAW;
+        info->bits_per_channel = 8;
+    } else if (OSWRAPPER_AUDIO_MEMCMP(format_id, "alaw", 4) == 0) {
+        info->codec = OSWRAPPER_AUDIO__CODEC_ALAW;
+        info->bits_per_channel = 8;
+    } else if (OSWRAPPER_AUDIO_MEMCMP(format_id, "ima4", 4) == 0) {
+        info->codec = OSWRAPPER_AUDIO__CODEC_IMA4;
+        info->bits_per_channel = 0;
+        info->frames_per_packet = OSWRAPPER_AUDIO__IMA4_FRAMES_PER_PACKET;
+        info->bytes_per_frame = OSWRAPPER_AUDIO__IMA4_BYTES_PER_CHANNEL * info->channel_count;
+    } else {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (info->codec != OSWRAPPER_AUDIO__CODEC_IMA4) {
+        info->bytes_per_frame = (info->bits_per_channel / 8) * info->channel_count;
+    }
+
+    /* Only packed samples, and packets of a fixed size, are supported */
+    if (bytes_per_packet != info->bytes_per_frame || frames_per_packet != info->frames_per_packet) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Parses a CAF header. The packet table is used for the exact length and priming of packetised audio,
+and chunks after the audio data are only read when its size is known. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_caf(oswrapper_audio__reader* reader, oswrapper_audio__source_info* info) {
+    OSWRAPPER_AUDIO_RESULT_TYPE found_desc = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    OSWRAPPER_AUDIO_RESULT_TYPE found_data = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    unsigned long long offset = 8;
+    const unsigned char* chunk = oswrapper_audio__reader_get(reader, 0, 8);
+
+    if (chunk == NULL || OSWRAPPER_AUDIO_MEMCMP(chunk, "caff", 4) != 0 || oswrapper_audio__read_u16_be(chunk + 4) != 1) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    while ((chunk = oswrapper_audio__reader_get(reader, offset, 12)) != NULL) {
+        unsigned long long chunk_size = oswrapper_audio__read_u64_be(chunk + 4);
+        unsigned long long available = reader->size - offset - 12;
+
+        if (OSWRAPPER_AUDIO_MEMCMP(chunk, "desc", 4) == 0) {
+            const unsigned char* desc = chunk_size >= 32 ? oswrapper_audio__reader_get(reader, offset + 12, 32) : NULL;
+
+            if (desc == NULL || !oswrapper_audio__parse_caf_desc(desc, info)) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            found_desc = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        } else if (OSWRAPPER_AUDIO_MEMCMP(chunk, "pakt", 4) == 0) {
+            const unsigned char* pakt = chunk_size >= 24 ? oswrapper_audio__reader_get(reader, offset + 12, 24) : NULL;
+
+            if (pakt == NULL) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            /* The number of valid frames, and the priming frames before them */
+            info->total_frames = oswrapper_audio__read_u64_be(pakt + 8);
+            info->priming_frames = oswrapper_audio__read_u32_be(pakt + 16);
+        } else if (OSWRAPPER_AUDIO_MEMCMP(chunk, "data", 4) == 0) {
+            /* The audio data starts after the edit count */
+            OSWRAPPER_AUDIO_RESULT_TYPE size_known = chunk_size != (unsigned long long) -1;
+
+            if (!found_desc || (size_known && chunk_size < 4)) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            if (!size_known) {
+                /* The data goes to the end of the file */
+                chunk_size = reader->streaming ? ((unsigned long long) -1) / 2 : available;
+            } else if (chunk_size > available && !reader->streaming) {
+                chunk_size = available;
+            }
+
+            info->data_offset = offset + 16;
+            info->data_size = chunk_size >= 4 ? chunk_size - 4 : 0;
+            info->data_size -= info->data_size % info->bytes_per_frame;
+            found_data = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+
+            /* Later chunks can't be found without the size, and aren't received yet when streaming */
+            if (!size_known || reader->streaming) {
+                break;
+            }
+        }
+
+        /* When streaming, the next read will ask for more data instead */
+        if (chunk_size > available && !reader->streaming) {
+            break;
+        }
+
+        /* A chunk can't end past the largest offset, which would make the next offset go backwards */
+        if (chunk_size > ((unsigned long long) -1) - 12 - offset) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        offset += 12 + chunk_size;
+    }
+
+    return found_desc && found_data ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* The size of each point in a FLAC seek table */
+#define OSWRAPPER_AUDIO__FLAC_SEEK_POINT_SIZE 18
+
+/* Parses the STREAMINFO block of a FLAC file */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_flac_streaminfo(const unsigned char* block, oswrapper_audio__source_info* info) {
+    /* The sample rate, channel count, bit depth, and total frames are packed into 64 bits */
+    unsigned long long packed = oswrapper_audio__read_u64_be(block + 10);
+    info->min_frames_per_packet = oswrapper_audio__read_u16_be(block);
+    info->frames_per_packet = oswrapper_audio__read_u16_be(block + 2);
+    info->max_packet_size = ((unsigned long) block[7] << 16) | ((unsigned long) block[8] << 8) | (unsigned long) block[9];
+    info->sample_rate = (unsigned long) (packed >> 44);
+    info->channel_count = (unsigned int) ((packed >> 41) & 7) + 1;
+    info->bits_per_channel = (unsigned int) ((packed >> 36) & 31) + 1;
+    info->total_frames = packed & (((unsigned long long) 1 << 36) - 1);
+    info->codec = OSWRAPPER_AUDIO__CODEC_FLAC;
+    info->bytes_per_frame = 0;
+
+    /* 0 total frames means the length isn't known */
+    if (info->total_frames == 0) {
+        info->total_frames = (unsigned long long) -1;
+    }
+
+    if (info->min_frames_per_packet < 16 || info->frames_per_packet < info->min_frames_per_packet || info->sample_rate == 0 || info->bits_per_channel < 4) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Parses the metadata blocks of a FLAC file, which may start with an ID3v2 tag.
+The audio data is every frame after the metadata blocks, up to the end of the file. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_flac(oswrapper_audio__reader* reader, oswrapper_audio__source_info* info) {
+    OSWRAPPER_AUDIO_RESULT_TYPE found_streaminfo = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    OSWRAPPER_AUDIO_RESULT_TYPE last_block = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    unsigned long long offset = 0;
+    const unsigned char* block = oswrapper_audio__reader_get(reader, 0, 10);
+
+    if (block != NULL && OSWRAPPER_AUDIO_MEMCMP(block, "ID3", 3) == 0) {
+        /* The tag size has 7 bits in each byte, and doesn't include the header or the optional footer */
+        offset = 10 + (((unsigned long long) (block[6] & 0x7F) << 21) | ((unsigned long long) (block[7] & 0x7F) << 14) | ((unsigned long long) (block[8] & 0x7F) << 7) | (unsigned long long) (block[9] & 0x7F));
+
+        if (block[5] & 0x10) {
+            offset += 10;
+        }
+    }
+
+    block = oswrapper_audio__reader_get(reader, offset, 4);
+
+    if (block == NULL || OSWRAPPER_AUDIO_MEMCMP(block, "fLaC", 4) != 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    offset += 4;
+
+    while (!last_block) {
+        unsigned int block_type;
+        unsigned long block_size;
+        block = oswrapper_audio__reader_get(reader, offset, 4);
+
+        if (block == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        last_block = (block[0] & 0x80) != 0;
+        block_type = block[0] & 0x7F;
+        block_size = ((unsigned long) block[1] << 16) | ((unsigned long) block[2] << 8) | (unsigned long) block[3];
+
+        if (block_type == 0) {
+            const unsigned char* streaminfo = block_size >= 34 ? oswrapper_audio__reader_get(reader, offset + 4, 34) : NULL;
+
+            if (streaminfo == NULL || !oswrapper_audio__parse_flac_streaminfo(streaminfo, info)) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            found_streaminfo = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        } else if (block_type == 3) {
+            info->seek_table_offset = offset + 4;
+            info->seek_point_count = block_size / OSWRAPPER_AUDIO__FLAC_SEEK_POINT_SIZE;
+        } else if (block_type == 127) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        offset += 4 + block_size;
+    }
+
+    /* Reading the last byte of the metadata asks for more data when streaming */
+    if (!found_streaminfo || oswrapper_audio__reader_get(reader, offset - 1, 1) == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->data_offset = offset;
+    info->data_size = reader->streaming ? ((unsigned long long) -1) / 2 : reader->size - offset;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* The largest frame length of ALAC packets */
+#define OSWRAPPER_AUDIO__ALAC_MAX_FRAME_LENGTH 65535
+
+/* Reads the header of the MP4 box at the given offset, which has to end by the end offset.
+Sets type to the box type and header_size to the size of its header,
+and returns the size of the box including its header, or 0 if it isn't a valid box. */
+static unsigned long long oswrapper_audio__mp4_box(oswrapper_audio__reader* reader, unsigned long long offset, unsigned long long end, unsigned char* type, unsigned int* header_size) {
+    const unsigned char* box = end - offset >= 8 ? oswrapper_audio__reader_get(reader, offset, 8) : NULL;
+    unsigned long long size;
+
+    if (box == NULL) {
+        return 0;
+    }
+
+    size = oswrapper_audio__read_u32_be(box);
+    OSWRAPPER_AUDIO_MEMCPY(type, box + 4, 4);
+    *header_size = 8;
+
+    if (size == 1) {
+        /* A 64 bit size comes after the type */
+        box = end - offset >= 16 ? oswrapper_audio__reader_get(reader, offset + 8, 8) : NULL;
+
+        if (box == NULL) {
+            return 0;
+        }
+
+        size = oswrapper_audio__read_u64_be(box);
+        *header_size = 16;
+    } else if (size == 0) {
+        /* The box goes to the end of its parent */
+        size = end - offset;
+    }
+
+    return size >= *header_size && size <= end - offset ? size : 0;
+}
+
+/* Finds the first box of the given type between the offsets, and sets where its contents start and end */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__mp4_find_box(oswrapper_audio__reader* reader, unsigned long long offset, unsigned long long end, const char* type, unsigned long long* box_offset, unsigned long long* box_end) {
+    while (offset < end) {
+        unsigned char box_type[4];
+        unsigned int header_size;
+        unsigned long long size = oswrapper_audio__mp4_box(reader, offset, end, box_type, &header_size);
+
+        if (size == 0) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        if (OSWRAPPER_AUDIO_MEMCMP(box_type, type, 4) == 0) {
+            *box_offset = offset + header_size;
+            *box_end = offset + size;
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        offset += size;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* Converts the duration of an MP4 packet to frames, when the track's timescale isn't its sample rate */
+static unsigned long long oswrapper_audio__mp4_packet_frames(const oswrapper_audio__source_info* info, unsigned long duration) {
+    if (info->mp4.timescale == 0 || info->mp4.timescale == info->sample_rate) {
+        return duration;
+    }
+
+    return ((unsigned long long) duration * info->sample_rate) / info->mp4.timescale;
+}
+
+/* Parses the ALAC specific config (magic cookie) */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_alac_config(const unsigned char* config, oswrapper_audio__source_info* info) {
+    unsigned long frame_length = oswrapper_audio__read_u32_be(config);
+    info->codec = OSWRAPPER_AUDIO__CODEC_ALAC;
+    info->bits_per_channel = config[5];
+    info->mp4.history_mult = config[6];
+    info->mp4.initial_history = config[7];
+    info->mp4.rice_limit = config[8];
+    info->channel_count = config[9];
+    info->max_packet_size = oswrapper_audio__read_u32_be(config + 12);
+    info->sample_rate = oswrapper_audio__read_u32_be(config + 20);
+    info->bytes_per_frame = 0;
+
+    /* Packets of one frame would be treated as PCM */
+    if (frame_length < 2 || frame_length > OSWRAPPER_AUDIO__ALAC_MAX_FRAME_LENGTH || config[4] != 0 || info->sample_rate == 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if ((info->bits_per_channel != 16 && info->bits_per_channel != 20 && info->bits_per_channel != 24 && info->bits_per_channel != 32) || info->channel_count < 1 || info->channel_count > 8 || info->mp4.rice_limit < 1 || info->mp4.rice_limit > 31) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->frames_per_packet = frame_length;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Parses the sample description box, which has to describe ALAC audio */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_mp4_stsd(oswrapper_audio__reader* reader, unsigned long long offset, unsigned long long end, oswrapper_audio__source_info* info) {
+    unsigned char type[4];
+    unsigned int header_size;
+    unsigned int version;
+    unsigned long long entry_end;
+    unsigned long long config_offset;
+    unsigned long long config_end;
+    const unsigned char* entry;
+    /* The version, flags, and entry count come before the first sample description */
+    unsigned long long size = end - offset >= 8 ? oswrapper_audio__mp4_box(reader, offset + 8, end, type, &header_size) : 0;
+
+    if (size == 0 || OSWRAPPER_AUDIO_MEMCMP(type, "alac", 4) != 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    entry_end = offset + 8 + size;
+    offset += 8 + header_size;
+    entry = size - header_size >= 28 ? oswrapper_audio__reader_get(reader, offset, 28) : NULL;
+
+    if (entry == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* Sound sample descriptions have 28 bytes of fields, and versions 1 and 2 have more fields after them */
+    version = oswrapper_audio__read_u16_be(entry + 8);
+    offset += 28 + (version == 1 ? 16 : version == 2 ? 36 : 0);
+
+    /* The ALAC specific config is after its version and flags */
+    if (!oswrapper_audio__mp4_find_box(reader, offset, entry_end, "alac", &config_offset, &config_end) || config_end - config_offset < 28) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    entry = oswrapper_audio__reader_get(reader, config_offset + 4, 24);
+
+    if (entry == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    return oswrapper_audio__parse_alac_config(entry, info);
+}
+
+/* Finds the sample tables of an ALAC track, and counts its frames */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_mp4_stbl(oswrapper_audio__reader* reader, unsigned long long offset, unsigned long long end, oswrapper_audio__source_info* info) {
+    /* stsd, stts, stsc, stsz, and stco or co64 are all needed */
+    unsigned int found_tables = 0;
+    unsigned long long total_frames = 0;
+    unsigned long packets = 0;
+    unsigned long i;
+
+    while (offset < end) {
+        unsigned char type[4];
+        unsigned int header_size;
+        unsigned long long size = oswrapper_audio__mp4_box(reader, offset, end, type, &header_size);
+        unsigned long long box_offset = offset + header_size;
+        unsigned long long box_size = size - header_size;
+        const unsigned char* box = size != 0 && box_size >= 12 ? oswrapper_audio__reader_get(reader, box_offset, 12) : NULL;
+
+        if (size == 0) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        if (OSWRAPPER_AUDIO_MEMCMP(type, "stsd", 4) == 0) {
+            if (!oswrapper_audio__parse_mp4_stsd(reader, box_offset, offset + size, info)) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            found_tables |= 1;
+        } else if (box != NULL && OSWRAPPER_AUDIO_MEMCMP(type, "stts", 4) == 0) {
+            info->mp4.time_offset = box_offset + 8;
+            info->mp4.time_count = oswrapper_audio__read_u32_be(box + 4);
+            found_tables |= (unsigned long long) info->mp4.time_count * 8 <= box_size - 8 ? 2 : 0;
+        } else if (box != NULL && OSWRAPPER_AUDIO_MEMCMP(type, "stsc", 4) == 0) {
+            info->mp4.chunk_map_offset = box_offset + 8;
+            info->mp4.chunk_map_count = oswrapper_audio__read_u32_be(box + 4);
+            found_tables |= (unsigned long long) info->mp4.chunk_map_count * 12 <= box_size - 8 ? 4 : 0;
+        } else if (box != NULL && OSWRAPPER_AUDIO_MEMCMP(type, "stsz", 4) == 0) {
+            info->mp4.size_offset = box_offset + 12;
+            info->mp4.sample_size = oswrapper_audio__read_u32_be(box + 4);
+            info->mp4.packet_count = oswrapper_audio__read_u32_be(box + 8);
+            found_tables |= info->mp4.sample_size != 0 || (unsigned long long) info->mp4.packet_count * 4 <= box_size - 12 ? 8 : 0;
+        } else if (box != NULL && (OSWRAPPER_AUDIO_MEMCMP(type, "stco", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(type, "co64", 4) == 0)) {
+            info->mp4.chunk_offset_offset = box_offset + 8;
+            info->mp4.chunk_count = oswrapper_audio__read_u32_be(box + 4);
+            info->mp4.chunk_offset_size = type[0] == 'c' ? 8 : 4;
+            found_tables |= (unsigned long long) info->mp4.chunk_count * info->mp4.chunk_offset_size <= box_size - 8 ? 16 : 0;
+        }
+
+        offset += size;
+    }
+
+    if (found_tables != 31) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* Packets without a duration aren't decoded */
+    for (i = 0; i < info->mp4.time_count && packets < info->mp4.packet_count; i++) {
+        const unsigned char* entry = oswrapper_audio__reader_get(reader, info->mp4.time_offset + (unsigned long long) i * 8, 8);
+        unsigned long count;
+
+        if (entry == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        count = oswrapper_audio__read_u32_be(entry);
+        count = count < info->mp4.packet_count - packets ? count : info->mp4.packet_count - packets;
+        total_frames += count * oswrapper_audio__mp4_packet_frames(info, oswrapper_audio__read_u32_be(entry + 4));
+        packets += count;
+    }
+
+    info->mp4.packet_count = packets;
+    info->total_frames = total_frames;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Parses a track box, and returns success if it has ALAC audio */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_mp4_trak(oswrapper_audio__reader* reader, unsigned long long offset, unsigned long long end, oswrapper_audio__source_info* info) {
+    unsigned long long media_end;
+    unsigned long long box_offset;
+    unsigned long long box_end;
+    const unsigned char* box;
+
+    if (!oswrapper_audio__mp4_find_box(reader, offset, end, "mdia", &offset, &media_end)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* The media header has the timescale of the packet durations, which is at a different offset in version 1 */
+    if (!oswrapper_audio__mp4_find_box(reader, offset, media_end, "mdhd", &box_offset, &box_end) || box_end - box_offset < 24) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    box = oswrapper_audio__reader_get(reader, box_offset, 24);
+
+    if (box == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    info->mp4.timescale = oswrapper_audio__read_u32_be(box + (box[0] == 1 ? 20 : 12));
+
+    if (!oswrapper_audio__mp4_find_box(reader, offset, media_end, "minf", &offset, &box_end) || !oswrapper_audio__mp4_find_box(reader, offset, box_end, "stbl", &offset, &box_end)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    return oswrapper_audio__parse_mp4_stbl(reader, offset, box_end, info);
+}
+
+/* Parses an MP4 (M4A) file, using the first track with ALAC audio. Edit lists aren't used.
+The audio data is the contents of the first media data box, and the movie box can be before or after it. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_mp4(oswrapper_audio__reader* reader, oswrapper_audio__source_info* info) {
+    OSWRAPPER_AUDIO_RESULT_TYPE found_track = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    OSWRAPPER_AUDIO_RESULT_TYPE found_data = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    unsigned long long offset = 0;
+
+    while (!found_track || !found_data) {
+        unsigned char type[4];
+        unsigned int header_size;
+        /* When streaming, the next read will ask for more data instead */
+        unsigned long long size = oswrapper_audio__mp4_box(reader, offset, ((unsigned long long) -1) / 2, type, &header_size);
+
+        if (size == 0) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        if (OSWRAPPER_AUDIO_MEMCMP(type, "moov", 4) == 0) {
+            unsigned long long track_offset = offset + header_size;
+            unsigned long long track_end;
+
+            /* Reading the last byte of the movie box asks for more data when streaming */
+            if (oswrapper_audio__reader_get(reader, offset + size - 1, 1) == NULL) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            while (!found_track) {
+                if (!oswrapper_audio__mp4_find_box(reader, track_offset, offset + size, "trak", &track_offset, &track_end)) {
+                    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+                }
+
+                found_track = oswrapper_audio__parse_mp4_trak(reader, track_offset, track_end, info);
+                track_offset = track_end;
+            }
+        } else if (OSWRAPPER_AUDIO_MEMCMP(type, "mdat", 4) == 0 && !found_data) {
+            info->data_offset = offset + header_size;
+            info->data_size = size - header_size;
+
+            if (!reader->streaming && (info->data_offset > reader->size || info->data_size > reader->size - info->data_offset)) {
+                /* The file was cut off */
+                info->data_size = info->data_offset < reader->size ? reader->size - info->data_offset : 0;
+            }
+
+            found_data = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        offset += size;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Parses the header of any supported container format */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__parse_header(oswrapper_audio__reader* reader, oswrapper_audio__source_info* info) {
+    const unsigned char* magic = oswrapper_audio__reader_get(reader, 0, 4);
+    OSWRAPPER_AUDIO_RESULT_TYPE result;
+    unsigned long long max_frames;
+    /* Not every format sets every field */
+    info->codec = OSWRAPPER_AUDIO__CODEC_PCM_INTEGER;
+    info->sample_rate = 0;
+    info->channel_count = 0;
+    info->bits_per_channel = 0;
+    info->bytes_per_frame = 0;
+    info->big_endian = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    info->data_offset = 0;
+    info->data_size = 0;
+    /* Only set by formats with a packet table */
+    info->frames_per_packet = 1;
+    info->priming_frames = 0;
+    info->total_frames = (unsigned long long) -1;
+    info->min_frames_per_packet = 0;
+    info->max_packet_size = 0;
+    info->seek_table_offset = 0;
+    info->seek_point_count = 0;
+
+    if (magic != NULL && (OSWRAPPER_AUDIO_MEMCMP(magic, "fLaC", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(magic, "ID3", 3) == 0)) {
+        result = oswrapper_audio__parse_flac(reader, info);
+    } else if (magic != NULL && OSWRAPPER_AUDIO_MEMCMP(magic, "FORM", 4) == 0) {
+        result = oswrapper_audio__parse_aiff(reader, info);
+    } else if (magic != NULL && OSWRAPPER_AUDIO_MEMCMP(magic, "caff", 4) == 0) {
+        result = oswrapper_audio__parse_caf(reader, info);
+    } else if (magic != NULL && OSWRAPPER_AUDIO_MEMCMP(magic, ".snd", 4) == 0) {
+        result = oswrapper_audio__parse_au(reader, info);
+    } else if ((magic = oswrapper_audio__reader_get(reader, 4, 4)) != NULL && (OSWRAPPER_AUDIO_MEMCMP(magic, "ftyp", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(magic, "moov", 4) == 0 || OSWRAPPER_AUDIO_MEMCMP(magic, "mdat", 4) == 0)) {
+        /* MP4 files start with a box, which has its type after its size */
+        result = oswrapper_audio__parse_mp4(reader, info);
+    } else {
+        result = oswrapper_audio__parse_wave(reader, info);
+    }
+
+    if (!result) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* The length of audio with packets of different sizes can only come from the header */
+    if (info->bytes_per_frame == 0) {
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+    /* The packet table can't have more frames than the audio data */
+    max_frames = (info->data_size / info->bytes_per_frame) * info->frames_per_packet;
+    max_frames = max_frames > info->priming_frames ? max_frames - info->priming_frames : 0;
+
+    if (info->total_frames > max_frames) {
+        info->total_frames = max_frames;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+/* End shared container parsing */
+
+#if defined(OSWRAPPER_AUDIO_USE_PORTABLE_IMPL) || defined(OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL)
+/* Start shared sample conversion */
+/* Decoders which don't convert to the hinted output format themselves use these functions.
+Conversions which are used often have SIMD versions, define OSWRAPPER_AUDIO_NO_SIMD to only use the plain C versions. */
+#ifndef OSWRAPPER_AUDIO_NO_SIMD
+#if defined(__AVX2__)
+#define OSWRAPPER_AUDIO__USE_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OSWRAPPER_AUDIO__USE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define OSWRAPPER_AUDIO__USE_NEON
+#include <arm_neon.h>
+#endif
+#endif /* OSWRAPPER_AUDIO_NO_SIMD */
+
+/* Samples are converted in chunks of this many samples, using a buffer on the stack */
+#define OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE 128
+
+/* Size of the buffer that audio data is read into before it's converted, when it can't be read directly */
+#ifndef OSWRAPPER_AUDIO_READ_BUFFER_SIZE
+#define OSWRAPPER_AUDIO_READ_BUFFER_SIZE 0x1000
+#endif
+
+/* Assumed to be 32 bits on every supported platform */
+typedef int oswrapper_audio__int32;
+typedef unsigned int oswrapper_audio__uint32;
+
+typedef enum {
+    OSWRAPPER_AUDIO__SAMPLE_U8 = 0,
+    OSWRAPPER_AUDIO__SAMPLE_S8,
+    OSWRAPPER_AUDIO__SAMPLE_S16,
+    OSWRAPPER_AUDIO__SAMPLE_S24,
+    OSWRAPPER_AUDIO__SAMPLE_S32,
+    OSWRAPPER_AUDIO__SAMPLE_F32,
+    OSWRAPPER_AUDIO__SAMPLE_F64,
+    /* 8 bit companded samples, which are only used as an input format */
+    OSWRAPPER_AUDIO__SAMPLE_ULAW,
+    OSWRAPPER_AUDIO__SAMPLE_ALAW
+} oswrapper_audio__sample_format;
+
+/* Converts samples from one format and byte order to another */
+typedef struct oswrapper_audio__converter {
+    oswrapper_audio__sample_format input_format;
+    oswrapper_audio__sample_format output_format;
+    /* Set when the samples aren't in the byte order of this system */
+    OSWRAPPER_AUDIO_RESULT_TYPE swap_input;
+    OSWRAPPER_AUDIO_RESULT_TYPE swap_output;
+} oswrapper_audio__converter;
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__system_is_big_endian(void) {
+    const unsigned int one = 1;
+    return *((const unsigned char*) &one) == 0 ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+static unsigned int oswrapper_audio__sample_format_bits(oswrapper_audio__sample_format format) {
+    switch (format) {
+    case OSWRAPPER_AUDIO__SAMPLE_U8:
+    case OSWRAPPER_AUDIO__SAMPLE_S8:
+    case OSWRAPPER_AUDIO__SAMPLE_ULAW:
+    case OSWRAPPER_AUDIO__SAMPLE_ALAW:
+        return 8;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S16:
+        return 16;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S24:
+        return 24;
+
+    case OSWRAPPER_AUDIO__SAMPLE_F64:
+        return 64;
+
+    default:
+        return 32;
+    }
+}
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__sample_format_is_float(oswrapper_audio__sample_format format) {
+    return format == OSWRAPPER_AUDIO__SAMPLE_F32 || format == OSWRAPPER_AUDIO__SAMPLE_F64 ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* Picks the output format for the hinted format in the given OSWrapper_audio_spec.
+The input format is used for any values which weren't hinted. 8 bit integer PCM is always signed,
+and companded samples are decoded to 16 bit integer PCM. */
+static oswrapper_audio__sample_format oswrapper_audio__get_hinted_sample_format(const OSWrapper_audio_spec* audio, oswrapper_audio__sample_format input_format) {
+    unsigned int bits_per_channel = audio->bits_per_channel;
+    OSWRAPPER_AUDIO_RESULT_TYPE input_is_float = oswrapper_audio__sample_format_is_float(input_format);
+
+    if (input_format == OSWRAPPER_AUDIO__SAMPLE_U8) {
+        input_format = OSWRAPPER_AUDIO__SAMPLE_S8;
+    } else if (input_format == OSWRAPPER_AUDIO__SAMPLE_ULAW || input_format == OSWRAPPER_AUDIO__SAMPLE_ALAW) {
+        input_format = OSWRAPPER_AUDIO__SAMPLE_S16;
+    }
+
+    if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
+        if (bits_per_channel == 64 || (bits_per_channel == 0 && input_format == OSWRAPPER_AUDIO__SAMPLE_F64)) {
+            return OSWRAPPER_AUDIO__SAMPLE_F64;
+        }
+
+        return OSWRAPPER_AUDIO__SAMPLE_F32;
+    }
+
+    switch (bits_per_channel) {
+    case 8:
+        return OSWRAPPER_AUDIO__SAMPLE_S8;
+
+    case 16:
+        return OSWRAPPER_AUDIO__SAMPLE_S16;
+
+    case 24:
+        return OSWRAPPER_AUDIO__SAMPLE_S24;
+
+    case 32:
+        /* Use the input format if it's 32 bit floating point PCM and the audio type wasn't hinted */
+        return audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET && input_format == OSWRAPPER_AUDIO__SAMPLE_F32 ? OSWRAPPER_AUDIO__SAMPLE_F32 : OSWRAPPER_AUDIO__SAMPLE_S32;
+
+    case 64:
+        if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET) {
+            return OSWRAPPER_AUDIO__SAMPLE_F64;
+        }
+
+        break;
+
+    default:
+        break;
+    }
+
+    /* Integer PCM was hinted, use the input format if it's integer PCM, otherwise fall back to 16 bit PCM */
+    if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER && input_is_float) {
+        return OSWRAPPER_AUDIO__SAMPLE_S16;
+    }
+
+    return input_format;
+}
+
+/* Sets the output format of the given OSWrapper_audio_spec to the given sample format */
+static void oswrapper_audio__set_spec_sample_format(OSWrapper_audio_spec* audio, oswrapper_audio__sample_format format, OSWRAPPER_AUDIO_RESULT_TYPE big_endian) {
+    audio->bits_per_channel = oswrapper_audio__sample_format_bits(format);
+    audio->audio_type = oswrapper_audio__sample_format_is_float(format) ? OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT : OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    audio->endianness_type = big_endian ? OSWRAPPER_AUDIO_ENDIANNESS_BIG : OSWRAPPER_AUDIO_ENDIANNESS_LITTLE;
+}
+
+/* Returns whether the hinted output byte order is big-endian */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__get_hinted_big_endian(const OSWrapper_audio_spec* audio) {
+    if (audio->endianness_type == OSWRAPPER_AUDIO_ENDIANNESS_USE_SYSTEM_DEFAULT) {
+        return oswrapper_audio__system_is_big_endian();
+    }
+
+    return audio->endianness_type == OSWRAPPER_AUDIO_ENDIANNESS_BIG ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+static void oswrapper_audio__converter_init(oswrapper_audio__converter* converter, oswrapper_audio__sample_format input_format, OSWRAPPER_AUDIO_RESULT_TYPE input_big_endian, oswrapper_audio__sample_format output_format, OSWRAPPER_AUDIO_RESULT_TYPE output_big_endian) {
+    OSWRAPPER_AUDIO_RESULT_TYPE system_big_endian = oswrapper_audio__system_is_big_endian();
+    converter->input_format = input_format;
+    converter->output_format = output_format;
+    /* Byte order doesn't matter for 8 bit samples */
+    converter->swap_input = oswrapper_audio__sample_format_bits(input_format) > 8 && !input_big_endian != !system_big_endian;
+    converter->swap_output = oswrapper_audio__sample_format_bits(output_format) > 8 && !output_big_endian != !system_big_endian;
+}
+
+/* Returns whether the converter just copies the samples */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__converter_is_passthrough(const oswrapper_audio__converter* converter) {
+    return converter->input_format == converter->output_format && converter->swap_input == converter->swap_output ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* Reverses the byte order of each sample, for byte orders which aren't the same as this system's.
+Big-endian AIFF files are decoded by swapping each chunk of samples with this before converting them,
+so the common sample sizes have SIMD versions. */
+static void oswrapper_audio__swap_samples(unsigned char* data, size_t sample_count, size_t sample_size) {
+    size_t i = 0;
+#if defined(OSWRAPPER_AUDIO__USE_AVX2)
+
+    if (sample_size == 2 || sample_size == 4 || sample_size == 8) {
+        /* Reverses the bytes of each sample within each 128 bit lane */
+        const __m256i shuffle = sample_size == 2 ? _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+                                : sample_size == 4 ? _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+                                : _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        size_t per_vector = 32 / sample_size;
+
+        for (; i + per_vector <= sample_count; i += per_vector, data += 32) {
+            _mm256_storeu_si256((__m256i*) data, _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*) data), shuffle));
+        }
+    }
+
+#elif defined(OSWRAPPER_AUDIO__USE_SSE2)
+
+    if (sample_size == 2 || sample_size == 4 || sample_size == 8) {
+        size_t per_vector = 16 / sample_size;
+
+        for (; i + per_vector <= sample_count; i += per_vector, data += 16) {
+            __m128i samples = _mm_loadu_si128((const __m128i*) data);
+
+            /* Reverse the order of the 16 bit words in each sample first */
+            if (sample_size == 4) {
+                samples = _mm_shufflehi_epi16(_mm_shufflelo_epi16(samples, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+            } else if (sample_size == 8) {
+                samples = _mm_shufflehi_epi16(_mm_shufflelo_epi16(samples, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+            }
+
+            /* Then swap the bytes of each 16 bit word */
+            samples = _mm_or_si128(_mm_slli_epi16(samples, 8), _mm_srli_epi16(samples, 8));
+            _mm_storeu_si128((__m128i*) data, samples);
+        }
+    }
+
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+
+    if (sample_size == 2) {
+        for (; i + 8 <= sample_count; i += 8, data += 16) {
+            vst1q_u8(data, vrev16q_u8(vld1q_u8(data)));
+        }
+    } else if (sample_size == 4) {
+        for (; i + 4 <= sample_count; i += 4, data += 16) {
+            vst1q_u8(data, vrev32q_u8(vld1q_u8(data)));
+        }
+    } else if (sample_size == 8) {
+        for (; i + 2 <= sample_count; i += 2, data += 16) {
+            vst1q_u8(data, vrev64q_u8(vld1q_u8(data)));
+        }
+    }
+
+#endif
+
+    switch (sample_size) {
+    case 2:
+        for (; i < sample_count; i++, data += 2) {
+            unsigned char temp = data[0];
+            data[0] = data[1];
+            data[1] = temp;
+        }
+
+        break;
+
+    case 3:
+        for (; i < sample_count; i++, data += 3) {
+            unsigned char temp = data[0];
+            data[0] = data[2];
+            data[2] = temp;
+        }
+
+        break;
+
+    case 4:
+        for (; i < sample_count; i++, data += 4) {
+            oswrapper_audio__uint32 value;
+            OSWRAPPER_AUDIO_MEMCPY(&value, data, 4);
+            value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+            OSWRAPPER_AUDIO_MEMCPY(data, &value, 4);
+        }
+
+        break;
+
+    case 8:
+        for (; i < sample_count; i++, data += 8) {
+            size_t j;
+
+            for (j = 0; j < 4; j++) {
+                unsigned char temp = data[j];
+                data[j] = data[7 - j];
+                data[7 - j] = temp;
+            }
+        }
+
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* Plain C versions of the common conversions. These are also used for the samples left over by the SIMD versions. */
+static void oswrapper_audio__convert_s16_to_f32_scalar(const short* input, float* output, size_t sample_count) {
+    size_t i;
+
+    for (i = 0; i < sample_count; i++) {
+        output[i] = (float) input[i] * (1.0f / 32768.0f);
+    }
+}
+
+static void oswrapper_audio__convert_s32_to_f32_scalar(const oswrapper_audio__int32* input, float* output, size_t sample_count) {
+    size_t i;
+
+    for (i = 0; i < sample_count; i++) {
+        output[i] = (float) input[i] * (1.0f / 2147483648.0f);
+    }
+}
+
+static void oswrapper_audio__convert_f32_to_s16_scalar(const float* input, short* output, size_t sample_count) {
+    size_t i;
+
+    for (i = 0; i < sample_count; i++) {
+        float scaled = input[i] * 32768.0f;
+
+        /* Also catches NaN */
+        if (!(scaled >= -32768.0f)) {
+            scaled = -32768.0f;
+        } else if (scaled > 32767.0f) {
+            scaled = 32767.0f;
+        }
+
+        output[i] = (short) scaled;
+    }
+}
+
+static void oswrapper_audio__convert_s16_to_f32(const short* input, float* output, size_t sample_count) {
+    size_t i = 0;
+#if defined(OSWRAPPER_AUDIO__USE_AVX2)
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+
+    for (; i + 8 <= sample_count; i += 8) {
+        __m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*) (input + i)));
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+
+#elif defined(OSWRAPPER_AUDIO__USE_SSE2)
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+    for (; i + 8 <= sample_count; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i*) (input + i));
+        /* Sign extend by unpacking into the high half, then shifting down */
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+    const float32x4_t scale = vdupq_n_f32(1.0f / 32768.0f);
+
+    for (; i + 8 <= sample_count; i += 8) {
+        int16x8_t samples = vld1q_s16(input + i);
+        vst1q_f32(output + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), scale));
+        vst1q_f32(output + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), scale));
+    }
+
+#endif
+    oswrapper_audio__convert_s16_to_f32_scalar(input + i, output + i, sample_count - i);
+}
+
+static void oswrapper_audio__convert_s32_to_f32(const oswrapper_audio__int32* input, float* output, size_t sample_count) {
+    size_t i = 0;
+#if defined(OSWRAPPER_AUDIO__USE_AVX2)
+    const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+
+    for (; i + 8 <= sample_count; i += 8) {
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (input + i))), scale));
+    }
+
+#elif defined(OSWRAPPER_AUDIO__USE_SSE2)
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+
+    for (; i + 4 <= sample_count; i += 4) {
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (input + i))), scale));
+    }
+
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+    const float32x4_t scale = vdupq_n_f32(1.0f / 2147483648.0f);
+
+    for (; i + 4 <= sample_count; i += 4) {
+        vst1q_f32(output + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(input + i)), scale));
+    }
+
+#endif
+    oswrapper_audio__convert_s32_to_f32_scalar(input + i, output + i, sample_count - i);
+}
+
+static void oswrapper_audio__convert_f32_to_s16(const float* input, short* output, size_t sample_count) {
+    size_t i = 0;
+#if defined(OSWRAPPER_AUDIO__USE_SSE2)
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 min = _mm_set1_ps(-32768.0f);
+    const __m128 max = _mm_set1_ps(32767.0f);
+
+    for (; i + 8 <= sample_count; i += 8) {
+        /* max returns the second operand for NaN, the same as the plain C version */
+        __m128 low = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i), scale), min), max);
+        __m128 high = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale), min), max);
+        _mm_storeu_si128((__m128i*) (output + i), _mm_packs_epi32(_mm_cvttps_epi32(low), _mm_cvttps_epi32(high)));
+    }
+
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+    const float32x4_t scale = vdupq_n_f32(32768.0f);
+
+    for (; i + 8 <= sample_count; i += 8) {
+        /* Saturated when narrowing */
+        int32x4_t low = vcvtq_s32_f32(vmulq_f32(vld1q_f32(input + i), scale));
+        int32x4_t high = vcvtq_s32_f32(vmulq_f32(vld1q_f32(input + i + 4), scale));
+        vst1q_s16(output + i, vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+    }
+
+#endif
+    oswrapper_audio__convert_f32_to_s16_scalar(input + i, output + i, sample_count - i);
+}
+
+/* Converts a float sample to an integer sample with the given amount of bits, stored in the top bits of a 32 bit integer */
+static oswrapper_audio__int32 oswrapper_audio__float_to_s32(double sample, unsigned int bits) {
+    double scale = (double) (1UL << (bits - 1));
+    double scaled = sample * scale;
+
+    /* Also catches NaN */
+    if (!(scaled >= -scale)) {
+        scaled = -scale;
+    } else if (scaled > scale - 1.0) {
+        scaled = scale - 1.0;
+    }
+
+    return (oswrapper_audio__int32) ((oswrapper_audio__uint32) (oswrapper_audio__int32) scaled << (32 - bits));
+}
+
+/* Decodes a G.711 mu-law sample to 16 bit integer PCM */
+static short oswrapper_audio__ulaw_to_s16(unsigned char sample) {
+    int exponent;
+    int magnitude;
+    sample = (unsigned char) ~sample;
+    exponent = (sample >> 4) & 7;
+    magnitude = ((((sample & 0x0F) << 3) + 0x84) << exponent) - 0x84;
+    return (short) ((sample & 0x80) ? -magnitude : magnitude);
+}
+
+/* Decodes a G.711 A-law sample to 16 bit integer PCM */
+static short oswrapper_audio__alaw_to_s16(unsigned char sample) {
+    int exponent;
+    int magnitude;
+    sample ^= 0x55;
+    exponent = (sample >> 4) & 7;
+    magnitude = (sample & 0x0F) << 4;
+    magnitude = exponent == 0 ? magnitude + 8 : (magnitude + 0x108) << (exponent - 1);
+    return (short) ((sample & 0x80) ? magnitude : -magnitude);
+}
+
+/* Reads samples in any format to integer samples stored in the top bits of a 32 bit integer.
+output_bits is the amount of bits the output format has, which float samples are rounded to. */
+static void oswrapper_audio__read_samples_s32(const unsigned char* input, oswrapper_audio__sample_format format, oswrapper_audio__int32* output, size_t sample_count, unsigned int output_bits) {
+    size_t i;
+
+    switch (format) {
+    case OSWRAPPER_AUDIO__SAMPLE_U8:
+        for (i = 0; i < sample_count; i++) {
+            output[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) (input[i] ^ 0x80) << 24);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S8:
+        for (i = 0; i < sample_count; i++) {
+            output[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) input[i] << 24);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S16:
+        for (i = 0; i < sample_count; i++) {
+            short sample;
+            OSWRAPPER_AUDIO_MEMCPY(&sample, input + (i * 2), 2);
+            output[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) sample << 16);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S24:
+        /* The samples are in the byte order of the system at this point */
+        if (oswrapper_audio__system_is_big_endian()) {
+            for (i = 0; i < sample_count; i++, input += 3) {
+                output[i] = (oswrapper_audio__int32) (((oswrapper_audio__uint32) input[0] << 24) | ((oswrapper_audio__uint32) input[1] << 16) | ((oswrapper_audio__uint32) input[2] << 8));
+            }
+        } else {
+            for (i = 0; i < sample_count; i++, input += 3) {
+                output[i] = (oswrapper_audio__int32) (((oswrapper_audio__uint32) input[2] << 24) | ((oswrapper_audio__uint32) input[1] << 16) | ((oswrapper_audio__uint32) input[0] << 8));
+            }
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S32:
+        OSWRAPPER_AUDIO_MEMCPY(output, input, sample_count * 4);
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_F32:
+        for (i = 0; i < sample_count; i++) {
+            float sample;
+            OSWRAPPER_AUDIO_MEMCPY(&sample, input + (i * 4), 4);
+            output[i] = oswrapper_audio__float_to_s32(sample, output_bits);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_F64:
+        for (i = 0; i < sample_count; i++) {
+            double sample;
+            OSWRAPPER_AUDIO_MEMCPY(&sample, input + (i * 8), 8);
+            output[i] = oswrapper_audio__float_to_s32(sample, output_bits);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_ULAW:
+        for (i = 0; i < sample_count; i++) {
+            output[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) oswrapper_audio__ulaw_to_s16(input[i]) << 16);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_ALAW:
+        for (i = 0; i < sample_count; i++) {
+            output[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) oswrapper_audio__alaw_to_s16(input[i]) << 16);
+        }
+
+        break;
+    }
+}
+
+/* Writes integer samples stored in the top bits of a 32 bit integer to an integer format */
+static void oswrapper_audio__write_samples_s32(const oswrapper_audio__int32* input, oswrapper_audio__sample_format format, unsigned char* output, size_t sample_count) {
+    size_t i;
+
+    switch (format) {
+    case OSWRAPPER_AUDIO__SAMPLE_U8:
+        for (i = 0; i < sample_count; i++) {
+            output[i] = (unsigned char) (((oswrapper_audio__uint32) input[i] >> 24) ^ 0x80);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S8:
+        for (i = 0; i < sample_count; i++) {
+            output[i] = (unsigned char) ((oswrapper_audio__uint32) input[i] >> 24);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S16:
+        for (i = 0; i < sample_count; i++) {
+            short sample = (short) (input[i] >> 16);
+            OSWRAPPER_AUDIO_MEMCPY(output + (i * 2), &sample, 2);
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_S24:
+        if (oswrapper_audio__system_is_big_endian()) {
+            for (i = 0; i < sample_count; i++, output += 3) {
+                output[0] = (unsigned char) ((oswrapper_audio__uint32) input[i] >> 24);
+                output[1] = (unsigned char) ((oswrapper_audio__uint32) input[i] >> 16);
+                output[2] = (unsigned char) ((oswrapper_audio__uint32) input[i] >> 8);
+            }
+        } else {
+            for (i = 0; i < sample_count; i++, output += 3) {
+                output[0] = (unsigned char) ((oswrapper_audio__uint32) input[i] >> 8);
+                output[1] = (unsigned char) ((oswrapper_audio__uint32) input[i] >> 16);
+                output[2] = (unsigned char) ((oswrapper_audio__uint32) input[i] >> 24);
+            }
+        }
+
+        break;
+
+    default:
+        OSWRAPPER_AUDIO_MEMCPY(output, input, sample_count * 4);
+        break;
+    }
+}
+
+/* Reads samples in any format to 32 bit float samples */
+static void oswrapper_audio__read_samples_f32(const unsigned char* input, oswrapper_audio__sample_format format, float* output, size_t sample_count) {
+    size_t i;
+
+    switch (format) {
+    case OSWRAPPER_AUDIO__SAMPLE_F32:
+        OSWRAPPER_AUDIO_MEMCPY(output, input, sample_count * 4);
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_F64:
+        for (i = 0; i < sample_count; i++) {
+            double sample;
+            OSWRAPPER_AUDIO_MEMCPY(&sample, input + (i * 8), 8);
+            output[i] = (float) sample;
+        }
+
+        break;
+
+    default: {
+        /* Read as 32 bit integers first, this is exact for every integer format */
+        oswrapper_audio__int32 samples[OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE];
+        oswrapper_audio__read_samples_s32(input, format, samples, sample_count, 32);
+        oswrapper_audio__convert_s32_to_f32(samples, output, sample_count);
+        break;
+    }
+    }
+}
+
+/* Reads samples in any format to 64 bit float samples */
+static void oswrapper_audio__read_samples_f64(const unsigned char* input, oswrapper_audio__sample_format format, double* output, size_t sample_count) {
+    size_t i;
+
+    switch (format) {
+    case OSWRAPPER_AUDIO__SAMPLE_F32:
+        for (i = 0; i < sample_count; i++) {
+            float sample;
+            OSWRAPPER_AUDIO_MEMCPY(&sample, input + (i * 4), 4);
+            output[i] = sample;
+        }
+
+        break;
+
+    case OSWRAPPER_AUDIO__SAMPLE_F64:
+        OSWRAPPER_AUDIO_MEMCPY(output, input, sample_count * 8);
+        break;
+
+    default: {
+        oswrapper_audio__int32 samples[OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE];
+        oswrapper_audio__read_samples_s32(input, format, samples, sample_count, 32);
+
+        for (i = 0; i < sample_count; i++) {
+            output[i] = (double) samples[i] * (1.0 / 2147483648.0);
+        }
+
+        break;
+    }
+    }
+}
+
+/* Converts sample_count samples from input to output. The input and output must not overlap. */
+static void oswrapper_audio__convert_samples(const oswrapper_audio__converter* converter, const void* input, void* output, size_t sample_count) {
+    size_t input_size = oswrapper_audio__sample_format_bits(converter->input_format) / 8;
+    size_t output_size = oswrapper_audio__sample_format_bits(converter->output_format) / 8;
+    const unsigned char* input_bytes = (const unsigned char*) input;
+    unsigned char* output_bytes = (unsigned char*) output;
+
+    if (oswrapper_audio__converter_is_passthrough(converter)) {
+        OSWRAPPER_AUDIO_MEMCPY(output, input, sample_count * input_size);
+        return;
+    }
+
+    while (sample_count > 0) {
+        /* Aligned for any sample type */
+        double swapped[OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE];
+        const unsigned char* chunk_input = input_bytes;
+        size_t chunk_size = sample_count < OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE ? sample_count : OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE;
+
+        if (converter->swap_input) {
+            OSWRAPPER_AUDIO_MEMCPY(swapped, input_bytes, chunk_size * input_size);
+            oswrapper_audio__swap_samples((unsigned char*) swapped, chunk_size, input_size);
+            chunk_input = (const unsigned char*) swapped;
+        }
+
+        if (converter->input_format == converter->output_format) {
+            /* Only the byte order is different */
+            OSWRAPPER_AUDIO_MEMCPY(output_bytes, chunk_input, chunk_size * input_size);
+        } else if ((converter->input_format == OSWRAPPER_AUDIO__SAMPLE_U8 || converter->input_format == OSWRAPPER_AUDIO__SAMPLE_S8) && output_size == 1) {
+            /* Converting between signed and unsigned 8 bit PCM just flips the top bit */
+            size_t i;
+
+            for (i = 0; i < chunk_size; i++) {
+                output_bytes[i] = chunk_input[i] ^ 0x80;
+            }
+        } else if (converter->input_format == OSWRAPPER_AUDIO__SAMPLE_S16 && converter->output_format == OSWRAPPER_AUDIO__SAMPLE_F32 && ((size_t) chunk_input & 1) == 0 && ((size_t) output_bytes & 3) == 0) {
+            oswrapper_audio__convert_s16_to_f32((const short*) chunk_input, (float*) output_bytes, chunk_size);
+        } else if (converter->input_format == OSWRAPPER_AUDIO__SAMPLE_S32 && converter->output_format == OSWRAPPER_AUDIO__SAMPLE_F32 && ((size_t) chunk_input & 3) == 0 && ((size_t) output_bytes & 3) == 0) {
+            oswrapper_audio__convert_s32_to_f32((const oswrapper_audio__int32*) chunk_input, (float*) output_bytes, chunk_size);
+        } else if (converter->input_format == OSWRAPPER_AUDIO__SAMPLE_F32 && converter->output_format == OSWRAPPER_AUDIO__SAMPLE_S16 && ((size_t) chunk_input & 3) == 0 && ((size_t) output_bytes & 1) == 0) {
+            oswrapper_audio__convert_f32_to_s16((const float*) chunk_input, (short*) output_bytes, chunk_size);
+        } else if (converter->output_format == OSWRAPPER_AUDIO__SAMPLE_F32) {
+            float samples[OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE];
+            oswrapper_audio__read_samples_f32(chunk_input, converter->input_format, samples, chunk_size);
+            OSWRAPPER_AUDIO_MEMCPY(output_bytes, samples, chunk_size * 4);
+        } else if (converter->output_format == OSWRAPPER_AUDIO__SAMPLE_F64) {
+            double samples[OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE];
+            oswrapper_audio__read_samples_f64(chunk_input, converter->input_format, samples, chunk_size);
+            OSWRAPPER_AUDIO_MEMCPY(output_bytes, samples, chunk_size * 8);
+        } else {
+            oswrapper_audio__int32 samples[OSWRAPPER_AUDIO__CONVERT_CHUNK_SIZE];
+            oswrapper_audio__read_samples_s32(chunk_input, converter->input_format, samples, chunk_size, (unsigned int) output_size * 8);
+            oswrapper_audio__write_samples_s32(samples, converter->output_format, output_bytes, chunk_size);
+        }
+
+        if (converter->swap_output) {
+            oswrapper_audio__swap_samples(output_bytes, chunk_size, output_size);
+        }
+
+        input_bytes += chunk_size * input_size;
+        output_bytes += chunk_size * output_size;
+        sample_count -= chunk_size;
+    }
+}
+
+/* Remixes interleaved 32 bit floating point PCM in the byte order of this system to a different channel count */
+typedef struct oswrapper_audio__remixer {
+    unsigned int input_channels;
+    unsigned int output_channels;
+    /* For each input channel, how much it adds to each output channel.
+    Each column has column_size coefficients, the ones after output_channels are 0. */
+    float* matrix;
+    size_t column_size;
+    /* Space for buffer_frames frames of input and output */
+    size_t buffer_frames;
+    float* input_buffer;
+    float* output_buffer;
+} oswrapper_audio__remixer;
+
+/* Fills in the standard matrix for remixing between the given channel counts.
+The matrix has a row of input_channels coefficients for each output channel.
+Channels are assumed to be in the order used by WAVE files. */
+static void oswrapper_audio__standard_remix_matrix(unsigned int input_channels, unsigned int output_channels, float* matrix) {
+    /* Centre and surround channels are mixed into the front channels at -3 dB */
+    const float quiet = 0.70710678f;
+    float stereo[2][8];
+    OSWRAPPER_AUDIO_RESULT_TYPE has_stereo = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    unsigned int in_channel;
+    unsigned int out_channel;
+
+    for (in_channel = 0; in_channel < 8; in_channel++) {
+        stereo[0][in_channel] = 0;
+        stereo[1][in_channel] = 0;
+    }
+
+    for (out_channel = 0; out_channel < output_channels; out_channel++) {
+        for (in_channel = 0; in_channel < input_channels; in_channel++) {
+            matrix[(out_channel * input_channels) + in_channel] = 0;
+        }
+    }
+
+    /* The stereo downmix of each layout */
+    switch (input_channels) {
+    case 1:
+        stereo[0][0] = 1;
+        stereo[1][0] = 1;
+        break;
+
+    case 2:
+        stereo[0][0] = 1;
+        stereo[1][1] = 1;
+        break;
+
+    case 3:
+        /* Front left, front right, centre */
+        stereo[0][0] = 1;
+        stereo[1][1] = 1;
+        stereo[0][2] = quiet;
+        stereo[1][2] = quiet;
+        break;
+
+    case 4:
+        /* Quad: front left, front right, back left, back right */
+        stereo[0][0] = 1;
+        stereo[1][1] = 1;
+        stereo[0][2] = quiet;
+        stereo[1][3] = quiet;
+        break;
+
+    case 5:
+    case 6:
+    case 8:
+        /* 5.0, 5.1, and 7.1: front left, front right, centre, LFE, then pairs of surround channels.
+        5.0 has no LFE channel, and the LFE channel isn't mixed in. */
+        stereo[0][0] = 1;
+        stereo[1][1] = 1;
+        stereo[0][2] = quiet;
+        stereo[1][2] = quiet;
+
+        for (in_channel = input_channels == 5 ? 3 : 4; in_channel + 1 < input_channels; in_channel += 2) {
+            stereo[0][in_channel] = quiet;
+            stereo[1][in_channel + 1] = quiet;
+        }
+
+        break;
+
+    default:
+        has_stereo = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        break;
+    }
+
+    if (has_stereo) {
+        /* Each output channel is normalised so it can't clip */
+        for (out_channel = 0; out_channel < 2; out_channel++) {
+            float sum = 0;
+
+            for (in_channel = 0; in_channel < input_channels; in_channel++) {
+                sum += stereo[out_channel][in_channel];
+            }
+
+            for (in_channel = 0; in_channel < input_channels; in_channel++) {
+                stereo[out_channel][in_channel] /= sum;
+            }
+        }
+    }
+
+    if (output_channels == 1) {
+        /* Average the stereo downmix, or every channel for unknown layouts */
+        for (in_channel = 0; in_channel < input_channels; in_channel++) {
+            matrix[in_channel] = has_stereo ? (stereo[0][in_channel] + stereo[1][in_channel]) * 0.5f : 1.0f / input_channels;
+        }
+    } else if (has_stereo && (output_channels == 2 || input_channels <= 2)) {
+        /* Downmixing to stereo, or upmixing mono or stereo to the front channels */
+        for (out_channel = 0; out_channel < 2; out_channel++) {
+            for (in_channel = 0; in_channel < input_channels; in_channel++) {
+                matrix[(out_channel * input_channels) + in_channel] = stereo[out_channel][in_channel];
+            }
+        }
+    } else {
+        /* Copy each channel which exists in both, and leave any extra output channels silent */
+        for (out_channel = 0; out_channel < output_channels && out_channel < input_channels; out_channel++) {
+            matrix[(out_channel * input_channels) + out_channel] = 1;
+        }
+    }
+}
+
+/* The size of a remixer, which is allocated together with its matrix and buffers */
+static size_t oswrapper_audio__remixer_size(unsigned int input_channels, unsigned int output_channels, size_t buffer_frames) {
+    size_t column_size = (output_channels + 3) & ~(size_t) 3;
+    return sizeof(oswrapper_audio__remixer) + sizeof(float) * ((input_channels * column_size) + (output_channels * input_channels) + (buffer_frames * (input_channels + output_channels)));
+}
+
+/* Creates a remixer with the given matrix, which has a row of input_channels coefficients for each output channel.
+The standard matrix for the channel counts is used if the matrix is NULL. */
+static oswrapper_audio__remixer* oswrapper_audio__create_remixer(unsigned int input_channels, unsigned int output_channels, const float* matrix, size_t buffer_frames, const OSWrapper_audio_allocator* allocator) {
+    oswrapper_audio__remixer* remixer;
+    /* Padded for SIMD */
+    size_t column_size = (output_channels + 3) & ~(size_t) 3;
+    unsigned int in_channel;
+    size_t out_channel;
+    /* Everything is allocated together, the arrays of floats are aligned by following the struct */
+    remixer = (oswrapper_audio__remixer*) oswrapper_audio__malloc(allocator, oswrapper_audio__remixer_size(input_channels, output_channels, buffer_frames));
+
+    if (remixer == NULL) {
+        return NULL;
+    }
+
+    remixer->input_channels = input_channels;
+    remixer->output_channels = output_channels;
+    remixer->matrix = (float*) (remixer + 1);
+    remixer->column_size = column_size;
+    remixer->buffer_frames = buffer_frames;
+    remixer->input_buffer = remixer->matrix + (input_channels * column_size);
+    remixer->output_buffer = remixer->input_buffer + (buffer_frames * input_channels);
+
+    if (matrix == NULL) {
+        /* Built in the space after the output buffer */
+        float* standard_matrix = remixer->output_buffer + (buffer_frames * output_channels);
+        oswrapper_audio__standard_remix_matrix(input_channels, output_channels, standard_matrix);
+        matrix = standard_matrix;
+    }
+
+    /* Stored one column per input channel, so each input sample is multiplied by a whole column at once */
+    for (in_channel = 0; in_channel < input_channels; in_channel++) {
+        for (out_channel = 0; out_channel < column_size; out_channel++) {
+            remixer->matrix[(in_channel * column_size) + out_channel] = out_channel < output_channels ? matrix[(out_channel * input_channels) + in_channel] : 0.0f;
+        }
+    }
+
+    return remixer;
+}
+
+/* Creates a remixer for the hinted channel matrix or channel count, or sets it to NULL if no remixing is needed.
+Returns 0 if the hinted channel matrix doesn't fit the audio, or if the remixer couldn't be created. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__create_hinted_remixer(const OSWrapper_audio_spec* hints, unsigned int input_channels, size_t buffer_frames, oswrapper_audio__remixer** remixer) {
+    const OSWrapper_audio_channel_matrix* channel_matrix = hints->channel_matrix;
+    *remixer = NULL;
+
+    if (channel_matrix != NULL) {
+        if (input_channels == 0 || channel_matrix->input_channel_count != input_channels || channel_matrix->output_channel_count == 0 || channel_matrix->coefficients == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        *remixer = oswrapper_audio__create_remixer(input_channels, channel_matrix->output_channel_count, channel_matrix->coefficients, buffer_frames, hints->allocator);
+    } else if (hints->channel_count != 0 && hints->channel_count != input_channels && input_channels != 0) {
+        *remixer = oswrapper_audio__create_remixer(input_channels, hints->channel_count, NULL, buffer_frames, hints->allocator);
+    } else {
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+    return *remixer != NULL ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* Remixes frame_count frames from input to output. The input and output must not overlap. */
+static void oswrapper_audio__remix(const oswrapper_audio__remixer* remixer, const float* input, float* output, size_t frame_count) {
+    unsigned int input_channels = remixer->input_channels;
+    unsigned int output_channels = remixer->output_channels;
+    size_t frame = 0;
+    unsigned int in_channel;
+    unsigned int out_channel;
+#if defined(OSWRAPPER_AUDIO__USE_SSE2) || defined(OSWRAPPER_AUDIO__USE_NEON)
+    /* Each input sample is multiplied by its column of the matrix, and added to every output channel at once.
+    The padding at the end of the columns is stored past the end of each output frame,
+    which is overwritten by the next frame, so only the last few frames need to be done separately. */
+    const float* matrix = remixer->matrix;
+    size_t column_size = remixer->column_size;
+    size_t output_samples = frame_count * output_channels;
+
+    if (output_channels <= 4) {
+        for (; (frame * output_channels) + 4 <= output_samples; frame++) {
+            const float* frame_input = input + (frame * input_channels);
+#if defined(OSWRAPPER_AUDIO__USE_SSE2)
+            __m128 sum = _mm_mul_ps(_mm_set1_ps(frame_input[0]), _mm_loadu_ps(matrix));
+
+            for (in_channel = 1; in_channel < input_channels; in_channel++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(frame_input[in_channel]), _mm_loadu_ps(matrix + (in_channel * column_size))));
+            }
+
+            _mm_storeu_ps(output + (frame * output_channels), sum);
+#else
+            float32x4_t sum = vmulq_n_f32(vld1q_f32(matrix), frame_input[0]);
+
+            for (in_channel = 1; in_channel < input_channels; in_channel++) {
+                sum = vmlaq_n_f32(sum, vld1q_f32(matrix + (in_channel * column_size)), frame_input[in_channel]);
+            }
+
+            vst1q_f32(output + (frame * output_channels), sum);
+#endif
+        }
+    } else if (output_channels <= 8) {
+        for (; (frame * output_channels) + 8 <= output_samples; frame++) {
+            const float* frame_input = input + (frame * input_channels);
+#if defined(OSWRAPPER_AUDIO__USE_SSE2)
+            __m128 sample = _mm_set1_ps(frame_input[0]);
+            __m128 low = _mm_mul_ps(sample, _mm_loadu_ps(matrix));
+            __m128 high = _mm_mul_ps(sample, _mm_loadu_ps(matrix + 4));
+
+            for (in_channel = 1; in_channel < input_channels; in_channel++) {
+                const float* column = matrix + (in_channel * column_size);
+                sample = _mm_set1_ps(frame_input[in_channel]);
+                low = _mm_add_ps(low, _mm_mul_ps(sample, _mm_loadu_ps(column)));
+                high = _mm_add_ps(high, _mm_mul_ps(sample, _mm_loadu_ps(column + 4)));
+            }
+
+            _mm_storeu_ps(output + (frame * output_channels), low);
+            _mm_storeu_ps(output + (frame * output_channels) + 4, high);
+#else
+            float32x4_t low = vmulq_n_f32(vld1q_f32(matrix), frame_input[0]);
+            float32x4_t high = vmulq_n_f32(vld1q_f32(matrix + 4), frame_input[0]);
+
+            for (in_channel = 1; in_channel < input_channels; in_channel++) {
+                const float* column = matrix + (in_channel * column_size);
+                low = vmlaq_n_f32(low, vld1q_f32(column), frame_input[in_channel]);
+                high = vmlaq_n_f32(high, vld1q_f32(column + 4), frame_input[in_channel]);
+            }
+
+            vst1q_f32(output + (frame * output_channels), low);
+            vst1q_f32(output + (frame * output_channels) + 4, high);
+#endif
+        }
+    }
+
+#endif
+
+    for (; frame < frame_count; frame++) {
+        const float* frame_input = input + (frame * input_channels);
+        float* frame_output = output + (frame * output_channels);
+
+        for (out_channel = 0; out_channel < output_channels; out_channel++) {
+            const float* coefficient = remixer->matrix + out_channel;
+            float sum = 0;
+
+            for (in_channel = 0; in_channel < input_channels; in_channel++) {
+                sum += frame_input[in_channel] * coefficient[in_channel * remixer->column_size];
+            }
+
+            frame_output[out_channel] = sum;
+        }
+    }
+}
+
+/* Remixes frame_count frames (at most buffer_frames) from input, and converts them to the output format.
+When no conversion is needed, the frames are remixed straight into the output. */
+static void oswrapper_audio__remix_to_output(const oswrapper_audio__remixer* remixer, const oswrapper_audio__converter* converter, const float* input, unsigned char* output, size_t frame_count) {
+    if (oswrapper_audio__converter_is_passthrough(converter) && ((size_t) output & 3) == 0) {
+        oswrapper_audio__remix(remixer, input, (float*) output, frame_count);
+    } else {
+        oswrapper_audio__remix(remixer, input, remixer->output_buffer, frame_count);
+        oswrapper_audio__convert_samples(converter, remixer->output_buffer, output, frame_count * remixer->output_channels);
+    }
+}
+/* End shared sample conversion */
+#endif /* defined(OSWRAPPER_AUDIO_USE_PORTABLE_IMPL) || defined(OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL) */
+
+#ifdef OSWRAPPER_AUDIO_USE_AUDIOTOOLBOX_IMPL
+/* Start macOS AudioToolbox implementation */
+#include <AudioToolbox/AudioConverter.h>
+#if !defined(MAC_OS_X_VERSION_10_6) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_6
+#include <CoreServices/CoreServices.h>
+#endif
+#include <AudioToolbox/ExtendedAudioFile.h>
+
+#include <AvailabilityMacros.h>
+
+#if (!defined(MAC_OS_X_VERSION_10_6) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_6) && !defined(kAudioFileReadPermission)
+#define kAudioFileReadPermission 0x01
+#endif
+
+#if (!defined(MAC_OS_X_VERSION_10_13) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_13) && !defined(kAudioFormatFLAC)
+#define kAudioFormatFLAC 'flac'
+#endif
+
+typedef struct oswrapper_audio__callback_data_mac {
+    size_t data_size;
+    /* NULL when loading from callbacks */
+    const unsigned char* data;
+    /* Only used when loading from callbacks */
+    oswrapper_audio__callbacks callbacks;
+} oswrapper_audio__callback_data_mac;
+
+typedef struct oswrapper_audio__internal_data_mac {
+    AudioFileID audio_file;
+    ExtAudioFileRef audio_file_ext;
+    oswrapper_audio__callback_data_mac* callback_data;
+    /* ExtAudioFileSeek and ExtAudioFileTell use frames at the sample rate of the file */
+    Float64 file_sample_rate;
+} oswrapper_audio__internal_data_mac;
+
+static OSStatus oswrapper_audio__audio_file_read_callback(void* inClientData, SInt64 inPosition, UInt32 requestCount, void* buffer, UInt32* actualCount) {
+    size_t bytes_read;
+    oswrapper_audio__callback_data_mac* callback_data = (oswrapper_audio__callback_data_mac*) inClientData;
+
+    if (callback_data->data == NULL) {
+        /* Read through the user provided callbacks */
+        bytes_read = inPosition >= 0 ? oswrapper_audio__callbacks_read_at(&callback_data->callbacks, (unsigned long long) inPosition, buffer, requestCount) : 0;
+    } else if (inPosition < (SInt64) callback_data->data_size) {
+        size_t bytes_available = callback_data->data_size - inPosition;
+        bytes_read = requestCount <= bytes_available ? requestCount : bytes_available;
+        OSWRAPPER_AUDIO_MEMCPY((buffer), (callback_data->data + inPosition), (bytes_read));
+    } else {
+        bytes_read = 0;
+    }
+
+    if (actualCount != NULL) {
+        *actualCount = bytes_read;
+    }
+
+    return 0;
+}
+
+static SInt64 oswrapper_audio__audio_file_get_size_callback(void* inClientData) {
+    oswrapper_audio__callback_data_mac* callback_data = (oswrapper_audio__callback_data_mac*) inClientData;
+
+    if (callback_data->data == NULL) {
+        return (SInt64) callback_data->callbacks.size;
+    }
+
+    return callback_data->data_size;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void) {
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_uninit(void) {
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_free_context(OSWrapper_audio_spec* audio) {
+    OSStatus error;
+    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
+    error = ExtAudioFileDispose(internal_data->audio_file_ext);
+
+    if (!error) {
+        error = AudioFileClose(internal_data->audio_file);
+
+        if (!error) {
+            /* callback_data is only used for in-memory decoding, so this is expected to be NULL when decoding files. */
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+            if (internal_data->callback_data != NULL)
+#endif
+            {
+                oswrapper_audio__free(audio->allocator, internal_data->callback_data);
+            }
+
+            oswrapper_audio__free(audio->allocator, audio->internal_data);
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__load_from_open(AudioFileID audio_file, oswrapper_audio__callback_data_mac* callback_data, OSWrapper_audio_spec* audio) {
+    OSStatus error;
+    ExtAudioFileRef audio_file_ext;
+    /* Custom channel matrices aren't supported by AudioToolbox */
+    error = audio->channel_matrix != NULL ? kAudio_ParamError : ExtAudioFileWrapAudioFileID(audio_file, false, &audio_file_ext);
+
+    if (!error) {
+        AudioStreamBasicDescription input_file_format;
+        UInt32 property_size = sizeof(AudioStreamBasicDescription);
+        error = ExtAudioFileGetProperty(audio_file_ext, kExtAudioFileProperty_FileDataFormat, &property_size, &input_file_format);
+
+        if (!error) {
+            AudioStreamBasicDescription output_format;
+            output_format.mFormatID = kAudioFormatLinearPCM;
+
+            /* Use hinted output format */
+            if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
+                output_format.mFormatFlags = kLinearPCMFormatFlagIsFloat;
+            } else if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) {
+                output_format.mFormatFlags = kLinearPCMFormatFlagIsSignedInteger;
+            } else if (input_file_format.mFormatID == kAudioFormatLinearPCM && input_file_format.mFormatFlags & kLinearPCMFormatFlagIsFloat) {
+                output_format.mFormatFlags = kLinearPCMFormatFlagIsFloat;
+            } else {
+                output_format.mFormatFlags = kLinearPCMFormatFlagIsSignedInteger;
+            }
+
+            output_format.mFormatFlags |= kLinearPCMFormatFlagIsPacked;
+
+            /* Use hinted endianness */
+            if (audio->endianness_type == OSWRAPPER_AUDIO_ENDIANNESS_BIG) {
+                output_format.mFormatFlags |= kAudioFormatFlagIsBigEndian;
+            }
+
+#if defined(__ppc64__) || defined(__ppc__)
+            else if (audio->endianness_type == OSWRAPPER_AUDIO_ENDIANNESS_USE_SYSTEM_DEFAULT) {
+                output_format.mFormatFlags |= kAudioFormatFlagIsBigEndian;
+            }
+
+#endif
+            /* Use hinted sample rate */
+            output_format.mSampleRate = audio->sample_rate == 0 ? input_file_format.mSampleRate : audio->sample_rate;
+
+            /* Sanity check */
+            if (output_format.mSampleRate == 0) {
+                output_format.mSampleRate = 44100;
+            }
+
+            /* Use hinted bits per channel */
+            output_format.mBitsPerChannel = audio->bits_per_channel == 0 ? input_file_format.mBitsPerChannel : audio->bits_per_channel;
+
+            /* Get bits per channel for ALAC and FLAC files */
+            if ((output_format.mBitsPerChannel == 0) && (input_file_format.mFormatID == kAudioFormatAppleLossless || input_file_format.mFormatID == kAudioFormatFLAC)) {
+                switch (input_file_format.mFormatFlags) {
+                case kAppleLosslessFormatFlag_16BitSourceData:
+                    output_format.mBitsPerChannel = 16;
+                    break;
+
+                case kAppleLosslessFormatFlag_20BitSourceData:
+                    output_format.mBitsPerChannel = 20;
+                    break;
+
+                case kAppleLosslessFormatFlag_24BitSourceData:
+                    output_format.mBitsPerChannel = 24;
+                    break;
+
+                case kAppleLosslessFormatFlag_32BitSourceData:
+                    output_format.mBitsPerChannel = 32;
+                    break;
+
+                default:
+                    break;
+                }
+            }
+
+            /* Sanity check */
+            if (output_format.mBitsPerChannel == 0) {
+                if (output_format.mFormatFlags & kLinearPCMFormatFlagIsFloat) {
+                    output_format.mBitsPerChannel = 32;
+                } else {
+                    output_format.mBitsPerChannel = 16;
+                }
+            }
+
+            /* Use hinted channels */
+            output_format.mChannelsPerFrame = audio->channel_count == 0 ? input_file_format.mChannelsPerFrame : audio->channel_count;
+
+            /* Sanity check */
+            if (output_format.mChannelsPerFrame == 0) {
+                output_format.mChannelsPerFrame = 2;
+            }
+
+            /* kAudioFormatLinearPCM doesn't use packets */
+            output_format.mFramesPerPacket = 1;
+            /* Bytes per channel * channels per frame */
+            output_format.mBytesPerFrame = (output_format.mBitsPerChannel / 8) * output_format.mChannelsPerFrame;
+            /* Bytes per frame * frames per packet */
+            output_format.mBytesPerPacket = output_format.mBytesPerFrame * output_format.mFramesPerPacket;
+            error = ExtAudioFileSetProperty(audio_file_ext, kExtAudioFileProperty_ClientDataFormat, sizeof(AudioStreamBasicDescription), &output_format);
+
+            if (!error) {
+                oswrapper_audio__internal_data_mac* internal_data = NULL;
+
+                if (input_file_format.mChannelsPerFrame == 1 && output_format.mChannelsPerFrame == 2) {
+                    /* Try to set up appropriate channel mappings */
+                    AudioConverterRef converter = NULL;
+                    property_size = sizeof(AudioConverterRef);
+
+                    if (!ExtAudioFileGetProperty(audio_file_ext, kExtAudioFileProperty_AudioConverter, &property_size, &converter) && converter != NULL) {
                         /* Output from input mono channel to both stereo channels */
                         SInt32 channel_map[2] = {0, 0};
                         /* Failure is mostly harmless */
@@ -425,717 +3485,6965 @@ static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__load_from_open(AudioFileID a
                     }
                 }
 
-                internal_data = (oswrapper_audio__internal_data_mac*) OSWRAPPER_AUDIO_MALLOC(sizeof(oswrapper_audio__internal_data_mac));
+                internal_data = (oswrapper_audio__internal_data_mac*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__internal_data_mac));
+
+                if (internal_data != NULL) {
+                    audio->sample_rate = output_format.mSampleRate;
+                    audio->bits_per_channel = output_format.mBitsPerChannel;
+                    audio->channel_count = output_format.mChannelsPerFrame;
+                    audio->audio_type = (output_format.mFormatFlags & kLinearPCMFormatFlagIsFloat) ? OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT : OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+                    audio->endianness_type = (output_format.mFormatFlags & kAudioFormatFlagIsBigEndian) ? OSWRAPPER_AUDIO_ENDIANNESS_BIG : OSWRAPPER_AUDIO_ENDIANNESS_LITTLE;
+                    audio->internal_data = (void*) internal_data;
+                    internal_data->audio_file = audio_file;
+                    internal_data->audio_file_ext = audio_file_ext;
+                    internal_data->callback_data = callback_data;
+                    internal_data->file_sample_rate = input_file_format.mSampleRate > 0 ? input_file_format.mSampleRate : output_format.mSampleRate;
+                    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+                }
+            }
+        }
+
+        ExtAudioFileDispose(audio_file_ext);
+    }
+
+    AudioFileClose(audio_file);
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__callback_data_mac* callback_data = (oswrapper_audio__callback_data_mac*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__callback_data_mac));
+
+    if (callback_data != NULL) {
+        AudioFileID audio_file;
+        OSStatus error;
+        callback_data->data = data;
+        callback_data->data_size = data_size;
+        error = AudioFileOpenWithCallbacks((void*) callback_data, oswrapper_audio__audio_file_read_callback, NULL, oswrapper_audio__audio_file_get_size_callback, NULL, 0, &audio_file);
+
+        if (!error && oswrapper_audio__load_from_open(audio_file, callback_data, audio)) {
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        oswrapper_audio__free(audio->allocator, callback_data);
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size(const OSWrapper_audio_spec* hints, unsigned int max_channel_count, unsigned long max_sample_rate) {
+    (void) hints;
+    (void) max_channel_count;
+    (void) max_sample_rate;
+    return 0;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size_from_memory(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints) {
+    (void) data;
+    (void) data_size;
+    (void) hints;
+    return 0;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_callbacks(OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__callback_data_mac* callback_data = (oswrapper_audio__callback_data_mac*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__callback_data_mac));
+
+    if (callback_data != NULL) {
+        AudioFileID audio_file;
+        OSStatus error;
+        callback_data->data = NULL;
+        callback_data->data_size = 0;
+
+        if (oswrapper_audio__callbacks_init(&callback_data->callbacks, read, seek, tell, user_data)) {
+            error = AudioFileOpenWithCallbacks((void*) callback_data, oswrapper_audio__audio_file_read_callback, NULL, oswrapper_audio__audio_file_get_size_callback, NULL, 0, &audio_file);
+
+            if (!error && oswrapper_audio__load_from_open(audio_file, callback_data, audio)) {
+                return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+            }
+        }
+
+        oswrapper_audio__free(audio->allocator, callback_data);
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio) {
+    AudioFileID audio_file;
+    OSStatus error;
+    CFStringRef path_cfstr;
+    CFURLRef path_url;
+#if !defined(MAC_OS_X_VERSION_10_5) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_5
+    FSRef path_fsref;
+#endif
+    path_cfstr = CFStringCreateWithCString(kCFAllocatorDefault, path, kCFStringEncodingUTF8);
+    path_url = CFURLCreateWithFileSystemPath(NULL, path_cfstr, kCFURLPOSIXPathStyle, false);
+#if !defined(MAC_OS_X_VERSION_10_5) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_5
+    CFURLGetFSRef(path_url, &path_fsref);
+    error = AudioFileOpen(&path_fsref, kAudioFileReadPermission, 0, &audio_file);
+#else
+    error = AudioFileOpenURL(path_url, kAudioFileReadPermission, 0, &audio_file);
+#endif
+    CFRelease(path_url);
+    CFRelease(path_cfstr);
+
+    if (!error && oswrapper_audio__load_from_open(audio_file, NULL, audio)) {
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+
+/* ExtAudioFile pulls data through callbacks, and can't wait for more data to arrive */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_push(OSWrapper_audio_spec* audio) {
+    (void) audio;
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_push_bytes(OSWrapper_audio_spec* audio, const unsigned char* data, size_t data_size) {
+    (void) audio;
+    (void) data;
+    (void) data_size;
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_push_end(OSWrapper_audio_spec* audio) {
+    (void) audio;
+}
+
+OSWRAPPER_AUDIO_DEF OSWrapper_audio_length_type oswrapper_audio_get_length(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* frames) {
+    AudioStreamBasicDescription input_file_format;
+    SInt64 file_length_frames;
+    UInt32 property_size;
+    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
+    property_size = sizeof(SInt64);
+
+    if (ExtAudioFileGetProperty(internal_data->audio_file_ext, kExtAudioFileProperty_FileLengthFrames, &property_size, &file_length_frames) || file_length_frames < 0) {
+        return OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+    }
+
+    property_size = sizeof(AudioStreamBasicDescription);
+
+    if (ExtAudioFileGetProperty(internal_data->audio_file_ext, kExtAudioFileProperty_FileDataFormat, &property_size, &input_file_format) || input_file_format.mSampleRate <= 0) {
+        return OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+    }
+
+    if (input_file_format.mSampleRate != audio->sample_rate) {
+        /* The length is in frames of the file format, so scale it to the output sample rate */
+        *frames = (OSWRAPPER_AUDIO_SEEK_TYPE) ((double) file_length_frames * audio->sample_rate / input_file_format.mSampleRate + 0.5);
+        return OSWRAPPER_AUDIO_LENGTH_ESTIMATED;
+    }
+
+    *frames = (OSWRAPPER_AUDIO_SEEK_TYPE) file_length_frames;
+
+    /* Formats with a constant packet size have an exact length.
+    Formats with variable packet sizes are only exact if the file stores a packet table. */
+    if (input_file_format.mBytesPerPacket == 0) {
+        UInt32 is_writable;
+        property_size = 0;
+
+        if (AudioFileGetPropertyInfo(internal_data->audio_file, kAudioFilePropertyPacketTableInfo, &property_size, &is_writable) || property_size == 0) {
+            return OSWRAPPER_AUDIO_LENGTH_ESTIMATED;
+        }
+    }
+
+    return OSWRAPPER_AUDIO_LENGTH_EXACT;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos) {
+    OSStatus error;
+    SInt64 file_pos;
+    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
+    error = ExtAudioFileTell(internal_data->audio_file_ext, &file_pos);
+
+    if (error) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (internal_data->file_sample_rate != audio->sample_rate) {
+        /* Convert from frames of the file to frames of the output format */
+        file_pos = (SInt64) ((double) file_pos * audio->sample_rate / internal_data->file_sample_rate + 0.5);
+    }
+
+    *pos = (OSWRAPPER_AUDIO_SEEK_TYPE) file_pos;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
+    SInt64 file_pos;
+    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
+
+    if (pos < 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    file_pos = (SInt64) pos;
+
+    if (internal_data->file_sample_rate != audio->sample_rate) {
+        /* Convert from frames of the output format to frames of the file */
+        file_pos = (SInt64) ((double) pos * internal_data->file_sample_rate / audio->sample_rate + 0.5);
+    }
+
+    return !ExtAudioFileSeek(internal_data->audio_file_ext, file_pos) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
+    ExtAudioFileSeek(internal_data->audio_file_ext, 0);
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do) {
+    AudioBufferList buffer_list;
+    UInt32 frames;
+    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
+    frames = frames_to_do;
+    buffer_list.mNumberBuffers = 1;
+    buffer_list.mBuffers[0].mNumberChannels = audio->channel_count;
+    buffer_list.mBuffers[0].mDataByteSize = frames_to_do * ((audio->bits_per_channel / 8) * audio->channel_count);
+    buffer_list.mBuffers[0].mData = buffer;
+    ExtAudioFileRead(internal_data->audio_file_ext, &frames, &buffer_list);
+    return frames;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_peek_samples(OSWrapper_audio_spec* audio, const void** samples, size_t* frames) {
+    /* ExtAudioFile always decodes into the caller's buffer */
+    (void) audio;
+    (void) samples;
+    (void) frames;
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_consume(OSWrapper_audio_spec* audio, size_t frames) {
+    OSWRAPPER_AUDIO_SEEK_TYPE pos;
+    return oswrapper_audio_get_pos(audio, &pos) && oswrapper_audio_seek(audio, pos + (OSWRAPPER_AUDIO_SEEK_TYPE) frames) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+/* End macOS AudioToolbox implementation */
+#elif defined(OSWRAPPER_AUDIO_USE_WIN_MF_IMPL)
+/* Start Win32 MF implementation */
+#ifndef COBJMACROS
+#define COBJMACROS
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <cguid.h>
+#include <initguid.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <shlwapi.h>
+#include <stdio.h>
+
+/* Using CINTERFACE breaks some headers, so we have to define these ourselves */
+#if defined(__cplusplus) && !defined(CINTERFACE) && !defined(OSWRAPPER_AUDIO_NO_DEFINE_WINMF_C_INTERFACE)
+#ifndef IMFAttributes_GetGUID
+#define IMFAttributes_GetGUID(attributes, ...) attributes->GetGUID(__VA_ARGS__)
+#endif
+#ifndef IMFByteStream_Release
+#define IMFByteStream_Release(byte_stream) byte_stream->Release()
+#endif
+#ifndef IMFMediaBuffer_Lock
+#define IMFMediaBuffer_Lock(media_buffer, ...) media_buffer->Lock(__VA_ARGS__)
+#endif
+#ifndef IMFMediaBuffer_Release
+#define IMFMediaBuffer_Release(media_buffer) media_buffer->Release()
+#endif
+#ifndef IMFMediaBuffer_Unlock
+#define IMFMediaBuffer_Unlock(media_buffer) media_buffer->Unlock()
+#endif
+#ifndef IMFMediaType_GetUINT32
+#define IMFMediaType_GetUINT32(media_type, ...) media_type->GetUINT32(__VA_ARGS__)
+#endif
+#ifndef IMFMediaType_Release
+#define IMFMediaType_Release(media_type) media_type->Release()
+#endif
+#ifndef IMFMediaType_SetGUID
+#define IMFMediaType_SetGUID(media_type, ...) media_type->SetGUID(__VA_ARGS__)
+#endif
+#ifndef IMFMediaType_SetUINT32
+#define IMFMediaType_SetUINT32(media_type, ...) media_type->SetUINT32(__VA_ARGS__)
+#endif
+#ifndef IMFSample_ConvertToContiguousBuffer
+#define IMFSample_ConvertToContiguousBuffer(sample, ...) sample->ConvertToContiguousBuffer(__VA_ARGS__)
+#endif
+#ifndef IMFSample_GetSampleTime
+#define IMFSample_GetSampleTime(sample, ...) sample->GetSampleTime(__VA_ARGS__)
+#endif
+#ifndef IMFSample_Release
+#define IMFSample_Release(sample) sample->Release()
+#endif
+#ifndef IMFSourceReader_GetPresentationAttribute
+#define IMFSourceReader_GetPresentationAttribute(source_reader, ...) source_reader->GetPresentationAttribute(__VA_ARGS__)
+#endif
+#ifndef IMFSourceReader_GetNativeMediaType
+#define IMFSourceReader_GetNativeMediaType(source_reader, ...) source_reader->GetNativeMediaType(__VA_ARGS__)
+#endif
+#ifndef IMFSourceReader_ReadSample
+#define IMFSourceReader_ReadSample(source_reader, ...) source_reader->ReadSample(__VA_ARGS__)
+#endif
+#ifndef IMFSourceReader_Release
+#define IMFSourceReader_Release(source_reader) source_reader->Release()
+#endif
+#ifndef IMFSourceReader_SetCurrentMediaType
+#define IMFSourceReader_SetCurrentMediaType(source_reader, ...) source_reader->SetCurrentMediaType(__VA_ARGS__)
+#endif
+#ifndef IMFSourceReader_SetCurrentPosition
+#define IMFSourceReader_SetCurrentPosition(source_reader, ...) source_reader->SetCurrentPosition(__VA_ARGS__)
+#endif
+#ifndef IMFSourceReader_SetStreamSelection
+#define IMFSourceReader_SetStreamSelection(source_reader, ...) source_reader->SetStreamSelection(__VA_ARGS__)
+#endif
+#ifndef IStream_Release
+#define IStream_Release(istream) istream->Release()
+#endif
+#endif
+
+/* TODO Ugly hack */
+#ifndef OSWRAPPER_AUDIO_PATH_MAX
+#define OSWRAPPER_AUDIO_PATH_MAX MAX_PATH
+#endif
+
+#ifdef OSWRAPPER_AUDIO_MANAGE_COINIT
+#include <objbase.h>
+
+#ifndef OSWRAPPER_AUDIO_COINIT_VALUE
+#define OSWRAPPER_AUDIO_COINIT_VALUE COINIT_MULTITHREADED
+#endif
+#endif
+
+/* The startup flags forMFStartup */
+#ifndef OSWRAPPER_AUDIO__MF_STARTUP_VAL
+#define OSWRAPPER_AUDIO__MF_STARTUP_VAL MFSTARTUP_LITE
+#endif
+
+typedef struct oswrapper_audio__internal_data_win {
+    IMFSourceReader* reader;
+    IMFByteStream* byte_stream;
+    IStream* memory_stream;
+    short* internal_buffer;
+    /* Buffer size */
+    size_t internal_buffer_size;
+    /* Remaining samples */
+    size_t internal_buffer_remaining;
+    /* Current position */
+    size_t internal_buffer_pos;
+    /* Has the reader thrown an error? */
+    OSWRAPPER_AUDIO_RESULT_TYPE no_reader_error;
+    /* Exact length in frames if the header could be parsed, otherwise -1 */
+    OSWRAPPER_AUDIO_SEEK_TYPE exact_length;
+    /* Current position in frames */
+    OSWRAPPER_AUDIO_SEEK_TYPE current_frame;
+    /* Should decoded frames before current_frame be skipped? Set after seeking. */
+    OSWRAPPER_AUDIO_RESULT_TYPE skip_to_current_frame;
+} oswrapper_audio__internal_data_win;
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void) {
+#ifdef OSWRAPPER_AUDIO_MANAGE_COINIT
+    HRESULT result = CoInitializeEx(NULL, OSWRAPPER_AUDIO_COINIT_VALUE);
+
+    if (SUCCEEDED(result)) {
+        result = MFStartup(MF_VERSION, OSWRAPPER_AUDIO__MF_STARTUP_VAL);
+
+        if (SUCCEEDED(result)) {
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        CoUninitialize();
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+#else
+    return SUCCEEDED(MFStartup(MF_VERSION, OSWRAPPER_AUDIO__MF_STARTUP_VAL)) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+#endif
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_uninit(void) {
+#ifdef OSWRAPPER_AUDIO_MANAGE_COINIT
+
+    if (FAILED(MFShutdown())) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    CoUninitialize();
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+#else
+    return SUCCEEDED(MFShutdown()) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+#endif
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_free_context(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+    IMFSourceReader_Release(internal_data->reader);
+
+    /* Only expected for decoding from memory or callbacks */
+    if (internal_data->byte_stream != NULL) {
+        IMFByteStream_Release(internal_data->byte_stream);
+    }
+
+    /* Only expected for decoding from memory or callbacks */
+    if (internal_data->memory_stream != NULL) {
+        IStream_Release(internal_data->memory_stream);
+    }
+
+    if (internal_data->internal_buffer != NULL) {
+        oswrapper_audio__free(audio->allocator, internal_data->internal_buffer);
+    }
+
+    oswrapper_audio__free(audio->allocator, audio->internal_data);
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+#define OSWRAPPER_AUDIO__END_FAIL_FALSE(cond) if(!cond) { return_val = OSWRAPPER_AUDIO_RESULT_FAILURE; goto cleanup; }
+#define OSWRAPPER_AUDIO__END_FAIL(hres) OSWRAPPER_AUDIO__END_FAIL_FALSE(SUCCEEDED(hres))
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__configure_stream(IMFSourceReader* reader, OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_RESULT_TYPE initial_configure) {
+    OSWRAPPER_AUDIO_RESULT_TYPE return_val;
+    HRESULT result;
+    UINT32 sample_rate, channel_count, bits_per_channel;
+    GUID format_type;
+    IMFMediaType* media_type;
+    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+
+    if ((initial_configure != OSWRAPPER_AUDIO_RESULT_SUCCESS) && (internal_data != NULL) && (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_FAILURE)) {
+        /* IMFSourceReader methods can no longer be called */
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    media_type = NULL;
+    result = S_OK;
+    return_val = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    channel_count = audio->channel_count;
+    sample_rate = audio->sample_rate;
+    bits_per_channel = audio->bits_per_channel;
+
+    if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
+        format_type = MFAudioFormat_Float;
+    } else if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) {
+        format_type = MFAudioFormat_PCM;
+    } else {
+        /* Fallback */
+        format_type = MFAudioFormat_PCM;
+    }
+
+    OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_SetStreamSelection(reader, (DWORD) MF_SOURCE_READER_ALL_STREAMS, FALSE));
+    OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_SetStreamSelection(reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, TRUE));
+
+    /* Get / set the format */
+    if ((sample_rate == 0) || (channel_count == 0) || (bits_per_channel == 0) || (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET)) {
+        OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_GetNativeMediaType(reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, 0, &media_type));
+
+        if (channel_count == 0) {
+#ifdef __cplusplus
+            IMFMediaType_GetUINT32(media_type, MF_MT_AUDIO_NUM_CHANNELS, &channel_count);
+#else
+            IMFMediaType_GetUINT32(media_type, &MF_MT_AUDIO_NUM_CHANNELS, &channel_count);
+#endif
+
+            /* Sanity check */
+            if (channel_count == 0) {
+                channel_count = 2;
+            }
+
+            audio->channel_count = channel_count;
+        }
+
+        if (sample_rate == 0) {
+#ifdef __cplusplus
+            IMFMediaType_GetUINT32(media_type, MF_MT_AUDIO_SAMPLES_PER_SECOND, &sample_rate);
+#else
+            IMFMediaType_GetUINT32(media_type, &MF_MT_AUDIO_SAMPLES_PER_SECOND, &sample_rate);
+#endif
+
+            /* Sanity check */
+            if (sample_rate == 0) {
+                sample_rate = 44100;
+            }
+
+            audio->sample_rate = sample_rate;
+        }
+
+        if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET) {
+#ifdef __cplusplus
+            IMFAttributes_GetGUID(media_type, MF_MT_SUBTYPE, &format_type);
+#else
+            IMFAttributes_GetGUID(media_type, &MF_MT_SUBTYPE, &format_type);
+#endif
+
+            /* Sanity check */
+            if (!OSWRAPPER_AUDIO_MEMCMP(&format_type, &MFAudioFormat_PCM, sizeof(GUID))) {
+                audio->audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+            } else if (!OSWRAPPER_AUDIO_MEMCMP(&format_type, &MFAudioFormat_Float, sizeof(GUID))) {
+                audio->audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
+            } else {
+                /* Fallback */
+                format_type = MFAudioFormat_PCM;
+                audio->audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+            }
+        }
+
+        if (bits_per_channel == 0) {
+#ifdef __cplusplus
+            IMFMediaType_GetUINT32(media_type, MF_MT_AUDIO_BITS_PER_SAMPLE, &bits_per_channel);
+#else
+            IMFMediaType_GetUINT32(media_type, &MF_MT_AUDIO_BITS_PER_SAMPLE, &bits_per_channel);
+#endif
+
+            /* Sanity check */
+            if (bits_per_channel == 0) {
+                if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
+                    bits_per_channel = 32;
+                } else {
+                    bits_per_channel = 16;
+                }
+            }
+
+            audio->bits_per_channel = bits_per_channel;
+        }
+
+        IMFMediaType_Release(media_type);
+    }
+
+    OSWRAPPER_AUDIO__END_FAIL(MFCreateMediaType(&media_type));
+#ifdef __cplusplus
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetGUID(media_type, MF_MT_MAJOR_TYPE, MFMediaType_Audio));
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetGUID(media_type, MF_MT_SUBTYPE, format_type));
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, MF_MT_AUDIO_BITS_PER_SAMPLE, audio->bits_per_channel));
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, MF_MT_AUDIO_SAMPLES_PER_SECOND, audio->sample_rate));
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, MF_MT_AUDIO_NUM_CHANNELS, audio->channel_count));
+#else
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetGUID(media_type, &MF_MT_MAJOR_TYPE, &MFMediaType_Audio));
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetGUID(media_type, &MF_MT_SUBTYPE, &format_type));
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, &MF_MT_AUDIO_BITS_PER_SAMPLE, audio->bits_per_channel));
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, &MF_MT_AUDIO_SAMPLES_PER_SECOND, audio->sample_rate));
+    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, &MF_MT_AUDIO_NUM_CHANNELS, audio->channel_count));
+#endif
+    OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_SetCurrentMediaType(reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, NULL, media_type));
+    OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_SetStreamSelection(reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, TRUE));
+cleanup:
+
+    if (media_type != NULL) {
+        IMFMediaType_Release(media_type);
+    }
+
+    return return_val;
+}
+
+/* header is the parsed header of the file, or NULL if it couldn't be parsed.
+It must be parsed before the source reader is created, as Media Foundation can read from the stream on other threads. */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__load_from_reader(IMFSourceReader* reader, IMFByteStream* byte_stream, IStream* memory_stream, const oswrapper_audio__source_info* header, OSWrapper_audio_spec* audio) {
+    /* Custom channel matrices aren't supported by Media Foundation */
+    if (audio->channel_matrix == NULL && oswrapper_audio__configure_stream(reader, audio, OSWRAPPER_AUDIO_RESULT_SUCCESS)) {
+        oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__internal_data_win));
+
+        if (internal_data != NULL) {
+            audio->endianness_type = OSWRAPPER_AUDIO_ENDIANNESS_LITTLE;
+            audio->internal_data = (void*) internal_data;
+            internal_data->reader = reader;
+            internal_data->byte_stream = byte_stream;
+            internal_data->memory_stream = memory_stream;
+            internal_data->internal_buffer = NULL;
+            internal_data->internal_buffer_pos = 0;
+            internal_data->internal_buffer_remaining = 0;
+            internal_data->internal_buffer_size = 0;
+            internal_data->no_reader_error = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+            internal_data->exact_length = -1;
+            internal_data->current_frame = 0;
+            internal_data->skip_to_current_frame = OSWRAPPER_AUDIO_RESULT_FAILURE;
+
+            /* Media Foundation only reports the duration in 100 nanosecond units,
+            so get the exact length from the header for formats with a known layout */
+            if (header != NULL && header->sample_rate == audio->sample_rate) {
+                internal_data->exact_length = (OSWRAPPER_AUDIO_SEEK_TYPE) header->total_frames;
+            }
+
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
+
+    IMFSourceReader_Release(reader);
+
+    /* Only expected for decoding from memory or callbacks */
+    if (byte_stream != NULL) {
+        IMFByteStream_Release(byte_stream);
+    }
+
+    /* Only expected for decoding from memory or callbacks */
+    if (memory_stream != NULL) {
+        IStream_Release(memory_stream);
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
+    IStream* memory_stream = SHCreateMemStream(data, (UINT) data_size);
+
+    if (memory_stream != NULL) {
+        HRESULT result;
+        IMFByteStream* byte_stream = NULL;
+        result = MFCreateMFByteStreamOnStream(memory_stream, &byte_stream);
+
+        if (SUCCEEDED(result)) {
+            IMFSourceReader* reader = NULL;
+            result = MFCreateSourceReaderFromByteStream(byte_stream, NULL, &reader);
+
+            if (SUCCEEDED(result)) {
+                oswrapper_audio__source_info header;
+                oswrapper_audio__reader header_reader;
+                oswrapper_audio__reader_init_memory(&header_reader, data, data_size);
+                return oswrapper_audio__load_from_reader(reader, byte_stream, memory_stream, oswrapper_audio__parse_header(&header_reader, &header) ? &header : NULL, audio);
+            }
+
+            IMFByteStream_Release(byte_stream);
+        }
+
+        IStream_Release(memory_stream);
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size(const OSWrapper_audio_spec* hints, unsigned int max_channel_count, unsigned long max_sample_rate) {
+    (void) hints;
+    (void) max_channel_count;
+    (void) max_sample_rate;
+    return 0;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size_from_memory(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints) {
+    (void) data;
+    (void) data_size;
+    (void) hints;
+    return 0;
+}
+
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio) {
+    HRESULT result;
+    /* TODO Ugly hack */
+    wchar_t path_buffer[OSWRAPPER_AUDIO_PATH_MAX];
+    result = MultiByteToWideChar(CP_UTF8, 0, path, -1, path_buffer, OSWRAPPER_AUDIO_PATH_MAX);
+
+    if (SUCCEEDED(result)) {
+        IMFSourceReader* reader = NULL;
+        oswrapper_audio__source_info header;
+        oswrapper_audio__reader header_reader;
+        OSWRAPPER_AUDIO_RESULT_TYPE has_header = OSWRAPPER_AUDIO_RESULT_FAILURE;
+
+        if (oswrapper_audio__reader_init_path(&header_reader, path, audio->allocator)) {
+            has_header = oswrapper_audio__parse_header(&header_reader, &header);
+            oswrapper_audio__reader_uninit(&header_reader);
+        }
+
+        result = MFCreateSourceReaderFromURL(path_buffer, NULL, &reader);
+
+        if (SUCCEEDED(result)) {
+            return oswrapper_audio__load_from_reader(reader, NULL, NULL, has_header ? &header : NULL, audio);
+        }
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+
+/* A read only IStream which reads from user provided callbacks, so Media Foundation can read the file as it decodes.
+It starts with a pointer to a table of methods in the same order as IStream's, so it can be used as an IStream from both C and C++. */
+typedef struct oswrapper_audio__callback_stream oswrapper_audio__callback_stream;
+
+typedef struct oswrapper_audio__callback_stream_vtbl {
+    HRESULT (STDMETHODCALLTYPE* query_interface)(oswrapper_audio__callback_stream* stream, const IID* iid, void** object);
+    ULONG (STDMETHODCALLTYPE* add_ref)(oswrapper_audio__callback_stream* stream);
+    ULONG (STDMETHODCALLTYPE* release)(oswrapper_audio__callback_stream* stream);
+    HRESULT (STDMETHODCALLTYPE* read)(oswrapper_audio__callback_stream* stream, void* buffer, ULONG size, ULONG* bytes_read);
+    HRESULT (STDMETHODCALLTYPE* write)(oswrapper_audio__callback_stream* stream, const void* buffer, ULONG size, ULONG* bytes_written);
+    HRESULT (STDMETHODCALLTYPE* seek)(oswrapper_audio__callback_stream* stream, LARGE_INTEGER offset, DWORD origin, ULARGE_INTEGER* new_position);
+    HRESULT (STDMETHODCALLTYPE* set_size)(oswrapper_audio__callback_stream* stream, ULARGE_INTEGER size);
+    HRESULT (STDMETHODCALLTYPE* copy_to)(oswrapper_audio__callback_stream* stream, IStream* target, ULARGE_INTEGER size, ULARGE_INTEGER* bytes_read, ULARGE_INTEGER* bytes_written);
+    HRESULT (STDMETHODCALLTYPE* commit)(oswrapper_audio__callback_stream* stream, DWORD flags);
+    HRESULT (STDMETHODCALLTYPE* revert)(oswrapper_audio__callback_stream* stream);
+    HRESULT (STDMETHODCALLTYPE* lock_region)(oswrapper_audio__callback_stream* stream, ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD lock_type);
+    HRESULT (STDMETHODCALLTYPE* unlock_region)(oswrapper_audio__callback_stream* stream, ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD lock_type);
+    HRESULT (STDMETHODCALLTYPE* stat)(oswrapper_audio__callback_stream* stream, STATSTG* stat, DWORD flags);
+    HRESULT (STDMETHODCALLTYPE* clone)(oswrapper_audio__callback_stream* stream, IStream** clone);
+} oswrapper_audio__callback_stream_vtbl;
+
+struct oswrapper_audio__callback_stream {
+    const oswrapper_audio__callback_stream_vtbl* vtbl;
+    LONG ref_count;
+    oswrapper_audio__callbacks callbacks;
+    /* The position of the stream, which is separate from the position of the callbacks */
+    unsigned long long position;
+    /* Media Foundation can read from the stream on its own threads */
+    CRITICAL_SECTION lock;
+    const OSWrapper_audio_allocator* allocator;
+};
+
+/* The interfaces the stream implements. These are defined here so uuid.lib isn't needed. */
+static const IID oswrapper_audio__iid_iunknown = { 0x00000000, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+static const IID oswrapper_audio__iid_isequentialstream = { 0x0C733A30, 0x2A1C, 0x11CE, { 0xAD, 0xE5, 0x00, 0xAA, 0x00, 0x44, 0x77, 0x3D } };
+static const IID oswrapper_audio__iid_istream = { 0x0000000C, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+
+static ULONG STDMETHODCALLTYPE oswrapper_audio__callback_stream_add_ref(oswrapper_audio__callback_stream* stream) {
+    return (ULONG) InterlockedIncrement(&stream->ref_count);
+}
+
+static ULONG STDMETHODCALLTYPE oswrapper_audio__callback_stream_release(oswrapper_audio__callback_stream* stream) {
+    LONG ref_count = InterlockedDecrement(&stream->ref_count);
+
+    if (ref_count == 0) {
+        DeleteCriticalSection(&stream->lock);
+        oswrapper_audio__free(stream->allocator, stream);
+    }
+
+    return (ULONG) ref_count;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_query_interface(oswrapper_audio__callback_stream* stream, const IID* iid, void** object) {
+    if (object == NULL) {
+        return E_POINTER;
+    }
+
+    if (OSWRAPPER_AUDIO_MEMCMP(iid, &oswrapper_audio__iid_iunknown, sizeof(IID)) != 0 && OSWRAPPER_AUDIO_MEMCMP(iid, &oswrapper_audio__iid_isequentialstream, sizeof(IID)) != 0
+            && OSWRAPPER_AUDIO_MEMCMP(iid, &oswrapper_audio__iid_istream, sizeof(IID)) != 0) {
+        *object = NULL;
+        return E_NOINTERFACE;
+    }
+
+    oswrapper_audio__callback_stream_add_ref(stream);
+    *object = (void*) stream;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_read(oswrapper_audio__callback_stream* stream, void* buffer, ULONG size, ULONG* bytes_read) {
+    size_t read_this_time;
+    EnterCriticalSection(&stream->lock);
+    read_this_time = oswrapper_audio__callbacks_read_at(&stream->callbacks, stream->position, buffer, size);
+    stream->position += read_this_time;
+    LeaveCriticalSection(&stream->lock);
+
+    if (bytes_read != NULL) {
+        *bytes_read = (ULONG) read_this_time;
+    }
+
+    /* S_FALSE means the end of the stream was reached */
+    return read_this_time == size ? S_OK : S_FALSE;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_write(oswrapper_audio__callback_stream* stream, const void* buffer, ULONG size, ULONG* bytes_written) {
+    (void) stream;
+    (void) buffer;
+    (void) size;
+
+    if (bytes_written != NULL) {
+        *bytes_written = 0;
+    }
+
+    return STG_E_ACCESSDENIED;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_seek(oswrapper_audio__callback_stream* stream, LARGE_INTEGER offset, DWORD origin, ULARGE_INTEGER* new_position) {
+    HRESULT result = S_OK;
+    LONGLONG position;
+    EnterCriticalSection(&stream->lock);
+
+    if (origin == STREAM_SEEK_SET) {
+        position = offset.QuadPart;
+    } else if (origin == STREAM_SEEK_CUR) {
+        position = (LONGLONG) stream->position + offset.QuadPart;
+    } else if (origin == STREAM_SEEK_END) {
+        position = (LONGLONG) stream->callbacks.size + offset.QuadPart;
+    } else {
+        position = -1;
+    }
+
+    /* Seeking past the end is allowed, and reads from there read nothing */
+    if (position < 0) {
+        result = STG_E_INVALIDFUNCTION;
+    } else {
+        stream->position = (unsigned long long) position;
+    }
+
+    if (new_position != NULL) {
+        new_position->QuadPart = (ULONGLONG) stream->position;
+    }
+
+    LeaveCriticalSection(&stream->lock);
+    return result;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_set_size(oswrapper_audio__callback_stream* stream, ULARGE_INTEGER size) {
+    (void) stream;
+    (void) size;
+    return STG_E_ACCESSDENIED;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_copy_to(oswrapper_audio__callback_stream* stream, IStream* target, ULARGE_INTEGER size, ULARGE_INTEGER* bytes_read, ULARGE_INTEGER* bytes_written) {
+    (void) stream;
+    (void) target;
+    (void) size;
+    (void) bytes_read;
+    (void) bytes_written;
+    return E_NOTIMPL;
+}
+
+/* Nothing is written, so there's nothing to commit or revert */
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_commit(oswrapper_audio__callback_stream* stream, DWORD flags) {
+    (void) stream;
+    (void) flags;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_revert(oswrapper_audio__callback_stream* stream) {
+    (void) stream;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_lock_region(oswrapper_audio__callback_stream* stream, ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD lock_type) {
+    (void) stream;
+    (void) offset;
+    (void) size;
+    (void) lock_type;
+    return STG_E_INVALIDFUNCTION;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_stat(oswrapper_audio__callback_stream* stream, STATSTG* stat, DWORD flags) {
+    /* Zeroed, so the stream has no name or times */
+    static STATSTG empty_stat;
+    (void) flags;
+
+    if (stat == NULL) {
+        return STG_E_INVALIDPOINTER;
+    }
+
+    *stat = empty_stat;
+    stat->type = STGTY_STREAM;
+    stat->cbSize.QuadPart = (ULONGLONG) stream->callbacks.size;
+    stat->grfMode = STGM_READ;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE oswrapper_audio__callback_stream_clone(oswrapper_audio__callback_stream* stream, IStream** clone) {
+    (void) stream;
+
+    if (clone != NULL) {
+        *clone = NULL;
+    }
+
+    return E_NOTIMPL;
+}
+
+static const oswrapper_audio__callback_stream_vtbl oswrapper_audio__callback_stream_methods = {
+    oswrapper_audio__callback_stream_query_interface,
+    oswrapper_audio__callback_stream_add_ref,
+    oswrapper_audio__callback_stream_release,
+    oswrapper_audio__callback_stream_read,
+    oswrapper_audio__callback_stream_write,
+    oswrapper_audio__callback_stream_seek,
+    oswrapper_audio__callback_stream_set_size,
+    oswrapper_audio__callback_stream_copy_to,
+    oswrapper_audio__callback_stream_commit,
+    oswrapper_audio__callback_stream_revert,
+    oswrapper_audio__callback_stream_lock_region,
+    oswrapper_audio__callback_stream_lock_region,
+    oswrapper_audio__callback_stream_stat,
+    oswrapper_audio__callback_stream_clone
+};
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_callbacks(OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__callback_stream* stream = (oswrapper_audio__callback_stream*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__callback_stream));
+    oswrapper_audio__source_info header;
+    oswrapper_audio__reader header_reader;
+    OSWRAPPER_AUDIO_RESULT_TYPE has_header = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    IMFByteStream* byte_stream = NULL;
+    IMFSourceReader* reader = NULL;
+
+    if (stream == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    stream->vtbl = &oswrapper_audio__callback_stream_methods;
+    stream->ref_count = 1;
+    stream->position = 0;
+    stream->allocator = audio->allocator;
+    InitializeCriticalSection(&stream->lock);
+
+    if (!oswrapper_audio__callbacks_init(&stream->callbacks, read, seek, tell, user_data)) {
+        oswrapper_audio__callback_stream_release(stream);
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* The header is read before Media Foundation starts reading from the stream */
+    if (oswrapper_audio__reader_init_callbacks(&header_reader, &stream->callbacks, audio->allocator)) {
+        has_header = oswrapper_audio__parse_header(&header_reader, &header);
+    }
+
+    oswrapper_audio__reader_uninit(&header_reader);
+
+    if (SUCCEEDED(MFCreateMFByteStreamOnStream((IStream*) (void*) stream, &byte_stream))) {
+        if (SUCCEEDED(MFCreateSourceReaderFromByteStream(byte_stream, NULL, &reader))) {
+            return oswrapper_audio__load_from_reader(reader, byte_stream, (IStream*) (void*) stream, has_header ? &header : NULL, audio);
+        }
+
+        IMFByteStream_Release(byte_stream);
+    }
+
+    oswrapper_audio__callback_stream_release(stream);
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* The Media Foundation source reader pulls data from a byte stream, and can't wait for more data to arrive */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_push(OSWrapper_audio_spec* audio) {
+    (void) audio;
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_push_bytes(OSWrapper_audio_spec* audio, const unsigned char* data, size_t data_size) {
+    (void) audio;
+    (void) data;
+    (void) data_size;
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_push_end(OSWrapper_audio_spec* audio) {
+    (void) audio;
+}
+
+OSWRAPPER_AUDIO_DEF OSWrapper_audio_length_type oswrapper_audio_get_length(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* frames) {
+    oswrapper_audio__internal_data_win* internal_data;
+    HRESULT result;
+    PROPVARIANT duration_propvariant;
+    ULONGLONG duration;
+    internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+
+    if (internal_data->exact_length >= 0) {
+        *frames = internal_data->exact_length;
+        return OSWRAPPER_AUDIO_LENGTH_EXACT;
+    }
+
+    if (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_FAILURE) {
+        /* IMFSourceReader methods can no longer be called */
+        return OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+    }
+
+    duration_propvariant.vt = VT_EMPTY;
+#ifdef __cplusplus
+    result = IMFSourceReader_GetPresentationAttribute(internal_data->reader, (DWORD) MF_SOURCE_READER_MEDIASOURCE, MF_PD_DURATION, &duration_propvariant);
+#else
+    result = IMFSourceReader_GetPresentationAttribute(internal_data->reader, (DWORD) MF_SOURCE_READER_MEDIASOURCE, &MF_PD_DURATION, &duration_propvariant);
+#endif
+
+    if (FAILED(result) || duration_propvariant.vt != VT_UI8) {
+        PropVariantClear(&duration_propvariant);
+        return OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+    }
+
+    duration = duration_propvariant.uhVal.QuadPart;
+    PropVariantClear(&duration_propvariant);
+    /* The duration is in 100 nanosecond units. Split the calculation to avoid overflow. */
+    *frames = (OSWRAPPER_AUDIO_SEEK_TYPE) ((duration / 10000000) * audio->sample_rate + ((duration % 10000000) * audio->sample_rate) / 10000000);
+    return OSWRAPPER_AUDIO_LENGTH_ESTIMATED;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos) {
+    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+    *pos = internal_data->current_frame;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
+    oswrapper_audio__internal_data_win* internal_data;
+    HRESULT result;
+    PROPVARIANT pos_propvariant = { 0 };
+    internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+
+    if (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_FAILURE) {
+        /* IMFSourceReader methods can no longer be called */
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (pos < 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    pos_propvariant.vt = VT_I8;
+    /* The position is in 100 nanosecond units. Split the calculation to avoid overflow. */
+    pos_propvariant.hVal.QuadPart = (pos / audio->sample_rate) * 10000000 + ((pos % audio->sample_rate) * 10000000) / audio->sample_rate;
+#ifdef __cplusplus
+    result = IMFSourceReader_SetCurrentPosition(internal_data->reader, GUID_NULL, pos_propvariant);
+#else
+    result = IMFSourceReader_SetCurrentPosition(internal_data->reader, &GUID_NULL, &pos_propvariant);
+#endif
+    PropVariantClear(&pos_propvariant);
+
+    if (FAILED(result)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* Reset buffer positions */
+    internal_data->internal_buffer_remaining = 0;
+    internal_data->internal_buffer_pos = 0;
+    /* The reader seeks to a position at or before the requested time,
+    so skip any decoded frames before the requested position */
+    internal_data->current_frame = pos;
+    internal_data->skip_to_current_frame = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio) {
+    oswrapper_audio_seek(audio, 0);
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do) {
+    size_t frame_size;
+    size_t frames_done;
+    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+    frame_size = (audio->bits_per_channel / 8) * audio->channel_count;
+    frames_to_do = frames_to_do * frame_size / sizeof(short);
+    frames_done = 0;
+
+    /* Copy any previous excess frames from the internal buffer */
+    if (internal_data->internal_buffer_remaining > 0) {
+        size_t copied_sample_data_size = internal_data->internal_buffer_remaining < frames_to_do ? internal_data->internal_buffer_remaining : frames_to_do;
+        OSWRAPPER_AUDIO_MEMCPY(buffer, internal_data->internal_buffer + internal_data->internal_buffer_pos, copied_sample_data_size * (sizeof internal_data->internal_buffer[0]));
+        internal_data->internal_buffer_remaining -= copied_sample_data_size;
+        internal_data->internal_buffer_pos += copied_sample_data_size;
+        frames_done = copied_sample_data_size;
+    }
+
+    /* Get new samples */
+    while (frames_to_do > frames_done) {
+        size_t new_target_frames = 0;
+        /* Set if a whole sample was skipped after seeking */
+        OSWRAPPER_AUDIO_RESULT_TYPE skipped_sample = OSWRAPPER_AUDIO_RESULT_FAILURE;
+
+        /* Check if IMFSourceReader methods can still be called */
+        if (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_SUCCESS) {
+            IMFSample* sample;
+            DWORD flags;
+            HRESULT result;
+            sample = NULL;
+            result = IMFSourceReader_ReadSample(internal_data->reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, 0, NULL, &flags, NULL, &sample);
+
+            if (SUCCEEDED(result)) {
+                /* TODO handle more flags */
+                if (flags & MF_SOURCE_READERF_ERROR) {
+                    /* IMFSourceReader methods can no longer be called */
+                    internal_data->no_reader_error = OSWRAPPER_AUDIO_RESULT_FAILURE;
+                } else if ((flags & MF_SOURCE_READERF_ENDOFSTREAM) || (flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED) || (sample == NULL)) {
+                    /* TODO handle these more gracefully */
+                } else {
+                    IMFMediaBuffer* media_buffer;
+                    result = IMFSample_ConvertToContiguousBuffer(sample, &media_buffer);
+
+                    if (SUCCEEDED(result)) {
+                        DWORD current_length;
+                        BYTE* sample_audio_data = NULL;
+                        result = IMFMediaBuffer_Lock(media_buffer, &sample_audio_data, NULL, &current_length);
+
+                        if (SUCCEEDED(result)) {
+                            size_t new_target_size;
+                            LONGLONG sample_time;
+
+                            /* Skip any frames before the position that was seeked to */
+                            if (internal_data->skip_to_current_frame && SUCCEEDED(IMFSample_GetSampleTime(sample, &sample_time))) {
+                                /* The sample time is in 100 nanosecond units */
+                                OSWRAPPER_AUDIO_SEEK_TYPE sample_frame = (sample_time / 10000000) * audio->sample_rate + ((sample_time % 10000000) * audio->sample_rate) / 10000000;
+                                DWORD skip_length = 0;
+
+                                if (sample_frame < internal_data->current_frame) {
+                                    unsigned long long bytes_before = (unsigned long long) (internal_data->current_frame - sample_frame) * frame_size;
+                                    skip_length = bytes_before < current_length ? (DWORD) bytes_before : current_length;
+                                }
+
+                                if (skip_length > 0 && skip_length == current_length) {
+                                    /* The whole sample is before the seek position */
+                                    skipped_sample = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+                                } else {
+                                    internal_data->skip_to_current_frame = OSWRAPPER_AUDIO_RESULT_FAILURE;
+                                }
+
+                                sample_audio_data += skip_length;
+                                current_length -= skip_length;
+                            } else {
+                                internal_data->skip_to_current_frame = OSWRAPPER_AUDIO_RESULT_FAILURE;
+                            }
+
+                            new_target_frames = current_length / sizeof(short);
+                            new_target_size = frames_done + new_target_frames;
+
+                            /* If the size of the decoded sample would exceed the remaining buffer size,
+                               store the excess frames in the internal buffer */
+                            if (new_target_size > frames_to_do) {
+                                size_t remaining_sample_data_size = new_target_size - frames_to_do;
+                                /* Prevent copying more data to the output buffer than requested */
+                                new_target_frames -= remaining_sample_data_size;
+                                current_length = (DWORD) new_target_frames * sizeof(short);
+
+                                /* Is the internal buffer large enough to store the excess frames? */
+                                if (internal_data->internal_buffer_size < remaining_sample_data_size) {
+                                    /* Try to allocate enough memory to store the excess frames */
+                                    short* realloc_buffer = (short*) oswrapper_audio__malloc(audio->allocator, remaining_sample_data_size * sizeof(short));
+
+                                    if (realloc_buffer != NULL) {
+                                        /* Free old buffer */
+                                        oswrapper_audio__free(audio->allocator, internal_data->internal_buffer);
+                                        /* Replace old buffer with new buffer */
+                                        internal_data->internal_buffer = realloc_buffer;
+                                        internal_data->internal_buffer_size = remaining_sample_data_size;
+                                    } else {
+                                        /* If we can't allocate more memory, some excess frames will be lost.
+                                           This is unlikely, and mostly harmless. */
+                                        remaining_sample_data_size = internal_data->internal_buffer_size;
+                                    }
+                                }
+
+                                /* Copy as many excess frames as we have space for */
+                                internal_data->internal_buffer_remaining = remaining_sample_data_size;
+                                internal_data->internal_buffer_pos = 0;
+
+                                if (remaining_sample_data_size > 0) {
+                                    OSWRAPPER_AUDIO_MEMCPY((BYTE*)(internal_data->internal_buffer), sample_audio_data + current_length, remaining_sample_data_size * sizeof(short));
+                                }
+                            }
+
+                            /* Copy decoded sample data to buffer, minus excess frames */
+                            if (new_target_frames > 0) {
+                                OSWRAPPER_AUDIO_MEMCPY((BYTE*)(buffer + frames_done), sample_audio_data, current_length);
+                            }
+
+                            /* result = */ IMFMediaBuffer_Unlock(media_buffer);
+                            /* TODO I'm not sure there's any way to handle this?
+                            if (FAILED(result)) {
+                                ...some code?
+                            }*/
+                        }
+
+                        IMFMediaBuffer_Release(media_buffer);
+                    }
+                }
+            }
+
+            /* May be non-null even on failure */
+            if (sample != NULL) {
+                IMFSample_Release(sample);
+            }
+        }
+
+        if (new_target_frames == 0) {
+            if (!skipped_sample) {
+                /* Break the loop */
+                break;
+            }
+        } else {
+            frames_done += new_target_frames;
+        }
+    }
+
+    internal_data->current_frame += frames_done * sizeof(short) / frame_size;
+    return frames_done * sizeof(short) / frame_size;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_peek_samples(OSWrapper_audio_spec* audio, const void** samples, size_t* frames) {
+    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+    size_t frame_size = (audio->bits_per_channel / 8) * audio->channel_count;
+
+    /* Only the excess frames of the last IMFSample are kept, new samples are copied straight to the caller's buffer */
+    if (internal_data->internal_buffer_remaining == 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    *samples = internal_data->internal_buffer + internal_data->internal_buffer_pos;
+    *frames = internal_data->internal_buffer_remaining * sizeof(short) / frame_size;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_consume(OSWrapper_audio_spec* audio, size_t frames) {
+    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+    size_t frame_size = (audio->bits_per_channel / 8) * audio->channel_count;
+    size_t buffered_frames = internal_data->internal_buffer_remaining * sizeof(short) / frame_size;
+
+    if (frames > buffered_frames) {
+        /* Seeking also discards the internal buffer */
+        return oswrapper_audio_seek(audio, internal_data->current_frame + (OSWRAPPER_AUDIO_SEEK_TYPE) frames);
+    }
+
+    internal_data->internal_buffer_remaining -= frames * frame_size / sizeof(short);
+    internal_data->internal_buffer_pos += frames * frame_size / sizeof(short);
+    internal_data->current_frame += frames;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+/* End Win32 MF implementation */
+#elif defined(OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL)
+/* Start miniaudio implementation */
+/* miniaudio.h must be included before this file (or found on the include path),
+and MINIAUDIO_IMPLEMENTATION must be defined in exactly one file. */
+#ifndef miniaudio_h
+#include "miniaudio.h"
+#endif
+
+/* The amount of seek points to generate for formats without a seek index (MP3) */
+#ifndef OSWRAPPER_AUDIO_MINIAUDIO_SEEK_POINT_COUNT
+#define OSWRAPPER_AUDIO_MINIAUDIO_SEEK_POINT_COUNT 1024
+#endif
+
+typedef struct oswrapper_audio__internal_data_miniaudio {
+    ma_decoder decoder;
+    /* The config and data the decoder was created with, used to recreate the decoder with a seek table */
+    ma_decoder_config config;
+    /* NULL when loading from callbacks */
+    const unsigned char* data;
+    size_t data_size;
+    /* Only used when loading from callbacks */
+    oswrapper_audio__callbacks callbacks;
+    /* Has recreating the decoder with a seek table been attempted? */
+    OSWRAPPER_AUDIO_RESULT_TYPE tried_seek_table;
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+    /* Only used when loading from a path, otherwise expected to be empty */
+    oswrapper_audio__mapped_file file;
+#endif
+    /* Cached result of oswrapper_audio_get_length, or -1 if it hasn't been calculated yet.
+    Getting the length of an MP3 file requires scanning the whole file. */
+    OSWRAPPER_AUDIO_SEEK_TYPE length;
+    /* Converts from the decoder output format, for output formats miniaudio doesn't support */
+    oswrapper_audio__converter converter;
+    /* Audio is decoded into this buffer before converting it, NULL if no conversion is needed */
+    unsigned char* read_buffer;
+    size_t read_buffer_frames;
+    /* Only used when remixing, otherwise expected to be NULL.
+    The decoder outputs the channels of the file as 32 bit floating point PCM, which is remixed and then converted. */
+    oswrapper_audio__remixer* remixer;
+} oswrapper_audio__internal_data_miniaudio;
+
+/* Pick the miniaudio output format for the hinted audio format.
+The native decoder format is used for any values which weren't hinted. */
+static ma_format oswrapper_audio__get_miniaudio_format(const OSWrapper_audio_spec* audio, ma_format native_format) {
+    unsigned int bits_per_channel = audio->bits_per_channel;
+
+    if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
+        /* miniaudio only supports 32 bit floating point PCM */
+        return ma_format_f32;
+    }
+
+    if (bits_per_channel == 0) {
+        if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET || native_format == ma_format_unknown) {
+            return native_format;
+        }
+
+        /* Use the native format if it's integer PCM, otherwise fall back to 16 bit PCM */
+        return native_format == ma_format_f32 ? ma_format_s16 : native_format;
+    }
+
+    switch (bits_per_channel) {
+    case 8:
+        return ma_format_u8;
+
+    case 16:
+        return ma_format_s16;
+
+    case 24:
+        return ma_format_s24;
+
+    case 32:
+        /* Use the native format if it's 32 bit floating point PCM and the audio type wasn't hinted */
+        if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET && (native_format == ma_format_f32 || native_format == ma_format_unknown)) {
+            return native_format;
+        }
+
+        return ma_format_s32;
+
+    case 64:
+        /* Decoded as 32 bit floating point PCM, and converted afterwards */
+        return audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER ? ma_format_s16 : ma_format_f32;
+
+    default:
+        return audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET ? native_format : ma_format_s16;
+    }
+}
+
+static oswrapper_audio__sample_format oswrapper_audio__get_miniaudio_sample_format(ma_format format) {
+    switch (format) {
+    case ma_format_u8:
+        return OSWRAPPER_AUDIO__SAMPLE_U8;
+
+    case ma_format_s24:
+        return OSWRAPPER_AUDIO__SAMPLE_S24;
+
+    case ma_format_s32:
+        return OSWRAPPER_AUDIO__SAMPLE_S32;
+
+    case ma_format_f32:
+        return OSWRAPPER_AUDIO__SAMPLE_F32;
+
+    default:
+        return OSWRAPPER_AUDIO__SAMPLE_S16;
+    }
+}
+
+/* Sets up converting from the decoder output format to the hinted output format, which is chosen as the given miniaudio format,
+and sets the output format of the given OSWrapper_audio_spec */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__miniaudio_set_format(oswrapper_audio__internal_data_miniaudio* internal_data, ma_format format, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__sample_format input_format = oswrapper_audio__get_miniaudio_sample_format(internal_data->decoder.outputFormat);
+    oswrapper_audio__sample_format output_format = oswrapper_audio__get_miniaudio_sample_format(format);
+    OSWRAPPER_AUDIO_RESULT_TYPE output_big_endian = oswrapper_audio__get_hinted_big_endian(audio);
+
+    if (output_format == OSWRAPPER_AUDIO__SAMPLE_U8) {
+        /* 8 bit PCM is always output as signed */
+        output_format = OSWRAPPER_AUDIO__SAMPLE_S8;
+    } else if (output_format == OSWRAPPER_AUDIO__SAMPLE_F32 && oswrapper_audio__get_hinted_sample_format(audio, output_format) == OSWRAPPER_AUDIO__SAMPLE_F64) {
+        /* miniaudio doesn't support 64 bit floating point PCM */
+        output_format = OSWRAPPER_AUDIO__SAMPLE_F64;
+    }
+
+    oswrapper_audio__converter_init(&internal_data->converter, input_format, oswrapper_audio__system_is_big_endian(), output_format, output_big_endian);
+    internal_data->read_buffer = NULL;
+    internal_data->read_buffer_frames = 0;
+
+    /* When remixing, the remixer has its own buffers */
+    if (internal_data->remixer == NULL && !oswrapper_audio__converter_is_passthrough(&internal_data->converter)) {
+        size_t bytes_per_frame = (oswrapper_audio__sample_format_bits(input_format) / 8) * internal_data->decoder.outputChannels;
+        internal_data->read_buffer_frames = bytes_per_frame < OSWRAPPER_AUDIO_READ_BUFFER_SIZE ? OSWRAPPER_AUDIO_READ_BUFFER_SIZE / bytes_per_frame : 1;
+        internal_data->read_buffer = (unsigned char*) oswrapper_audio__malloc(audio->allocator, internal_data->read_buffer_frames * bytes_per_frame);
+
+        if (internal_data->read_buffer == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+    }
+
+    oswrapper_audio__set_spec_sample_format(audio, output_format, output_big_endian);
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+static ma_result oswrapper_audio__miniaudio_read_callback(ma_decoder* decoder, void* buffer, size_t bytes_to_read, size_t* bytes_read) {
+    oswrapper_audio__callbacks* callbacks = (oswrapper_audio__callbacks*) decoder->pUserData;
+    *bytes_read = callbacks->read(callbacks->user_data, buffer, bytes_to_read);
+    return (*bytes_read == 0 && bytes_to_read > 0) ? MA_AT_END : MA_SUCCESS;
+}
+
+static ma_result oswrapper_audio__miniaudio_seek_callback(ma_decoder* decoder, ma_int64 offset, ma_seek_origin origin) {
+    oswrapper_audio__callbacks* callbacks = (oswrapper_audio__callbacks*) decoder->pUserData;
+    OSWrapper_audio_seek_origin seek_origin = OSWRAPPER_AUDIO_SEEK_ORIGIN_START;
+
+    if (origin == ma_seek_origin_current) {
+        seek_origin = OSWRAPPER_AUDIO_SEEK_ORIGIN_CURRENT;
+    } else if (origin == ma_seek_origin_end) {
+        seek_origin = OSWRAPPER_AUDIO_SEEK_ORIGIN_END;
+    }
+
+    return callbacks->seek(callbacks->user_data, (OSWRAPPER_AUDIO_SEEK_TYPE) offset, seek_origin) ? MA_SUCCESS : MA_ERROR;
+}
+
+/* miniaudio doesn't pass the old size when reallocating, so allocations made through a context's allocator store their size before the returned memory */
+static size_t oswrapper_audio__miniaudio_alloc_header_size(const OSWrapper_audio_allocator* allocator) {
+    size_t alignment = allocator->alignment != 0 ? allocator->alignment : OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT;
+    return alignment > sizeof(size_t) ? alignment : sizeof(size_t);
+}
+
+static void* oswrapper_audio__miniaudio_malloc(size_t size, void* user_data) {
+    const OSWrapper_audio_allocator* allocator = (const OSWrapper_audio_allocator*) user_data;
+    size_t header_size = oswrapper_audio__miniaudio_alloc_header_size(allocator);
+    unsigned char* block = (unsigned char*) oswrapper_audio__malloc(allocator, header_size + size);
+
+    if (block == NULL) {
+        return NULL;
+    }
+
+    *((size_t*) block) = size;
+    return block + header_size;
+}
+
+static void* oswrapper_audio__miniaudio_realloc(void* ptr, size_t size, void* user_data) {
+    const OSWrapper_audio_allocator* allocator = (const OSWrapper_audio_allocator*) user_data;
+    size_t header_size = oswrapper_audio__miniaudio_alloc_header_size(allocator);
+    unsigned char* block;
+
+    if (ptr == NULL) {
+        return oswrapper_audio__miniaudio_malloc(size, user_data);
+    }
+
+    block = (unsigned char*) ptr - header_size;
+    block = (unsigned char*) oswrapper_audio__realloc(allocator, block, header_size + *((size_t*) block), header_size + size);
+
+    if (block == NULL) {
+        return NULL;
+    }
+
+    *((size_t*) block) = size;
+    return block + header_size;
+}
+
+static void oswrapper_audio__miniaudio_free(void* ptr, void* user_data) {
+    const OSWrapper_audio_allocator* allocator = (const OSWrapper_audio_allocator*) user_data;
+
+    if (ptr != NULL) {
+        oswrapper_audio__free(allocator, (unsigned char*) ptr - oswrapper_audio__miniaudio_alloc_header_size(allocator));
+    }
+}
+
+/* Create the decoder from either the stored memory or callbacks */
+static ma_result oswrapper_audio__miniaudio_init_decoder(oswrapper_audio__internal_data_miniaudio* internal_data, const ma_decoder_config* config) {
+    if (internal_data->data == NULL) {
+        /* The decoder expects to start reading from the start of the file */
+        if (!internal_data->callbacks.seek(internal_data->callbacks.user_data, 0, OSWRAPPER_AUDIO_SEEK_ORIGIN_START)) {
+            return MA_ERROR;
+        }
+
+        return ma_decoder_init(oswrapper_audio__miniaudio_read_callback, oswrapper_audio__miniaudio_seek_callback, (void*) &internal_data->callbacks, config, &internal_data->decoder);
+    }
+
+    return ma_decoder_init_memory(internal_data->data, internal_data->data_size, config, &internal_data->decoder);
+}
+
+/* Loads the audio file in the given memory, or from the given callbacks if data is NULL */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__load_miniaudio(const unsigned char* data, size_t data_size, const oswrapper_audio__callbacks* callbacks, OSWrapper_audio_spec* audio) {
+    ma_decoder_config config;
+    ma_format format;
+    oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__internal_data_miniaudio));
+
+    if (internal_data == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (callbacks != NULL) {
+        internal_data->callbacks = *callbacks;
+    }
+
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+    internal_data->file.data = NULL;
+    internal_data->file.size = 0;
+    internal_data->file.buffer = NULL;
+#endif
+    internal_data->length = -1;
+    internal_data->data = data;
+    internal_data->data_size = data_size;
+    internal_data->tried_seek_table = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    internal_data->remixer = NULL;
+    /* Use hinted output format. The channels are remixed afterwards, so the decoder uses the channel count of the file. */
+    format = oswrapper_audio__get_miniaudio_format(audio, ma_format_unknown);
+    config = ma_decoder_config_init(format, 0, audio->sample_rate);
+
+    if (audio->allocator != NULL) {
+        config.allocationCallbacks.pUserData = (void*) audio->allocator;
+        config.allocationCallbacks.onMalloc = oswrapper_audio__miniaudio_malloc;
+        config.allocationCallbacks.onRealloc = oswrapper_audio__miniaudio_realloc;
+        config.allocationCallbacks.onFree = oswrapper_audio__miniaudio_free;
+    }
+
+    /* miniaudio resamples with linear interpolation, followed by a low-pass filter of the given order */
+    if (audio->resample_quality == OSWRAPPER_AUDIO_RESAMPLE_QUALITY_LINEAR) {
+        config.resampling.linear.lpfOrder = 0;
+    } else if (audio->resample_quality == OSWRAPPER_AUDIO_RESAMPLE_QUALITY_HIGH) {
+        config.resampling.linear.lpfOrder = MA_MAX_FILTER_ORDER;
+    }
+
+    if (oswrapper_audio__miniaudio_init_decoder(internal_data, &config) == MA_SUCCESS) {
+        ma_format decoder_format;
+        unsigned int channel_count = internal_data->decoder.outputChannels;
+        /* The native format is only known after the decoder is initialised */
+        format = oswrapper_audio__get_miniaudio_format(audio, internal_data->decoder.outputFormat);
+
+        if (!oswrapper_audio__create_hinted_remixer(audio, channel_count, OSWRAPPER_AUDIO_READ_BUFFER_SIZE / (sizeof(float) * channel_count) + 1, &internal_data->remixer)) {
+            ma_decoder_uninit(&internal_data->decoder);
+            oswrapper_audio__free(audio->allocator, internal_data);
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        /* The remixer needs 32 bit floating point PCM */
+        decoder_format = internal_data->remixer != NULL ? ma_format_f32 : format;
+
+        if (decoder_format != internal_data->decoder.outputFormat) {
+            ma_decoder_uninit(&internal_data->decoder);
+            config.format = decoder_format;
+
+            if (oswrapper_audio__miniaudio_init_decoder(internal_data, &config) != MA_SUCCESS) {
+                goto fail;
+            }
+        }
+
+        if (!oswrapper_audio__miniaudio_set_format(internal_data, format, audio)) {
+            ma_decoder_uninit(&internal_data->decoder);
+            goto fail;
+        }
+
+        internal_data->config = config;
+        audio->sample_rate = internal_data->decoder.outputSampleRate;
+        audio->channel_count = internal_data->remixer != NULL ? internal_data->remixer->output_channels : channel_count;
+        audio->internal_data = (void*) internal_data;
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+    oswrapper_audio__free(audio->allocator, internal_data);
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+fail:
+
+    if (internal_data->remixer != NULL) {
+        oswrapper_audio__free(audio->allocator, internal_data->remixer);
+    }
+
+    oswrapper_audio__free(audio->allocator, internal_data);
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void) {
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_uninit(void) {
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_free_context(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+    ma_result result = ma_decoder_uninit(&internal_data->decoder);
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+    /* Only expected when loading from a path */
+    oswrapper_audio__unmap_file(&internal_data->file);
+#endif
+
+    if (internal_data->read_buffer != NULL) {
+        oswrapper_audio__free(audio->allocator, internal_data->read_buffer);
+    }
+
+    if (internal_data->remixer != NULL) {
+        oswrapper_audio__free(audio->allocator, internal_data->remixer);
+    }
+
+    oswrapper_audio__free(audio->allocator, audio->internal_data);
+    return result == MA_SUCCESS ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
+    return oswrapper_audio__load_miniaudio(data, data_size, NULL, audio);
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size(const OSWrapper_audio_spec* hints, unsigned int max_channel_count, unsigned long max_sample_rate) {
+    (void) hints;
+    (void) max_channel_count;
+    (void) max_sample_rate;
+    return 0;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size_from_memory(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints) {
+    (void) data;
+    (void) data_size;
+    (void) hints;
+    return 0;
+}
+
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__mapped_file file;
+
+    if (oswrapper_audio__map_file(path, &file, audio->allocator)) {
+        /* Decode the mapped file, the same as decoding from memory */
+        if (oswrapper_audio__load_miniaudio(file.data, file.size, NULL, audio)) {
+            oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+            internal_data->file = file;
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        oswrapper_audio__unmap_file(&file);
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_callbacks(OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__callbacks callbacks;
+
+    if (!oswrapper_audio__callbacks_init(&callbacks, read, seek, tell, user_data)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    return oswrapper_audio__load_miniaudio(NULL, 0, &callbacks, audio);
+}
+
+/* miniaudio's decoders pull data through callbacks, and can't wait for more data to arrive */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_push(OSWrapper_audio_spec* audio) {
+    (void) audio;
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_push_bytes(OSWrapper_audio_spec* audio, const unsigned char* data, size_t data_size) {
+    (void) audio;
+    (void) data;
+    (void) data_size;
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_push_end(OSWrapper_audio_spec* audio) {
+    (void) audio;
+}
+
+OSWRAPPER_AUDIO_DEF OSWrapper_audio_length_type oswrapper_audio_get_length(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* frames) {
+    oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+
+    if (internal_data->length < 0) {
+        ma_uint64 length;
+
+        /* miniaudio reports a length of 0 when it isn't known */
+        if (ma_decoder_get_length_in_pcm_frames(&internal_data->decoder, &length) != MA_SUCCESS || length == 0) {
+            return OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+        }
+
+        internal_data->length = (OSWRAPPER_AUDIO_SEEK_TYPE) length;
+    }
+
+    *frames = internal_data->length;
+    /* The length is calculated from the resampling ratio when resampling, which may be slightly off */
+    return internal_data->decoder.converter.sampleRateIn == internal_data->decoder.outputSampleRate ? OSWRAPPER_AUDIO_LENGTH_EXACT : OSWRAPPER_AUDIO_LENGTH_ESTIMATED;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos) {
+    ma_uint64 cursor;
+    oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+
+    if (ma_decoder_get_cursor_in_pcm_frames(&internal_data->decoder, &cursor) == MA_SUCCESS) {
+        *pos = (OSWRAPPER_AUDIO_SEEK_TYPE) cursor;
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* Recreate the decoder with a seek table, so MP3 files don't have to be decoded from the start on every seek.
+This scans the whole file, so it's only done the first time you seek.
+Other formats ignore the seek point count, and already seek using their own index. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__miniaudio_build_seek_table(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+    /* ma_decoder can't be moved once created, so the new decoder is created in a new context */
+    oswrapper_audio__internal_data_miniaudio* new_internal_data = (oswrapper_audio__internal_data_miniaudio*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__internal_data_miniaudio));
+
+    if (new_internal_data == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    new_internal_data->config = internal_data->config;
+    new_internal_data->config.seekPointCount = OSWRAPPER_AUDIO_MINIAUDIO_SEEK_POINT_COUNT;
+    new_internal_data->data = internal_data->data;
+    new_internal_data->data_size = internal_data->data_size;
+    new_internal_data->callbacks = internal_data->callbacks;
+
+    if (oswrapper_audio__miniaudio_init_decoder(new_internal_data, &new_internal_data->config) != MA_SUCCESS) {
+        oswrapper_audio__free(audio->allocator, new_internal_data);
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    new_internal_data->tried_seek_table = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+    new_internal_data->file = internal_data->file;
+#endif
+    new_internal_data->length = internal_data->length;
+    new_internal_data->converter = internal_data->converter;
+    new_internal_data->read_buffer = internal_data->read_buffer;
+    new_internal_data->read_buffer_frames = internal_data->read_buffer_frames;
+    new_internal_data->remixer = internal_data->remixer;
+    ma_decoder_uninit(&internal_data->decoder);
+    oswrapper_audio__free(audio->allocator, internal_data);
+    audio->internal_data = (void*) new_internal_data;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
+    oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+
+    if (pos < 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* Seeking to the start doesn't need a seek table */
+    if (pos > 0 && !internal_data->tried_seek_table) {
+        if (oswrapper_audio__miniaudio_build_seek_table(audio)) {
+            internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+        } else {
+            /* Failure is harmless, seeking will just be slower */
+            internal_data->tried_seek_table = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
+
+    return ma_decoder_seek_to_pcm_frame(&internal_data->decoder, (ma_uint64) pos) == MA_SUCCESS ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+    ma_decoder_seek_to_pcm_frame(&internal_data->decoder, 0);
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do) {
+    ma_uint64 frames_read = 0;
+    size_t frames_done = 0;
+    oswrapper_audio__internal_data_miniaudio* internal_data = (oswrapper_audio__internal_data_miniaudio*) audio->internal_data;
+    size_t output_bytes_per_frame = (audio->bits_per_channel / 8) * audio->channel_count;
+    unsigned char* output = (unsigned char*) buffer;
+    oswrapper_audio__remixer* remixer = internal_data->remixer;
+
+    if (remixer != NULL) {
+        while (frames_done < frames_to_do) {
+            size_t frames_this_read = frames_to_do - frames_done < remixer->buffer_frames ? frames_to_do - frames_done : remixer->buffer_frames;
+            frames_read = 0;
+            ma_decoder_read_pcm_frames(&internal_data->decoder, remixer->input_buffer, frames_this_read, &frames_read);
+
+            if (frames_read == 0) {
+                break;
+            }
+
+            oswrapper_audio__remix_to_output(remixer, &internal_data->converter, remixer->input_buffer, output + (frames_done * output_bytes_per_frame), (size_t) frames_read);
+            frames_done += (size_t) frames_read;
+
+            if ((size_t) frames_read < frames_this_read) {
+                break;
+            }
+        }
+
+        return frames_done;
+    }
+
+    if (internal_data->read_buffer == NULL) {
+        ma_decoder_read_pcm_frames(&internal_data->decoder, buffer, frames_to_do, &frames_read);
+        return (size_t) frames_read;
+    }
+
+    while (frames_done < frames_to_do) {
+        size_t frames_this_read = frames_to_do - frames_done;
+
+        if (frames_this_read > internal_data->read_buffer_frames) {
+            frames_this_read = internal_data->read_buffer_frames;
+        }
+
+        frames_read = 0;
+        ma_decoder_read_pcm_frames(&internal_data->decoder, internal_data->read_buffer, frames_this_read, &frames_read);
+
+        if (frames_read == 0) {
+            break;
+        }
+
+        oswrapper_audio__convert_samples(&internal_data->converter, internal_data->read_buffer, output + (frames_done * output_bytes_per_frame), (size_t) frames_read * internal_data->decoder.outputChannels);
+        frames_done += (size_t) frames_read;
+
+        if ((size_t) frames_read < frames_this_read) {
+            break;
+        }
+    }
+
+    return frames_done;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_peek_samples(OSWrapper_audio_spec* audio, const void** samples, size_t* frames) {
+    /* miniaudio always decodes into the caller's buffer */
+    (void) audio;
+    (void) samples;
+    (void) frames;
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_consume(OSWrapper_audio_spec* audio, size_t frames) {
+    OSWRAPPER_AUDIO_SEEK_TYPE pos;
+    return oswrapper_audio_get_pos(audio, &pos) && oswrapper_audio_seek(audio, pos + (OSWRAPPER_AUDIO_SEEK_TYPE) frames) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+/* End miniaudio implementation */
+#elif defined(OSWRAPPER_AUDIO_USE_PORTABLE_IMPL)
+/* Start portable implementation */
+
+/* Initial size of the buffer for data passed to oswrapper_audio_push_bytes */
+#ifndef OSWRAPPER_AUDIO_PUSH_BUFFER_SIZE
+#define OSWRAPPER_AUDIO_PUSH_BUFFER_SIZE 0x10000
+#endif
+
+/* Data received by an audio context created with oswrapper_audio_load_push */
+typedef struct oswrapper_audio__push_buffer {
+    /* Received data which hasn't been decoded yet */
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+    /* Offset of the first byte of data from the start of the file */
+    unsigned long long offset;
+    OSWRAPPER_AUDIO_RESULT_TYPE header_parsed;
+    OSWRAPPER_AUDIO_RESULT_TYPE ended;
+    /* The output format hints, used once the header has been received */
+    OSWrapper_audio_spec hints;
+} oswrapper_audio__push_buffer;
+
+/* Resampling filters have a phase for each fractional position between input frames.
+Sample rate ratios which would need more phases than this interpolate between the nearest phases. */
+#ifndef OSWRAPPER_AUDIO_RESAMPLE_MAX_PHASES
+#define OSWRAPPER_AUDIO_RESAMPLE_MAX_PHASES 512
+#endif
+
+/* Limits how long resampling filters get when downsampling by a large ratio */
+#define OSWRAPPER_AUDIO__RESAMPLE_MAX_TAPS 2048
+/* Frames are resampled and remixed in chunks of this many frames */
+#define OSWRAPPER_AUDIO__CHUNK_FRAMES 256
+
+/* Resamples audio with a polyphase filter. The input is 32 bit floating point PCM in the byte order of this system. */
+typedef struct oswrapper_audio__resampler {
+    /* The sample rates, divided by their greatest common divisor */
+    unsigned long input_rate;
+    unsigned long output_rate;
+    unsigned int channel_count;
+    unsigned int tap_count;
+    unsigned long phase_count;
+    /* tap_count coefficients for each phase, with an extra phase at the end for interpolating */
+    float* filter;
+    /* The interpolated coefficients, when there aren't enough phases for every position */
+    float* coefficients;
+    /* Input frames for each channel, stored one channel after another with space for history_capacity frames each */
+    float* history;
+    size_t history_capacity;
+    size_t history_start;
+    size_t history_frames;
+    /* The input frame at history_start. Negative before the start of the audio, which is treated as silence. */
+    OSWRAPPER_AUDIO_SEEK_TYPE history_pos;
+    /* The next output frame */
+    unsigned long long output_frame;
+    /* Interleaved input frames read from the source, and output frames before they're converted to the output format */
+    float* input_buffer;
+    float* output_buffer;
+} oswrapper_audio__resampler;
+
+/* Only used by FLAC. Frames each have their own size and block size, so they're found by decoding the frames before them,
+or by searching for frame headers. Every channel of a frame is decoded to samples, then interleaved to the packet buffer. */
+typedef struct oswrapper_audio__flac_decoder {
+    /* Used to grow the read buffer, and to free the seek table copy */
+    const OSWrapper_audio_allocator* allocator;
+    unsigned int channel_count;
+    unsigned int bits_per_sample;
+    /* The block size of every frame except the last, or 0 if frames can have different block sizes */
+    unsigned int fixed_block_size;
+    unsigned int max_block_size;
+    /* The most bytes a frame can have. Grown when loading from callbacks if a frame doesn't fit in the read buffer. */
+    size_t max_frame_size;
+    /* The offset of the end of the audio data, which is the end of the file */
+    unsigned long long data_end;
+    /* Seek points from the SEEKTABLE block, as they are in the file. Points into the file when loading from memory,
+    otherwise into seek_table_copy. */
+    const unsigned char* seek_table;
+    unsigned char* seek_table_copy;
+    unsigned long seek_point_count;
+    /* The offset and first frame of the next frame to decode */
+    unsigned long long next_offset;
+    unsigned long long next_frame;
+    /* Set when the next frame was found by searching for a frame header, so its CRC is checked before trusting it */
+    OSWRAPPER_AUDIO_RESULT_TYPE verify_next;
+    /* The frames which have been decoded to the packet buffer */
+    unsigned long long block_first_frame;
+    size_t block_frames;
+    /* The part of the file in the read buffer, when loading from callbacks */
+    unsigned long long read_buffer_offset;
+    size_t read_buffer_filled;
+    /* The samples of the last decoded frame, with max_block_size samples for each channel */
+    oswrapper_audio__int32* samples;
+} oswrapper_audio__flac_decoder;
+
+/* Packets of an ALAC track with the same duration, from the time to sample table */
+typedef struct oswrapper_audio__alac_run {
+    unsigned long long first_frame;
+    unsigned long first_packet;
+    unsigned long frames_per_packet;
+} oswrapper_audio__alac_run;
+
+/* Packets of an ALAC track which are next to each other in the file */
+typedef struct oswrapper_audio__alac_group {
+    unsigned long long offset;
+    unsigned long first_packet;
+} oswrapper_audio__alac_group;
+
+/* Only used by ALAC. The sample tables of the MP4 container are read into an index of runs and groups when the decoder is created,
+so the first frame and offset of any packet are found with a binary search.
+Every channel of a packet is decoded to samples, then interleaved to the packet buffer. */
+typedef struct oswrapper_audio__alac_decoder {
+    unsigned int channel_count;
+    unsigned int bits_per_sample;
+    unsigned int frame_length;
+    /* Adaptive Rice coding parameters */
+    unsigned int history_mult;
+    unsigned int initial_history;
+    unsigned int rice_limit;
+    /* The output channel of each channel in a packet */
+    const unsigned char* channel_map;
+    unsigned long packet_count;
+    unsigned long long total_frames;
+    /* The size of every packet, or 0 if each packet has its own size. The sample size table is as it is in the file,
+    and points into the file when loading from memory, otherwise into packet_sizes_copy. */
+    unsigned long fixed_packet_size;
+    const unsigned char* packet_sizes;
+    unsigned char* packet_sizes_copy;
+    size_t max_packet_size;
+    /* The offset of the end of the audio data */
+    unsigned long long data_end;
+    /* The runs and groups share one allocation, with the runs first */
+    oswrapper_audio__alac_run* runs;
+    unsigned long run_count;
+    oswrapper_audio__alac_group* groups;
+    unsigned long group_count;
+    /* The next packet to decode and its offset, so packets decoded in order don't need to be looked up,
+    and the group after the one with the last decoded packet */
+    unsigned long next_packet;
+    unsigned long long next_offset;
+    unsigned long next_group;
+    /* The frames which have been decoded to the packet buffer */
+    unsigned long long block_first_frame;
+    size_t block_frames;
+    /* The part of the file in the read buffer, when loading from callbacks */
+    unsigned long long read_buffer_offset;
+    size_t read_buffer_filled;
+    /* The samples of the last decoded packet, with frame_length samples for each channel */
+    oswrapper_audio__int32* samples;
+} oswrapper_audio__alac_decoder;
+
+/* Frees an ALAC decoder, and its index and sample size table copy */
+static void oswrapper_audio__free_alac_decoder(oswrapper_audio__alac_decoder* alac, const OSWrapper_audio_allocator* allocator) {
+    if (alac->packet_sizes_copy != NULL) {
+        oswrapper_audio__free(allocator, alac->packet_sizes_copy);
+    }
+
+    if (alac->runs != NULL) {
+        oswrapper_audio__free(allocator, alac->runs);
+    }
+
+    oswrapper_audio__free(allocator, alac);
+}
+
+typedef struct oswrapper_audio__internal_data_portable {
+    /* Start of the audio data. Points directly into the memory passed to oswrapper_audio_load_from_memory.
+    NULL when loading from callbacks. */
+    const unsigned char* audio_data;
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+    /* Only used when loading from a path, otherwise expected to be empty */
+    oswrapper_audio__mapped_file file;
+#endif
+    /* Only used when loading from callbacks */
+    oswrapper_audio__callbacks callbacks;
+    /* Only used when loading from callbacks and converting the audio data, otherwise expected to be NULL */
+    unsigned char* read_buffer;
+    size_t read_buffer_size;
+    /* Only used when created with oswrapper_audio_load_push, otherwise expected to be NULL */
+    oswrapper_audio__push_buffer* push;
+    /* Only used when resampling, otherwise expected to be NULL */
+    oswrapper_audio__resampler* resampler;
+    /* Only used when remixing, otherwise expected to be NULL */
+    oswrapper_audio__remixer* remixer;
+    /* Upmixing happens after resampling, so fewer channels need to be resampled */
+    OSWRAPPER_AUDIO_RESULT_TYPE remix_after_resampling;
+    /* Offset of the audio data from the start of the file */
+    unsigned long long data_offset;
+    /* Converts the audio data to the output format,
+    or to 32 bit floating point PCM when remixing or resampling, which output_converter then converts to the output format */
+    oswrapper_audio__converter converter;
+    oswrapper_audio__converter output_converter;
+    unsigned int channel_count;
+    /* The size of each frame, or of each packet for codecs which decode several frames from each packet */
+    size_t bytes_per_frame;
+    size_t converted_bytes_per_frame;
+    /* In frames of the audio data, which are only the same as frames of the output format when not resampling */
+    unsigned long long total_frames;
+    unsigned long long current_frame;
+    /* The channel count of the output format */
+    unsigned int output_channel_count;
+    /* Only used by codecs with more than one frame per packet. Packets are decoded to packet_buffer as integer PCM
+    in the byte order of this system, which is converted by the converter the same as audio data.
+    packet_index is the packet it holds. For FLAC, frames_per_packet is the largest block size. */
+    oswrapper_audio__codec codec;
+    unsigned int frames_per_packet;
+    unsigned long long priming_frames;
+    void* packet_buffer;
+    unsigned long long packet_index;
+    /* Only used by FLAC, otherwise expected to be NULL */
+    oswrapper_audio__flac_decoder* flac;
+    /* Only used by ALAC, otherwise expected to be NULL */
+    oswrapper_audio__alac_decoder* alac;
+} oswrapper_audio__internal_data_portable;
+
+/* sin, without depending on libm. Only used when creating resampling filters. */
+static double oswrapper_audio__sin(double x) {
+    const double pi = 3.14159265358979323846;
+    double term;
+    double sum;
+    double x_squared;
+    int i;
+    /* Reduce to [-pi, pi] */
+    x -= (double) (long long) (x / (2 * pi)) * (2 * pi);
+
+    if (x > pi) {
+        x -= 2 * pi;
+    } else if (x < -pi) {
+        x += 2 * pi;
+    }
+
+    /* Reduce to [-pi / 2, pi / 2] */
+    if (x > pi / 2) {
+        x = pi - x;
+    } else if (x < -pi / 2) {
+        x = -pi - x;
+    }
+
+    x_squared = x * x;
+    term = x;
+    sum = x;
+
+    for (i = 1; i < 12; i++) {
+        term *= -x_squared / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+
+    return sum;
+}
+
+/* The modified Bessel function of the first kind I0(x), for the Kaiser window. Takes x squared. */
+static double oswrapper_audio__bessel_i0(double x_squared) {
+    double term = 1;
+    double sum = 1;
+    int i;
+
+    for (i = 1; i < 100 && term > sum * 1e-12; i++) {
+        term *= x_squared / (4.0 * i * i);
+        sum += term;
+    }
+
+    return sum;
+}
+
+static unsigned long oswrapper_audio__gcd(unsigned long a, unsigned long b) {
+    while (b != 0) {
+        unsigned long temp = a % b;
+        a = b;
+        b = temp;
+    }
+
+    return a;
+}
+
+/* Sums the products of count pairs of floats */
+static float oswrapper_audio__dot_f32(const float* a, const float* b, size_t count) {
+    size_t i = 0;
+    float sum = 0.0f;
+#if defined(OSWRAPPER_AUDIO__USE_AVX2)
+    __m256 acc = _mm256_setzero_ps();
+    __m128 acc_128;
+
+    for (; i + 8 <= count; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+
+    acc_128 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    acc_128 = _mm_add_ps(acc_128, _mm_movehl_ps(acc_128, acc_128));
+    acc_128 = _mm_add_ss(acc_128, _mm_shuffle_ps(acc_128, acc_128, 1));
+    sum = _mm_cvtss_f32(acc_128);
+#elif defined(OSWRAPPER_AUDIO__USE_SSE2)
+    __m128 acc = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    float32x2_t acc_64;
+
+    for (; i + 4 <= count; i += 4) {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+
+    acc_64 = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(acc_64, acc_64), 0);
+#endif
+
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+/* Returns half the filter length for the given quality and sample rates,
+and sets the cutoff frequency (relative to the Nyquist frequency of the input) and Kaiser window shape to use */
+static unsigned int oswrapper_audio__resampler_half_taps(unsigned long input_rate, unsigned long output_rate, OSWrapper_audio_resample_quality quality, double* cutoff, double* beta) {
+    unsigned int half_taps;
+    *cutoff = 1;
+    *beta = 0;
+
+    switch (quality) {
+    case OSWRAPPER_AUDIO_RESAMPLE_QUALITY_LINEAR:
+        half_taps = 1;
+        break;
+
+    case OSWRAPPER_AUDIO_RESAMPLE_QUALITY_HIGH:
+        /* Around 90 dB of stopband attenuation */
+        half_taps = 64;
+        *cutoff = 0.95;
+        *beta = 9;
+        break;
+
+    default:
+        /* Around 60 dB of stopband attenuation */
+        half_taps = 16;
+        *cutoff = 0.88;
+        *beta = 6;
+        break;
+    }
+
+    if (half_taps > 1 && output_rate < input_rate) {
+        /* Frequencies above the Nyquist frequency of the output are filtered out, which needs a longer filter */
+        unsigned long long scaled_half_taps = ((unsigned long long) half_taps * input_rate + output_rate - 1) / output_rate;
+        *cutoff = *cutoff * output_rate / input_rate;
+        half_taps = scaled_half_taps < OSWRAPPER_AUDIO__RESAMPLE_MAX_TAPS / 2 ? (unsigned int) scaled_half_taps : OSWRAPPER_AUDIO__RESAMPLE_MAX_TAPS / 2;
+        /* Keep the filter length a multiple of 8 for SIMD */
+        half_taps = (half_taps + 3) & ~3u;
+    }
+
+    return half_taps;
+}
+
+/* The size of a resampler, which is allocated together with its filter table and buffers */
+static size_t oswrapper_audio__resampler_size(unsigned long phase_count, unsigned int tap_count, unsigned int channel_count) {
+    return sizeof(oswrapper_audio__resampler) + sizeof(float) * (((phase_count + 2) * tap_count) + (channel_count * (tap_count + OSWRAPPER_AUDIO__CHUNK_FRAMES)) + (2 * OSWRAPPER_AUDIO__CHUNK_FRAMES * channel_count));
+}
+
+/* Creates a resampler, and the filter table for the given quality */
+static oswrapper_audio__resampler* oswrapper_audio__create_resampler(unsigned long input_rate, unsigned long output_rate, unsigned int channel_count, OSWrapper_audio_resample_quality quality, const OSWrapper_audio_allocator* allocator) {
+    oswrapper_audio__resampler* resampler;
+    unsigned long gcd = oswrapper_audio__gcd(input_rate, output_rate);
+    unsigned long phase_count;
+    unsigned long phase;
+    unsigned int half_taps;
+    unsigned int tap_count;
+    unsigned int tap;
+    size_t history_capacity;
+    double cutoff;
+    double beta;
+    double bessel_beta;
+    input_rate /= gcd;
+    output_rate /= gcd;
+    phase_count = output_rate < OSWRAPPER_AUDIO_RESAMPLE_MAX_PHASES ? output_rate : OSWRAPPER_AUDIO_RESAMPLE_MAX_PHASES;
+    half_taps = oswrapper_audio__resampler_half_taps(input_rate, output_rate, quality, &cutoff, &beta);
+    tap_count = half_taps * 2;
+    history_capacity = tap_count + OSWRAPPER_AUDIO__CHUNK_FRAMES;
+    /* Everything is allocated together, the arrays of floats are aligned by following the struct */
+    resampler = (oswrapper_audio__resampler*) oswrapper_audio__malloc(allocator, oswrapper_audio__resampler_size(phase_count, tap_count, channel_count));
+
+    if (resampler == NULL) {
+        return NULL;
+    }
+
+    resampler->input_rate = input_rate;
+    resampler->output_rate = output_rate;
+    resampler->channel_count = channel_count;
+    resampler->tap_count = tap_count;
+    resampler->phase_count = phase_count;
+    resampler->filter = (float*) (resampler + 1);
+    resampler->coefficients = resampler->filter + ((phase_count + 1) * tap_count);
+    resampler->history = resampler->coefficients + tap_count;
+    resampler->history_capacity = history_capacity;
+    resampler->history_start = 0;
+    resampler->history_frames = 0;
+    resampler->history_pos = 1 - (OSWRAPPER_AUDIO_SEEK_TYPE) half_taps;
+    resampler->output_frame = 0;
+    resampler->input_buffer = resampler->history + (channel_count * history_capacity);
+    resampler->output_buffer = resampler->input_buffer + (OSWRAPPER_AUDIO__CHUNK_FRAMES * channel_count);
+    bessel_beta = oswrapper_audio__bessel_i0(beta * beta);
+
+    for (phase = 0; phase <= phase_count; phase++) {
+        float* coefficients = resampler->filter + (phase * tap_count);
+        double sum = 0;
+
+        for (tap = 0; tap < tap_count; tap++) {
+            /* Distance from the output frame to this input frame, in input frames */
+            double x = ((double) phase / phase_count) + half_taps - 1 - tap;
+            double coefficient;
+
+            if (half_taps == 1) {
+                coefficient = x < 0 ? 1 + x : 1 - x;
+            } else {
+                double window_pos = x / half_taps;
+                double sinc_x = 3.14159265358979323846 * cutoff * x;
+                coefficient = sinc_x == 0 ? cutoff : cutoff * oswrapper_audio__sin(sinc_x) / sinc_x;
+                /* Kaiser window */
+                coefficient *= window_pos * window_pos < 1 ? oswrapper_audio__bessel_i0(beta * beta * (1 - window_pos * window_pos)) / bessel_beta : 0;
+            }
+
+            coefficients[tap] = (float) coefficient;
+            sum += coefficient;
+        }
+
+        /* Normalise the gain of each phase, so constant input stays constant */
+        for (tap = 0; tap < tap_count; tap++) {
+            coefficients[tap] = (float) (coefficients[tap] / sum);
+        }
+    }
+
+    return resampler;
+}
+
+/* Returns the first input frame used for the given output frame, and the phase of the filter to use for it.
+blend is how far the position is between the phase and the next phase, when there aren't enough phases for every position. */
+static OSWRAPPER_AUDIO_SEEK_TYPE oswrapper_audio__resampler_input_pos(const oswrapper_audio__resampler* resampler, unsigned long long output_frame, unsigned long* phase, float* blend) {
+    unsigned long long input_pos = output_frame * resampler->input_rate;
+    unsigned long long phase_pos = (input_pos % resampler->output_rate) * resampler->phase_count;
+    *phase = (unsigned long) (phase_pos / resampler->output_rate);
+    *blend = (float) (phase_pos % resampler->output_rate) / (float) resampler->output_rate;
+    return (OSWRAPPER_AUDIO_SEEK_TYPE) (input_pos / resampler->output_rate) - (OSWRAPPER_AUDIO_SEEK_TYPE) (resampler->tap_count / 2 - 1);
+}
+
+/* The amount of output frames for the given amount of input frames */
+static unsigned long long oswrapper_audio__resampled_length(const oswrapper_audio__resampler* resampler, unsigned long long input_frames) {
+    return ((input_frames * resampler->output_rate) + resampler->input_rate - 1) / resampler->input_rate;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void) {
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_uninit(void) {
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_free_context(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+    /* Only expected when loading from a path */
+    oswrapper_audio__unmap_file(&internal_data->file);
+#endif
+
+    /* Only expected when created with oswrapper_audio_load_push */
+    if (internal_data->push != NULL) {
+        if (internal_data->push->data != NULL) {
+            oswrapper_audio__free(audio->allocator, internal_data->push->data);
+        }
+
+        oswrapper_audio__free(audio->allocator, internal_data->push);
+    }
+
+    if (internal_data->read_buffer != NULL) {
+        oswrapper_audio__free(audio->allocator, internal_data->read_buffer);
+    }
+
+    if (internal_data->packet_buffer != NULL) {
+        oswrapper_audio__free(audio->allocator, internal_data->packet_buffer);
+    }
+
+    if (internal_data->flac != NULL) {
+        if (internal_data->flac->seek_table_copy != NULL) {
+            oswrapper_audio__free(audio->allocator, internal_data->flac->seek_table_copy);
+        }
+
+        oswrapper_audio__free(audio->allocator, internal_data->flac);
+    }
+
+    if (internal_data->alac != NULL) {
+        oswrapper_audio__free_alac_decoder(internal_data->alac, audio->allocator);
+    }
+
+    if (internal_data->resampler != NULL) {
+        oswrapper_audio__free(audio->allocator, internal_data->resampler);
+    }
+
+    if (internal_data->remixer != NULL) {
+        oswrapper_audio__free(audio->allocator, internal_data->remixer);
+    }
+
+    oswrapper_audio__free(audio->allocator, audio->internal_data);
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* FLAC frames are searched for by reading ahead at most this many of the largest blocks, otherwise the decoder seeks */
+#define OSWRAPPER_AUDIO__FLAC_SEEK_DISTANCE 16
+/* The longest a frame header can be */
+#define OSWRAPPER_AUDIO__FLAC_MAX_HEADER_SIZE 16
+
+#if !defined(__GNUC__) && defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#pragma intrinsic(_BitScanReverse64)
+#define OSWRAPPER_AUDIO__USE_BIT_SCAN_REVERSE_64
+#endif
+
+/* Counts the leading zero bits of a value which isn't 0 */
+static unsigned int oswrapper_audio__count_leading_zeros_64(unsigned long long value) {
+#if defined(__GNUC__)
+    return (unsigned int) __builtin_clzll(value);
+#elif defined(OSWRAPPER_AUDIO__USE_BIT_SCAN_REVERSE_64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - (unsigned int) index;
+#else
+    unsigned int count = 0;
+
+    while (!(value & ((unsigned long long) 1 << 63))) {
+        value <<= 1;
+        count++;
+    }
+
+    return count;
+#endif
+}
+
+/* Reads bits from the start of a FLAC frame. Bits are loaded into a 64 bit cache eight bytes at a time,
+with the next bit to read as its most significant bit. */
+typedef struct oswrapper_audio__flac_bits {
+    const unsigned char* next;
+    const unsigned char* end;
+    unsigned long long cache;
+    /* The amount of bits in the cache which haven't been read. The bits after them are either 0, or the bits at next. */
+    unsigned int cache_bits;
+    /* Set when a read went past the end of the data */
+    OSWRAPPER_AUDIO_RESULT_TYPE overrun;
+} oswrapper_audio__flac_bits;
+
+/* Fills the cache with at least 56 bits, or every remaining bit */
+static void oswrapper_audio__flac_refill(oswrapper_audio__flac_bits* bits) {
+    if (bits->end - bits->next >= 8) {
+        /* Only the whole bytes which fit are counted, the rest are loaded again by the next refill */
+        unsigned int bytes = (63 - bits->cache_bits) >> 3;
+        bits->cache |= oswrapper_audio__read_u64_be(bits->next) >> bits->cache_bits;
+        bits->next += bytes;
+        bits->cache_bits += bytes * 8;
+    } else {
+        while (bits->cache_bits <= 56 && bits->next < bits->end) {
+            bits->cache |= (unsigned long long) *bits->next << (56 - bits->cache_bits);
+            bits->next++;
+            bits->cache_bits += 8;
+        }
+    }
+}
+
+/* Reads up to 32 bits as an unsigned value */
+static oswrapper_audio__uint32 oswrapper_audio__flac_read_bits(oswrapper_audio__flac_bits* bits, unsigned int count) {
+    oswrapper_audio__uint32 value;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    if (bits->cache_bits < count) {
+        oswrapper_audio__flac_refill(bits);
+
+        if (bits->cache_bits < count) {
+            bits->overrun = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+            bits->cache = 0;
+            bits->cache_bits = 0;
+            return 0;
+        }
+    }
+
+    value = (oswrapper_audio__uint32) (bits->cache >> (64 - count));
+    bits->cache <<= count;
+    bits->cache_bits -= count;
+    return value;
+}
+
+/* Reads up to 32 bits as a two's complement signed value */
+static oswrapper_audio__int32 oswrapper_audio__flac_read_signed(oswrapper_audio__flac_bits* bits, unsigned int count) {
+    oswrapper_audio__uint32 sign;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    sign = (oswrapper_audio__uint32) 1 << (count - 1);
+    return (oswrapper_audio__int32) ((oswrapper_audio__flac_read_bits(bits, count) ^ sign) - sign);
+}
+
+/* Reads a unary coded value, which is the amount of 0 bits before the next 1 bit */
+static oswrapper_audio__uint32 oswrapper_audio__flac_read_unary(oswrapper_audio__flac_bits* bits) {
+    oswrapper_audio__uint32 value = 0;
+
+    while (1) {
+        unsigned int zeros;
+
+        if (bits->cache_bits == 0) {
+            oswrapper_audio__flac_refill(bits);
+
+            if (bits->cache_bits == 0) {
+                bits->overrun = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+                return value;
+            }
+        }
+
+        zeros = bits->cache != 0 ? oswrapper_audio__count_leading_zeros_64(bits->cache) : 64;
+
+        if (zeros < bits->cache_bits) {
+            bits->cache <<= zeros + 1;
+            bits->cache_bits -= zeros + 1;
+            return value + zeros;
+        }
+
+        value += bits->cache_bits;
+        bits->cache = 0;
+        bits->cache_bits = 0;
+    }
+}
+
+/* Reads Rice coded residuals. Decoding FLAC spends most of its time here, so the bit cache is kept in local variables. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__flac_read_rice(oswrapper_audio__flac_bits* bits, oswrapper_audio__int32* output, unsigned int count, unsigned int parameter) {
+    oswrapper_audio__flac_bits local = *bits;
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        oswrapper_audio__uint32 value = 0;
+
+        if (local.cache_bits < 32) {
+            oswrapper_audio__flac_refill(&local);
+        }
+
+        /* The quotient is unary coded, and is usually short enough to be in the cache */
+        while (1) {
+            unsigned int zeros = local.cache != 0 ? oswrapper_audio__count_leading_zeros_64(local.cache) : 64;
+
+            if (zeros < local.cache_bits) {
+                value += zeros;
+                local.cache <<= zeros + 1;
+                local.cache_bits -= zeros + 1;
+                break;
+            }
+
+            value += local.cache_bits;
+            local.cache = 0;
+            local.cache_bits = 0;
+            oswrapper_audio__flac_refill(&local);
+
+            if (local.cache_bits == 0) {
+                bits->overrun = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+        }
+
+        /* Then the remainder is the next parameter bits */
+        if (parameter != 0) {
+            if (local.cache_bits < parameter) {
+                oswrapper_audio__flac_refill(&local);
+
+                if (local.cache_bits < parameter) {
+                    bits->overrun = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+                    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+                }
+            }
+
+            value = (value << parameter) | (oswrapper_audio__uint32) (local.cache >> (64 - parameter));
+            local.cache <<= parameter;
+            local.cache_bits -= parameter;
+        }
+
+        /* Signed values are zigzag coded */
+        output[i] = (oswrapper_audio__int32) ((value >> 1) ^ (0 - (value & 1)));
+    }
+
+    *bits = local;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Reads the residual of a subframe which predicts every sample after the first order samples */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__flac_read_residual(oswrapper_audio__flac_bits* bits, oswrapper_audio__int32* samples, unsigned int block_size, unsigned int order) {
+    unsigned int method = oswrapper_audio__flac_read_bits(bits, 2);
+    unsigned int partition_order = oswrapper_audio__flac_read_bits(bits, 4);
+    /* Method 1 has 5 bit Rice parameters instead of 4, and the largest parameter means the partition isn't Rice coded */
+    unsigned int parameter_bits = method == 1 ? 5 : 4;
+    unsigned int escape = method == 1 ? 31 : 15;
+    unsigned int partition_size = block_size >> partition_order;
+    unsigned int partition;
+    unsigned int sample = order;
+
+    if (method > 1 || (partition_size << partition_order) != block_size || partition_size < order) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    for (partition = 0; partition < (1u << partition_order); partition++) {
+        /* The first partition doesn't have the warm up samples */
+        unsigned int count = partition == 0 ? partition_size - order : partition_size;
+        unsigned int parameter = oswrapper_audio__flac_read_bits(bits, parameter_bits);
+
+        if (parameter == escape) {
+            unsigned int sample_bits = oswrapper_audio__flac_read_bits(bits, 5);
+            unsigned int i;
+
+            for (i = 0; i < count; i++) {
+                samples[sample + i] = oswrapper_audio__flac_read_signed(bits, sample_bits);
+            }
+        } else if (!oswrapper_audio__flac_read_rice(bits, samples + sample, count, parameter)) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        if (bits->overrun) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        sample += count;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Adds the prediction of a fixed predictor to the residual. Unsigned arithmetic wraps,
+which gives the right samples for valid audio data, and doesn't overflow for invalid audio data. */
+static void oswrapper_audio__flac_restore_fixed(oswrapper_audio__int32* samples, unsigned int block_size, unsigned int order) {
+    oswrapper_audio__uint32* s = (oswrapper_audio__uint32*) samples;
+    unsigned int i;
+
+    switch (order) {
+    case 1:
+        for (i = 1; i < block_size; i++) {
+            s[i] += s[i - 1];
+        }
+
+        break;
+
+    case 2:
+        for (i = 2; i < block_size; i++) {
+            s[i] += (2 * s[i - 1]) - s[i - 2];
+        }
+
+        break;
+
+    case 3:
+        for (i = 3; i < block_size; i++) {
+            s[i] += (3 * (s[i - 1] - s[i - 2])) + s[i - 3];
+        }
+
+        break;
+
+    case 4:
+        for (i = 4; i < block_size; i++) {
+            s[i] += (4 * (s[i - 1] + s[i - 3])) - (6 * s[i - 2]) - s[i - 4];
+        }
+
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* Adds the prediction of a linear predictor to the residual, when the prediction fits in 32 bits.
+This is the case for almost all audio up to 16 bits, so each order has its own unrolled loop.
+Like the fixed predictor, unsigned arithmetic wraps instead of overflowing for invalid audio data. */
+static void oswrapper_audio__flac_restore_lpc_32(oswrapper_audio__int32* samples, unsigned int block_size, const oswrapper_audio__int32* coefficients, unsigned int order, unsigned int shift) {
+    const oswrapper_audio__uint32* c = (const oswrapper_audio__uint32*) coefficients;
+    unsigned int i;
+
+    for (i = order; i < block_size; i++) {
+        const oswrapper_audio__uint32* history = (const oswrapper_audio__uint32*) samples + i;
+        oswrapper_audio__uint32 prediction = 0;
+        unsigned int j;
+
+        switch (order) {
+        default:
+            for (j = 12; j < order; j++) {
+                prediction += c[j] * history[-1 - (int) j];
+            }
+
+        /* Falls through */
+        case 12:
+            prediction += c[11] * history[-12];
+
+        /* Falls through */
+        case 11:
+            prediction += c[10] * history[-11];
+
+        /* Falls through */
+        case 10:
+            prediction += c[9] * history[-10];
+
+        /* Falls through */
+        case 9:
+            prediction += c[8] * history[-9];
+
+        /* Falls through */
+        case 8:
+            prediction += c[7] * history[-8];
+
+        /* Falls through */
+        case 7:
+            prediction += c[6] * history[-7];
+
+        /* Falls through */
+        case 6:
+            prediction += c[5] * history[-6];
+
+        /* Falls through */
+        case 5:
+            prediction += c[4] * history[-5];
+
+        /* Falls through */
+        case 4:
+            prediction += c[3] * history[-4];
+
+        /* Falls through */
+        case 3:
+            prediction += c[2] * history[-3];
+
+        /* Falls through */
+        case 2:
+            prediction += c[1] * history[-2];
+
+        /* Falls through */
+        case 1:
+            prediction += c[0] * history[-1];
+        }
+
+        samples[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) samples[i] + (oswrapper_audio__uint32) ((oswrapper_audio__int32) prediction >> shift));
+    }
+}
+
+/* Adds the prediction of a linear predictor to the residual, when the prediction needs 64 bits */
+static void oswrapper_audio__flac_restore_lpc_64(oswrapper_audio__int32* samples, unsigned int block_size, const oswrapper_audio__int32* coefficients, unsigned int order, unsigned int shift) {
+    unsigned int i;
+
+    for (i = order; i < block_size; i++) {
+        const oswrapper_audio__int32* history = samples + i;
+        long long prediction = 0;
+        unsigned int j;
+
+        switch (order) {
+        default:
+            for (j = 12; j < order; j++) {
+                prediction += (long long) coefficients[j] * history[-1 - (int) j];
+            }
+
+        /* Falls through */
+        case 12:
+            prediction += (long long) coefficients[11] * history[-12];
+
+        /* Falls through */
+        case 11:
+            prediction += (long long) coefficients[10] * history[-11];
+
+        /* Falls through */
+        case 10:
+            prediction += (long long) coefficients[9] * history[-10];
+
+        /* Falls through */
+        case 9:
+            prediction += (long long) coefficients[8] * history[-9];
+
+        /* Falls through */
+        case 8:
+            prediction += (long long) coefficients[7] * history[-8];
+
+        /* Falls through */
+        case 7:
+            prediction += (long long) coefficients[6] * history[-7];
+
+        /* Falls through */
+        case 6:
+            prediction += (long long) coefficients[5] * history[-6];
+
+        /* Falls through */
+        case 5:
+            prediction += (long long) coefficients[4] * history[-5];
+
+        /* Falls through */
+        case 4:
+            prediction += (long long) coefficients[3] * history[-4];
+
+        /* Falls through */
+        case 3:
+            prediction += (long long) coefficients[2] * history[-3];
+
+        /* Falls through */
+        case 2:
+            prediction += (long long) coefficients[1] * history[-2];
+
+        /* Falls through */
+        case 1:
+            prediction += (long long) coefficients[0] * history[-1];
+        }
+
+        samples[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) samples[i] + (oswrapper_audio__uint32) (prediction >> shift));
+    }
+}
+
+/* Decodes a subframe, which is one channel of a frame */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__flac_read_subframe(oswrapper_audio__flac_bits* bits, oswrapper_audio__int32* samples, unsigned int block_size, unsigned int sample_bits) {
+    unsigned int header = oswrapper_audio__flac_read_bits(bits, 8);
+    unsigned int type = (header >> 1) & 0x3F;
+    unsigned int wasted_bits = 0;
+    unsigned int order;
+    unsigned int i;
+
+    if (header & 0x80) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* Samples can have low bits which are always 0, which aren't stored */
+    if (header & 1) {
+        wasted_bits = oswrapper_audio__flac_read_unary(bits) + 1;
+
+        if (wasted_bits >= sample_bits) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        sample_bits -= wasted_bits;
+    }
+
+    /* The side channel of 32 bit audio would need 33 bits */
+    if (sample_bits > 32) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (type == 0) {
+        /* Constant */
+        oswrapper_audio__int32 value = oswrapper_audio__flac_read_signed(bits, sample_bits);
+
+        for (i = 0; i < block_size; i++) {
+            samples[i] = value;
+        }
+    } else if (type == 1) {
+        /* Verbatim */
+        for (i = 0; i < block_size; i++) {
+            samples[i] = oswrapper_audio__flac_read_signed(bits, sample_bits);
+        }
+    } else if (type >= 8 && type <= 12) {
+        /* Fixed predictor */
+        order = type - 8;
+
+        if (order > block_size) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        for (i = 0; i < order; i++) {
+            samples[i] = oswrapper_audio__flac_read_signed(bits, sample_bits);
+        }
+
+        if (!oswrapper_audio__flac_read_residual(bits, samples, block_size, order)) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        oswrapper_audio__flac_restore_fixed(samples, block_size, order);
+    } else if (type >= 32) {
+        /* Linear predictor */
+        oswrapper_audio__int32 coefficients[32];
+        unsigned int precision;
+        oswrapper_audio__int32 shift;
+        unsigned int order_bits = 0;
+        order = type - 31;
+
+        if (order > block_size) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        for (i = 0; i < order; i++) {
+            samples[i] = oswrapper_audio__flac_read_signed(bits, sample_bits);
+        }
+
+        precision = oswrapper_audio__flac_read_bits(bits, 4) + 1;
+        shift = oswrapper_audio__flac_read_signed(bits, 5);
+
+        if (precision == 16 || shift < 0) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        for (i = 0; i < order; i++) {
+            coefficients[i] = oswrapper_audio__flac_read_signed(bits, precision);
+        }
+
+        if (!oswrapper_audio__flac_read_residual(bits, samples, block_size, order)) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        while ((1u << (order_bits + 1)) <= order) {
+            order_bits++;
+        }
+
+        /* Each coefficient times a sample has at most sample_bits + precision bits, and they're summed order times */
+        if (sample_bits + precision + order_bits <= 32) {
+            oswrapper_audio__flac_restore_lpc_32(samples, block_size, coefficients, order, (unsigned int) shift);
+        } else {
+            oswrapper_audio__flac_restore_lpc_64(samples, block_size, coefficients, order, (unsigned int) shift);
+        }
+    } else {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (wasted_bits != 0) {
+        for (i = 0; i < block_size; i++) {
+            samples[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) samples[i] << wasted_bits);
+        }
+    }
+
+    return !bits->overrun;
+}
+
+/* A parsed FLAC frame header */
+typedef struct oswrapper_audio__flac_frame_header {
+    unsigned long long first_frame;
+    unsigned int block_size;
+    /* 0 to 7 when each channel is coded independently, 8 for left and side, 9 for side and right, 10 for mid and side */
+    unsigned int channel_assignment;
+} oswrapper_audio__flac_frame_header;
+
+static unsigned int oswrapper_audio__flac_crc8(const unsigned char* data, size_t size) {
+    unsigned int crc = 0;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        int bit;
+        crc ^= data[i];
+
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+        }
+    }
+
+    return crc;
+}
+
+static unsigned int oswrapper_audio__flac_crc16(const unsigned char* data, size_t size) {
+    unsigned int crc = 0;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        int bit;
+        crc ^= (unsigned int) data[i] << 8;
+
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) & 0xFFFF : (crc << 1) & 0xFFFF;
+        }
+    }
+
+    return crc;
+}
+
+/* Parses the frame header at the start of the given data.
+Returns the size of the header, 0 if it isn't a valid frame header for this stream,
+or OSWRAPPER_AUDIO_NEED_MORE_DATA if the data ends before the header does. */
+static size_t oswrapper_audio__flac_parse_frame_header(const oswrapper_audio__flac_decoder* flac, const unsigned char* data, size_t size, oswrapper_audio__flac_frame_header* header) {
+    /* 0 means the bit depth from STREAMINFO, 3 is reserved */
+    static const unsigned char sample_bits_codes[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+    OSWRAPPER_AUDIO_RESULT_TYPE variable_block_size;
+    unsigned long long number;
+    unsigned int block_code;
+    unsigned int rate_code;
+    unsigned int sample_bits_code;
+    size_t length;
+    size_t pos;
+    size_t i;
+
+    if (size < 5) {
+        return size >= 2 && (data[0] != 0xFF || (data[1] & 0xFE) != 0xF8) ? 0 : OSWRAPPER_AUDIO_NEED_MORE_DATA;
+    }
+
+    variable_block_size = data[1] & 1;
+    block_code = data[2] >> 4;
+    rate_code = data[2] & 0xF;
+    header->channel_assignment = data[3] >> 4;
+    sample_bits_code = (data[3] >> 1) & 7;
+
+    if (data[0] != 0xFF || (data[1] & 0xFE) != 0xF8 || block_code == 0 || rate_code == 15 || header->channel_assignment > 10 || sample_bits_code == 3 || (data[3] & 1)) {
+        return 0;
+    }
+
+    if (sample_bits_code != 0 && sample_bits_codes[sample_bits_code] != flac->bits_per_sample) {
+        return 0;
+    }
+
+    if (header->channel_assignment < 8 ? header->channel_assignment + 1 != flac->channel_count : flac->channel_count != 2) {
+        return 0;
+    }
+
+    /* The frame or sample number is coded like UTF-8, extended to 7 bytes */
+    if (data[4] < 0x80) {
+        number = data[4];
+        length = 1;
+    } else {
+        if (data[4] < 0xC0 || data[4] == 0xFF) {
+            return 0;
+        }
+
+        length = 2;
+
+        while (data[4] & (0x80 >> length)) {
+            length++;
+        }
+
+        number = data[4] & (0x7F >> length);
+    }
+
+    if (length > (variable_block_size ? 7u : 6u)) {
+        return 0;
+    }
+
+    pos = 4 + length;
+    /* The block size and sample rate can be after the number, and the header ends with a CRC */
+    length = pos + (block_code == 6 ? 1 : block_code == 7 ? 2 : 0) + (rate_code == 12 ? 1 : rate_code == 13 || rate_code == 14 ? 2 : 0) + 1;
+
+    if (size < length) {
+        return OSWRAPPER_AUDIO_NEED_MORE_DATA;
+    }
+
+    for (i = 5; i < pos; i++) {
+        if ((data[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+
+        number = (number << 6) | (data[i] & 0x3F);
+    }
+
+    if (block_code == 1) {
+        header->block_size = 192;
+    } else if (block_code <= 5) {
+        header->block_size = 576u << (block_code - 2);
+    } else if (block_code == 6) {
+        header->block_size = data[pos] + 1u;
+        pos += 1;
+    } else if (block_code == 7) {
+        header->block_size = oswrapper_audio__read_u16_be(data + pos) + 1u;
+        pos += 2;
+    } else {
+        header->block_size = 256u << (block_code - 8);
+    }
+
+    if (header->block_size > flac->max_block_size || oswrapper_audio__flac_crc8(data, length - 1) != data[length - 1]) {
+        return 0;
+    }
+
+    /* Fixed block size streams number frames, variable block size streams number samples */
+    header->first_frame = variable_block_size ? number : number * (flac->fixed_block_size != 0 ? flac->fixed_block_size : header->block_size);
+    return length;
+}
+
+/* Undoes the stereo decorrelation of a decoded frame */
+static void oswrapper_audio__flac_decorrelate(oswrapper_audio__int32* left, oswrapper_audio__int32* right, unsigned int channel_assignment, unsigned int block_size) {
+    unsigned int i = 0;
+
+    switch (channel_assignment) {
+    case 8:
+        /* Left and side, right is left - side */
+#if defined(OSWRAPPER_AUDIO__USE_SSE2)
+        for (; i + 4 <= block_size; i += 4) {
+            __m128i l = _mm_loadu_si128((const __m128i*) (left + i));
+            __m128i s = _mm_loadu_si128((const __m128i*) (right + i));
+            _mm_storeu_si128((__m128i*) (right + i), _mm_sub_epi32(l, s));
+        }
+
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+        for (; i + 4 <= block_size; i += 4) {
+            vst1q_s32(right + i, vsubq_s32(vld1q_s32(left + i), vld1q_s32(right + i)));
+        }
+
+#endif
+
+        for (; i < block_size; i++) {
+            right[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) left[i] - (oswrapper_audio__uint32) right[i]);
+        }
+
+        break;
+
+    case 9:
+        /* Side and right, left is side + right */
+#if defined(OSWRAPPER_AUDIO__USE_SSE2)
+        for (; i + 4 <= block_size; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i*) (left + i));
+            __m128i r = _mm_loadu_si128((const __m128i*) (right + i));
+            _mm_storeu_si128((__m128i*) (left + i), _mm_add_epi32(s, r));
+        }
+
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+        for (; i + 4 <= block_size; i += 4) {
+            vst1q_s32(left + i, vaddq_s32(vld1q_s32(left + i), vld1q_s32(right + i)));
+        }
+
+#endif
+
+        for (; i < block_size; i++) {
+            left[i] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) left[i] + (oswrapper_audio__uint32) right[i]);
+        }
+
+        break;
+
+    case 10:
+        /* Mid and side. The low bit of mid was dropped, and is the same as the low bit of side. */
+#if defined(OSWRAPPER_AUDIO__USE_SSE2)
+        {
+            const __m128i one = _mm_set1_epi32(1);
+
+            for (; i + 4 <= block_size; i += 4) {
+                __m128i s = _mm_loadu_si128((const __m128i*) (right + i));
+                __m128i m = _mm_or_si128(_mm_slli_epi32(_mm_loadu_si128((const __m128i*) (left + i)), 1), _mm_and_si128(s, one));
+                _mm_storeu_si128((__m128i*) (left + i), _mm_srai_epi32(_mm_add_epi32(m, s), 1));
+                _mm_storeu_si128((__m128i*) (right + i), _mm_srai_epi32(_mm_sub_epi32(m, s), 1));
+            }
+        }
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+        {
+            const int32x4_t one = vdupq_n_s32(1);
+
+            for (; i + 4 <= block_size; i += 4) {
+                int32x4_t s = vld1q_s32(right + i);
+                int32x4_t m = vorrq_s32(vshlq_n_s32(vld1q_s32(left + i), 1), vandq_s32(s, one));
+                vst1q_s32(left + i, vshrq_n_s32(vaddq_s32(m, s), 1));
+                vst1q_s32(right + i, vshrq_n_s32(vsubq_s32(m, s), 1));
+            }
+        }
+#endif
+
+        for (; i < block_size; i++) {
+            oswrapper_audio__uint32 side = (oswrapper_audio__uint32) right[i];
+            oswrapper_audio__uint32 mid = ((oswrapper_audio__uint32) left[i] << 1) | (side & 1);
+            left[i] = (oswrapper_audio__int32) (mid + side) >> 1;
+            right[i] = (oswrapper_audio__int32) (mid - side) >> 1;
+        }
+
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* Interleaves decoded channels to the packet buffer, as samples of the given format in the byte order of this system.
+Each channel has stride samples, and samples are shifted up to fill the format. Used by FLAC and ALAC. */
+static void oswrapper_audio__interleave_samples(const oswrapper_audio__int32* samples, unsigned int stride, unsigned int channel_count, unsigned int bits_per_sample, oswrapper_audio__sample_format format, void* output, unsigned int block_size) {
+    unsigned int shift = oswrapper_audio__sample_format_bits(format) - bits_per_sample;
+    unsigned int channel;
+    unsigned int i;
+
+    if (format == OSWRAPPER_AUDIO__SAMPLE_S16) {
+        short* out = (short*) output;
+
+        if (channel_count == 2) {
+            const oswrapper_audio__int32* left = samples;
+            const oswrapper_audio__int32* right = samples + stride;
+            i = 0;
+#if defined(OSWRAPPER_AUDIO__USE_SSE2)
+            {
+                const __m128i count = _mm_cvtsi32_si128((int) shift);
+
+                for (; i + 8 <= block_size; i += 8) {
+                    __m128i l = _mm_packs_epi32(_mm_sll_epi32(_mm_loadu_si128((const __m128i*) (left + i)), count), _mm_sll_epi32(_mm_loadu_si128((const __m128i*) (left + i + 4)), count));
+                    __m128i r = _mm_packs_epi32(_mm_sll_epi32(_mm_loadu_si128((const __m128i*) (right + i)), count), _mm_sll_epi32(_mm_loadu_si128((const __m128i*) (right + i + 4)), count));
+                    _mm_storeu_si128((__m128i*) (out + (i * 2)), _mm_unpacklo_epi16(l, r));
+                    _mm_storeu_si128((__m128i*) (out + (i * 2) + 8), _mm_unpackhi_epi16(l, r));
+                }
+            }
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+            {
+                const int32x4_t count = vdupq_n_s32((int) shift);
+
+                for (; i + 8 <= block_size; i += 8) {
+                    int16x8x2_t frames;
+                    frames.val[0] = vcombine_s16(vmovn_s32(vshlq_s32(vld1q_s32(left + i), count)), vmovn_s32(vshlq_s32(vld1q_s32(left + i + 4), count)));
+                    frames.val[1] = vcombine_s16(vmovn_s32(vshlq_s32(vld1q_s32(right + i), count)), vmovn_s32(vshlq_s32(vld1q_s32(right + i + 4), count)));
+                    vst2q_s16(out + (i * 2), frames);
+                }
+            }
+#endif
+
+            for (; i < block_size; i++) {
+                out[i * 2] = (short) ((oswrapper_audio__uint32) left[i] << shift);
+                out[(i * 2) + 1] = (short) ((oswrapper_audio__uint32) right[i] << shift);
+            }
+
+            return;
+        }
+
+        for (channel = 0; channel < channel_count; channel++) {
+            const oswrapper_audio__int32* in = samples + (channel * stride);
+
+            for (i = 0; i < block_size; i++) {
+                out[(i * channel_count) + channel] = (short) ((oswrapper_audio__uint32) in[i] << shift);
+            }
+        }
+    } else if (format == OSWRAPPER_AUDIO__SAMPLE_S32) {
+        oswrapper_audio__int32* out = (oswrapper_audio__int32*) output;
+
+        if (channel_count == 2) {
+            const oswrapper_audio__int32* left = samples;
+            const oswrapper_audio__int32* right = samples + stride;
+            i = 0;
+#if defined(OSWRAPPER_AUDIO__USE_SSE2)
+            {
+                const __m128i count = _mm_cvtsi32_si128((int) shift);
+
+                for (; i + 4 <= block_size; i += 4) {
+                    __m128i l = _mm_sll_epi32(_mm_loadu_si128((const __m128i*) (left + i)), count);
+                    __m128i r = _mm_sll_epi32(_mm_loadu_si128((const __m128i*) (right + i)), count);
+                    _mm_storeu_si128((__m128i*) (out + (i * 2)), _mm_unpacklo_epi32(l, r));
+                    _mm_storeu_si128((__m128i*) (out + (i * 2) + 4), _mm_unpackhi_epi32(l, r));
+                }
+            }
+#elif defined(OSWRAPPER_AUDIO__USE_NEON)
+            {
+                const int32x4_t count = vdupq_n_s32((int) shift);
+
+                for (; i + 4 <= block_size; i += 4) {
+                    int32x4x2_t frames;
+                    frames.val[0] = vshlq_s32(vld1q_s32(left + i), count);
+                    frames.val[1] = vshlq_s32(vld1q_s32(right + i), count);
+                    vst2q_s32(out + (i * 2), frames);
+                }
+            }
+#endif
+
+            for (; i < block_size; i++) {
+                out[i * 2] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) left[i] << shift);
+                out[(i * 2) + 1] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) right[i] << shift);
+            }
+
+            return;
+        }
+
+        for (channel = 0; channel < channel_count; channel++) {
+            const oswrapper_audio__int32* in = samples + (channel * stride);
+
+            for (i = 0; i < block_size; i++) {
+                out[(i * channel_count) + channel] = (oswrapper_audio__int32) ((oswrapper_audio__uint32) in[i] << shift);
+            }
+        }
+    } else if (format == OSWRAPPER_AUDIO__SAMPLE_S24) {
+        unsigned char* out = (unsigned char*) output;
+        OSWRAPPER_AUDIO_RESULT_TYPE big_endian = oswrapper_audio__system_is_big_endian();
+
+        for (channel = 0; channel < channel_count; channel++) {
+            const oswrapper_audio__int32* in = samples + (channel * stride);
+
+            for (i = 0; i < block_size; i++) {
+                oswrapper_audio__uint32 value = (oswrapper_audio__uint32) in[i] << shift;
+                unsigned char* sample = out + (((i * channel_count) + channel) * 3);
+                sample[big_endian ? 2 : 0] = (unsigned char) value;
+                sample[1] = (unsigned char) (value >> 8);
+                sample[big_endian ? 0 : 2] = (unsigned char) (value >> 16);
+            }
+        }
+    } else {
+        signed char* out = (signed char*) output;
+
+        for (channel = 0; channel < channel_count; channel++) {
+            const oswrapper_audio__int32* in = samples + (channel * stride);
+
+            for (i = 0; i < block_size; i++) {
+                out[(i * channel_count) + channel] = (signed char) ((oswrapper_audio__uint32) in[i] << shift);
+            }
+        }
+    }
+}
+
+/* Decodes the FLAC frame at the start of the given data to the decoder's samples.
+Returns the size of the frame, 0 if it isn't a valid frame,
+or OSWRAPPER_AUDIO_NEED_MORE_DATA if the data ends before the frame does. */
+static size_t oswrapper_audio__flac_decode_frame(oswrapper_audio__flac_decoder* flac, const unsigned char* data, size_t size, oswrapper_audio__flac_frame_header* header) {
+    size_t header_size = oswrapper_audio__flac_parse_frame_header(flac, data, size, header);
+    oswrapper_audio__flac_bits bits;
+    size_t frame_size;
+    unsigned int channel;
+
+    if (header_size == 0 || header_size == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+        return header_size;
+    }
+
+    bits.next = data + header_size;
+    bits.end = data + size;
+    bits.cache = 0;
+    bits.cache_bits = 0;
+    bits.overrun = OSWRAPPER_AUDIO_RESULT_FAILURE;
+
+    for (channel = 0; channel < flac->channel_count; channel++) {
+        /* The side channel has one more bit than the other channels */
+        unsigned int side = (header->channel_assignment == 8 && channel == 1) || (header->channel_assignment == 9 && channel == 0) || (header->channel_assignment == 10 && channel == 1);
+
+        if (!oswrapper_audio__flac_read_subframe(&bits, flac->samples + (channel * flac->max_block_size), header->block_size, flac->bits_per_sample + side)) {
+            return bits.overrun ? OSWRAPPER_AUDIO_NEED_MORE_DATA : 0;
+        }
+    }
+
+    /* The subframes are padded to a whole byte, then the frame ends with a CRC of the whole frame */
+    frame_size = (size_t) (bits.next - data) - (bits.cache_bits / 8);
+
+    if (size - frame_size < 2) {
+        return OSWRAPPER_AUDIO_NEED_MORE_DATA;
+    }
+
+    if (flac->verify_next && oswrapper_audio__flac_crc16(data, frame_size) != oswrapper_audio__read_u16_be(data + frame_size)) {
+        return 0;
+    }
+
+    oswrapper_audio__flac_decorrelate(flac->samples, flac->samples + flac->max_block_size, header->channel_assignment, header->block_size);
+    return frame_size + 2;
+}
+
+/* Copies size bytes at the given offset to the output, a window at a time */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__reader_copy(oswrapper_audio__reader* reader, unsigned long long offset, unsigned char* output, size_t size) {
+    size_t copied = 0;
+
+    while (copied < size) {
+        size_t this_chunk = size - copied < OSWRAPPER_AUDIO_READER_WINDOW_SIZE ? size - copied : OSWRAPPER_AUDIO_READER_WINDOW_SIZE;
+        const unsigned char* data = oswrapper_audio__reader_get(reader, offset + copied, this_chunk);
+
+        if (data == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        OSWRAPPER_AUDIO_MEMCPY(output + copied, data, this_chunk);
+        copied += this_chunk;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Creates a FLAC decoder for a parsed header. The seek table is copied, unless it's in memory which stays valid. */
+static oswrapper_audio__flac_decoder* oswrapper_audio__create_flac_decoder(const oswrapper_audio__source_info* info, oswrapper_audio__reader* reader, const OSWrapper_audio_allocator* allocator) {
+    oswrapper_audio__flac_decoder* flac;
+    /* Each sample of a verbatim subframe, which is the largest a subframe can be */
+    size_t max_frame_size = OSWRAPPER_AUDIO__FLAC_MAX_HEADER_SIZE + 2 + (info->channel_count * (2 + (((size_t) info->frames_per_packet * (info->bits_per_channel + 1)) + 7) / 8));
+    size_t seek_table_size = (size_t) info->seek_point_count * OSWRAPPER_AUDIO__FLAC_SEEK_POINT_SIZE;
+
+    if (info->channel_count > 8 || info->bits_per_channel > 32) {
+        return NULL;
+    }
+
+    flac = (oswrapper_audio__flac_decoder*) oswrapper_audio__malloc(allocator, sizeof(oswrapper_audio__flac_decoder) + ((size_t) info->frames_per_packet * info->channel_count * sizeof(oswrapper_audio__int32)));
+
+    if (flac == NULL) {
+        return NULL;
+    }
+
+    flac->allocator = allocator;
+    flac->channel_count = info->channel_count;
+    flac->bits_per_sample = info->bits_per_channel;
+    flac->fixed_block_size = info->min_frames_per_packet == info->frames_per_packet ? info->frames_per_packet : 0;
+    flac->max_block_size = info->frames_per_packet;
+    flac->max_frame_size = info->max_packet_size != 0 ? (size_t) info->max_packet_size : max_frame_size;
+    flac->data_end = info->data_offset + info->data_size;
+    flac->seek_table = NULL;
+    flac->seek_table_copy = NULL;
+    flac->seek_point_count = 0;
+    flac->next_offset = info->data_offset;
+    flac->next_frame = 0;
+    flac->verify_next = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    flac->block_first_frame = 0;
+    flac->block_frames = 0;
+    flac->read_buffer_offset = 0;
+    flac->read_buffer_filled = 0;
+    flac->samples = (oswrapper_audio__int32*) (flac + 1);
+
+    if (seek_table_size != 0 && info->seek_table_offset + seek_table_size <= info->data_offset) {
+        if (reader->data != NULL && !reader->streaming) {
+            flac->seek_table = reader->data + (size_t) info->seek_table_offset;
+        } else {
+            flac->seek_table_copy = (unsigned char*) oswrapper_audio__malloc(allocator, seek_table_size);
+
+            /* Seeking still works without the seek table, just slower */
+            if (flac->seek_table_copy != NULL && !oswrapper_audio__reader_copy(reader, info->seek_table_offset, flac->seek_table_copy, seek_table_size)) {
+                oswrapper_audio__free(allocator, flac->seek_table_copy);
+                flac->seek_table_copy = NULL;
+            }
+
+            flac->seek_table = flac->seek_table_copy;
+        }
+
+        if (flac->seek_table != NULL) {
+            flac->seek_point_count = info->seek_point_count;
+        }
+    }
+
+    return flac;
+}
+
+/* Only used by ALAC. Packets are grouped so finding the offset of a packet adds up the sizes of at most this many packets before it. */
+#define OSWRAPPER_AUDIO__ALAC_GROUP_PACKETS 64
+/* When loading from callbacks, the read buffer holds this many of the largest packets */
+#define OSWRAPPER_AUDIO__ALAC_READ_PACKETS 8
+
+/* ALAC element types */
+#define OSWRAPPER_AUDIO__ALAC_SCE 0
+#define OSWRAPPER_AUDIO__ALAC_CPE 1
+#define OSWRAPPER_AUDIO__ALAC_LFE 3
+#define OSWRAPPER_AUDIO__ALAC_DSE 4
+#define OSWRAPPER_AUDIO__ALAC_FIL 6
+
+/* The output channel of each channel in an ALAC packet, for each channel count.
+Packets have the centre channel first and the LFE channel last. */
+static const unsigned char oswrapper_audio__alac_channel_maps[8][8] = {
+    { 0 },
+    { 0, 1 },
+    { 2, 0, 1 },
+    { 2, 0, 1, 3 },
+    { 2, 0, 1, 3, 4 },
+    { 2, 0, 1, 4, 5, 3 },
+    { 2, 0, 1, 4, 5, 6, 3 },
+    { 2, 6, 7, 0, 1, 4, 5, 3 }
+};
+
+/* Reads bits from an ALAC packet. The position can go past the end, where every bit is 0,
+so it's checked after each element instead of after each read. */
+typedef struct oswrapper_audio__alac_bits {
+    const unsigned char* data;
+    size_t size;
+    /* In bits */
+    size_t pos;
+} oswrapper_audio__alac_bits;
+
+/* Counts the leading zero bits of a 32 bit value, which can be 0 */
+static unsigned int oswrapper_audio__alac_count_leading_zeros(oswrapper_audio__uint32 value) {
+    return value != 0 ? oswrapper_audio__count_leading_zeros_64(value) - 32 : 32;
+}
+
+/* Returns the next 32 bits, without reading them */
+static oswrapper_audio__uint32 oswrapper_audio__alac_peek(const oswrapper_audio__alac_bits* bits) {
+    size_t byte = bits->pos >> 3;
+    unsigned long long value = 0;
+    unsigned int i;
+
+    if (byte + 5 <= bits->size) {
+        const unsigned char* data = bits->data + byte;
+        value = ((unsigned long long) data[0] << 32) | ((unsigned long long) oswrapper_audio__read_u32_be(data + 1));
+    } else {
+        for (i = 0; i < 5; i++) {
+            value = (value << 8) | (byte + i < bits->size ? bits->data[byte + i] : 0);
+        }
+    }
+
+    return (oswrapper_audio__uint32) (value >> (8 - (bits->pos & 7)));
+}
+
+/* Reads up to 32 bits */
+static oswrapper_audio__uint32 oswrapper_audio__alac_read(oswrapper_audio__alac_bits* bits, unsigned int count) {
+    oswrapper_audio__uint32 value;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    value = oswrapper_audio__alac_peek(bits) >> (32 - count);
+    bits->pos += count;
+    return value;
+}
+
+/* Sign extends the low bits of a value */
+static oswrapper_audio__int32 oswrapper_audio__alac_sign_extend(oswrapper_audio__uint32 value, unsigned int bits) {
+    unsigned int shift = 32 - bits;
+    return (oswrapper_audio__int32) (value << shift) >> shift;
+}
+
+/* Decodes the residual of one channel of an ALAC element, which uses adaptive Rice coding
+with the parameter chosen from a running average of the values before it. Runs of zeros are coded separately when the average is small. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__alac_read_residual(const oswrapper_audio__alac_decoder* alac, oswrapper_audio__alac_bits* bits, oswrapper_audio__int32* output, unsigned long count, unsigned int sample_bits, oswrapper_audio__uint32 history_mult) {
+    oswrapper_audio__uint32 history = alac->initial_history;
+    oswrapper_audio__uint32 limit_mask = ((oswrapper_audio__uint32) 1 << alac->rice_limit) - 1;
+    /* Set after a run of zeros, which makes the next value one larger */
+    oswrapper_audio__uint32 after_zeros = 0;
+    unsigned long i = 0;
+
+    while (i < count) {
+        oswrapper_audio__uint32 stream = oswrapper_audio__alac_peek(bits);
+        oswrapper_audio__uint32 prefix = oswrapper_audio__alac_count_leading_zeros(~stream);
+        unsigned int k = 31 - oswrapper_audio__alac_count_leading_zeros((history >> 9) + 3);
+        oswrapper_audio__uint32 value;
+        oswrapper_audio__uint32 decoded;
+        oswrapper_audio__uint32 half;
+        k = k < alac->rice_limit ? k : alac->rice_limit;
+
+        if (prefix >= 9) {
+            /* Escaped values are stored in sample_bits bits */
+            bits->pos += 9;
+            value = oswrapper_audio__alac_read(bits, sample_bits);
+        } else {
+            value = prefix;
+            bits->pos += prefix + 1;
+
+            if (k != 1) {
+                oswrapper_audio__uint32 suffix = prefix + 1 + k <= 32 ? (stream << (prefix + 1)) >> (32 - k) : oswrapper_audio__alac_peek(bits) >> (32 - k);
+                value = prefix * (((oswrapper_audio__uint32) 1 << k) - 1);
+                bits->pos += k - 1;
+
+                /* Suffixes of 0 and 1 are one bit shorter */
+                if (suffix >= 2) {
+                    value += suffix - 1;
+                    bits->pos++;
+                }
+            }
+        }
+
+        /* Odd values are negative */
+        decoded = value + after_zeros;
+        half = (decoded >> 1) + (decoded & 1);
+        output[i++] = (oswrapper_audio__int32) ((decoded & 1) ? 0 - half : half);
+        history = (history_mult * decoded) + history - ((history_mult * history) >> 9);
+        after_zeros = 0;
+
+        if (value > 0xFFFF) {
+            history = 0xFFFF;
+        }
+
+        if ((history << 2) < 512 && i < count) {
+            unsigned int zero_k = oswrapper_audio__alac_count_leading_zeros(history) - 24 + ((history + 16) >> 6);
+            oswrapper_audio__uint32 run;
+            stream = oswrapper_audio__alac_peek(bits);
+            prefix = oswrapper_audio__alac_count_leading_zeros(~stream);
+
+            if (prefix >= 9) {
+                run = (stream >> 7) & 0xFFFF;
+                bits->pos += 25;
+            } else {
+                oswrapper_audio__uint32 suffix = (stream << (prefix + 1)) >> (32 - zero_k);
+                run = prefix * ((((oswrapper_audio__uint32) 1 << zero_k) - 1) & limit_mask);
+                bits->pos += prefix + 1 + zero_k;
+
+                if (suffix >= 2) {
+                    run += suffix - 1;
+                } else {
+                    bits->pos--;
+                }
+            }
+
+            if (run > count - i) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            after_zeros = run < 65535 ? 1 : 0;
+            history = 0;
+
+            for (; run > 0; run--) {
+                output[i++] = 0;
+            }
+        }
+    }
+
+    return bits->pos <= bits->size * 8 ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+/* Undoes the adaptive prediction of one channel of an ALAC element in place.
+The coefficients are adapted after each sample by the sign of its residual. An order of 31 is a running sum instead. */
+static void oswrapper_audio__alac_predict(oswrapper_audio__int32* samples, unsigned long count, short* coefficients, unsigned int order, unsigned int sample_bits, unsigned int den_shift) {
+    oswrapper_audio__uint32 den_half = den_shift != 0 ? (oswrapper_audio__uint32) 1 << (den_shift - 1) : 0;
+    unsigned long j;
+
+    if (order == 0) {
+        return;
+    }
+
+    /* The first samples, or every sample for an order of 31, only add the previous sample */
+    for (j = 1; j < count && (j <= order || order == 31); j++) {
+        samples[j] = oswrapper_audio__alac_sign_extend((oswrapper_audio__uint32) samples[j] + (oswrapper_audio__uint32) samples[j - 1], sample_bits);
+    }
+
+    for (; j < count; j++) {
+        oswrapper_audio__int32 top = samples[j - order - 1];
+        oswrapper_audio__int32 residual = samples[j];
+        oswrapper_audio__uint32 sum = 0;
+        unsigned int k;
+
+        for (k = 0; k < order; k++) {
+            sum += (oswrapper_audio__uint32) (oswrapper_audio__int32) coefficients[k] * ((oswrapper_audio__uint32) samples[j - 1 - k] - (oswrapper_audio__uint32) top);
+        }
+
+        samples[j] = oswrapper_audio__alac_sign_extend((oswrapper_audio__uint32) residual + (oswrapper_audio__uint32) top + (oswrapper_audio__uint32) ((oswrapper_audio__int32) (sum + den_half) >> den_shift), sample_bits);
+
+        /* Coefficients are adapted starting from the one for the oldest sample, until the residual would have been used up */
+        for (k = order; k > 0 && residual != 0; k--) {
+            oswrapper_audio__int32 difference = (oswrapper_audio__int32) ((oswrapper_audio__uint32) top - (oswrapper_audio__uint32) samples[j - k]);
+            oswrapper_audio__uint32 magnitude = difference < 0 ? 0 - (oswrapper_audio__uint32) difference : (oswrapper_audio__uint32) difference;
+            int sign = difference > 0 ? 1 : difference < 0 ? -1 : 0;
+
+            if (residual > 0) {
+                coefficients[k - 1] = (short) (coefficients[k - 1] - sign);
+                residual = (oswrapper_audio__int32) ((oswrapper_audio__uint32) residual - ((order - k + 1) * (magnitude >> den_shift)));
+
+                if (residual <= 0) {
+                    break;
+                }
+            } else {
+                coefficients[k - 1] = (short) (coefficients[k - 1] + sign);
+                residual = (oswrapper_audio__int32) ((oswrapper_audio__uint32) residual - ((order - k + 1) * (oswrapper_audio__uint32) ((oswrapper_audio__int32) (0 - magnitude) >> den_shift)));
+
+                if (residual >= 0) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Decodes an SCE, LFE, or CPE element of an ALAC packet to one or two channels.
+Returns the amount of frames in it, or 0 if it isn't a valid element. */
+static unsigned long oswrapper_audio__alac_decode_element(oswrapper_audio__alac_decoder* alac, oswrapper_audio__alac_bits* bits, oswrapper_audio__int32** channels, unsigned int channel_count) {
+    short coefficients[2][32];
+    unsigned int modes[2];
+    unsigned int den_shifts[2];
+    unsigned int history_mults[2];
+    unsigned int orders[2];
+    unsigned long frames = alac->frame_length;
+    unsigned int header;
+    unsigned int shift_bytes;
+    unsigned int sample_bits;
+    unsigned int mix_bits;
+    oswrapper_audio__int32 mix_res;
+    size_t shift_pos = 0;
+    unsigned int channel;
+    unsigned int k;
+    unsigned long i;
+
+    /* The element instance tag, then 12 unused bits */
+    oswrapper_audio__alac_read(bits, 4);
+
+    if (oswrapper_audio__alac_read(bits, 12) != 0) {
+        return 0;
+    }
+
+    /* Whether the frame count is stored, how many low bytes of each sample are stored uncompressed, and whether every sample is uncompressed */
+    header = oswrapper_audio__alac_read(bits, 4);
+    shift_bytes = (header >> 1) & 3;
+
+    if (shift_bytes == 3) {
+        return 0;
+    }
+
+    if (header & 8) {
+        frames = oswrapper_audio__alac_read(bits, 32);
+
+        if (frames == 0 || frames > alac->frame_length) {
+            return 0;
+        }
+    }
+
+    if (header & 1) {
+        for (i = 0; i < frames; i++) {
+            for (channel = 0; channel < channel_count; channel++) {
+                channels[channel][i] = oswrapper_audio__alac_sign_extend(oswrapper_audio__alac_read(bits, alac->bits_per_sample), alac->bits_per_sample);
+            }
+        }
+
+        return bits->pos <= bits->size * 8 ? frames : 0;
+    }
+
+    /* The difference channel of a stereo pair needs one more bit */
+    sample_bits = alac->bits_per_sample - (shift_bytes * 8) + (channel_count - 1);
+    mix_bits = oswrapper_audio__alac_read(bits, 8);
+    mix_res = oswrapper_audio__alac_sign_extend(oswrapper_audio__alac_read(bits, 8), 8);
+
+    if (sample_bits > 32 || mix_bits > 31) {
+        return 0;
+    }
+
+    for (channel = 0; channel < channel_count; channel++) {
+        header = oswrapper_audio__alac_read(bits, 8);
+        modes[channel] = header >> 4;
+        den_shifts[channel] = header & 15;
+        header = oswrapper_audio__alac_read(bits, 8);
+        history_mults[channel] = (alac->history_mult * (header >> 5)) / 4;
+        orders[channel] = header & 31;
+
+        for (k = 0; k < orders[channel]; k++) {
+            coefficients[channel][k] = (short) oswrapper_audio__alac_sign_extend(oswrapper_audio__alac_read(bits, 16), 16);
+        }
+    }
+
+    /* The shifted low bytes come before the residuals, but are added after prediction */
+    if (shift_bytes != 0) {
+        shift_pos = bits->pos;
+        bits->pos += (size_t) shift_bytes * 8 * channel_count * frames;
+    }
+
+    for (channel = 0; channel < channel_count; channel++) {
+        if (!oswrapper_audio__alac_read_residual(alac, bits, channels[channel], frames, sample_bits, history_mults[channel])) {
+            return 0;
+        }
+
+        if (modes[channel] != 0) {
+            oswrapper_audio__alac_predict(channels[channel], frames, NULL, 31, sample_bits, 0);
+        }
+
+        oswrapper_audio__alac_predict(channels[channel], frames, coefficients[channel], orders[channel], sample_bits, den_shifts[channel]);
+    }
+
+    /* Stereo pairs can be stored as a weighted mid channel and a difference channel */
+    if (channel_count == 2 && mix_res != 0) {
+        for (i = 0; i < frames; i++) {
+            oswrapper_audio__uint32 difference = (oswrapper_audio__uint32) channels[1][i];
+            oswrapper_audio__uint32 left = (oswrapper_audio__uint32) channels[0][i] + difference - (oswrapper_audio__uint32) ((oswrapper_audio__int32) ((oswrapper_audio__uint32) mix_res * difference) >> mix_bits);
+            channels[0][i] = (oswrapper_audio__int32) left;
+            channels[1][i] = (oswrapper_audio__int32) (left - difference);
+        }
+    }
+
+    if (shift_bytes != 0) {
+        size_t end = bits->pos;
+        bits->pos = shift_pos;
+
+        for (i = 0; i < frames; i++) {
+            for (channel = 0; channel < channel_count; channel++) {
+                channels[channel][i] = (oswrapper_audio__int32) (((oswrapper_audio__uint32) channels[channel][i] << (shift_bytes * 8)) | oswrapper_audio__alac_read(bits, shift_bytes * 8));
+            }
+        }
+
+        bits->pos = end;
+    }
+
+    return frames;
+}
+
+/* Decodes an ALAC packet to the decoder's samples, in the order of the output channels.
+Returns the amount of frames in it, or 0 if it isn't a valid packet. */
+static unsigned long oswrapper_audio__alac_decode_packet(oswrapper_audio__alac_decoder* alac, const unsigned char* data, size_t size) {
+    oswrapper_audio__alac_bits bits;
+    unsigned long frames = 0;
+    unsigned int channel = 0;
+    bits.data = data;
+    bits.size = size;
+    bits.pos = 0;
+
+    while (channel < alac->channel_count) {
+        unsigned int tag = oswrapper_audio__alac_read(&bits, 3);
+        unsigned long count;
+
+        if (tag == OSWRAPPER_AUDIO__ALAC_SCE || tag == OSWRAPPER_AUDIO__ALAC_CPE || tag == OSWRAPPER_AUDIO__ALAC_LFE) {
+            oswrapper_audio__int32* channels[2];
+            unsigned int channel_count = tag == OSWRAPPER_AUDIO__ALAC_CPE ? 2 : 1;
+            unsigned long element_frames;
+
+            if (channel + channel_count > alac->channel_count) {
+                return 0;
+            }
+
+            channels[0] = alac->samples + ((size_t) alac->channel_map[channel] * alac->frame_length);
+            channels[1] = channel_count == 2 ? alac->samples + ((size_t) alac->channel_map[channel + 1] * alac->frame_length) : NULL;
+            element_frames = oswrapper_audio__alac_decode_element(alac, &bits, channels, channel_count);
+
+            /* Every channel has the same amount of frames */
+            if (element_frames == 0 || (frames != 0 && element_frames != frames)) {
+                return 0;
+            }
+
+            frames = element_frames;
+            channel += channel_count;
+        } else if (tag == OSWRAPPER_AUDIO__ALAC_DSE) {
+            /* Data stream elements are skipped, and can be aligned to a byte */
+            unsigned int aligned;
+            oswrapper_audio__alac_read(&bits, 4);
+            aligned = oswrapper_audio__alac_read(&bits, 1);
+            count = oswrapper_audio__alac_read(&bits, 8);
+
+            if (count == 255) {
+                count += oswrapper_audio__alac_read(&bits, 8);
+            }
+
+            if (aligned) {
+                bits.pos = (bits.pos + 7) & ~(size_t) 7;
+            }
+
+            bits.pos += (size_t) count * 8;
+        } else if (tag == OSWRAPPER_AUDIO__ALAC_FIL) {
+            /* Fill elements are skipped */
+            count = oswrapper_audio__alac_read(&bits, 4);
+
+            if (count == 15) {
+                count += oswrapper_audio__alac_read(&bits, 8) - 1;
+            }
+
+            bits.pos += (size_t) count * 8;
+        } else {
+            return 0;
+        }
+
+        if (bits.pos > size * 8) {
+            return 0;
+        }
+    }
+
+    return frames;
+}
+
+/* Returns the size of an ALAC packet */
+static unsigned long oswrapper_audio__alac_packet_size(const oswrapper_audio__alac_decoder* alac, unsigned long packet) {
+    return alac->packet_sizes != NULL ? oswrapper_audio__read_u32_be(alac->packet_sizes + ((size_t) packet * 4)) : alac->fixed_packet_size;
+}
+
+/* Reads the chunk offset and sample to chunk tables, and groups packets which are next to each other in the file.
+Returns the amount of groups, and fills groups if it isn't NULL. Packets from the first one which isn't in the audio data are dropped. */
+static unsigned long oswrapper_audio__alac_build_groups(oswrapper_audio__alac_decoder* alac, const oswrapper_audio__source_info* info, oswrapper_audio__reader* reader, oswrapper_audio__alac_group* groups) {
+    unsigned long group_count = 0;
+    unsigned long group_first_packet = 0;
+    unsigned long packet = 0;
+    unsigned long map_index = 0;
+    unsigned long packets_per_chunk = 0;
+    unsigned long long next_offset = 0;
+    unsigned long chunk;
+
+    for (chunk = 0; chunk < info->mp4.chunk_count && packet < alac->packet_count; chunk++) {
+        const unsigned char* entry;
+        unsigned long long offset;
+        unsigned long i;
+
+        /* Each entry of the sample to chunk table applies from its first chunk, counted from 1, until the next entry */
+        while (map_index < info->mp4.chunk_map_count) {
+            entry = oswrapper_audio__reader_get(reader, info->mp4.chunk_map_offset + ((unsigned long long) map_index * 12), 12);
+
+            if (entry == NULL || oswrapper_audio__read_u32_be(entry) > chunk + 1) {
+                break;
+            }
+
+            packets_per_chunk = oswrapper_audio__read_u32_be(entry + 4);
+            map_index++;
+        }
+
+        entry = oswrapper_audio__reader_get(reader, info->mp4.chunk_offset_offset + ((unsigned long long) chunk * info->mp4.chunk_offset_size), info->mp4.chunk_offset_size);
+
+        if (entry == NULL) {
+            break;
+        }
+
+        offset = info->mp4.chunk_offset_size == 8 ? oswrapper_audio__read_u64_be(entry) : oswrapper_audio__read_u32_be(entry);
+
+        for (i = 0; i < packets_per_chunk && packet < alac->packet_count; i++) {
+            unsigned long size = oswrapper_audio__alac_packet_size(alac, packet);
+
+            if (size == 0 || offset < info->data_offset || offset > alac->data_end || size > alac->data_end - offset) {
+                alac->packet_count = packet;
+                return group_count;
+            }
+
+            if (group_count == 0 || offset != next_offset || packet - group_first_packet >= OSWRAPPER_AUDIO__ALAC_GROUP_PACKETS) {
+                if (groups != NULL) {
+                    groups[group_count].offset = offset;
+                    groups[group_count].first_packet = packet;
+                }
+
+                group_first_packet = packet;
+                group_count++;
+            }
+
+            if (size > alac->max_packet_size) {
+                alac->max_packet_size = size;
+            }
+
+            offset += size;
+            next_offset = offset;
+            packet++;
+        }
+    }
+
+    alac->packet_count = packet;
+    return group_count;
+}
+
+/* Reads the time to sample table into runs of packets with the same duration.
+Packets without a duration are never decoded, and packets can't be longer than the frame length. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__alac_build_runs(oswrapper_audio__alac_decoder* alac, const oswrapper_audio__source_info* info, oswrapper_audio__reader* reader) {
+    unsigned long packet = 0;
+    unsigned long i;
+
+    for (i = 0; i < info->mp4.time_count && packet < alac->packet_count; i++) {
+        const unsigned char* entry = oswrapper_audio__reader_get(reader, info->mp4.time_offset + ((unsigned long long) i * 8), 8);
+        unsigned long count;
+        unsigned long long frames;
+
+        if (entry == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        count = oswrapper_audio__read_u32_be(entry);
+        count = count < alac->packet_count - packet ? count : alac->packet_count - packet;
+        frames = oswrapper_audio__mp4_packet_frames(info, oswrapper_audio__read_u32_be(entry + 4));
+        frames = frames < alac->frame_length ? frames : alac->frame_length;
+
+        if (count != 0 && frames != 0) {
+            const oswrapper_audio__alac_run* last = alac->run_count != 0 ? alac->runs + (alac->run_count - 1) : NULL;
+
+            /* Entries which carry on from the last run are merged into it */
+            if (last == NULL || last->frames_per_packet != frames || last->first_packet + ((alac->total_frames - last->first_frame) / frames) != packet) {
+                oswrapper_audio__alac_run* run = alac->runs + alac->run_count;
+                run->first_frame = alac->total_frames;
+                run->first_packet = packet;
+                run->frames_per_packet = (unsigned long) frames;
+                alac->run_count++;
+            }
+
+            alac->total_frames += count * frames;
+        }
+
+        packet += count;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Creates an ALAC decoder for a parsed header, and reads the sample tables into its index.
+The sample size table is copied, unless it's in memory which stays valid. */
+static oswrapper_audio__alac_decoder* oswrapper_audio__create_alac_decoder(const oswrapper_audio__source_info* info, oswrapper_audio__reader* reader, const OSWrapper_audio_allocator* allocator) {
+    oswrapper_audio__alac_decoder* alac = (oswrapper_audio__alac_decoder*) oswrapper_audio__malloc(allocator, sizeof(oswrapper_audio__alac_decoder) + ((size_t) info->frames_per_packet * info->channel_count * sizeof(oswrapper_audio__int32)));
+    size_t packet_sizes_size = info->mp4.sample_size == 0 ? (size_t) info->mp4.packet_count * 4 : 0;
+    unsigned long max_runs = info->mp4.time_count < info->mp4.packet_count ? info->mp4.time_count : info->mp4.packet_count;
+
+    if (alac == NULL) {
+        return NULL;
+    }
+
+    alac->channel_count = info->channel_count;
+    alac->bits_per_sample = info->bits_per_channel;
+    alac->frame_length = info->frames_per_packet;
+    alac->history_mult = info->mp4.history_mult;
+    alac->initial_history = info->mp4.initial_history;
+    alac->rice_limit = info->mp4.rice_limit;
+    alac->channel_map = oswrapper_audio__alac_channel_maps[info->channel_count - 1];
+    alac->packet_count = info->mp4.packet_count;
+    alac->total_frames = 0;
+    alac->fixed_packet_size = info->mp4.sample_size;
+    alac->packet_sizes = NULL;
+    alac->packet_sizes_copy = NULL;
+    alac->max_packet_size = 0;
+    alac->data_end = info->data_offset + info->data_size;
+    alac->runs = NULL;
+    alac->run_count = 0;
+    alac->groups = NULL;
+    alac->group_count = 0;
+    alac->next_packet = 0;
+    alac->next_offset = info->data_offset;
+    alac->next_group = 1;
+    alac->block_first_frame = 0;
+    alac->block_frames = 0;
+    alac->read_buffer_offset = 0;
+    alac->read_buffer_filled = 0;
+    alac->samples = (oswrapper_audio__int32*) (alac + 1);
+
+    if (packet_sizes_size != 0) {
+        if (reader->data != NULL && !reader->streaming) {
+            alac->packet_sizes = reader->data + (size_t) info->mp4.size_offset;
+        } else {
+            alac->packet_sizes_copy = (unsigned char*) oswrapper_audio__malloc(allocator, packet_sizes_size);
+
+            if (alac->packet_sizes_copy == NULL || !oswrapper_audio__reader_copy(reader, info->mp4.size_offset, alac->packet_sizes_copy, packet_sizes_size)) {
+                oswrapper_audio__free_alac_decoder(alac, allocator);
+                return NULL;
+            }
+
+            alac->packet_sizes = alac->packet_sizes_copy;
+        }
+    }
+
+    /* The groups are counted first, so the index is allocated once at the size it needs */
+    alac->group_count = oswrapper_audio__alac_build_groups(alac, info, reader, NULL);
+
+    if (alac->packet_count != 0) {
+        alac->runs = (oswrapper_audio__alac_run*) oswrapper_audio__malloc(allocator, ((size_t) max_runs * sizeof(oswrapper_audio__alac_run)) + ((size_t) alac->group_count * sizeof(oswrapper_audio__alac_group)));
+
+        if (alac->runs == NULL) {
+            oswrapper_audio__free_alac_decoder(alac, allocator);
+            return NULL;
+        }
+
+        alac->groups = (oswrapper_audio__alac_group*) (alac->runs + max_runs);
+        oswrapper_audio__alac_build_groups(alac, info, reader, alac->groups);
+        alac->next_offset = alac->groups[0].offset;
+
+        if (!oswrapper_audio__alac_build_runs(alac, info, reader)) {
+            oswrapper_audio__free_alac_decoder(alac, allocator);
+            return NULL;
+        }
+    }
+
+    return alac;
+}
+
+/* Returns the most storage the index of an ALAC file's sample tables can need, including aligning it.
+Each entry of the time to sample table is at most one run, and groups only start at a new chunk or after a full group. */
+static size_t oswrapper_audio__alac_index_size(const oswrapper_audio__source_info* info) {
+    unsigned long packet_count = info->mp4.packet_count;
+    unsigned long max_runs = info->mp4.time_count < packet_count ? info->mp4.time_count : packet_count;
+    unsigned long long max_groups = (unsigned long long) info->mp4.chunk_count + (packet_count / OSWRAPPER_AUDIO__ALAC_GROUP_PACKETS) + 1;
+
+    if (packet_count == 0) {
+        return 0;
+    }
+
+    if (max_groups > packet_count) {
+        max_groups = packet_count;
+    }
+
+    return ((size_t) max_runs * sizeof(oswrapper_audio__alac_run)) + ((size_t) max_groups * sizeof(oswrapper_audio__alac_group)) + (OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT - 1);
+}
+
+/* Returns the sample format of the audio data described by a parsed header */
+static oswrapper_audio__sample_format oswrapper_audio__get_source_sample_format(const oswrapper_audio__source_info* info) {
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_PCM_UNSIGNED_8) {
+        return OSWRAPPER_AUDIO__SAMPLE_U8;
+    }
+
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_ULAW) {
+        return OSWRAPPER_AUDIO__SAMPLE_ULAW;
+    }
+
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_ALAW) {
+        return OSWRAPPER_AUDIO__SAMPLE_ALAW;
+    }
+
+    /* Packets are decoded to 16 bit PCM */
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_IMA4) {
+        return OSWRAPPER_AUDIO__SAMPLE_S16;
+    }
+
+    /* FLAC frames and ALAC packets are decoded to the smallest format which holds every sample */
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_FLAC || info->codec == OSWRAPPER_AUDIO__CODEC_ALAC) {
+        return info->bits_per_channel <= 8 ? OSWRAPPER_AUDIO__SAMPLE_S8 : info->bits_per_channel <= 16 ? OSWRAPPER_AUDIO__SAMPLE_S16 : info->bits_per_channel <= 24 ? OSWRAPPER_AUDIO__SAMPLE_S24 : OSWRAPPER_AUDIO__SAMPLE_S32;
+    }
+
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_PCM_FLOAT) {
+        return info->bits_per_channel == 64 ? OSWRAPPER_AUDIO__SAMPLE_F64 : OSWRAPPER_AUDIO__SAMPLE_F32;
+    }
+
+    switch (info->bits_per_channel) {
+    case 8:
+        return OSWRAPPER_AUDIO__SAMPLE_S8;
+
+    case 16:
+        return OSWRAPPER_AUDIO__SAMPLE_S16;
+
+    case 24:
+        return OSWRAPPER_AUDIO__SAMPLE_S24;
+
+    default:
+        return OSWRAPPER_AUDIO__SAMPLE_S32;
+    }
+}
+
+/* Sets the format of the decoding context from a parsed header, and the output format from the hinted format */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__set_portable_format(oswrapper_audio__internal_data_portable* internal_data, const oswrapper_audio__source_info* info, oswrapper_audio__reader* reader, const OSWrapper_audio_spec* hints, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__sample_format input_format = oswrapper_audio__get_source_sample_format(info);
+    oswrapper_audio__sample_format output_format = oswrapper_audio__get_hinted_sample_format(hints, input_format);
+    OSWRAPPER_AUDIO_RESULT_TYPE output_big_endian = oswrapper_audio__get_hinted_big_endian(hints);
+    /* Decoded packets are in the byte order of this system */
+    OSWRAPPER_AUDIO_RESULT_TYPE input_big_endian = info->frames_per_packet > 1 ? oswrapper_audio__system_is_big_endian() : info->big_endian;
+    unsigned int output_channel_count = info->channel_count;
+
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_FLAC) {
+        internal_data->flac = oswrapper_audio__create_flac_decoder(info, reader, hints->allocator);
+
+        if (internal_data->flac == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+    }
+
+    if (info->codec == OSWRAPPER_AUDIO__CODEC_ALAC) {
+        internal_data->alac = oswrapper_audio__create_alac_decoder(info, reader, hints->allocator);
+
+        if (internal_data->alac == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+    }
+
+    if (info->frames_per_packet > 1) {
+        internal_data->packet_buffer = oswrapper_audio__malloc(hints->allocator, (size_t) info->frames_per_packet * info->channel_count * (oswrapper_audio__sample_format_bits(input_format) / 8));
+
+        if (internal_data->packet_buffer == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+    }
+
+    if (!oswrapper_audio__create_hinted_remixer(hints, info->channel_count, OSWRAPPER_AUDIO__CHUNK_FRAMES, &internal_data->remixer)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (internal_data->remixer != NULL) {
+        output_channel_count = internal_data->remixer->output_channels;
+        internal_data->remix_after_resampling = output_channel_count > info->channel_count;
+    }
+
+    if (hints->sample_rate != 0 && info->sample_rate != 0 && hints->sample_rate != info->sample_rate) {
+        internal_data->resampler = oswrapper_audio__create_resampler(info->sample_rate, hints->sample_rate, internal_data->remix_after_resampling ? info->channel_count : output_channel_count, hints->resample_quality, hints->allocator);
+
+        if (internal_data->resampler == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        audio->sample_rate = hints->sample_rate;
+    } else {
+        audio->sample_rate = info->sample_rate;
+    }
+
+    if (internal_data->remixer != NULL || internal_data->resampler != NULL) {
+        /* The audio data is converted to 32 bit floating point PCM for remixing and resampling */
+        oswrapper_audio__converter_init(&internal_data->converter, input_format, input_big_endian, OSWRAPPER_AUDIO__SAMPLE_F32, oswrapper_audio__system_is_big_endian());
+        oswrapper_audio__converter_init(&internal_data->output_converter, OSWRAPPER_AUDIO__SAMPLE_F32, oswrapper_audio__system_is_big_endian(), output_format, output_big_endian);
+    } else {
+        oswrapper_audio__converter_init(&internal_data->converter, input_format, input_big_endian, output_format, output_big_endian);
+    }
+
+    audio->channel_count = output_channel_count;
+    internal_data->output_channel_count = output_channel_count;
+    oswrapper_audio__set_spec_sample_format(audio, output_format, output_big_endian);
+    internal_data->data_offset = info->data_offset;
+    internal_data->channel_count = info->channel_count;
+    internal_data->bytes_per_frame = info->bytes_per_frame;
+    internal_data->converted_bytes_per_frame = (oswrapper_audio__sample_format_bits(internal_data->converter.output_format) / 8) * info->channel_count;
+    /* ALAC packets which aren't in the audio data are dropped when the sample tables are read */
+    internal_data->total_frames = internal_data->alac != NULL ? internal_data->alac->total_frames : info->total_frames;
+    internal_data->current_frame = 0;
+    internal_data->codec = info->codec;
+    internal_data->frames_per_packet = info->frames_per_packet;
+    internal_data->priming_frames = info->priming_frames;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Allocates an empty decoding context */
+static oswrapper_audio__internal_data_portable* oswrapper_audio__alloc_portable(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__internal_data_portable));
+
+    if (internal_data != NULL) {
+        audio->internal_data = (void*) internal_data;
+        internal_data->audio_data = NULL;
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+        internal_data->file.data = NULL;
+        internal_data->file.size = 0;
+        internal_data->file.buffer = NULL;
+#endif
+        internal_data->read_buffer = NULL;
+        internal_data->read_buffer_size = 0;
+        internal_data->push = NULL;
+        internal_data->resampler = NULL;
+        internal_data->remixer = NULL;
+        internal_data->remix_after_resampling = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        internal_data->data_offset = 0;
+        oswrapper_audio__converter_init(&internal_data->converter, OSWRAPPER_AUDIO__SAMPLE_S16, OSWRAPPER_AUDIO_RESULT_FAILURE, OSWRAPPER_AUDIO__SAMPLE_S16, OSWRAPPER_AUDIO_RESULT_FAILURE);
+        internal_data->output_converter = internal_data->converter;
+        internal_data->channel_count = 0;
+        internal_data->bytes_per_frame = 0;
+        internal_data->converted_bytes_per_frame = 0;
+        internal_data->total_frames = 0;
+        internal_data->current_frame = 0;
+        internal_data->output_channel_count = 0;
+        internal_data->codec = OSWRAPPER_AUDIO__CODEC_PCM_INTEGER;
+        internal_data->frames_per_packet = 1;
+        internal_data->priming_frames = 0;
+        internal_data->packet_buffer = NULL;
+        internal_data->packet_index = (unsigned long long) -1;
+        internal_data->flac = NULL;
+        internal_data->alac = NULL;
+    }
+
+    return internal_data;
+}
+
+/* Creates the decoding context for a parsed header. The values on the passed OSWrapper_audio_spec are used as hints. */
+static oswrapper_audio__internal_data_portable* oswrapper_audio__create_portable(const oswrapper_audio__source_info* info, oswrapper_audio__reader* reader, OSWrapper_audio_spec* audio) {
+    OSWrapper_audio_spec hints = *audio;
+    oswrapper_audio__internal_data_portable* internal_data = oswrapper_audio__alloc_portable(audio);
+
+    if (internal_data != NULL && !oswrapper_audio__set_portable_format(internal_data, info, reader, &hints, audio)) {
+        oswrapper_audio_free_context(audio);
+        return NULL;
+    }
+
+    return internal_data;
+}
+
+/* Returns the offset in the file of the frame or packet which has the given frame */
+static unsigned long long oswrapper_audio__portable_data_offset(const oswrapper_audio__internal_data_portable* internal_data, unsigned long long frame) {
+    return internal_data->data_offset + (((frame + internal_data->priming_frames) / internal_data->frames_per_packet) * internal_data->bytes_per_frame);
+}
+
+/* Returns the audio data from the given offset in the file, and sets size to how much of it there is.
+When loading from callbacks, the read buffer is refilled if it doesn't have the largest frame from the offset.
+Returns NULL if the data has already been discarded, or is past the end of the audio data. */
+static const unsigned char* oswrapper_audio__flac_get_data(oswrapper_audio__internal_data_portable* internal_data, unsigned long long offset, size_t* size) {
+    oswrapper_audio__flac_decoder* flac = internal_data->flac;
+    oswrapper_audio__push_buffer* push = internal_data->push;
+
+    if (push != NULL) {
+        if (offset < push->offset || offset > push->offset + push->size) {
+            return NULL;
+        }
+
+        *size = (size_t) (push->offset + push->size - offset);
+        return push->data + (size_t) (offset - push->offset);
+    }
+
+    if (offset < internal_data->data_offset || offset > flac->data_end) {
+        return NULL;
+    }
+
+    if (internal_data->audio_data != NULL) {
+        *size = (size_t) (flac->data_end - offset);
+        return internal_data->audio_data + (size_t) (offset - internal_data->data_offset);
+    }
+
+    if (offset < flac->read_buffer_offset || offset > flac->read_buffer_offset + flac->read_buffer_filled
+            || (offset + flac->max_frame_size > flac->read_buffer_offset + flac->read_buffer_filled && flac->read_buffer_offset + flac->read_buffer_filled < flac->data_end)) {
+        flac->read_buffer_offset = offset;
+        flac->read_buffer_filled = oswrapper_audio__callbacks_read_at(&internal_data->callbacks, offset, internal_data->read_buffer, internal_data->read_buffer_size);
+    }
+
+    *size = (size_t) (flac->read_buffer_offset + flac->read_buffer_filled - offset);
+    return internal_data->read_buffer + (size_t) (offset - flac->read_buffer_offset);
+}
+
+/* Doubles the size of the read buffer, for frames which are larger than the largest frame size in STREAMINFO */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__flac_grow_read_buffer(oswrapper_audio__internal_data_portable* internal_data) {
+    oswrapper_audio__flac_decoder* flac = internal_data->flac;
+    unsigned char* read_buffer;
+
+    if (internal_data->read_buffer_size > ((size_t) -1) / 2) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    read_buffer = (unsigned char*) oswrapper_audio__realloc(flac->allocator, internal_data->read_buffer, 0, internal_data->read_buffer_size * 2);
+
+    if (read_buffer == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    internal_data->read_buffer = read_buffer;
+    internal_data->read_buffer_size *= 2;
+    flac->max_frame_size = internal_data->read_buffer_size / 2;
+    flac->read_buffer_filled = 0;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Searches for the first valid frame header from the given offset, which starts before the end offset.
+Returns the offset of the frame, or (unsigned long long) -1 if there isn't one. */
+static unsigned long long oswrapper_audio__flac_find_frame(oswrapper_audio__internal_data_portable* internal_data, unsigned long long offset, unsigned long long end, oswrapper_audio__flac_frame_header* header) {
+    oswrapper_audio__push_buffer* push = internal_data->push;
+
+    while (offset < end) {
+        size_t size = 0;
+        const unsigned char* data = oswrapper_audio__flac_get_data(internal_data, offset, &size);
+        /* A header which goes past the data that's available is searched for again from the next offset */
+        OSWRAPPER_AUDIO_RESULT_TYPE at_end = push != NULL ? push->ended : internal_data->audio_data != NULL || offset + size >= internal_data->flac->data_end;
+        size_t limit = at_end ? size : (size > OSWRAPPER_AUDIO__FLAC_MAX_HEADER_SIZE ? size - OSWRAPPER_AUDIO__FLAC_MAX_HEADER_SIZE : 0);
+        size_t i;
+
+        if (data == NULL || limit == 0) {
+            break;
+        }
+
+        if (limit > end - offset) {
+            limit = (size_t) (end - offset);
+        }
+
+        for (i = 0; i + 1 < size && i < limit; i++) {
+            if (data[i] == 0xFF && (data[i + 1] & 0xFE) == 0xF8) {
+                size_t header_size = oswrapper_audio__flac_parse_frame_header(internal_data->flac, data + i, size - i, header);
+
+                if (header_size != 0 && header_size != OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+                    return offset + i;
+                }
+            }
+        }
+
+        if (i < limit) {
+            break;
+        }
+
+        offset += limit;
+    }
+
+    return (unsigned long long) -1;
+}
+
+/* Decodes the next frame to the decoder's samples. Damaged frames are skipped.
+Returns the amount of frames in it, 0 at the end of the audio data,
+or OSWRAPPER_AUDIO_NEED_MORE_DATA if it hasn't been pushed yet. */
+static size_t oswrapper_audio__flac_decode_next(oswrapper_audio__internal_data_portable* internal_data, oswrapper_audio__flac_frame_header* header) {
+    oswrapper_audio__flac_decoder* flac = internal_data->flac;
+    oswrapper_audio__push_buffer* push = internal_data->push;
+
+    while (1) {
+        size_t size = 0;
+        const unsigned char* data = oswrapper_audio__flac_get_data(internal_data, flac->next_offset, &size);
+        OSWRAPPER_AUDIO_RESULT_TYPE more_data = push != NULL ? !push->ended : internal_data->audio_data == NULL && flac->next_offset + size < flac->data_end;
+        size_t frame_size;
+        unsigned long long found;
+
+        if (data == NULL) {
+            return 0;
+        }
+
+        frame_size = size != 0 ? oswrapper_audio__flac_decode_frame(flac, data, size, header) : OSWRAPPER_AUDIO_NEED_MORE_DATA;
+
+        /* A frame header which was searched for and goes past the end of the data can be part of another frame */
+        if (frame_size == OSWRAPPER_AUDIO_NEED_MORE_DATA && !more_data && flac->verify_next && size != 0) {
+            frame_size = 0;
+        }
+
+        if (frame_size != 0 && frame_size != OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            flac->next_offset += frame_size;
+            flac->next_frame = header->first_frame + header->block_size;
+            flac->verify_next = OSWRAPPER_AUDIO_RESULT_FAILURE;
+            return header->block_size;
+        }
+
+        if (frame_size == OSWRAPPER_AUDIO_NEED_MORE_DATA && more_data) {
+            if (push != NULL) {
+                return OSWRAPPER_AUDIO_NEED_MORE_DATA;
+            }
+
+            /* The frame is larger than STREAMINFO said frames can be */
+            if (!oswrapper_audio__flac_grow_read_buffer(internal_data)) {
+                return 0;
+            }
+
+            continue;
+        }
+
+        found = frame_size == 0 ? oswrapper_audio__flac_find_frame(internal_data, flac->next_offset + 1, flac->data_end, header) : (unsigned long long) -1;
+
+        if (found == (unsigned long long) -1) {
+            if (frame_size == 0 && push != NULL && !push->ended) {
+                return OSWRAPPER_AUDIO_NEED_MORE_DATA;
+            }
+
+            /* The audio data ends here, even if STREAMINFO said it was longer */
+            if (internal_data->total_frames > flac->next_frame) {
+                internal_data->total_frames = flac->next_frame;
+            }
+
+            return 0;
+        }
+
+        flac->next_offset = found;
+        flac->verify_next = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+}
+
+/* Moves the decoder to a frame which starts at or before the given frame.
+The closest seek points are found first, then the frames between them are searched for in halves. */
+static void oswrapper_audio__flac_seek(oswrapper_audio__internal_data_portable* internal_data, unsigned long long frame) {
+    oswrapper_audio__flac_decoder* flac = internal_data->flac;
+    unsigned long long low_offset = internal_data->data_offset;
+    unsigned long long low_frame = 0;
+    unsigned long long high_offset = flac->data_end;
+    OSWRAPPER_AUDIO_RESULT_TYPE searched = OSWRAPPER_AUDIO_RESULT_FAILURE;
+
+    if (flac->next_frame <= frame) {
+        low_offset = flac->next_offset;
+        low_frame = flac->next_frame;
+        searched = flac->verify_next;
+    }
+
+    if (flac->seek_point_count != 0) {
+        /* Seek points are sorted by frame, and placeholder points have the largest frame */
+        unsigned long first = 0;
+        unsigned long count = flac->seek_point_count;
+
+        while (count > 0) {
+            unsigned long half = count / 2;
+
+            if (oswrapper_audio__read_u64_be(flac->seek_table + ((first + half) * OSWRAPPER_AUDIO__FLAC_SEEK_POINT_SIZE)) <= frame) {
+                first += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+
+        if (first > 0) {
+            const unsigned char* point = flac->seek_table + ((first - 1) * OSWRAPPER_AUDIO__FLAC_SEEK_POINT_SIZE);
+            unsigned long long point_frame = oswrapper_audio__read_u64_be(point);
+            unsigned long long point_offset = internal_data->data_offset + oswrapper_audio__read_u64_be(point + 8);
+
+            if (point_frame >= low_frame && point_offset >= low_offset && point_offset < high_offset) {
+                low_offset = point_offset;
+                low_frame = point_frame;
+                searched = OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+        }
+
+        if (first < flac->seek_point_count) {
+            const unsigned char* point = flac->seek_table + (first * OSWRAPPER_AUDIO__FLAC_SEEK_POINT_SIZE);
+            unsigned long long point_offset = internal_data->data_offset + oswrapper_audio__read_u64_be(point + 8);
+
+            if (oswrapper_audio__read_u64_be(point) != (unsigned long long) -1 && point_offset > low_offset && point_offset < high_offset) {
+                high_offset = point_offset;
+            }
+        }
+    }
+
+    /* Only pushed data which hasn't been discarded can be searched */
+    if (internal_data->push == NULL) {
+        while (high_offset - low_offset > (unsigned long long) flac->max_frame_size * 4) {
+            oswrapper_audio__flac_frame_header header;
+            unsigned long long middle = low_offset + ((high_offset - low_offset) / 2);
+            unsigned long long found = oswrapper_audio__flac_find_frame(internal_data, middle, high_offset, &header);
+
+            if (found != (unsigned long long) -1 && header.first_frame <= frame && header.first_frame >= low_frame) {
+                low_offset = found;
+                low_frame = header.first_frame;
+                searched = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+            } else {
+                /* The frame is in the first half, as no frames in the second half start at or before it */
+                high_offset = middle;
+            }
+        }
+    }
+
+    flac->next_offset = low_offset;
+    flac->next_frame = low_frame;
+    flac->verify_next = searched;
+}
+
+/* Decodes the frame which has the given frame to the packet buffer, if it isn't there already.
+Returns the amount of frames in it and sets first_frame to its first frame, or the same as oswrapper_audio__flac_decode_next. */
+static size_t oswrapper_audio__flac_decode_block(oswrapper_audio__internal_data_portable* internal_data, unsigned long long frame, unsigned long long* first_frame) {
+    oswrapper_audio__flac_decoder* flac = internal_data->flac;
+
+    if (flac->block_frames != 0 && frame >= flac->block_first_frame && frame - flac->block_first_frame < flac->block_frames) {
+        *first_frame = flac->block_first_frame;
+        return flac->block_frames;
+    }
+
+    /* Going back, or far enough ahead that finding the frame is faster than decoding every frame before it */
+    if (frame < flac->next_frame || (internal_data->push == NULL && frame - flac->next_frame > (unsigned long long) flac->max_block_size * OSWRAPPER_AUDIO__FLAC_SEEK_DISTANCE)) {
+        if (internal_data->push != NULL) {
+            return 0;
+        }
+
+        oswrapper_audio__flac_seek(internal_data, frame);
+    }
+
+    while (1) {
+        oswrapper_audio__flac_frame_header header;
+        size_t block_frames = oswrapper_audio__flac_decode_next(internal_data, &header);
+
+        if (block_frames == 0 || block_frames == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            return block_frames;
+        }
+
+        /* Only the frame which is needed is interleaved */
+        if (frame < header.first_frame + block_frames) {
+            oswrapper_audio__interleave_samples(flac->samples, flac->max_block_size, flac->channel_count, flac->bits_per_sample, internal_data->converter.input_format, internal_data->packet_buffer, header.block_size);
+            flac->block_first_frame = header.first_frame;
+            flac->block_frames = block_frames;
+            *first_frame = header.first_frame;
+            return block_frames;
+        }
+    }
+}
+
+/* Finds the length of FLAC audio when STREAMINFO doesn't have it, by decoding the last frames */
+static void oswrapper_audio__flac_find_length(oswrapper_audio__internal_data_portable* internal_data) {
+    oswrapper_audio__flac_decoder* flac = internal_data->flac;
+    unsigned long long search_size = (unsigned long long) flac->max_frame_size * 2;
+    unsigned long long offset = flac->data_end - internal_data->data_offset > search_size ? flac->data_end - search_size : internal_data->data_offset;
+    unsigned long long total_frames = 0;
+    oswrapper_audio__flac_frame_header header;
+
+    if (internal_data->total_frames != (unsigned long long) -1) {
+        return;
+    }
+
+    flac->verify_next = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    offset = oswrapper_audio__flac_find_frame(internal_data, offset, flac->data_end, &header);
+
+    while (offset != (unsigned long long) -1 && offset < flac->data_end) {
+        size_t size = 0;
+        const unsigned char* data = oswrapper_audio__flac_get_data(internal_data, offset, &size);
+        size_t frame_size = data != NULL ? oswrapper_audio__flac_decode_frame(flac, data, size, &header) : 0;
+
+        if (frame_size != 0 && frame_size != OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            total_frames = header.first_frame + header.block_size;
+            offset += frame_size;
+        } else {
+            offset = oswrapper_audio__flac_find_frame(internal_data, offset + 1, flac->data_end, &header);
+        }
+    }
+
+    flac->verify_next = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    internal_data->total_frames = total_frames;
+}
+
+/* Finds the ALAC packet which has the given frame with a binary search of the runs, and sets its first frame and how many frames it has.
+Returns the packet count if the frame is past the end. */
+static unsigned long oswrapper_audio__alac_find_packet(const oswrapper_audio__alac_decoder* alac, unsigned long long frame, unsigned long long* first_frame, unsigned long* frames) {
+    const oswrapper_audio__alac_run* run;
+    unsigned long long packet;
+    unsigned long first = 0;
+    unsigned long count = alac->run_count;
+
+    if (frame >= alac->total_frames) {
+        return alac->packet_count;
+    }
+
+    /* The first run starts at frame 0, so there's always a run which starts at or before the frame */
+    while (count > 0) {
+        unsigned long half = count / 2;
+
+        if (alac->runs[first + half].first_frame <= frame) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+
+    run = alac->runs + (first - 1);
+    packet = (frame - run->first_frame) / run->frames_per_packet;
+    *first_frame = run->first_frame + (packet * run->frames_per_packet);
+    *frames = run->frames_per_packet;
+    return run->first_packet + (unsigned long) packet;
+}
+
+/* Returns the offset in the file of an ALAC packet, from a binary search of the groups
+and the sizes of the packets before it in its group */
+static unsigned long long oswrapper_audio__alac_packet_offset(const oswrapper_audio__alac_decoder* alac, unsigned long packet, unsigned long* next_group) {
+    const oswrapper_audio__alac_group* group;
+    unsigned long long offset;
+    unsigned long first = 0;
+    unsigned long count = alac->group_count;
+    unsigned long i;
+
+    /* Packets decoded in order don't need to be looked up */
+    if (packet == alac->next_packet) {
+        *next_group = alac->next_group;
+        return alac->next_offset;
+    }
+
+    while (count > 0) {
+        unsigned long half = count / 2;
+
+        if (alac->groups[first + half].first_packet <= packet) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+
+    group = alac->groups + (first - 1);
+    offset = group->offset;
+    *next_group = first;
+
+    for (i = group->first_packet; i < packet; i++) {
+        offset += oswrapper_audio__alac_packet_size(alac, i);
+    }
+
+    return offset;
+}
+
+/* Returns the ALAC packet of the given size at the given offset in the file, or NULL if it has already been discarded or can't be read.
+When loading from callbacks, the read buffer is refilled from the offset if it doesn't have the whole packet,
+so packets which are next to each other in the file are read several at a time. */
+static const unsigned char* oswrapper_audio__alac_get_data(oswrapper_audio__internal_data_portable* internal_data, unsigned long long offset, size_t size) {
+    oswrapper_audio__alac_decoder* alac = internal_data->alac;
+    oswrapper_audio__push_buffer* push = internal_data->push;
+
+    if (push != NULL) {
+        if (offset < push->offset || offset + size > push->offset + push->size) {
+            return NULL;
+        }
+
+        return push->data + (size_t) (offset - push->offset);
+    }
+
+    /* Every packet in the index is in the audio data */
+    if (internal_data->audio_data != NULL) {
+        return internal_data->audio_data + (size_t) (offset - internal_data->data_offset);
+    }
+
+    if (offset < alac->read_buffer_offset || offset + size > alac->read_buffer_offset + alac->read_buffer_filled) {
+        alac->read_buffer_offset = offset;
+        alac->read_buffer_filled = oswrapper_audio__callbacks_read_at(&internal_data->callbacks, offset, internal_data->read_buffer, internal_data->read_buffer_size);
+
+        if (size > alac->read_buffer_filled) {
+            return NULL;
+        }
+    }
+
+    return internal_data->read_buffer + (size_t) (offset - alac->read_buffer_offset);
+}
+
+/* Decodes the ALAC packet which has the given frame to the packet buffer, if it isn't there already. Damaged packets are skipped.
+Returns the amount of frames in it and sets first_frame to its first frame, 0 if there are no more packets which can be read,
+or OSWRAPPER_AUDIO_NEED_MORE_DATA if it hasn't been pushed yet. */
+static size_t oswrapper_audio__alac_decode_block(oswrapper_audio__internal_data_portable* internal_data, unsigned long long frame, unsigned long long* first_frame) {
+    oswrapper_audio__alac_decoder* alac = internal_data->alac;
+    oswrapper_audio__push_buffer* push = internal_data->push;
+
+    if (alac->block_frames != 0 && frame >= alac->block_first_frame && frame - alac->block_first_frame < alac->block_frames) {
+        *first_frame = alac->block_first_frame;
+        return alac->block_frames;
+    }
+
+    while (1) {
+        unsigned long long packet_first_frame = 0;
+        unsigned long packet_frames = 0;
+        unsigned long packet = oswrapper_audio__alac_find_packet(alac, frame, &packet_first_frame, &packet_frames);
+        unsigned long long offset;
+        unsigned long next_group;
+        size_t size;
+        const unsigned char* data;
+        unsigned long frames;
+
+        if (packet >= alac->packet_count) {
+            return 0;
+        }
+
+        offset = oswrapper_audio__alac_packet_offset(alac, packet, &next_group);
+        size = (size_t) oswrapper_audio__alac_packet_size(alac, packet);
+        data = oswrapper_audio__alac_get_data(internal_data, offset, size);
+
+        if (data == NULL) {
+            return push != NULL && offset >= push->offset && !push->ended ? OSWRAPPER_AUDIO_NEED_MORE_DATA : 0;
+        }
+
+        frames = oswrapper_audio__alac_decode_packet(alac, data, size);
+        alac->next_packet = packet + 1;
+        alac->next_offset = offset + size;
+        alac->next_group = next_group;
+
+        /* The packet after the last one in a group can be anywhere in the file */
+        if (next_group < alac->group_count && alac->groups[next_group].first_packet == packet + 1) {
+            alac->next_offset = alac->groups[next_group].offset;
+            alac->next_group++;
+        }
+
+        if (frames != 0) {
+            unsigned int channel;
+
+            /* Frames which the packet should have, but doesn't, are silent */
+            for (channel = 0; channel < alac->channel_count && frames < packet_frames; channel++) {
+                oswrapper_audio__int32* samples = alac->samples + ((size_t) channel * alac->frame_length);
+                unsigned long i;
+
+                for (i = frames; i < packet_frames; i++) {
+                    samples[i] = 0;
+                }
+            }
+
+            oswrapper_audio__interleave_samples(alac->samples, alac->frame_length, alac->channel_count, alac->bits_per_sample, internal_data->converter.input_format, internal_data->packet_buffer, (unsigned int) packet_frames);
+            alac->block_first_frame = packet_first_frame;
+            alac->block_frames = packet_frames;
+            *first_frame = packet_first_frame;
+            return packet_frames;
+        }
+
+        frame = packet_first_frame + packet_frames;
+    }
+}
+
+/* Parses the audio file in the given memory. Only the header is read, the audio data is decoded in place. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__load_portable(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__source_info info;
+    oswrapper_audio__reader reader;
+    oswrapper_audio__reader_init_memory(&reader, data, data_size);
+
+    if (oswrapper_audio__parse_header(&reader, &info)) {
+        oswrapper_audio__internal_data_portable* internal_data = oswrapper_audio__create_portable(&info, &reader, audio);
+
+        if (internal_data != NULL) {
+            /* The offsets are within the passed memory, so they fit in a size_t */
+            internal_data->audio_data = data + (size_t) info.data_offset;
+
+            if (internal_data->flac != NULL) {
+                oswrapper_audio__flac_find_length(internal_data);
+            }
+
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
+    return oswrapper_audio__load_portable(data, data_size, audio);
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size(const OSWrapper_audio_spec* hints, unsigned int max_channel_count, unsigned long max_sample_rate) {
+    const OSWrapper_audio_channel_matrix* channel_matrix = hints->channel_matrix;
+    unsigned int input_channels = channel_matrix != NULL ? channel_matrix->input_channel_count : max_channel_count;
+    unsigned int output_channels = channel_matrix != NULL ? channel_matrix->output_channel_count : hints->channel_count;
+    unsigned int resampled_channels = input_channels > output_channels ? input_channels : output_channels;
+    /* Loading from memory allocates the decoding context, and possibly a FLAC or ALAC decoder, a packet buffer, a remixer, and a resampler */
+    size_t size = OSWRAPPER_AUDIO__STORAGE_OVERHEAD(5) + sizeof(oswrapper_audio__internal_data_portable);
+    /* The largest FLAC blocks and ALAC packets need the most space, with 32 bit samples for decoding and up to 32 bit samples for the packet buffer */
+    size += (sizeof(oswrapper_audio__flac_decoder) > sizeof(oswrapper_audio__alac_decoder) ? sizeof(oswrapper_audio__flac_decoder) : sizeof(oswrapper_audio__alac_decoder)) + ((size_t) 65535 * max_channel_count * sizeof(oswrapper_audio__int32) * 2);
+
+    if (output_channels != 0) {
+        size += oswrapper_audio__remixer_size(input_channels, output_channels, OSWRAPPER_AUDIO__CHUNK_FRAMES);
+    }
+
+    if (hints->sample_rate != 0) {
+        /* The filter is longest when downsampling by the largest ratio */
+        double cutoff;
+        double beta;
+        /* Without a maximum, use a ratio which always needs the longest filter */
+        unsigned long input_rate = max_sample_rate != 0 ? max_sample_rate : hints->sample_rate * OSWRAPPER_AUDIO__RESAMPLE_MAX_TAPS;
+        unsigned int half_taps = oswrapper_audio__resampler_half_taps(input_rate, hints->sample_rate, hints->resample_quality, &cutoff, &beta);
+        unsigned long phase_count = hints->sample_rate < OSWRAPPER_AUDIO_RESAMPLE_MAX_PHASES ? hints->sample_rate : OSWRAPPER_AUDIO_RESAMPLE_MAX_PHASES;
+        size += oswrapper_audio__resampler_size(phase_count, half_taps * 2, resampled_channels);
+    }
+
+    return size;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size_from_memory(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints) {
+    oswrapper_audio__reader reader;
+    oswrapper_audio__source_info info;
+    size_t size;
+    oswrapper_audio__reader_init_memory(&reader, data, data_size);
+
+    if (!oswrapper_audio__parse_header(&reader, &info)) {
+        return 0;
+    }
+
+    size = oswrapper_audio_context_size(hints, info.channel_count, info.sample_rate);
+
+    if (info.codec == OSWRAPPER_AUDIO__CODEC_ALAC) {
+        size += oswrapper_audio__alac_index_size(&info);
+    }
+
+    return size;
+}
+
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio) {
+    oswrapper_audio__mapped_file file;
+
+    if (oswrapper_audio__map_file(path, &file, audio->allocator)) {
+        /* The mapped file is decoded in place, the same as decoding from memory */
+        if (oswrapper_audio__load_portable(file.data, file.size, audio)) {
+            oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+            internal_data->file = file;
+            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        oswrapper_audio__unmap_file(&file);
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_callbacks(OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data, OSWrapper_audio_spec* audio) {
+    OSWRAPPER_AUDIO_RESULT_TYPE result = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    oswrapper_audio__callbacks callbacks;
+    oswrapper_audio__reader reader;
+    oswrapper_audio__source_info info;
+
+    if (!oswrapper_audio__callbacks_init(&callbacks, read, seek, tell, user_data)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (oswrapper_audio__reader_init_callbacks(&reader, &callbacks, audio->allocator) && oswrapper_audio__parse_header(&reader, &info)) {
+        oswrapper_audio__internal_data_portable* internal_data = oswrapper_audio__create_portable(&info, &reader, audio);
+
+        if (internal_data != NULL) {
+            /* The audio data is read through the callbacks as it's decoded */
+            internal_data->callbacks = callbacks;
+            result = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+
+            if (!oswrapper_audio__converter_is_passthrough(&internal_data->converter) || internal_data->frames_per_packet > 1) {
+                /* The audio data can't be read straight into the output buffer, so it's read into another buffer first */
+                internal_data->read_buffer_size = internal_data->bytes_per_frame > OSWRAPPER_AUDIO_READ_BUFFER_SIZE ? internal_data->bytes_per_frame : OSWRAPPER_AUDIO_READ_BUFFER_SIZE;
+
+                /* FLAC frames are decoded from the read buffer, which holds at least two of the largest frames */
+                if (internal_data->flac != NULL) {
+                    internal_data->read_buffer_size = internal_data->flac->max_frame_size > OSWRAPPER_AUDIO_READ_BUFFER_SIZE ? internal_data->flac->max_frame_size * 2 : OSWRAPPER_AUDIO_READ_BUFFER_SIZE * 2;
+                    internal_data->flac->max_frame_size = internal_data->read_buffer_size / 2;
+                }
+
+                /* ALAC packets are read from the read buffer several of the largest packets at a time, so reads are large and in order */
+                if (internal_data->alac != NULL && internal_data->alac->max_packet_size * OSWRAPPER_AUDIO__ALAC_READ_PACKETS > internal_data->read_buffer_size) {
+                    internal_data->read_buffer_size = internal_data->alac->max_packet_size * OSWRAPPER_AUDIO__ALAC_READ_PACKETS;
+                }
+
+                internal_data->read_buffer = (unsigned char*) oswrapper_audio__malloc(audio->allocator, internal_data->read_buffer_size);
+
+                if (internal_data->read_buffer == NULL) {
+                    oswrapper_audio_free_context(audio);
+                    result = OSWRAPPER_AUDIO_RESULT_FAILURE;
+                } else if (internal_data->flac != NULL) {
+                    oswrapper_audio__flac_find_length(internal_data);
+                }
+            }
+        }
+    }
+
+    oswrapper_audio__reader_uninit(&reader);
+    return result;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_push(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_portable* internal_data;
+    oswrapper_audio__push_buffer* push = (oswrapper_audio__push_buffer*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__push_buffer));
+
+    if (push == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    internal_data = oswrapper_audio__alloc_portable(audio);
+
+    if (internal_data == NULL) {
+        oswrapper_audio__free(audio->allocator, push);
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    push->data = NULL;
+    push->size = 0;
+    push->capacity = 0;
+    push->offset = 0;
+    push->header_parsed = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    push->ended = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    push->hints = *audio;
+    internal_data->push = push;
+    /* The format isn't known until the header has been received */
+    audio->sample_rate = 0;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_push_bytes(OSWrapper_audio_spec* audio, const unsigned char* data, size_t data_size) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+    oswrapper_audio__push_buffer* push = internal_data->push;
+    size_t discard = 0;
+
+    if (push == NULL || push->ended) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (push->header_parsed) {
+        /* Data before the current position has already been decoded, so it can be discarded */
+        unsigned long long decode_offset = internal_data->flac != NULL ? internal_data->flac->next_offset : internal_data->alac != NULL ? internal_data->alac->next_offset : oswrapper_audio__portable_data_offset(internal_data, internal_data->current_frame);
+
+        if (decode_offset > push->offset) {
+            discard = decode_offset - push->offset < push->size ? (size_t) (decode_offset - push->offset) : push->size;
+        }
+    }
+
+    if (data_size > push->capacity - (push->size - discard)) {
+        /* Grow the buffer, only keeping the data which hasn't been decoded yet */
+        unsigned char* new_data;
+        size_t new_capacity = push->capacity != 0 ? push->capacity : OSWRAPPER_AUDIO_PUSH_BUFFER_SIZE;
+
+        while (data_size > new_capacity - (push->size - discard)) {
+            if (new_capacity > ((size_t) -1) / 2) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            new_capacity *= 2;
+        }
+
+        new_data = (unsigned char*) oswrapper_audio__malloc(audio->allocator, new_capacity);
+
+        if (new_data == NULL) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        if (push->data != NULL) {
+            OSWRAPPER_AUDIO_MEMCPY(new_data, push->data + discard, push->size - discard);
+            oswrapper_audio__free(audio->allocator, push->data);
+        }
+
+        push->data = new_data;
+        push->capacity = new_capacity;
+        push->size -= discard;
+        push->offset += discard;
+    } else if (discard != 0) {
+        /* Move the remaining data to the start of the buffer, so the discarded data can be reused */
+        OSWRAPPER_AUDIO_MEMMOVE(push->data, push->data + discard, push->size - discard);
+        push->size -= discard;
+        push->offset += discard;
+    }
+
+    if (data_size != 0) {
+        OSWRAPPER_AUDIO_MEMCPY(push->data + push->size, data, data_size);
+        push->size += data_size;
+    }
+
+    if (!push->header_parsed) {
+        /* Nothing is discarded until the header has been parsed, so the buffer always starts at the start of the file */
+        oswrapper_audio__source_info info;
+        oswrapper_audio__reader reader;
+        oswrapper_audio__reader_init_streaming(&reader, push->data, push->size);
+
+        if (oswrapper_audio__parse_header(&reader, &info)) {
+            if (!oswrapper_audio__set_portable_format(internal_data, &info, &reader, &push->hints, audio)) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            push->header_parsed = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        } else if (!reader.need_more_data) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_push_end(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+    oswrapper_audio__push_buffer* push = internal_data->push;
+
+    if (push == NULL) {
+        return;
+    }
+
+    push->ended = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+
+    /* The length of FLAC audio is found when the last frame is decoded */
+    if (push->header_parsed && internal_data->bytes_per_frame != 0) {
+        /* The size in the header may be wrong for streamed files, so the length is now the amount of data received */
+        unsigned long long end = push->offset + push->size;
+        unsigned long long frames_received = end > internal_data->data_offset ? ((end - internal_data->data_offset) / internal_data->bytes_per_frame) * internal_data->frames_per_packet : 0;
+        frames_received = frames_received > internal_data->priming_frames ? frames_received - internal_data->priming_frames : 0;
+
+        if (frames_received < internal_data->total_frames) {
+            internal_data->total_frames = frames_received;
+        }
+    }
+}
+
+OSWRAPPER_AUDIO_DEF OSWrapper_audio_length_type oswrapper_audio_get_length(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* frames) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+
+    if (internal_data->push != NULL && !internal_data->push->header_parsed) {
+        return OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+    }
+
+    /* Pushed FLAC files without a length in STREAMINFO have no length until the last frame is decoded */
+    if (internal_data->total_frames == (unsigned long long) -1) {
+        return OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+    }
+
+    if (internal_data->resampler != NULL) {
+        *frames = (OSWRAPPER_AUDIO_SEEK_TYPE) oswrapper_audio__resampled_length(internal_data->resampler, internal_data->total_frames);
+    } else {
+        *frames = (OSWRAPPER_AUDIO_SEEK_TYPE) internal_data->total_frames;
+    }
+
+    /* The size in the header can't be trusted until all data has been received */
+    return internal_data->push != NULL && !internal_data->push->ended ? OSWRAPPER_AUDIO_LENGTH_ESTIMATED : OSWRAPPER_AUDIO_LENGTH_EXACT;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+    *pos = (OSWRAPPER_AUDIO_SEEK_TYPE) (internal_data->resampler != NULL ? internal_data->resampler->output_frame : internal_data->current_frame);
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+    oswrapper_audio__resampler* resampler = internal_data->resampler;
+    /* The first frame of the audio data which is needed */
+    OSWRAPPER_AUDIO_SEEK_TYPE input_pos = pos;
+    unsigned long phase;
+    float blend;
+
+    if (pos < 0 || (unsigned long long) pos > (resampler != NULL ? oswrapper_audio__resampled_length(resampler, internal_data->total_frames) : internal_data->total_frames)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (resampler != NULL) {
+        input_pos = oswrapper_audio__resampler_input_pos(resampler, (unsigned long long) pos, &phase, &blend);
+    }
+
+    if (internal_data->push != NULL) {
+        /* Only data which has been received and not discarded can be seeked to */
+        oswrapper_audio__push_buffer* push = internal_data->push;
+        oswrapper_audio__flac_decoder* flac = internal_data->flac;
+        oswrapper_audio__alac_decoder* alac = internal_data->alac;
+        unsigned long long offset = push->header_parsed ? oswrapper_audio__portable_data_offset(internal_data, (unsigned long long) (input_pos > 0 ? input_pos : 0)) : 0;
+
+        /* ALAC packets are found with the index. Seeking to the end doesn't need any more data. */
+        if (alac != NULL) {
+            unsigned long long first_frame;
+            unsigned long frames;
+            unsigned long next_group;
+            unsigned long packet = oswrapper_audio__alac_find_packet(alac, (unsigned long long) (input_pos > 0 ? input_pos : 0), &first_frame, &frames);
+            offset = packet < alac->packet_count ? oswrapper_audio__alac_packet_offset(alac, packet, &next_group) : push->offset;
+        }
+
+        if (!push->header_parsed || offset < push->offset || offset > push->offset + push->size) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        /* FLAC frames can only be found by decoding the frames before them, so only the decoded frames and later frames can be seeked to */
+        if (flac != NULL && (unsigned long long) (input_pos > 0 ? input_pos : 0) < (flac->block_frames != 0 && flac->block_first_frame < flac->next_frame ? flac->block_first_frame : flac->next_frame)) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+    }
+
+    if (resampler != NULL) {
+        /* The resampler history is refilled from the new position */
+        resampler->output_frame = (unsigned long long) pos;
+        resampler->history_start = 0;
+        resampler->history_frames = 0;
+        resampler->history_pos = input_pos;
+    }
+
+    /* Every frame or packet is the same size, so the position is just an offset into the audio data */
+    internal_data->current_frame = (unsigned long long) (input_pos > 0 ? input_pos : 0);
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio) {
+    /* Can only fail if the start of pushed data has already been discarded */
+    oswrapper_audio_seek(audio, 0);
+}
+
+/* IMA ADPCM quantizer step sizes, and how each sample changes the step */
+static const short oswrapper_audio__ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const signed char oswrapper_audio__ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/* Decodes an Apple IMA4 packet to interleaved 16 bit PCM. Each channel has its own block in the packet. */
+static void oswrapper_audio__decode_ima4(const unsigned char* packet, unsigned int channel_count, short* output) {
+    unsigned int channel;
+
+    for (channel = 0; channel < channel_count; channel++) {
+        const unsigned char* block = packet + (channel * OSWRAPPER_AUDIO__IMA4_BYTES_PER_CHANNEL);
+        /* The header has the top 9 bits of the predictor, and the step index */
+        unsigned int header = oswrapper_audio__read_u16_be(block);
+        long predictor = (long) (header & 0xFF80) - ((header & 0x8000) ? 0x10000L : 0);
+        int index = (int) (header & 0x7F);
+        short* channel_output = output + channel;
+        unsigned int i;
+
+        if (index > 88) {
+            index = 88;
+        }
+
+        for (i = 0; i < OSWRAPPER_AUDIO__IMA4_FRAMES_PER_PACKET; i++) {
+            /* The low nibble of each byte is first */
+            unsigned int nibble = (block[2 + (i / 2)] >> ((i & 1) * 4)) & 0xF;
+            long step = oswrapper_audio__ima_step_table[index];
+            long diff = step >> 3;
+
+            if (nibble & 4) {
+                diff += step;
+            }
+
+            if (nibble & 2) {
+                diff += step >> 1;
+            }
+
+            if (nibble & 1) {
+                diff += step >> 2;
+            }
+
+            predictor += (nibble & 8) ? -diff : diff;
+
+            if (predictor > 32767) {
+                predictor = 32767;
+            } else if (predictor < -32768) {
+                predictor = -32768;
+            }
+
+            index += oswrapper_audio__ima_index_table[nibble];
+
+            if (index < 0) {
+                index = 0;
+            } else if (index > 88) {
+                index = 88;
+            }
+
+            channel_output[i * channel_count] = (short) predictor;
+        }
+    }
+}
+
+/* Decodes the packet which has the given frame to the packet buffer, if it isn't there already.
+Returns the amount of frames in the packet and sets first_frame to its first frame, 0 if it couldn't be read,
+or OSWRAPPER_AUDIO_NEED_MORE_DATA if it hasn't been pushed yet. */
+static size_t oswrapper_audio__decode_packet(oswrapper_audio__internal_data_portable* internal_data, unsigned long long frame, unsigned long long* first_frame) {
+    oswrapper_audio__push_buffer* push = internal_data->push;
+    unsigned long long packet_index = frame / internal_data->frames_per_packet;
+    unsigned long long offset = internal_data->data_offset + (packet_index * internal_data->bytes_per_frame);
+    const unsigned char* packet;
+
+    if (internal_data->flac != NULL) {
+        return oswrapper_audio__flac_decode_block(internal_data, frame, first_frame);
+    }
+
+    if (internal_data->alac != NULL) {
+        return oswrapper_audio__alac_decode_block(internal_data, frame, first_frame);
+    }
+
+    *first_frame = packet_index * internal_data->frames_per_packet;
+
+    if (packet_index == internal_data->packet_index) {
+        return internal_data->frames_per_packet;
+    }
+
+    if (push != NULL) {
+        if (offset < push->offset) {
+            return 0;
+        }
+
+        if (offset + internal_data->bytes_per_frame > push->offset + push->size) {
+            return push->ended ? 0 : OSWRAPPER_AUDIO_NEED_MORE_DATA;
+        }
+
+        packet = push->data + (size_t) (offset - push->offset);
+    } else if (internal_data->audio_data != NULL) {
+        packet = internal_data->audio_data + (size_t) (packet_index * internal_data->bytes_per_frame);
+    } else {
+        if (oswrapper_audio__callbacks_read_at(&internal_data->callbacks, offset, internal_data->read_buffer, internal_data->bytes_per_frame) != internal_data->bytes_per_frame) {
+            return 0;
+        }
+
+        packet = internal_data->read_buffer;
+    }
+
+    oswrapper_audio__decode_ima4(packet, internal_data->channel_count, (short*) internal_data->packet_buffer);
+    internal_data->packet_index = packet_index;
+    return internal_data->frames_per_packet;
+}
+
+/* Reads frames of audio data for codecs with more than one frame per packet, converted by the context's converter.
+Returns OSWRAPPER_AUDIO_NEED_MORE_DATA if the data hasn't been pushed yet. */
+static size_t oswrapper_audio__read_packets(oswrapper_audio__internal_data_portable* internal_data, void* buffer, size_t frames_to_do) {
+    unsigned char* output = (unsigned char*) buffer;
+    size_t packet_bytes_per_frame = (oswrapper_audio__sample_format_bits(internal_data->converter.input_format) / 8) * internal_data->channel_count;
+    unsigned long long frames_remaining = internal_data->total_frames > internal_data->current_frame ? internal_data->total_frames - internal_data->current_frame : 0;
+    size_t frames_done = 0;
+
+    if (frames_to_do > frames_remaining) {
+        frames_to_do = (size_t) frames_remaining;
+    }
+
+    while (frames_done < frames_to_do) {
+        /* Priming frames are decoded from the first packets, but aren't part of the audio */
+        unsigned long long frame = internal_data->current_frame + internal_data->priming_frames;
+        unsigned long long first_frame = 0;
+        size_t packet_frames = oswrapper_audio__decode_packet(internal_data, frame, &first_frame);
+        size_t first;
+        size_t frames_this_packet;
+
+        if (packet_frames == 0 || packet_frames == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            if (frames_done == 0 && packet_frames == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+                return OSWRAPPER_AUDIO_NEED_MORE_DATA;
+            }
+
+            break;
+        }
+
+        /* Damaged audio data can be missing frames, which are skipped */
+        if (first_frame > frame) {
+            internal_data->current_frame += first_frame - frame;
+            frame = first_frame;
+
+            if (internal_data->current_frame >= internal_data->total_frames) {
+                break;
+            }
+        }
+
+        first = (size_t) (frame - first_frame);
+        frames_this_packet = packet_frames - first < frames_to_do - frames_done ? packet_frames - first : frames_to_do - frames_done;
+        oswrapper_audio__convert_samples(&internal_data->converter, (const unsigned char*) internal_data->packet_buffer + (first * packet_bytes_per_frame), output + (frames_done * internal_data->converted_bytes_per_frame), frames_this_packet * internal_data->channel_count);
+        frames_done += frames_this_packet;
+        internal_data->current_frame += frames_this_packet;
+    }
+
+    return frames_done;
+}
+
+/* Reads frames of audio data, converted by the context's converter.
+Returns OSWRAPPER_AUDIO_NEED_MORE_DATA if the data hasn't been pushed yet. */
+static size_t oswrapper_audio__read_portable(oswrapper_audio__internal_data_portable* internal_data, void* buffer, size_t frames_to_do) {
+    const unsigned char* source;
+    unsigned long long frames_remaining;
+    oswrapper_audio__push_buffer* push = internal_data->push;
+    unsigned long long decode_offset;
+
+    if (internal_data->frames_per_packet > 1) {
+        return oswrapper_audio__read_packets(internal_data, buffer, frames_to_do);
+    }
+
+    frames_remaining = internal_data->total_frames > internal_data->current_frame ? internal_data->total_frames - internal_data->current_frame : 0;
+    decode_offset = oswrapper_audio__portable_data_offset(internal_data, internal_data->current_frame);
+
+    if (push != NULL && frames_remaining != 0 && frames_to_do != 0) {
+        /* Only decode the frames which have been received so far.
+        The resampler can skip ahead to frames which haven't been received yet. */
+        unsigned long long frames_available = push->offset + push->size > decode_offset ? (push->offset + push->size - decode_offset) / internal_data->bytes_per_frame : 0;
+
+        if (frames_available == 0) {
+            return push->ended ? 0 : OSWRAPPER_AUDIO_NEED_MORE_DATA;
+        }
+
+        if (frames_remaining > frames_available) {
+            frames_remaining = frames_available;
+        }
+    }
+
+    if (frames_to_do > frames_remaining) {
+        frames_to_do = (size_t) frames_remaining;
+    }
+
+    if (push != NULL) {
+        source = push->data + (size_t) (decode_offset - push->offset);
+    } else if (internal_data->audio_data == NULL) {
+        if (internal_data->read_buffer == NULL) {
+            /* The audio data is already in the output format, so read it straight into the output buffer */
+            size_t bytes_read = oswrapper_audio__callbacks_read_at(&internal_data->callbacks, decode_offset, buffer, frames_to_do * internal_data->bytes_per_frame);
+            frames_to_do = bytes_read / internal_data->bytes_per_frame;
+        } else {
+            /* Read and convert the audio data in pieces */
+            size_t frames_per_read = internal_data->read_buffer_size / internal_data->bytes_per_frame;
+            unsigned char* output = (unsigned char*) buffer;
+            size_t frames_done = 0;
+
+            while (frames_done < frames_to_do) {
+                size_t frames_this_read = frames_to_do - frames_done < frames_per_read ? frames_to_do - frames_done : frames_per_read;
+                size_t frames_read = oswrapper_audio__callbacks_read_at(&internal_data->callbacks, decode_offset + (frames_done * internal_data->bytes_per_frame), internal_data->read_buffer, frames_this_read * internal_data->bytes_per_frame) / internal_data->bytes_per_frame;
+                oswrapper_audio__convert_samples(&internal_data->converter, internal_data->read_buffer, output + (frames_done * internal_data->converted_bytes_per_frame), frames_read * internal_data->channel_count);
+                frames_done += frames_read;
+
+                if (frames_read != frames_this_read) {
+                    break;
+                }
+            }
+
+            frames_to_do = frames_done;
+        }
+
+        internal_data->current_frame += frames_to_do;
+        return frames_to_do;
+    } else {
+        source = internal_data->audio_data + (size_t) (internal_data->current_frame * internal_data->bytes_per_frame);
+    }
+
+    oswrapper_audio__convert_samples(&internal_data->converter, source, buffer, frames_to_do * internal_data->channel_count);
+    internal_data->current_frame += frames_to_do;
+    return frames_to_do;
+}
+
+/* Reads up to OSWRAPPER_AUDIO__CHUNK_FRAMES frames of audio data for the resampler,
+remixed first when remixing before resampling.
+Returns OSWRAPPER_AUDIO_NEED_MORE_DATA if the data hasn't been pushed yet. */
+static size_t oswrapper_audio__read_resampler_input(oswrapper_audio__internal_data_portable* internal_data, float* buffer, size_t frames_to_do) {
+    oswrapper_audio__remixer* remixer = internal_data->remixer;
+    size_t frames_read;
+
+    if (remixer == NULL || internal_data->remix_after_resampling) {
+        return oswrapper_audio__read_portable(internal_data, buffer, frames_to_do);
+    }
+
+    frames_read = oswrapper_audio__read_portable(internal_data, remixer->input_buffer, frames_to_do);
+
+    if (frames_read != OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+        oswrapper_audio__remix(remixer, remixer->input_buffer, buffer, frames_read);
+    }
+
+    return frames_read;
+}
+
+/* Reads audio data into the resampler history, until it contains the tap_count input frames starting at first.
+Returns 0 if the data hasn't been pushed yet. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__fill_resampler(oswrapper_audio__internal_data_portable* internal_data, OSWRAPPER_AUDIO_SEEK_TYPE first) {
+    oswrapper_audio__resampler* resampler = internal_data->resampler;
+    unsigned int channel_count = resampler->channel_count;
+    unsigned int channel;
+    size_t i;
+
+    /* Drop input frames which aren't needed anymore */
+    if (first > resampler->history_pos) {
+        if ((unsigned long long) (first - resampler->history_pos) < resampler->history_frames) {
+            resampler->history_start += (size_t) (first - resampler->history_pos);
+            resampler->history_frames -= (size_t) (first - resampler->history_pos);
+        } else {
+            /* Input frames between the old and new history are skipped */
+            if (first > (OSWRAPPER_AUDIO_SEEK_TYPE) internal_data->current_frame) {
+                internal_data->current_frame = (unsigned long long) first;
+            }
+
+            resampler->history_start = 0;
+            resampler->history_frames = 0;
+        }
+
+        resampler->history_pos = first;
+    }
+
+    while (resampler->history_pos + (OSWRAPPER_AUDIO_SEEK_TYPE) resampler->history_frames < first + (OSWRAPPER_AUDIO_SEEK_TYPE) resampler->tap_count) {
+        OSWRAPPER_AUDIO_SEEK_TYPE fill_pos = resampler->history_pos + (OSWRAPPER_AUDIO_SEEK_TYPE) resampler->history_frames;
+        OSWRAPPER_AUDIO_RESULT_TYPE silence = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        size_t space;
+        size_t frames_read;
+
+        if (resampler->history_capacity - resampler->history_start - resampler->history_frames < OSWRAPPER_AUDIO__CHUNK_FRAMES) {
+            /* Move the history to the start of the buffer. The copy moves backwards, so overlapping is fine. */
+            for (channel = 0; channel < channel_count; channel++) {
+                float* history = resampler->history + (channel * resampler->history_capacity);
+
+                for (i = 0; i < resampler->history_frames; i++) {
+                    history[i] = history[resampler->history_start + i];
+                }
+            }
+
+            resampler->history_start = 0;
+        }
+
+        space = resampler->history_capacity - resampler->history_start - resampler->history_frames;
+
+        if (space > OSWRAPPER_AUDIO__CHUNK_FRAMES) {
+            space = OSWRAPPER_AUDIO__CHUNK_FRAMES;
+        }
+
+        if (fill_pos < 0) {
+            /* Silence before the start of the audio */
+            frames_read = (OSWRAPPER_AUDIO_SEEK_TYPE) space < -fill_pos ? space : (size_t) -fill_pos;
+            silence = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        } else {
+            frames_read = oswrapper_audio__read_resampler_input(internal_data, resampler->input_buffer, space);
+
+            if (frames_read == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
+            }
+
+            if (frames_read == 0) {
+                /* Silence after the end of the audio */
+                frames_read = space;
+                silence = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+            }
+        }
+
+        for (channel = 0; channel < channel_count; channel++) {
+            float* history = resampler->history + (channel * resampler->history_capacity) + resampler->history_start + resampler->history_frames;
+            const float* input = resampler->input_buffer + channel;
+
+            for (i = 0; i < frames_read; i++) {
+                history[i] = silence ? 0.0f : input[i * channel_count];
+            }
+        }
+
+        resampler->history_frames += frames_read;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+/* Resamples audio data to the output buffer.
+Returns OSWRAPPER_AUDIO_NEED_MORE_DATA if the data hasn't been pushed yet. */
+static size_t oswrapper_audio__resample_portable(oswrapper_audio__internal_data_portable* internal_data, void* buffer, size_t frames_to_do) {
+    oswrapper_audio__resampler* resampler = internal_data->resampler;
+    unsigned int channel_count = resampler->channel_count;
+    unsigned long long length = oswrapper_audio__resampled_length(resampler, internal_data->total_frames);
+    size_t output_bytes_per_frame = (oswrapper_audio__sample_format_bits(internal_data->output_converter.output_format) / 8) * internal_data->output_channel_count;
+    unsigned char* output = (unsigned char*) buffer;
+    size_t frames_done = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE need_more_data = OSWRAPPER_AUDIO_RESULT_FAILURE;
+
+    if (resampler->output_frame >= length) {
+        return 0;
+    }
+
+    if (frames_to_do > length - resampler->output_frame) {
+        frames_to_do = (size_t) (length - resampler->output_frame);
+    }
+
+    while (frames_done < frames_to_do && !need_more_data) {
+        size_t chunk_frames = frames_to_do - frames_done < OSWRAPPER_AUDIO__CHUNK_FRAMES ? frames_to_do - frames_done : OSWRAPPER_AUDIO__CHUNK_FRAMES;
+        size_t chunk_done;
+
+        for (chunk_done = 0; chunk_done < chunk_frames; chunk_done++) {
+            unsigned long phase;
+            unsigned int channel;
+            float blend;
+            const float* filter;
+            const float* history;
+            OSWRAPPER_AUDIO_SEEK_TYPE first = oswrapper_audio__resampler_input_pos(resampler, resampler->output_frame, &phase, &blend);
+
+            if (!oswrapper_audio__fill_resampler(internal_data, first)) {
+                need_more_data = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+                break;
+            }
+
+            filter = resampler->filter + (phase * resampler->tap_count);
+
+            if (blend != 0.0f) {
+                unsigned int tap;
+
+                for (tap = 0; tap < resampler->tap_count; tap++) {
+                    resampler->coefficients[tap] = filter[tap] + (blend * (filter[tap + resampler->tap_count] - filter[tap]));
+                }
+
+                filter = resampler->coefficients;
+            }
+
+            history = resampler->history + resampler->history_start;
+
+            for (channel = 0; channel < channel_count; channel++) {
+                resampler->output_buffer[(chunk_done * channel_count) + channel] = oswrapper_audio__dot_f32(filter, history + (channel * resampler->history_capacity), resampler->tap_count);
+            }
+
+            resampler->output_frame++;
+        }
+
+        if (internal_data->remix_after_resampling) {
+            oswrapper_audio__remix_to_output(internal_data->remixer, &internal_data->output_converter, resampler->output_buffer, output + (frames_done * output_bytes_per_frame), chunk_done);
+        } else {
+            oswrapper_audio__convert_samples(&internal_data->output_converter, resampler->output_buffer, output + (frames_done * output_bytes_per_frame), chunk_done * channel_count);
+        }
+
+        frames_done += chunk_done;
+    }
+
+    return frames_done == 0 && need_more_data ? OSWRAPPER_AUDIO_NEED_MORE_DATA : frames_done;
+}
+
+/* Remixes audio data to the output buffer, when not resampling.
+Returns OSWRAPPER_AUDIO_NEED_MORE_DATA if the data hasn't been pushed yet. */
+static size_t oswrapper_audio__remix_portable(oswrapper_audio__internal_data_portable* internal_data, void* buffer, size_t frames_to_do) {
+    oswrapper_audio__remixer* remixer = internal_data->remixer;
+    size_t output_bytes_per_frame = (oswrapper_audio__sample_format_bits(internal_data->output_converter.output_format) / 8) * remixer->output_channels;
+    unsigned char* output = (unsigned char*) buffer;
+    size_t frames_done = 0;
+
+    while (frames_done < frames_to_do) {
+        size_t chunk_frames = frames_to_do - frames_done < remixer->buffer_frames ? frames_to_do - frames_done : remixer->buffer_frames;
+        size_t frames_read = oswrapper_audio__read_portable(internal_data, remixer->input_buffer, chunk_frames);
+
+        if (frames_read == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            return frames_done == 0 ? OSWRAPPER_AUDIO_NEED_MORE_DATA : frames_done;
+        }
+
+        oswrapper_audio__remix_to_output(remixer, &internal_data->output_converter, remixer->input_buffer, output + (frames_done * output_bytes_per_frame), frames_read);
+        frames_done += frames_read;
+
+        if (frames_read != chunk_frames) {
+            break;
+        }
+    }
+
+    return frames_done;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+
+    if (internal_data->push != NULL && !internal_data->push->header_parsed) {
+        return internal_data->push->ended ? 0 : OSWRAPPER_AUDIO_NEED_MORE_DATA;
+    }
+
+    if (internal_data->resampler != NULL) {
+        return oswrapper_audio__resample_portable(internal_data, buffer, frames_to_do);
+    }
+
+    if (internal_data->remixer != NULL) {
+        return oswrapper_audio__remix_portable(internal_data, buffer, frames_to_do);
+    }
+
+    return oswrapper_audio__read_portable(internal_data, buffer, frames_to_do);
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_peek_samples(OSWrapper_audio_spec* audio, const void** samples, size_t* frames) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+    size_t sample_size = internal_data->bytes_per_frame / internal_data->channel_count;
+    const unsigned char* source;
+
+    /* The audio data can only be used directly if it's in memory, and already in the output format */
+    if (internal_data->audio_data == NULL || internal_data->frames_per_packet > 1 || internal_data->resampler != NULL || internal_data->remixer != NULL || !oswrapper_audio__converter_is_passthrough(&internal_data->converter)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    source = internal_data->audio_data + (size_t) (internal_data->current_frame * internal_data->bytes_per_frame);
+
+    /* 24 bit samples are only ever read as bytes */
+    if (sample_size != 3 && ((size_t) source % sample_size) != 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    *samples = source;
+    *frames = (size_t) (internal_data->total_frames - internal_data->current_frame);
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_consume(OSWrapper_audio_spec* audio, size_t frames) {
+    OSWRAPPER_AUDIO_SEEK_TYPE pos;
+    OSWRAPPER_AUDIO_SEEK_TYPE length;
+
+    if (!oswrapper_audio_get_length(audio, &length) || !oswrapper_audio_get_pos(audio, &pos)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* Seeking without resampling only moves the position in the audio data */
+    return oswrapper_audio_seek(audio, length - pos > (OSWRAPPER_AUDIO_SEEK_TYPE) frames ? pos + (OSWRAPPER_AUDIO_SEEK_TYPE) frames : length);
+}
+
+#ifdef OSWRAPPER_AUDIO_USE_THREADS
+/* FLAC frames and ALAC packets don't depend on each other, so the frames after a seek are the same as the frames decoded from the start.
+Resampled audio depends on the frames before it, so it's always decoded from the start. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__can_decode_in_pieces(OSWrapper_audio_spec* audio) {
+    oswrapper_audio__internal_data_portable* internal_data = (oswrapper_audio__internal_data_portable*) audio->internal_data;
+    return (internal_data->flac != NULL || internal_data->alac != NULL) && internal_data->push == NULL && internal_data->resampler == NULL ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+#endif /* OSWRAPPER_AUDIO_USE_THREADS */
+/* End portable implementation */
+#else
+/* No audio loader implementation */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_uninit(void) {
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_free_context(OSWrapper_audio_spec* audio) {
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size(const OSWrapper_audio_spec* hints, unsigned int max_channel_count, unsigned long max_sample_rate) {
+    return 0;
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_context_size_from_memory(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints) {
+    return 0;
+}
+
+#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_callbacks(OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data, OSWrapper_audio_spec* audio) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_push(OSWrapper_audio_spec* audio) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_push_bytes(OSWrapper_audio_spec* audio, const unsigned char* data, size_t data_size) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_push_end(OSWrapper_audio_spec* audio) {
+    /* Nothing */
+}
+
+OSWRAPPER_AUDIO_DEF OSWrapper_audio_length_type oswrapper_audio_get_length(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* frames) {
+    return OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio) {
+    /* Nothing */
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do) {
+    return 0;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_peek_samples(OSWrapper_audio_spec* audio, const void** samples, size_t* frames) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_consume(OSWrapper_audio_spec* audio, size_t frames) {
+    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+/* End no audio loader implementation */
+#endif
+
+/* Start shared planar output */
+/* Size of the buffer on the stack that audio is decoded into before it's split into channels */
+#define OSWRAPPER_AUDIO__PLANAR_CHUNK_SIZE 0x800
+
+/* Copies frame_count interleaved frames to a separate buffer for each channel, starting frame_offset samples into each buffer.
+The input must be aligned for the sample size. */
+static void oswrapper_audio__deinterleave(const unsigned char* input, size_t sample_size, unsigned int channel_count, void** channels, size_t frame_offset, size_t frame_count) {
+    size_t frame_size = sample_size * channel_count;
+    unsigned int channel;
+    size_t i;
+
+    for (channel = 0; channel < channel_count; channel++) {
+        const unsigned char* channel_input = input + (channel * sample_size);
+        unsigned char* output = (unsigned char*) channels[channel] + (frame_offset * sample_size);
+
+        if (sample_size == 1) {
+            for (i = 0; i < frame_count; i++) {
+                output[i] = channel_input[i * frame_size];
+            }
+        } else if (sample_size == 2 && ((size_t) output & 1) == 0) {
+            for (i = 0; i < frame_count; i++) {
+                ((short*) output)[i] = ((const short*) channel_input)[i * channel_count];
+            }
+        } else if (sample_size == 4 && ((size_t) output & 3) == 0) {
+            /* Copied as integers, so float samples are never changed by the FPU */
+            for (i = 0; i < frame_count; i++) {
+                ((unsigned int*) output)[i] = ((const unsigned int*) channel_input)[i * channel_count];
+            }
+        } else {
+            /* 24 and 64 bit samples, or an unaligned buffer */
+            for (i = 0; i < frame_count; i++) {
+                OSWRAPPER_AUDIO_MEMCPY(output + (i * sample_size), channel_input + (i * frame_size), sample_size);
+            }
+        }
+    }
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples_planar(OSWrapper_audio_spec* audio, void** channels, size_t frames_to_do) {
+    /* Aligned for any sample type */
+    double chunk[OSWRAPPER_AUDIO__PLANAR_CHUNK_SIZE / sizeof(double)];
+    size_t sample_size = audio->bits_per_channel / 8;
+    size_t frame_size = sample_size * audio->channel_count;
+    size_t chunk_frames;
+    size_t frames_done = 0;
+
+    if (frame_size == 0) {
+        /* The format of pushed audio isn't known until the header has been received */
+        return oswrapper_audio_get_samples(audio, (short*) chunk, 0);
+    }
+
+    if (frame_size > sizeof(chunk)) {
+        return 0;
+    }
+
+    chunk_frames = sizeof(chunk) / frame_size;
+
+    while (frames_done < frames_to_do) {
+        size_t frames_this_iter = frames_to_do - frames_done < chunk_frames ? frames_to_do - frames_done : chunk_frames;
+        size_t frames_read = oswrapper_audio_get_samples(audio, (short*) chunk, frames_this_iter);
+
+        if (frames_read == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            return frames_done == 0 ? OSWRAPPER_AUDIO_NEED_MORE_DATA : frames_done;
+        }
+
+        oswrapper_audio__deinterleave((const unsigned char*) chunk, sample_size, audio->channel_count, channels, frames_done, frames_read);
+        frames_done += frames_read;
+
+        if (frames_read < frames_this_iter) {
+            break;
+        }
+    }
+
+    return frames_done;
+}
+/* End shared planar output */
+
+/* Start shared vectored output */
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples_iov(OSWrapper_audio_spec* audio, const OSWrapper_audio_iovec* iov, int count) {
+    size_t frames_done = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        size_t frames_read = oswrapper_audio_get_samples(audio, (short*) iov[i].buffer, iov[i].frames);
+
+        if (frames_read == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            return frames_done == 0 ? OSWRAPPER_AUDIO_NEED_MORE_DATA : frames_done;
+        }
+
+        frames_done += frames_read;
+
+        if (frames_read < iov[i].frames) {
+            break;
+        }
+    }
+
+    return frames_done;
+}
+/* End shared vectored output */
+
+/* Start shared whole file decoding */
+#ifdef OSWRAPPER_AUDIO_USE_THREADS
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__decode_all_pieces(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints, OSWrapper_audio_spec* audio, unsigned char* output, size_t frames);
+#endif
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_decode_all(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio, void** pcm, size_t* frames) {
+#ifdef OSWRAPPER_AUDIO_USE_THREADS
+    OSWrapper_audio_spec hints = *audio;
+#endif
+    OSWRAPPER_AUDIO_SEEK_TYPE length = 0;
+    OSWrapper_audio_length_type length_type;
+    unsigned char* decoded;
+    size_t frame_size;
+    size_t capacity;
+    size_t frames_done = 0;
+    *pcm = NULL;
+    *frames = 0;
+
+    if (!oswrapper_audio_load_from_memory(data, data_size, audio)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    frame_size = (audio->bits_per_channel / 8) * audio->channel_count;
+    length_type = oswrapper_audio_get_length(audio, &length);
+
+    if (length_type != OSWRAPPER_AUDIO_LENGTH_UNKNOWN && length >= 0 && (OSWRAPPER_AUDIO_SEEK_TYPE) (size_t) length == length) {
+        capacity = (size_t) length;
+    } else {
+        /* Start with a second of audio, and grow as needed */
+        capacity = audio->sample_rate;
+        length_type = OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+    }
+
+    if (frame_size == 0 || capacity > ((size_t) -1) / frame_size) {
+        oswrapper_audio_free_context(audio);
+        audio->internal_data = NULL;
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    decoded = (unsigned char*) oswrapper_audio__malloc(audio->allocator, capacity > 0 ? capacity * frame_size : 1);
+
+    if (decoded == NULL) {
+        oswrapper_audio_free_context(audio);
+        audio->internal_data = NULL;
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+#ifdef OSWRAPPER_AUDIO_USE_THREADS
+
+    /* Long files which can be decoded in pieces are decoded by several threads at once */
+    if (length_type == OSWRAPPER_AUDIO_LENGTH_EXACT && oswrapper_audio__decode_all_pieces(data, data_size, &hints, audio, decoded, capacity)) {
+        frames_done = capacity;
+    }
+
+#endif
+
+    while (1) {
+        size_t this_iter;
+
+        /* Estimated and unknown lengths can be too short */
+        if (frames_done == capacity) {
+            unsigned char* grown;
+
+            if (length_type == OSWRAPPER_AUDIO_LENGTH_EXACT) {
+                break;
+            }
+
+            if (capacity == 0) {
+                capacity = 4096;
+            } else if (capacity > ((size_t) -1) / frame_size / 2) {
+                break;
+            } else {
+                capacity *= 2;
+            }
+
+            grown = (unsigned char*) oswrapper_audio__realloc(audio->allocator, decoded, frames_done * frame_size, capacity * frame_size);
 
-                if (internal_data != NULL) {
-                    audio->sample_rate = output_format.mSampleRate;
-                    audio->bits_per_channel = output_format.mBitsPerChannel;
-                    audio->channel_count = output_format.mChannelsPerFrame;
-                    audio->audio_type = (output_format.mFormatFlags & kLinearPCMFormatFlagIsFloat) ? OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT : OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
-                    audio->endianness_type = (output_format.mFormatFlags & kAudioFormatFlagIsBigEndian) ? OSWRAPPER_AUDIO_ENDIANNESS_BIG : OSWRAPPER_AUDIO_ENDIANNESS_LITTLE;
-                    audio->internal_data = (void*) internal_data;
-                    internal_data->audio_file = audio_file;
-                    internal_data->audio_file_ext = audio_file_ext;
-                    internal_data->callback_data = callback_data;
-                    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
-                }
+            if (grown == NULL) {
+                oswrapper_audio__free(audio->allocator, decoded);
+                oswrapper_audio_free_context(audio);
+                audio->internal_data = NULL;
+                return OSWRAPPER_AUDIO_RESULT_FAILURE;
             }
+
+            decoded = grown;
         }
 
-        ExtAudioFileDispose(audio_file_ext);
+        /* The decoder works through as much of the audio as possible in each call */
+        this_iter = oswrapper_audio_get_samples(audio, (short*) (decoded + (frames_done * frame_size)), capacity - frames_done);
+
+        if (this_iter == 0 || this_iter == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            break;
+        }
+
+        frames_done += this_iter;
     }
 
-    AudioFileClose(audio_file);
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    oswrapper_audio_free_context(audio);
+    audio->internal_data = NULL;
+    *pcm = decoded;
+    *frames = frames_done;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
 }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
-    oswrapper_audio__callback_data_mac* callback_data = (oswrapper_audio__callback_data_mac*) OSWRAPPER_AUDIO_MALLOC(sizeof(oswrapper_audio__callback_data_mac));
-
-    if (callback_data != NULL) {
-        AudioFileID audio_file;
-        OSStatus error;
-        callback_data->data = data;
-        callback_data->data_size = data_size;
-        error = AudioFileOpenWithCallbacks((void*) callback_data, oswrapper_audio__audio_file_read_callback, NULL, oswrapper_audio__audio_file_get_size_callback, NULL, 0, &audio_file);
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_free_pcm(const OSWrapper_audio_spec* audio, void* pcm) {
+    oswrapper_audio__free(audio->allocator, pcm);
+}
+/* End shared whole file decoding */
 
-        if (!error && oswrapper_audio__load_from_open(audio_file, callback_data, audio)) {
-            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
-        }
+/* Start shared in-place loading */
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory_inplace(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio, void* storage, size_t storage_size) {
+    oswrapper_audio__storage* header;
+    size_t padding = (OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT - ((size_t) storage % OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT)) % OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT;
 
-        OSWRAPPER_AUDIO_FREE(callback_data);
+    if (storage == NULL || storage_size < padding || storage_size - padding < sizeof(oswrapper_audio__storage)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
     }
 
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    /* The storage header is kept in the storage, so the allocator stays valid for as long as the audio context */
+    header = (oswrapper_audio__storage*) ((unsigned char*) storage + padding);
+    header->allocator.alloc_func = oswrapper_audio__storage_alloc;
+    header->allocator.realloc_func = NULL;
+    header->allocator.free_func = oswrapper_audio__storage_free;
+    header->allocator.user_data = (void*) header;
+    header->allocator.alignment = OSWRAPPER_AUDIO__DEFAULT_ALIGNMENT;
+    header->next = (unsigned char*) (header + 1);
+    header->end = (unsigned char*) storage + storage_size;
+    audio->allocator = &header->allocator;
+    return oswrapper_audio_load_from_memory(data, data_size, audio);
 }
+/* End shared in-place loading */
 
-#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio) {
-    AudioFileID audio_file;
-    OSStatus error;
-    CFStringRef path_cfstr;
-    CFURLRef path_url;
-#if !defined(MAC_OS_X_VERSION_10_5) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_5
-    FSRef path_fsref;
+#ifdef OSWRAPPER_AUDIO_USE_THREADS
+/* Start shared threading */
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
 #endif
-    path_cfstr = CFStringCreateWithCString(kCFAllocatorDefault, path, kCFStringEncodingUTF8);
-    path_url = CFURLCreateWithFileSystemPath(NULL, path_cfstr, kCFURLPOSIXPathStyle, false);
-#if !defined(MAC_OS_X_VERSION_10_5) || MAC_OS_X_VERSION_MIN_REQUIRED < MAC_OS_X_VERSION_10_5
-    CFURLGetFSRef(path_url, &path_fsref);
-    error = AudioFileOpen(&path_fsref, kAudioFileReadPermission, 0, &audio_file);
+#include <windows.h>
+#define OSWRAPPER_AUDIO__THREADS_WIN32
 #else
-    error = AudioFileOpenURL(path_url, kAudioFileReadPermission, 0, &audio_file);
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define OSWRAPPER_AUDIO__THREADS_POSIX
 #endif
-    CFRelease(path_url);
-    CFRelease(path_cfstr);
 
-    if (!error && oswrapper_audio__load_from_open(audio_file, NULL, audio)) {
-        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
-    }
+/* Values shared between threads. Loads acquire, and stores release. */
+#if defined(_MSC_VER) && !defined(__clang__)
+typedef volatile LONG oswrapper_audio__atomic;
 
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+static unsigned int oswrapper_audio__atomic_load(oswrapper_audio__atomic* value) {
+    return (unsigned int) InterlockedCompareExchange(value, 0, 0);
 }
-#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
 
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
-/* Unstable-ish API */
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos) {
-    OSStatus error;
-    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
-    error = ExtAudioFileTell(internal_data->audio_file_ext, pos);
-    return !error ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+static void oswrapper_audio__atomic_store(oswrapper_audio__atomic* value, unsigned int new_value) {
+    InterlockedExchange(value, (LONG) new_value);
 }
 
-OSWRAPPER_AUDIO_DEF void oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
-    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
-    ExtAudioFileSeek(internal_data->audio_file_ext, pos);
+/* Returns the value before it was incremented */
+static unsigned int oswrapper_audio__atomic_increment(oswrapper_audio__atomic* value) {
+    return (unsigned int) InterlockedIncrement(value) - 1;
 }
-#endif /* OSWRAPPER_AUDIO_EXPERIMENTAL */
+#else
+typedef unsigned int oswrapper_audio__atomic;
 
-OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio) {
-    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
-    ExtAudioFileSeek(internal_data->audio_file_ext, 0);
+static unsigned int oswrapper_audio__atomic_load(oswrapper_audio__atomic* value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
 }
 
-OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do) {
-    AudioBufferList buffer_list;
-    UInt32 frames;
-    oswrapper_audio__internal_data_mac* internal_data = (oswrapper_audio__internal_data_mac*) audio->internal_data;
-    frames = frames_to_do;
-    buffer_list.mNumberBuffers = 1;
-    buffer_list.mBuffers[0].mNumberChannels = audio->channel_count;
-    buffer_list.mBuffers[0].mDataByteSize = frames_to_do * ((audio->bits_per_channel / 8) * audio->channel_count);
-    buffer_list.mBuffers[0].mData = buffer;
-    ExtAudioFileRead(internal_data->audio_file_ext, &frames, &buffer_list);
-    return frames;
+static void oswrapper_audio__atomic_store(oswrapper_audio__atomic* value, unsigned int new_value) {
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
 }
-/* End macOS AudioToolbox implementation */
-#elif defined(OSWRAPPER_AUDIO_USE_WIN_MF_IMPL)
-/* Start Win32 MF implementation */
-#ifndef COBJMACROS
-#define COBJMACROS
-#endif
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#endif
-#include <windows.h>
-#include <cguid.h>
-#include <initguid.h>
-#include <mfapi.h>
-#include <mfidl.h>
-#include <mfreadwrite.h>
-#include <shlwapi.h>
-#include <stdio.h>
 
-/* Using CINTERFACE breaks some headers, so we have to define these ourselves */
-#if defined(__cplusplus) && !defined(CINTERFACE) && !defined(OSWRAPPER_AUDIO_NO_DEFINE_WINMF_C_INTERFACE)
-#ifndef IMFAttributes_GetGUID
-#define IMFAttributes_GetGUID(attributes, ...) attributes->GetGUID(__VA_ARGS__)
-#endif
-#ifndef IMFByteStream_Release
-#define IMFByteStream_Release(byte_stream) byte_stream->Release()
-#endif
-#ifndef IMFMediaBuffer_Lock
-#define IMFMediaBuffer_Lock(media_buffer, ...) media_buffer->Lock(__VA_ARGS__)
-#endif
-#ifndef IMFMediaBuffer_Release
-#define IMFMediaBuffer_Release(media_buffer) media_buffer->Release()
-#endif
-#ifndef IMFMediaBuffer_Unlock
-#define IMFMediaBuffer_Unlock(media_buffer) media_buffer->Unlock()
-#endif
-#ifndef IMFMediaType_GetUINT32
-#define IMFMediaType_GetUINT32(media_type, ...) media_type->GetUINT32(__VA_ARGS__)
-#endif
-#ifndef IMFMediaType_Release
-#define IMFMediaType_Release(media_type) media_type->Release()
-#endif
-#ifndef IMFMediaType_SetGUID
-#define IMFMediaType_SetGUID(media_type, ...) media_type->SetGUID(__VA_ARGS__)
-#endif
-#ifndef IMFMediaType_SetUINT32
-#define IMFMediaType_SetUINT32(media_type, ...) media_type->SetUINT32(__VA_ARGS__)
+/* Returns the value before it was incremented */
+static unsigned int oswrapper_audio__atomic_increment(oswrapper_audio__atomic* value) {
+    return __atomic_fetch_add(value, 1, __ATOMIC_ACQ_REL);
+}
 #endif
-#ifndef IMFSample_ConvertToContiguousBuffer
-#define IMFSample_ConvertToContiguousBuffer(sample, ...) sample->ConvertToContiguousBuffer(__VA_ARGS__)
+
+typedef void (*oswrapper_audio__thread_func)(void* user_data);
+
+typedef struct oswrapper_audio__thread {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
 #endif
-#ifndef IMFSample_Release
-#define IMFSample_Release(sample) sample->Release()
+    oswrapper_audio__thread_func func;
+    void* user_data;
+} oswrapper_audio__thread;
+
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+static DWORD WINAPI oswrapper_audio__thread_start(LPVOID param) {
+    oswrapper_audio__thread* thread = (oswrapper_audio__thread*) param;
+    thread->func(thread->user_data);
+    return 0;
+}
+#else
+static void* oswrapper_audio__thread_start(void* param) {
+    oswrapper_audio__thread* thread = (oswrapper_audio__thread*) param;
+    thread->func(thread->user_data);
+    return NULL;
+}
 #endif
-#ifndef IMFSourceReader_GetNativeMediaType
-#define IMFSourceReader_GetNativeMediaType(source_reader, ...) source_reader->GetNativeMediaType(__VA_ARGS__)
+
+/* The thread struct must stay valid until the thread has been joined */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__thread_create(oswrapper_audio__thread* thread, oswrapper_audio__thread_func func, void* user_data) {
+    thread->func = func;
+    thread->user_data = user_data;
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    thread->handle = CreateThread(NULL, 0, oswrapper_audio__thread_start, thread, 0, NULL);
+    return thread->handle != NULL ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+#else
+    return pthread_create(&thread->handle, NULL, oswrapper_audio__thread_start, thread) == 0 ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
 #endif
-#ifndef IMFSourceReader_ReadSample
-#define IMFSourceReader_ReadSample(source_reader, ...) source_reader->ReadSample(__VA_ARGS__)
+}
+
+static void oswrapper_audio__thread_join(oswrapper_audio__thread* thread) {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
 #endif
-#ifndef IMFSourceReader_Release
-#define IMFSourceReader_Release(source_reader) source_reader->Release()
+}
+
+/* Returns the amount of CPU cores which can be used, or 1 if it's not known */
+static unsigned int oswrapper_audio__cpu_count(void) {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned int) info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int) count : 1;
 #endif
-#ifndef IMFSourceReader_SetCurrentMediaType
-#define IMFSourceReader_SetCurrentMediaType(source_reader, ...) source_reader->SetCurrentMediaType(__VA_ARGS__)
+}
+
+/* A lock, and a way to wake a thread which is waiting on it */
+typedef struct oswrapper_audio__signal {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    CRITICAL_SECTION lock;
+    HANDLE event;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int signaled;
 #endif
-#ifndef IMFSourceReader_SetCurrentPosition
-#define IMFSourceReader_SetCurrentPosition(source_reader, ...) source_reader->SetCurrentPosition(__VA_ARGS__)
+} oswrapper_audio__signal;
+
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__signal_init(oswrapper_audio__signal* signal) {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    signal->event = CreateEventA(NULL, FALSE, FALSE, NULL);
+
+    if (signal->event == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    InitializeCriticalSection(&signal->lock);
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+#else
+    signal->signaled = 0;
+
+    if (pthread_mutex_init(&signal->lock, NULL) != 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (pthread_cond_init(&signal->cond, NULL) != 0) {
+        pthread_mutex_destroy(&signal->lock);
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
 #endif
-#ifndef IMFSourceReader_SetStreamSelection
-#define IMFSourceReader_SetStreamSelection(source_reader, ...) source_reader->SetStreamSelection(__VA_ARGS__)
+}
+
+static void oswrapper_audio__signal_uninit(oswrapper_audio__signal* signal) {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    DeleteCriticalSection(&signal->lock);
+    CloseHandle(signal->event);
+#else
+    pthread_cond_destroy(&signal->cond);
+    pthread_mutex_destroy(&signal->lock);
 #endif
-#ifndef IStream_Release
-#define IStream_Release(istream) istream->Release()
+}
+
+static void oswrapper_audio__signal_lock(oswrapper_audio__signal* signal) {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    EnterCriticalSection(&signal->lock);
+#else
+    pthread_mutex_lock(&signal->lock);
 #endif
+}
+
+static void oswrapper_audio__signal_unlock(oswrapper_audio__signal* signal) {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    LeaveCriticalSection(&signal->lock);
+#else
+    pthread_mutex_unlock(&signal->lock);
 #endif
+}
 
-/* TODO Ugly hack */
-#ifndef OSWRAPPER_AUDIO_PATH_MAX
-#define OSWRAPPER_AUDIO_PATH_MAX MAX_PATH
+/* Wake the thread waiting in oswrapper_audio__signal_wait, or make its next wait return straight away */
+static void oswrapper_audio__signal_notify(oswrapper_audio__signal* signal) {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    SetEvent(signal->event);
+#else
+    pthread_mutex_lock(&signal->lock);
+    signal->signaled = 1;
+    pthread_cond_signal(&signal->cond);
+    pthread_mutex_unlock(&signal->lock);
 #endif
+}
 
-#ifdef OSWRAPPER_AUDIO_MANAGE_COINIT
-#include <objbase.h>
+/* Wait until notified, or until the timeout in milliseconds has passed */
+static void oswrapper_audio__signal_wait(oswrapper_audio__signal* signal, unsigned long timeout_ms) {
+#ifdef OSWRAPPER_AUDIO__THREADS_WIN32
+    WaitForSingleObject(signal->event, (DWORD) timeout_ms);
+#else
+    pthread_mutex_lock(&signal->lock);
+
+    if (!signal->signaled) {
+        struct timeval now;
+        struct timespec until;
+        gettimeofday(&now, NULL);
+        until.tv_sec = now.tv_sec + (time_t) (timeout_ms / 1000);
+        until.tv_nsec = (long) (now.tv_usec * 1000) + (long) ((timeout_ms % 1000) * 1000000);
+
+        if (until.tv_nsec >= 1000000000) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
 
-#ifndef OSWRAPPER_AUDIO_COINIT_VALUE
-#define OSWRAPPER_AUDIO_COINIT_VALUE COINIT_MULTITHREADED
-#endif
-#endif
+        pthread_cond_timedwait(&signal->cond, &signal->lock, &until);
+    }
 
-/* The startup flags forMFStartup */
-#ifndef OSWRAPPER_AUDIO__MF_STARTUP_VAL
-#define OSWRAPPER_AUDIO__MF_STARTUP_VAL MFSTARTUP_LITE
+    signal->signaled = 0;
+    pthread_mutex_unlock(&signal->lock);
 #endif
+}
+/* End shared threading */
+
+/* Start shared stream implementation */
+/* The most frames decoded at once by a stream's worker thread, so seeking and stopping don't wait too long */
+#define OSWRAPPER_AUDIO__STREAM_CHUNK_FRAMES 4096
+/* The largest ring buffer, in frames. Ring buffer positions are counted with 32 bit integers which wrap around. */
+#define OSWRAPPER_AUDIO__STREAM_MAX_FRAMES 0x40000000
+
+struct OSWrapper_audio_stream {
+    OSWrapper_audio_spec* audio;
+    oswrapper_audio__thread thread;
+    /* Protects seek_pos, and wakes the worker thread */
+    oswrapper_audio__signal signal;
+    /* How long the worker thread waits before checking if there's space in the ring buffer */
+    unsigned long wait_ms;
+    size_t frame_size;
+    /* A power of 2, so the positions can wrap around */
+    unsigned int capacity;
+    unsigned char* ring;
+    /* Frames written by the worker thread, and read by the reader, counted from the start of the stream */
+    oswrapper_audio__atomic write_pos;
+    oswrapper_audio__atomic read_pos;
+    /* The write position when the worker last seeked, which the reader skips to */
+    oswrapper_audio__atomic flush_pos;
+    /* The amount of seeks requested, and the amount the worker has finished */
+    oswrapper_audio__atomic seeks_requested;
+    oswrapper_audio__atomic seeks_done;
+    OSWRAPPER_AUDIO_SEEK_TYPE seek_pos;
+    /* Only written by the reader */
+    unsigned int reader_seeks_done;
+    oswrapper_audio__atomic underruns;
+    oswrapper_audio__atomic loop;
+    /* Set by the worker thread when there's nothing left to decode */
+    oswrapper_audio__atomic decode_ended;
+    oswrapper_audio__atomic quit;
+};
+
+static void oswrapper_audio__stream_worker(void* user_data) {
+    OSWrapper_audio_stream* stream = (OSWrapper_audio_stream*) user_data;
+    unsigned int write_pos = 0;
+    unsigned int seeks_done = 0;
+    /* Prevents looping forever over audio with no frames */
+    size_t frames_since_rewind = 0;
+
+    while (!oswrapper_audio__atomic_load(&stream->quit)) {
+        unsigned int seeks_requested = oswrapper_audio__atomic_load(&stream->seeks_requested);
+
+        if (seeks_requested != seeks_done) {
+            OSWRAPPER_AUDIO_SEEK_TYPE pos;
+            oswrapper_audio__signal_lock(&stream->signal);
+            pos = stream->seek_pos;
+            seeks_requested = oswrapper_audio__atomic_load(&stream->seeks_requested);
+            oswrapper_audio__signal_unlock(&stream->signal);
+            oswrapper_audio_seek(stream->audio, pos);
+            frames_since_rewind = 0;
+            oswrapper_audio__atomic_store(&stream->decode_ended, 0);
+            /* The reader skips any frames before the seek, once it sees the seek has been done */
+            oswrapper_audio__atomic_store(&stream->flush_pos, write_pos);
+            seeks_done = seeks_requested;
+            oswrapper_audio__atomic_store(&stream->seeks_done, seeks_done);
+        }
 
-typedef struct oswrapper_audio__internal_data_win {
-    IMFSourceReader* reader;
-    IMFByteStream* byte_stream;
-    IStream* memory_stream;
-    short* internal_buffer;
-    /* Buffer size */
-    size_t internal_buffer_size;
-    /* Remaining samples */
-    size_t internal_buffer_remaining;
-    /* Current position */
-    size_t internal_buffer_pos;
-    /* Has the reader thrown an error? */
-    OSWRAPPER_AUDIO_RESULT_TYPE no_reader_error;
-} oswrapper_audio__internal_data_win;
+        if (!oswrapper_audio__atomic_load(&stream->decode_ended)) {
+            unsigned int free_frames = stream->capacity - (write_pos - oswrapper_audio__atomic_load(&stream->read_pos));
+
+            if (free_frames > 0) {
+                OSWrapper_audio_iovec iov[2];
+                unsigned int offset = write_pos & (stream->capacity - 1);
+                size_t frames_to_do = free_frames < OSWRAPPER_AUDIO__STREAM_CHUNK_FRAMES ? free_frames : OSWRAPPER_AUDIO__STREAM_CHUNK_FRAMES;
+                size_t frames_read;
+                iov[0].buffer = stream->ring + (offset * stream->frame_size);
+                iov[0].frames = stream->capacity - offset < frames_to_do ? stream->capacity - offset : frames_to_do;
+                iov[1].buffer = stream->ring;
+                iov[1].frames = frames_to_do - iov[0].frames;
+                frames_read = oswrapper_audio_get_samples_iov(stream->audio, iov, iov[1].frames > 0 ? 2 : 1);
+
+                if (frames_read != OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+                    write_pos += (unsigned int) frames_read;
+                    frames_since_rewind += frames_read;
+                    oswrapper_audio__atomic_store(&stream->write_pos, write_pos);
+
+                    if (frames_read == frames_to_do) {
+                        continue;
+                    }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void) {
-#ifdef OSWRAPPER_AUDIO_MANAGE_COINIT
-    HRESULT result = CoInitializeEx(NULL, OSWRAPPER_AUDIO_COINIT_VALUE);
+                    /* The audio has ended */
+                    if (oswrapper_audio__atomic_load(&stream->loop) && frames_since_rewind > 0 && oswrapper_audio_seek(stream->audio, 0)) {
+                        frames_since_rewind = 0;
+                        continue;
+                    }
+
+                    oswrapper_audio__atomic_store(&stream->decode_ended, 1);
+                }
+            }
+        }
+
+        oswrapper_audio__signal_wait(&stream->signal, stream->wait_ms);
+    }
+}
+
+OSWRAPPER_AUDIO_DEF OSWrapper_audio_stream* oswrapper_audio_stream_create(OSWrapper_audio_spec* audio, size_t buffer_frames, OSWRAPPER_AUDIO_RESULT_TYPE loop) {
+    OSWrapper_audio_stream* stream;
+    size_t frame_size = (audio->bits_per_channel / 8) * audio->channel_count;
+    /* The ring buffer is placed after the stream, aligned for any sample type */
+    size_t ring_offset = (sizeof(OSWrapper_audio_stream) + 15) & ~(size_t) 15;
+    unsigned int capacity = 1;
+
+    if (frame_size == 0 || buffer_frames == 0 || buffer_frames > OSWRAPPER_AUDIO__STREAM_MAX_FRAMES) {
+        return NULL;
+    }
+
+    while (capacity < buffer_frames) {
+        capacity *= 2;
+    }
+
+    if (capacity > ((size_t) -1 - ring_offset) / frame_size) {
+        return NULL;
+    }
+
+    stream = (OSWrapper_audio_stream*) oswrapper_audio__malloc(audio->allocator, ring_offset + (capacity * frame_size));
+
+    if (stream == NULL) {
+        return NULL;
+    }
+
+    stream->audio = audio;
+    /* Check for space a few times before the buffer would run out */
+    stream->wait_ms = audio->sample_rate != 0 ? (unsigned long) ((unsigned long long) capacity * 250 / audio->sample_rate) : 10;
+    stream->wait_ms = stream->wait_ms < 1 ? 1 : stream->wait_ms > 100 ? 100 : stream->wait_ms;
+    stream->frame_size = frame_size;
+    stream->capacity = capacity;
+    stream->ring = (unsigned char*) stream + ring_offset;
+    stream->write_pos = 0;
+    stream->read_pos = 0;
+    stream->flush_pos = 0;
+    stream->seeks_requested = 0;
+    stream->seeks_done = 0;
+    stream->seek_pos = 0;
+    stream->reader_seeks_done = 0;
+    stream->underruns = 0;
+    stream->loop = loop ? 1 : 0;
+    stream->decode_ended = 0;
+    stream->quit = 0;
+
+    if (!oswrapper_audio__signal_init(&stream->signal)) {
+        oswrapper_audio__free(audio->allocator, stream);
+        return NULL;
+    }
+
+    if (!oswrapper_audio__thread_create(&stream->thread, oswrapper_audio__stream_worker, stream)) {
+        oswrapper_audio__signal_uninit(&stream->signal);
+        oswrapper_audio__free(audio->allocator, stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_stream_destroy(OSWrapper_audio_stream* stream) {
+    oswrapper_audio__atomic_store(&stream->quit, 1);
+    oswrapper_audio__signal_notify(&stream->signal);
+    oswrapper_audio__thread_join(&stream->thread);
+    oswrapper_audio__signal_uninit(&stream->signal);
+    oswrapper_audio__free(stream->audio->allocator, stream);
+}
+
+OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_stream_read(OSWrapper_audio_stream* stream, void* buffer, size_t frames) {
+    unsigned int seeks_done = oswrapper_audio__atomic_load(&stream->seeks_done);
+    unsigned int read_pos = oswrapper_audio__atomic_load(&stream->read_pos);
+    unsigned int available;
+    unsigned int offset;
+    size_t first_frames;
+
+    if (oswrapper_audio__atomic_load(&stream->seeks_requested) != seeks_done) {
+        /* Don't play frames from before the seek */
+        return 0;
+    }
+
+    if (seeks_done != stream->reader_seeks_done) {
+        unsigned int flush_pos = oswrapper_audio__atomic_load(&stream->flush_pos);
+        stream->reader_seeks_done = seeks_done;
+
+        /* Only skip forwards, in case the worker has seeked again since seeks_done was loaded */
+        if ((int) (flush_pos - read_pos) > 0) {
+            read_pos = flush_pos;
+        }
+    }
 
-    if (SUCCEEDED(result)) {
-        result = MFStartup(MF_VERSION, OSWRAPPER_AUDIO__MF_STARTUP_VAL);
+    available = oswrapper_audio__atomic_load(&stream->write_pos) - read_pos;
 
-        if (SUCCEEDED(result)) {
-            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    if (frames > available) {
+        if (!oswrapper_audio__atomic_load(&stream->decode_ended)) {
+            oswrapper_audio__atomic_store(&stream->underruns, oswrapper_audio__atomic_load(&stream->underruns) + 1);
         }
 
-        CoUninitialize();
+        frames = available;
     }
 
+    offset = read_pos & (stream->capacity - 1);
+    first_frames = stream->capacity - offset < frames ? stream->capacity - offset : frames;
+    OSWRAPPER_AUDIO_MEMCPY(buffer, stream->ring + (offset * stream->frame_size), first_frames * stream->frame_size);
+    OSWRAPPER_AUDIO_MEMCPY((unsigned char*) buffer + (first_frames * stream->frame_size), stream->ring, (frames - first_frames) * stream->frame_size);
+    oswrapper_audio__atomic_store(&stream->read_pos, read_pos + (unsigned int) frames);
+    return frames;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_stream_get_stats(OSWrapper_audio_stream* stream, OSWrapper_audio_stream_stats* stats) {
+    unsigned int seeks_requested = oswrapper_audio__atomic_load(&stream->seeks_requested);
+    OSWRAPPER_AUDIO_RESULT_TYPE decode_ended = oswrapper_audio__atomic_load(&stream->decode_ended) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+    unsigned int read_pos = oswrapper_audio__atomic_load(&stream->read_pos);
+    stats->buffered_frames = oswrapper_audio__atomic_load(&stream->write_pos) - read_pos;
+    stats->buffer_frames = stream->capacity;
+    stats->underruns = oswrapper_audio__atomic_load(&stream->underruns);
+    stats->ended = decode_ended && stats->buffered_frames == 0 && seeks_requested == oswrapper_audio__atomic_load(&stream->seeks_done) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_stream_seek(OSWrapper_audio_stream* stream, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
+    oswrapper_audio__signal_lock(&stream->signal);
+    stream->seek_pos = pos;
+    oswrapper_audio__atomic_store(&stream->seeks_requested, oswrapper_audio__atomic_load(&stream->seeks_requested) + 1);
+    oswrapper_audio__signal_unlock(&stream->signal);
+    oswrapper_audio__signal_notify(&stream->signal);
+}
+
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_stream_set_loop(OSWrapper_audio_stream* stream, OSWRAPPER_AUDIO_RESULT_TYPE loop) {
+    oswrapper_audio__atomic_store(&stream->loop, loop ? 1 : 0);
+    oswrapper_audio__signal_notify(&stream->signal);
+}
+/* End shared stream implementation */
+
+/* Start shared piece decoding */
+/* Long files which can be decoded in pieces are split into pieces of at least this many frames,
+which are decoded by different threads at the same time */
+#ifndef OSWRAPPER_AUDIO_PIECE_MIN_FRAMES
+#define OSWRAPPER_AUDIO_PIECE_MIN_FRAMES 0x40000
+#endif
+
+#ifndef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+/* Other decoders always decode files from start to end */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__can_decode_in_pieces(OSWrapper_audio_spec* audio) {
+    (void) audio;
     return OSWRAPPER_AUDIO_RESULT_FAILURE;
-#else
-    return SUCCEEDED(MFStartup(MF_VERSION, OSWRAPPER_AUDIO__MF_STARTUP_VAL)) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
+}
 #endif
+
+/* Returns how many pieces a file with the given amount of frames should be split into, up to max_pieces */
+static unsigned int oswrapper_audio__piece_count(OSWrapper_audio_spec* audio, size_t frames, unsigned int max_pieces) {
+    size_t pieces = frames / OSWRAPPER_AUDIO_PIECE_MIN_FRAMES;
+
+    if (pieces < 2 || max_pieces < 2 || !oswrapper_audio__can_decode_in_pieces(audio)) {
+        return 1;
+    }
+
+    return pieces < max_pieces ? (unsigned int) pieces : max_pieces;
 }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_uninit(void) {
-#ifdef OSWRAPPER_AUDIO_MANAGE_COINIT
+/* Decodes the given frames of an audio context straight into their place in the output for the whole file.
+Frames which fail to decode are skipped, which moves the frames after them,
+so this only returns 1 if the audio context ends up exactly at the end of the piece. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__decode_piece(OSWrapper_audio_spec* audio, unsigned char* output, size_t first_frame, size_t frames) {
+    size_t frame_size = (audio->bits_per_channel / 8) * audio->channel_count;
+    size_t frames_done = 0;
+    OSWRAPPER_AUDIO_SEEK_TYPE pos = 0;
 
-    if (FAILED(MFShutdown())) {
+    if (!oswrapper_audio_seek(audio, (OSWRAPPER_AUDIO_SEEK_TYPE) first_frame)) {
         return OSWRAPPER_AUDIO_RESULT_FAILURE;
     }
 
-    CoUninitialize();
-    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
-#else
-    return SUCCEEDED(MFShutdown()) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
-#endif
+    while (frames_done < frames) {
+        size_t this_iter = oswrapper_audio_get_samples(audio, (short*) (output + ((first_frame + frames_done) * frame_size)), frames - frames_done);
+
+        if (this_iter == 0 || this_iter == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            break;
+        }
+
+        frames_done += this_iter;
+    }
+
+    return frames_done == frames && oswrapper_audio_get_pos(audio, &pos) && pos == (OSWRAPPER_AUDIO_SEEK_TYPE) (first_frame + frames) ? OSWRAPPER_AUDIO_RESULT_SUCCESS : OSWRAPPER_AUDIO_RESULT_FAILURE;
 }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_free_context(OSWrapper_audio_spec* audio) {
-    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
-    IMFSourceReader_Release(internal_data->reader);
+/* One piece of a file being decoded by oswrapper_audio_decode_all */
+typedef struct oswrapper_audio__piece {
+    OSWrapper_audio_spec audio;
+    unsigned char* output;
+    size_t first_frame;
+    size_t frames;
+    OSWRAPPER_AUDIO_RESULT_TYPE decoded;
+    OSWRAPPER_AUDIO_RESULT_TYPE started;
+    oswrapper_audio__thread thread;
+} oswrapper_audio__piece;
+
+static void oswrapper_audio__piece_worker(void* user_data) {
+    oswrapper_audio__piece* piece = (oswrapper_audio__piece*) user_data;
+    piece->decoded = oswrapper_audio__decode_piece(&piece->audio, piece->output, piece->first_frame, piece->frames);
+}
 
-    /* Only expected for in-memory decoding */
-    if (internal_data->byte_stream != NULL) {
-        IMFByteStream_Release(internal_data->byte_stream);
+/* Decodes every frame of a file in memory into output, by splitting it into pieces which are decoded by one thread per CPU core.
+The passed audio context decodes the first piece, and the other pieces use their own audio contexts loaded with the same hints.
+Returns 1 if every frame was decoded, or 0 if the file should be decoded from start to end instead,
+in which case the passed audio context is back at the start. */
+static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__decode_all_pieces(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints, OSWrapper_audio_spec* audio, unsigned char* output, size_t frames) {
+    unsigned int piece_count = oswrapper_audio__piece_count(audio, frames, oswrapper_audio__cpu_count());
+    OSWRAPPER_AUDIO_RESULT_TYPE all_decoded = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    oswrapper_audio__piece* pieces;
+    unsigned int loaded = 1;
+    size_t piece_frames;
+    unsigned int i;
+
+    if (piece_count < 2) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
     }
 
-    /* Only expected for in-memory decoding */
-    if (internal_data->memory_stream != NULL) {
-        IStream_Release(internal_data->memory_stream);
+    pieces = (oswrapper_audio__piece*) oswrapper_audio__malloc(audio->allocator, sizeof(oswrapper_audio__piece) * piece_count);
+
+    if (pieces == NULL) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
     }
 
-    if (internal_data->internal_buffer != NULL) {
-        OSWRAPPER_AUDIO_FREE(internal_data->internal_buffer);
+    /* Every audio context is loaded and freed on this thread, so the allocator is never used by the other threads */
+    pieces[0].audio = *audio;
+
+    while (loaded < piece_count) {
+        pieces[loaded].audio = *hints;
+        pieces[loaded].audio.internal_data = NULL;
+
+        if (!oswrapper_audio_load_from_memory(data, data_size, &pieces[loaded].audio)) {
+            break;
+        }
+
+        loaded++;
     }
 
-    OSWRAPPER_AUDIO_FREE(audio->internal_data);
-    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
-}
+    piece_frames = frames / loaded;
 
-#define OSWRAPPER_AUDIO__END_FAIL_FALSE(cond) if(!cond) { return_val = OSWRAPPER_AUDIO_RESULT_FAILURE; goto cleanup; }
-#define OSWRAPPER_AUDIO__END_FAIL(hres) OSWRAPPER_AUDIO__END_FAIL_FALSE(SUCCEEDED(hres))
+    for (i = 0; i < loaded; i++) {
+        pieces[i].output = output;
+        pieces[i].first_frame = piece_frames * i;
+        pieces[i].frames = i == loaded - 1 ? frames - pieces[i].first_frame : piece_frames;
+        pieces[i].decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        pieces[i].started = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
 
-static OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__configure_stream(IMFSourceReader* reader, OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_RESULT_TYPE initial_configure) {
-    OSWRAPPER_AUDIO_RESULT_TYPE return_val;
-    HRESULT result;
-    UINT32 sample_rate, channel_count, bits_per_channel;
-    GUID format_type;
-    IMFMediaType* media_type;
-    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+    for (i = 1; i < loaded; i++) {
+        pieces[i].started = oswrapper_audio__thread_create(&pieces[i].thread, oswrapper_audio__piece_worker, &pieces[i]);
+    }
 
-    if ((initial_configure != OSWRAPPER_AUDIO_RESULT_SUCCESS) && (internal_data != NULL) && (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_FAILURE)) {
-        /* IMFSourceReader methods can no longer be called */
-        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    /* If a thread can't be started, this thread decodes its piece as well */
+    for (i = 0; i < loaded; i++) {
+        if (!pieces[i].started) {
+            oswrapper_audio__piece_worker(&pieces[i]);
+        }
     }
 
-    media_type = NULL;
-    result = S_OK;
-    return_val = OSWRAPPER_AUDIO_RESULT_SUCCESS;
-    channel_count = audio->channel_count;
-    sample_rate = audio->sample_rate;
-    bits_per_channel = audio->bits_per_channel;
+    for (i = 0; i < loaded; i++) {
+        if (pieces[i].started) {
+            oswrapper_audio__thread_join(&pieces[i].thread);
+        }
 
-    if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
-        format_type = MFAudioFormat_Float;
-    } else if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) {
-        format_type = MFAudioFormat_PCM;
-    } else {
-        /* Fallback */
-        format_type = MFAudioFormat_PCM;
+        if (!pieces[i].decoded) {
+            all_decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        if (i > 0) {
+            oswrapper_audio_free_context(&pieces[i].audio);
+        }
     }
 
-    OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_SetStreamSelection(reader, (DWORD) MF_SOURCE_READER_ALL_STREAMS, FALSE));
-    OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_SetStreamSelection(reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, TRUE));
+    oswrapper_audio__free(audio->allocator, pieces);
 
-    /* Get / set the format */
-    if ((sample_rate == 0) || (channel_count == 0) || (bits_per_channel == 0) || (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET)) {
-        OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_GetNativeMediaType(reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, 0, &media_type));
+    if (!all_decoded) {
+        oswrapper_audio_seek(audio, 0);
+    }
 
-        if (channel_count == 0) {
-#ifdef __cplusplus
-            IMFMediaType_GetUINT32(media_type, MF_MT_AUDIO_NUM_CHANNELS, &channel_count);
-#else
-            IMFMediaType_GetUINT32(media_type, &MF_MT_AUDIO_NUM_CHANNELS, &channel_count);
-#endif
+    return all_decoded;
+}
+/* End shared piece decoding */
+
+/* Start shared batch decoding */
+/* The size of each thread's scratch buffer, used to count the frames of files without an exact length */
+#define OSWRAPPER_AUDIO__BATCH_SCRATCH_SIZE 0x10000
+
+/* A range of frames of one file, which is decoded by one thread.
+Long files which can be decoded in pieces are split into several ranges, and other files are decoded in one range. */
+typedef struct oswrapper_audio__batch_piece {
+    unsigned int index;
+    /* The amount of pieces the file is split into */
+    unsigned int split;
+    size_t first_frame;
+    size_t frames;
+    OSWRAPPER_AUDIO_RESULT_TYPE decoded;
+} oswrapper_audio__batch_piece;
+
+typedef struct oswrapper_audio__batch {
+    const char* const* paths;
+    const OSWrapper_audio_spec* spec_hint;
+    OSWrapper_audio_batch_result* results;
+    /* While measuring, there is one piece for each file. Once the decoded audio has been allocated,
+    the pieces are replaced by the pieces of every file in order. */
+    oswrapper_audio__batch_piece* pieces;
+    /* The amount of files or pieces */
+    unsigned int count;
+    /* The most pieces a file is split into */
+    unsigned int max_split;
+    /* The next file to be measured or piece to be decoded by a thread */
+    oswrapper_audio__atomic next_index;
+    /* Set once every file has been measured, and the decoded audio has been allocated */
+    OSWRAPPER_AUDIO_RESULT_TYPE decoding;
+} oswrapper_audio__batch;
+
+/* Finds the output format and length of a file, counting the frames with the scratch buffer if the exact length isn't known */
+static void oswrapper_audio__batch_measure(oswrapper_audio__batch* batch, OSWrapper_audio_batch_result* result, oswrapper_audio__batch_piece* piece, const char* path, unsigned char** scratch) {
+    OSWrapper_audio_spec audio = *batch->spec_hint;
+    OSWRAPPER_AUDIO_SEEK_TYPE length = 0;
+    size_t frame_size;
+    audio.internal_data = NULL;
 
-            /* Sanity check */
-            if (channel_count == 0) {
-                channel_count = 2;
-            }
+    if (!oswrapper_audio_load_from_path(path, &audio)) {
+        return;
+    }
 
-            audio->channel_count = channel_count;
+    frame_size = (audio.bits_per_channel / 8) * audio.channel_count;
+
+    if (frame_size == 0 || frame_size > OSWRAPPER_AUDIO__BATCH_SCRATCH_SIZE) {
+        oswrapper_audio_free_context(&audio);
+        return;
+    }
+
+    if (oswrapper_audio_get_length(&audio, &length) == OSWRAPPER_AUDIO_LENGTH_EXACT && length >= 0 && (OSWRAPPER_AUDIO_SEEK_TYPE) (size_t) length == length) {
+        result->frames = (size_t) length;
+        piece->split = oswrapper_audio__piece_count(&audio, result->frames, batch->max_split);
+    } else {
+        if (*scratch == NULL) {
+            *scratch = (unsigned char*) oswrapper_audio__malloc(batch->spec_hint->allocator, OSWRAPPER_AUDIO__BATCH_SCRATCH_SIZE);
+
+            if (*scratch == NULL) {
+                oswrapper_audio_free_context(&audio);
+                return;
+            }
         }
 
-        if (sample_rate == 0) {
-#ifdef __cplusplus
-            IMFMediaType_GetUINT32(media_type, MF_MT_AUDIO_SAMPLES_PER_SECOND, &sample_rate);
-#else
-            IMFMediaType_GetUINT32(media_type, &MF_MT_AUDIO_SAMPLES_PER_SECOND, &sample_rate);
-#endif
+        while (1) {
+            size_t this_iter = oswrapper_audio_get_samples(&audio, (short*) *scratch, OSWRAPPER_AUDIO__BATCH_SCRATCH_SIZE / frame_size);
 
-            /* Sanity check */
-            if (sample_rate == 0) {
-                sample_rate = 44100;
+            if (this_iter == 0 || this_iter == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+                break;
             }
 
-            audio->sample_rate = sample_rate;
+            result->frames += this_iter;
         }
+    }
 
-        if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_NOT_SET) {
-#ifdef __cplusplus
-            IMFAttributes_GetGUID(media_type, MF_MT_SUBTYPE, &format_type);
-#else
-            IMFAttributes_GetGUID(media_type, &MF_MT_SUBTYPE, &format_type);
-#endif
+    result->spec = audio;
+    result->spec.internal_data = NULL;
+    result->decoded = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    oswrapper_audio_free_context(&audio);
+}
 
-            /* Sanity check */
-            if (!OSWRAPPER_AUDIO_MEMCMP(&format_type, &MFAudioFormat_PCM, sizeof(GUID))) {
-                audio->audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
-            } else if (!OSWRAPPER_AUDIO_MEMCMP(&format_type, &MFAudioFormat_Float, sizeof(GUID))) {
-                audio->audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
-            } else {
-                /* Fallback */
-                format_type = MFAudioFormat_PCM;
-                audio->audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+/* Decodes a piece of a measured file straight into its place in the shared allocation.
+A file in one piece is decoded until it ends, and the amount of frames decoded is stored in the piece. */
+static void oswrapper_audio__batch_decode(oswrapper_audio__batch* batch, oswrapper_audio__batch_piece* piece) {
+    OSWrapper_audio_batch_result* result = &batch->results[piece->index];
+    OSWrapper_audio_spec audio = *batch->spec_hint;
+    size_t frame_size = (result->spec.bits_per_channel / 8) * result->spec.channel_count;
+    size_t frames_done = 0;
+    audio.internal_data = NULL;
+    piece->decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+
+    if (!oswrapper_audio_load_from_path(batch->paths[piece->index], &audio)) {
+        piece->frames = 0;
+        return;
+    }
+
+    /* The file might have changed since it was measured */
+    if (audio.sample_rate == result->spec.sample_rate && audio.channel_count == result->spec.channel_count && audio.bits_per_channel == result->spec.bits_per_channel
+            && audio.audio_type == result->spec.audio_type && audio.endianness_type == result->spec.endianness_type) {
+        if (piece->split > 1) {
+            piece->decoded = oswrapper_audio__decode_piece(&audio, (unsigned char*) result->samples, piece->first_frame, piece->frames);
+            frames_done = piece->frames;
+        } else {
+            while (frames_done < piece->frames) {
+                size_t this_iter = oswrapper_audio_get_samples(&audio, (short*) ((unsigned char*) result->samples + (frames_done * frame_size)), piece->frames - frames_done);
+
+                if (this_iter == 0 || this_iter == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+                    break;
+                }
+
+                frames_done += this_iter;
             }
+
+            piece->decoded = OSWRAPPER_AUDIO_RESULT_SUCCESS;
         }
+    }
 
-        if (bits_per_channel == 0) {
-#ifdef __cplusplus
-            IMFMediaType_GetUINT32(media_type, MF_MT_AUDIO_BITS_PER_SAMPLE, &bits_per_channel);
-#else
-            IMFMediaType_GetUINT32(media_type, &MF_MT_AUDIO_BITS_PER_SAMPLE, &bits_per_channel);
+    piece->frames = frames_done;
+    oswrapper_audio_free_context(&audio);
+}
+
+/* Each thread takes the next file or piece which hasn't been started yet, until there are none left */
+static void oswrapper_audio__batch_worker(void* user_data) {
+    oswrapper_audio__batch* batch = (oswrapper_audio__batch*) user_data;
+    unsigned char* scratch = NULL;
+#ifdef OSWRAPPER_AUDIO_USE_WIN_MF_IMPL
+    /* Media Foundation needs COM to be initialised on every thread which uses it */
+    HRESULT coinit_result = CoInitializeEx(NULL, OSWRAPPER_AUDIO_COINIT_VALUE);
 #endif
 
-            /* Sanity check */
-            if (bits_per_channel == 0) {
-                if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
-                    bits_per_channel = 32;
-                } else {
-                    bits_per_channel = 16;
-                }
-            }
+    while (1) {
+        unsigned int index = oswrapper_audio__atomic_increment(&batch->next_index);
 
-            audio->bits_per_channel = bits_per_channel;
+        if (index >= batch->count) {
+            break;
         }
 
-        IMFMediaType_Release(media_type);
+        if (batch->decoding) {
+            oswrapper_audio__batch_piece* piece = &batch->pieces[index];
+
+            if (batch->results[piece->index].decoded) {
+                oswrapper_audio__batch_decode(batch, piece);
+            }
+        } else {
+            oswrapper_audio__batch_measure(batch, &batch->results[index], &batch->pieces[index], batch->paths[index], &scratch);
+        }
+    }
+
+    if (scratch != NULL) {
+        oswrapper_audio__free(batch->spec_hint->allocator, scratch);
+    }
+
+#ifdef OSWRAPPER_AUDIO_USE_WIN_MF_IMPL
+
+    if (SUCCEEDED(coinit_result)) {
+        CoUninitialize();
     }
 
-    OSWRAPPER_AUDIO__END_FAIL(MFCreateMediaType(&media_type));
-#ifdef __cplusplus
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetGUID(media_type, MF_MT_MAJOR_TYPE, MFMediaType_Audio));
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetGUID(media_type, MF_MT_SUBTYPE, format_type));
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, MF_MT_AUDIO_BITS_PER_SAMPLE, audio->bits_per_channel));
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, MF_MT_AUDIO_SAMPLES_PER_SECOND, audio->sample_rate));
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, MF_MT_AUDIO_NUM_CHANNELS, audio->channel_count));
-#else
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetGUID(media_type, &MF_MT_MAJOR_TYPE, &MFMediaType_Audio));
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetGUID(media_type, &MF_MT_SUBTYPE, &format_type));
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, &MF_MT_AUDIO_BITS_PER_SAMPLE, audio->bits_per_channel));
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, &MF_MT_AUDIO_SAMPLES_PER_SECOND, audio->sample_rate));
-    OSWRAPPER_AUDIO__END_FAIL(IMFMediaType_SetUINT32(media_type, &MF_MT_AUDIO_NUM_CHANNELS, audio->channel_count));
 #endif
-    OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_SetCurrentMediaType(reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, NULL, media_type));
-    OSWRAPPER_AUDIO__END_FAIL(IMFSourceReader_SetStreamSelection(reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, TRUE));
-cleanup:
+}
 
-    if (media_type != NULL) {
-        IMFMediaType_Release(media_type);
+/* Runs the worker on this thread and threads - 1 other threads, and waits for them to finish */
+static void oswrapper_audio__batch_run(oswrapper_audio__batch* batch, oswrapper_audio__thread* threads, unsigned int thread_count) {
+    unsigned int started = 0;
+    unsigned int i;
+    oswrapper_audio__atomic_store(&batch->next_index, 0);
+
+    /* If a thread can't be started, the other threads do its work */
+    while (started < thread_count - 1 && oswrapper_audio__thread_create(&threads[started], oswrapper_audio__batch_worker, batch)) {
+        started++;
     }
 
-    return return_val;
+    oswrapper_audio__batch_worker(batch);
+
+    for (i = 0; i < started; i++) {
+        oswrapper_audio__thread_join(&threads[i]);
+    }
 }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio__load_from_reader(IMFSourceReader* reader, IMFByteStream* byte_stream, IStream* memory_stream, OSWrapper_audio_spec* audio) {
-    if (oswrapper_audio__configure_stream(reader, audio, OSWRAPPER_AUDIO_RESULT_SUCCESS)) {
-        oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) OSWRAPPER_AUDIO_MALLOC(sizeof(oswrapper_audio__internal_data_win));
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_decode_batch(const char* const* paths, size_t count, const OSWrapper_audio_spec* spec_hint, OSWrapper_audio_batch_result* results, unsigned int threads) {
+    oswrapper_audio__batch batch;
+    oswrapper_audio__thread* thread_handles = NULL;
+    oswrapper_audio__batch_piece* pieces;
+    oswrapper_audio__batch_piece* split_pieces;
+    unsigned char* samples;
+    size_t total_size = 0;
+    size_t piece_count = 0;
+    size_t i;
+    unsigned int split;
+    OSWRAPPER_AUDIO_RESULT_TYPE all_decoded = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+
+    /* File indexes are counted with 32 bit integers */
+    if (count > 0x7FFFFFFF) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
 
-        if (internal_data != NULL) {
-            audio->endianness_type = OSWRAPPER_AUDIO_ENDIANNESS_LITTLE;
-            audio->internal_data = (void*) internal_data;
-            internal_data->reader = reader;
-            internal_data->byte_stream = byte_stream;
-            internal_data->memory_stream = memory_stream;
-            internal_data->internal_buffer = NULL;
-            internal_data->internal_buffer_pos = 0;
-            internal_data->internal_buffer_remaining = 0;
-            internal_data->internal_buffer_size = 0;
-            internal_data->no_reader_error = OSWRAPPER_AUDIO_RESULT_SUCCESS;
-            return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    for (i = 0; i < count; i++) {
+        results[i].spec = *spec_hint;
+        results[i].spec.internal_data = NULL;
+        results[i].samples = NULL;
+        results[i].frames = 0;
+        results[i].decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    if (count == 0) {
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+    if (threads == 0) {
+        threads = oswrapper_audio__cpu_count();
+    }
+
+    /* Threads which aren't needed to measure every file can still decode pieces of long files */
+    if (threads > 1) {
+        thread_handles = (oswrapper_audio__thread*) oswrapper_audio__malloc(spec_hint->allocator, sizeof(oswrapper_audio__thread) * (threads - 1));
+
+        /* Decode everything on this thread instead */
+        if (thread_handles == NULL) {
+            threads = 1;
+        }
+    }
+
+    pieces = (oswrapper_audio__batch_piece*) oswrapper_audio__malloc(spec_hint->allocator, sizeof(oswrapper_audio__batch_piece) * count);
+
+    if (pieces == NULL) {
+        if (thread_handles != NULL) {
+            oswrapper_audio__free(spec_hint->allocator, thread_handles);
+        }
+
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    for (i = 0; i < count; i++) {
+        pieces[i].index = (unsigned int) i;
+        pieces[i].split = 1;
+        pieces[i].first_frame = 0;
+        pieces[i].frames = 0;
+        pieces[i].decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    batch.paths = paths;
+    batch.spec_hint = spec_hint;
+    batch.results = results;
+    batch.pieces = pieces;
+    batch.count = (unsigned int) count;
+    batch.max_split = threads;
+    batch.decoding = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    oswrapper_audio__batch_run(&batch, thread_handles, threads > count ? (unsigned int) count : threads);
+
+    /* Each file's audio is aligned for any sample type */
+    for (i = 0; i < count; i++) {
+        size_t frame_size = (results[i].spec.bits_per_channel / 8) * results[i].spec.channel_count;
+        size_t size;
+
+        if (!results[i].decoded) {
+            continue;
+        }
+
+        if (results[i].frames > ((size_t) -1 - 15) / frame_size) {
+            results[i].decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+            results[i].frames = 0;
+            continue;
+        }
+
+        size = ((results[i].frames * frame_size) + 15) & ~(size_t) 15;
+
+        if (size > (size_t) -1 - total_size) {
+            results[i].decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+            results[i].frames = 0;
+            continue;
+        }
+
+        total_size += size;
+        piece_count += pieces[i].split;
+    }
+
+    samples = (unsigned char*) oswrapper_audio__malloc(spec_hint->allocator, total_size > 0 ? total_size : 1);
+
+    if (samples == NULL) {
+        if (thread_handles != NULL) {
+            oswrapper_audio__free(spec_hint->allocator, thread_handles);
+        }
+
+        oswrapper_audio__free(spec_hint->allocator, pieces);
+
+        for (i = 0; i < count; i++) {
+            results[i].frames = 0;
+            results[i].decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
+
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
+
+    /* Every result points into the allocation in order, so the first result points to the start of it */
+    total_size = 0;
+
+    for (i = 0; i < count; i++) {
+        results[i].samples = samples + total_size;
+
+        if (results[i].decoded) {
+            size_t frame_size = (results[i].spec.bits_per_channel / 8) * results[i].spec.channel_count;
+            total_size += ((results[i].frames * frame_size) + 15) & ~(size_t) 15;
         }
     }
 
-    IMFSourceReader_Release(reader);
+    /* If there isn't room for the pieces of long files, every file is decoded in one piece instead.
+    These pieces replace the ones used for measuring, which are never after them. */
+    split_pieces = piece_count <= 0x7FFFFFFF ? (oswrapper_audio__batch_piece*) oswrapper_audio__malloc(spec_hint->allocator, sizeof(oswrapper_audio__batch_piece) * (piece_count > 0 ? piece_count : 1)) : NULL;
+    piece_count = 0;
 
-    /* Only expected for in-memory decoding */
-    if (byte_stream != NULL) {
-        IMFByteStream_Release(byte_stream);
+    for (i = 0; i < count; i++) {
+        size_t piece_frames;
+        unsigned int j;
+
+        if (!results[i].decoded) {
+            continue;
+        }
+
+        split = split_pieces != NULL ? pieces[i].split : 1;
+        piece_frames = results[i].frames / split;
+
+        for (j = 0; j < split; j++) {
+            oswrapper_audio__batch_piece* piece = split_pieces != NULL ? &split_pieces[piece_count] : &pieces[piece_count];
+            piece->index = (unsigned int) i;
+            piece->split = split;
+            piece->first_frame = piece_frames * j;
+            piece->frames = j == split - 1 ? results[i].frames - piece->first_frame : piece_frames;
+            piece->decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+            piece_count++;
+        }
     }
 
-    /* Only expected for in-memory decoding */
-    if (memory_stream != NULL) {
-        IStream_Release(memory_stream);
+    if (split_pieces != NULL) {
+        oswrapper_audio__free(spec_hint->allocator, pieces);
+        pieces = split_pieces;
     }
 
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
-}
+    batch.pieces = pieces;
+    batch.count = (unsigned int) piece_count;
+    batch.decoding = OSWRAPPER_AUDIO_RESULT_SUCCESS;
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
-    IStream* memory_stream = SHCreateMemStream(data, (UINT) data_size);
+    if (piece_count > 0) {
+        oswrapper_audio__batch_run(&batch, thread_handles, threads > piece_count ? (unsigned int) piece_count : threads);
+    }
 
-    if (memory_stream != NULL) {
-        HRESULT result;
-        IMFByteStream* byte_stream = NULL;
-        result = MFCreateMFByteStreamOnStream(memory_stream, &byte_stream);
+    if (thread_handles != NULL) {
+        oswrapper_audio__free(spec_hint->allocator, thread_handles);
+    }
 
-        if (SUCCEEDED(result)) {
-            IMFSourceReader* reader = NULL;
-            result = MFCreateSourceReaderFromByteStream(byte_stream, NULL, &reader);
+    for (i = 0; i < piece_count; i += split) {
+        oswrapper_audio__batch_piece* piece = &pieces[i];
+        OSWrapper_audio_batch_result* result = &results[piece->index];
+        OSWRAPPER_AUDIO_RESULT_TYPE pieces_decoded = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        unsigned int j;
+        split = piece->split;
 
-            if (SUCCEEDED(result)) {
-                return oswrapper_audio__load_from_reader(reader, byte_stream, memory_stream, audio);
+        for (j = 0; j < split; j++) {
+            if (!pieces[i + j].decoded) {
+                pieces_decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
             }
+        }
 
-            IMFByteStream_Release(byte_stream);
+        /* Frames which fail to decode move the frames after them, so a damaged file is decoded again from start to end on this thread */
+        if (split > 1 && !pieces_decoded) {
+            piece->split = 1;
+            piece->first_frame = 0;
+            piece->frames = result->frames;
+            oswrapper_audio__batch_decode(&batch, piece);
         }
 
-        IStream_Release(memory_stream);
+        if (piece->split == 1) {
+            result->decoded = piece->decoded;
+            result->frames = piece->frames;
+        }
     }
 
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
-}
-
-#ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio) {
-    HRESULT result;
-    /* TODO Ugly hack */
-    wchar_t path_buffer[OSWRAPPER_AUDIO_PATH_MAX];
-    result = MultiByteToWideChar(CP_UTF8, 0, path, -1, path_buffer, OSWRAPPER_AUDIO_PATH_MAX);
-
-    if (SUCCEEDED(result)) {
-        IMFSourceReader* reader = NULL;
-        result = MFCreateSourceReaderFromURL(path_buffer, NULL, &reader);
+    oswrapper_audio__free(spec_hint->allocator, pieces);
 
-        if (SUCCEEDED(result)) {
-            return oswrapper_audio__load_from_reader(reader, NULL, NULL, audio);
+    for (i = 0; i < count; i++) {
+        if (!results[i].decoded) {
+            all_decoded = OSWRAPPER_AUDIO_RESULT_FAILURE;
         }
     }
 
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
-}
-#endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
-
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
-/* Unstable-ish API */
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos) {
-    /* TODO Unimplemented
-      oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
-
-      if (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_FAILURE) {
-          / * IMFSourceReader methods can no longer be called * /
-          return OSWRAPPER_AUDIO_RESULT_FAILURE;
-      }
-      */
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    return all_decoded;
 }
 
-OSWRAPPER_AUDIO_DEF void oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
-    oswrapper_audio__internal_data_win* internal_data;
-    HRESULT result;
-    PROPVARIANT pos_propvariant = { 0 };
-    internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_free_batch(OSWrapper_audio_batch_result* results, size_t count) {
+    size_t i;
 
-    if (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_FAILURE) {
-        /* IMFSourceReader methods can no longer be called */
-        return;
+    if (count > 0 && results[0].samples != NULL) {
+        oswrapper_audio__free(results[0].spec.allocator, results[0].samples);
     }
 
-    result = S_OK;
-    pos_propvariant.vt = VT_I8;
-    pos_propvariant.hVal.QuadPart = pos;
-#ifdef __cplusplus
-    IMFSourceReader_SetCurrentPosition(internal_data->reader, GUID_NULL, pos_propvariant);
-#else
-    IMFSourceReader_SetCurrentPosition(internal_data->reader, &GUID_NULL, &pos_propvariant);
-#endif
-    PropVariantClear(&pos_propvariant);
-    /* Reset buffer positions */
-    internal_data->internal_buffer_remaining = 0;
-    internal_data->internal_buffer_pos = 0;
+    for (i = 0; i < count; i++) {
+        results[i].samples = NULL;
+        results[i].frames = 0;
+    }
 }
-#endif /* OSWRAPPER_AUDIO_EXPERIMENTAL */
+/* End shared batch decoding */
+#endif /* OSWRAPPER_AUDIO_USE_THREADS */
+
+#ifdef OSWRAPPER_AUDIO_USE_MINIAUDIO_DATA_SOURCE
+/* Start shared miniaudio data source */
+static ma_result oswrapper_audio__ma_data_source_read(ma_data_source* ds, void* frames_out, ma_uint64 frame_count, ma_uint64* frames_read) {
+    OSWrapper_audio_ma_data_source* data_source = (OSWrapper_audio_ma_data_source*) ds;
+    OSWrapper_audio_spec* audio = data_source->audio;
+    size_t frame_size = (audio->bits_per_channel / 8) * audio->channel_count;
+    ma_uint64 frames_done = 0;
+
+    while (frames_done < frame_count) {
+        ma_uint64 frames_left = frame_count - frames_done;
+        size_t frames_requested = frames_left > (ma_uint64) ((size_t) -1 / frame_size) ? (size_t) -1 / frame_size : (size_t) frames_left;
+        size_t this_iter = oswrapper_audio_get_samples(audio, (short*) ((unsigned char*) frames_out + ((size_t) frames_done * frame_size)), frames_requested);
+
+        if (this_iter == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            /* Frames from a push decoder haven't arrived yet */
+            *frames_read = frames_done;
+            return frames_done == 0 ? MA_BUSY : MA_SUCCESS;
+        }
 
-OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio) {
-    oswrapper_audio__internal_data_win* internal_data;
-    HRESULT result;
-    PROPVARIANT pos_propvariant = { 0 };
-    internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
+        if (this_iter == 0) {
+            break;
+        }
 
-    if (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_FAILURE) {
-        /* IMFSourceReader methods can no longer be called */
-        return;
+        frames_done += this_iter;
     }
 
-    result = S_OK;
-    pos_propvariant.vt = VT_I8;
-    pos_propvariant.hVal.QuadPart = 0;
-#ifdef __cplusplus
-    IMFSourceReader_SetCurrentPosition(internal_data->reader, GUID_NULL, pos_propvariant);
-#else
-    IMFSourceReader_SetCurrentPosition(internal_data->reader, &GUID_NULL, &pos_propvariant);
-#endif
-    PropVariantClear(&pos_propvariant);
-    /* Reset buffer positions */
-    internal_data->internal_buffer_remaining = 0;
-    internal_data->internal_buffer_pos = 0;
+    *frames_read = frames_done;
+    return frames_done == 0 ? MA_AT_END : MA_SUCCESS;
 }
 
-OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do) {
-    size_t frame_size;
-    size_t frames_done;
-    oswrapper_audio__internal_data_win* internal_data = (oswrapper_audio__internal_data_win*) audio->internal_data;
-    frame_size = (audio->bits_per_channel / 8) * audio->channel_count;
-    frames_to_do = frames_to_do * frame_size / sizeof(short);
-    frames_done = 0;
-
-    /* Copy any previous excess frames from the internal buffer */
-    if (internal_data->internal_buffer_remaining > 0) {
-        size_t copied_sample_data_size = internal_data->internal_buffer_remaining < frames_to_do ? internal_data->internal_buffer_remaining : frames_to_do;
-        OSWRAPPER_AUDIO_MEMCPY(buffer, internal_data->internal_buffer + internal_data->internal_buffer_pos, copied_sample_data_size * (sizeof internal_data->internal_buffer[0]));
-        internal_data->internal_buffer_remaining -= copied_sample_data_size;
-        internal_data->internal_buffer_pos += copied_sample_data_size;
-        frames_done = copied_sample_data_size;
-    }
+static ma_result oswrapper_audio__ma_data_source_seek(ma_data_source* ds, ma_uint64 frame_index) {
+    OSWrapper_audio_ma_data_source* data_source = (OSWrapper_audio_ma_data_source*) ds;
+    return oswrapper_audio_seek(data_source->audio, (OSWRAPPER_AUDIO_SEEK_TYPE) frame_index) ? MA_SUCCESS : MA_BAD_SEEK;
+}
 
-    /* Get new samples */
-    while (frames_to_do > frames_done) {
-        size_t new_target_frames = 0;
+static ma_result oswrapper_audio__ma_data_source_get_data_format(ma_data_source* ds, ma_format* format, ma_uint32* channels, ma_uint32* sample_rate, ma_channel* channel_map, size_t channel_map_cap) {
+    OSWrapper_audio_ma_data_source* data_source = (OSWrapper_audio_ma_data_source*) ds;
+    *format = data_source->format;
+    *channels = data_source->audio->channel_count;
+    *sample_rate = (ma_uint32) data_source->audio->sample_rate;
+    ma_channel_map_init_standard(ma_standard_channel_map_default, channel_map, channel_map_cap, data_source->audio->channel_count);
+    return MA_SUCCESS;
+}
 
-        /* Check if IMFSourceReader methods can still be called */
-        if (internal_data->no_reader_error == OSWRAPPER_AUDIO_RESULT_SUCCESS) {
-            IMFSample* sample;
-            DWORD flags;
-            HRESULT result;
-            sample = NULL;
-            result = IMFSourceReader_ReadSample(internal_data->reader, (DWORD) MF_SOURCE_READER_FIRST_AUDIO_STREAM, 0, NULL, &flags, NULL, &sample);
+static ma_result oswrapper_audio__ma_data_source_get_cursor(ma_data_source* ds, ma_uint64* cursor) {
+    OSWrapper_audio_ma_data_source* data_source = (OSWrapper_audio_ma_data_source*) ds;
+    OSWRAPPER_AUDIO_SEEK_TYPE pos = 0;
 
-            if (SUCCEEDED(result)) {
-                /* TODO handle more flags */
-                if (flags & MF_SOURCE_READERF_ERROR) {
-                    /* IMFSourceReader methods can no longer be called */
-                    internal_data->no_reader_error = OSWRAPPER_AUDIO_RESULT_FAILURE;
-                } else if ((flags & MF_SOURCE_READERF_ENDOFSTREAM) || (flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED) || (sample == NULL)) {
-                    /* TODO handle these more gracefully */
-                } else {
-                    IMFMediaBuffer* media_buffer;
-                    result = IMFSample_ConvertToContiguousBuffer(sample, &media_buffer);
+    if (!oswrapper_audio_get_pos(data_source->audio, &pos)) {
+        *cursor = 0;
+        return MA_ERROR;
+    }
 
-                    if (SUCCEEDED(result)) {
-                        DWORD current_length;
-                        BYTE* sample_audio_data = NULL;
-                        result = IMFMediaBuffer_Lock(media_buffer, &sample_audio_data, NULL, &current_length);
+    *cursor = (ma_uint64) pos;
+    return MA_SUCCESS;
+}
 
-                        if (SUCCEEDED(result)) {
-                            size_t new_target_size;
-                            new_target_frames = current_length / sizeof(short);
-                            new_target_size = frames_done + new_target_frames;
+static ma_result oswrapper_audio__ma_data_source_get_length(ma_data_source* ds, ma_uint64* length) {
+    OSWrapper_audio_ma_data_source* data_source = (OSWrapper_audio_ma_data_source*) ds;
+    OSWRAPPER_AUDIO_SEEK_TYPE frames = 0;
 
-                            /* If the size of the decoded sample would exceed the remaining buffer size,
-                               store the excess frames in the internal buffer */
-                            if (new_target_size > frames_to_do) {
-                                size_t remaining_sample_data_size = new_target_size - frames_to_do;
-                                /* Prevent copying more data to the output buffer than requested */
-                                new_target_frames -= remaining_sample_data_size;
-                                current_length = (DWORD) new_target_frames * sizeof(short);
+    if (oswrapper_audio_get_length(data_source->audio, &frames) == OSWRAPPER_AUDIO_LENGTH_UNKNOWN) {
+        *length = 0;
+        return MA_NOT_IMPLEMENTED;
+    }
 
-                                /* Is the internal buffer large enough to store the excess frames? */
-                                if (internal_data->internal_buffer_size < remaining_sample_data_size) {
-                                    /* Try to allocate enough memory to store the excess frames */
-                                    short* realloc_buffer = (short*) OSWRAPPER_AUDIO_MALLOC(remaining_sample_data_size * sizeof(short));
+    *length = (ma_uint64) frames;
+    return MA_SUCCESS;
+}
 
-                                    if (realloc_buffer != NULL) {
-                                        /* Free old buffer */
-                                        OSWRAPPER_AUDIO_FREE(internal_data->internal_buffer);
-                                        /* Replace old buffer with new buffer */
-                                        internal_data->internal_buffer = realloc_buffer;
-                                        internal_data->internal_buffer_size = remaining_sample_data_size;
-                                    } else {
-                                        /* If we can't allocate more memory, some excess frames will be lost.
-                                           This is unlikely, and mostly harmless. */
-                                        remaining_sample_data_size = internal_data->internal_buffer_size;
-                                    }
-                                }
+static ma_data_source_vtable oswrapper_audio__ma_data_source_vtable = {
+    oswrapper_audio__ma_data_source_read,
+    oswrapper_audio__ma_data_source_seek,
+    oswrapper_audio__ma_data_source_get_data_format,
+    oswrapper_audio__ma_data_source_get_cursor,
+    oswrapper_audio__ma_data_source_get_length,
+    NULL,
+    0
+};
+
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_ma_data_source_init(OSWrapper_audio_spec* audio, OSWrapper_audio_ma_data_source* data_source) {
+    ma_data_source_config config;
+    unsigned short byte_order_check = 1;
+    OSWrapper_audio_endianness_type system_endianness = *((unsigned char*) &byte_order_check) == 1 ? OSWRAPPER_AUDIO_ENDIANNESS_LITTLE : OSWRAPPER_AUDIO_ENDIANNESS_BIG;
+    data_source->audio = NULL;
+    data_source->format = ma_format_unknown;
+
+    if (audio->channel_count == 0) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
 
-                                /* Copy as many excess frames as we have space for */
-                                internal_data->internal_buffer_remaining = remaining_sample_data_size;
-                                internal_data->internal_buffer_pos = 0;
+    /* miniaudio only uses the system byte order */
+    if (audio->bits_per_channel > 8 && audio->endianness_type != OSWRAPPER_AUDIO_ENDIANNESS_USE_SYSTEM_DEFAULT && audio->endianness_type != system_endianness) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
 
-                                if (remaining_sample_data_size > 0) {
-                                    OSWRAPPER_AUDIO_MEMCPY((BYTE*)(internal_data->internal_buffer), sample_audio_data + current_length, remaining_sample_data_size * sizeof(short));
-                                }
-                            }
+    if (audio->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
+        if (audio->bits_per_channel != 32) {
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
+        }
 
-                            /* Copy decoded sample data to buffer, minus excess frames */
-                            if (new_target_frames > 0) {
-                                OSWRAPPER_AUDIO_MEMCPY((BYTE*)(buffer + frames_done), sample_audio_data, current_length);
-                            }
+        data_source->format = ma_format_f32;
+    } else {
+        /* 8 bit PCM isn't supported, as miniaudio uses unsigned 8 bit samples */
+        switch (audio->bits_per_channel) {
+        case 16:
+            data_source->format = ma_format_s16;
+            break;
 
-                            /* result = */ IMFMediaBuffer_Unlock(media_buffer);
-                            /* TODO I'm not sure there's any way to handle this?
-                            if (FAILED(result)) {
-                                ...some code?
-                            }*/
-                        }
+        case 24:
+            data_source->format = ma_format_s24;
+            break;
 
-                        IMFMediaBuffer_Release(media_buffer);
-                    }
-                }
-            }
+        case 32:
+            data_source->format = ma_format_s32;
+            break;
 
-            /* May be non-null even on failure */
-            if (sample != NULL) {
-                IMFSample_Release(sample);
-            }
+        default:
+            return OSWRAPPER_AUDIO_RESULT_FAILURE;
         }
+    }
 
-        if (new_target_frames == 0) {
-            /* Break the loop */
-            break;
-        } else {
-            frames_done += new_target_frames;
-        }
+    config = ma_data_source_config_init();
+    config.vtable = &oswrapper_audio__ma_data_source_vtable;
+
+    if (ma_data_source_init(&config, &data_source->base) != MA_SUCCESS) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
     }
 
-    return frames_done * sizeof(short) / frame_size;
-}
-/* End Win32 MF implementation */
-#else
-/* No audio loader implementation */
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_init(void) {
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    data_source->audio = audio;
+    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
 }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_uninit(void) {
-    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+OSWRAPPER_AUDIO_DEF void oswrapper_audio_ma_data_source_uninit(OSWrapper_audio_ma_data_source* data_source) {
+    ma_data_source_uninit(&data_source->base);
+    data_source->audio = NULL;
+}
+/* End shared miniaudio data source */
+#endif /* OSWRAPPER_AUDIO_USE_MINIAUDIO_DATA_SOURCE */
+
+/* Start shared probe implementation */
+static void oswrapper_audio__info_from_source(const oswrapper_audio__source_info* source, OSWrapper_audio_info* info) {
+    info->sample_rate = source->sample_rate;
+    info->channel_count = source->channel_count;
+    /* Companded samples count as compressed */
+    info->bits_per_channel = source->codec == OSWRAPPER_AUDIO__CODEC_ULAW || source->codec == OSWRAPPER_AUDIO__CODEC_ALAW || source->codec == OSWRAPPER_AUDIO__CODEC_IMA4 || source->codec == OSWRAPPER_AUDIO__CODEC_FLAC || source->codec == OSWRAPPER_AUDIO__CODEC_ALAC ? 0 : source->bits_per_channel;
+    info->audio_type = source->codec == OSWRAPPER_AUDIO__CODEC_PCM_FLOAT ? OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT : OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    info->endianness_type = source->big_endian ? OSWRAPPER_AUDIO_ENDIANNESS_BIG : OSWRAPPER_AUDIO_ENDIANNESS_LITTLE;
+    info->total_frames = (OSWRAPPER_AUDIO_SEEK_TYPE) source->total_frames;
 }
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_free_context(OSWrapper_audio_spec* audio) {
-    return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+#ifndef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+/* Fall back to loading the file with the platform decoder for formats the header parser doesn't understand */
+static void oswrapper_audio__info_from_spec(OSWrapper_audio_spec* audio, OSWrapper_audio_info* info) {
+    info->sample_rate = audio->sample_rate;
+    info->channel_count = audio->channel_count;
+    info->bits_per_channel = audio->bits_per_channel;
+    info->audio_type = audio->audio_type;
+    info->endianness_type = audio->endianness_type;
+    info->total_frames = -1;
+    oswrapper_audio_free_context(audio);
 }
+#endif
 
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_memory(const unsigned char* data, size_t data_size, OSWrapper_audio_spec* audio) {
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_probe(const unsigned char* data, size_t data_size, OSWrapper_audio_info* info) {
+    oswrapper_audio__source_info source;
+    oswrapper_audio__reader reader;
+#ifndef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+    OSWrapper_audio_spec audio;
+#endif
+    oswrapper_audio__reader_init_memory(&reader, data, data_size);
+
+    if (oswrapper_audio__parse_header(&reader, &source)) {
+        oswrapper_audio__info_from_source(&source, info);
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+#ifndef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+    audio.internal_data = NULL;
+    audio.sample_rate = 0;
+    audio.channel_count = 0;
+    audio.bits_per_channel = 0;
+    audio.audio_type = OSWRAPPER_AUDIO_FORMAT_NOT_SET;
+    audio.endianness_type = OSWRAPPER_AUDIO_ENDIANNESS_USE_SYSTEM_DEFAULT;
+    audio.resample_quality = OSWRAPPER_AUDIO_RESAMPLE_QUALITY_DEFAULT;
+    audio.channel_matrix = NULL;
+    audio.allocator = NULL;
+
+    if (oswrapper_audio_load_from_memory(data, data_size, &audio)) {
+        oswrapper_audio__info_from_spec(&audio, info);
+        return OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+#endif
     return OSWRAPPER_AUDIO_RESULT_FAILURE;
 }
 
 #ifndef OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_load_from_path(const char* path, OSWrapper_audio_spec* audio) {
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_probe_path(const char* path, OSWrapper_audio_info* info) {
+    OSWRAPPER_AUDIO_RESULT_TYPE result = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    oswrapper_audio__source_info source;
+    oswrapper_audio__reader reader;
+#ifndef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+    OSWrapper_audio_spec audio;
+#endif
+
+    if (oswrapper_audio__reader_init_path(&reader, path, NULL)) {
+        if (oswrapper_audio__parse_header(&reader, &source)) {
+            oswrapper_audio__info_from_source(&source, info);
+            result = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+
+        oswrapper_audio__reader_uninit(&reader);
+    }
+
+#ifndef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+
+    if (!result) {
+        audio.internal_data = NULL;
+        audio.sample_rate = 0;
+        audio.channel_count = 0;
+        audio.bits_per_channel = 0;
+        audio.audio_type = OSWRAPPER_AUDIO_FORMAT_NOT_SET;
+        audio.endianness_type = OSWRAPPER_AUDIO_ENDIANNESS_USE_SYSTEM_DEFAULT;
+        audio.resample_quality = OSWRAPPER_AUDIO_RESAMPLE_QUALITY_DEFAULT;
+        audio.channel_matrix = NULL;
+        audio.allocator = NULL;
+
+        if (oswrapper_audio_load_from_path(path, &audio)) {
+            oswrapper_audio__info_from_spec(&audio, info);
+            result = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
+
+#endif
+    return result;
 }
 #endif /* OSWRAPPER_AUDIO_NO_LOAD_FROM_PATH */
 
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
-/* Unstable-ish API */
-OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_get_pos(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE* pos) {
-    return OSWRAPPER_AUDIO_RESULT_FAILURE;
-}
+OSWRAPPER_AUDIO_DEF OSWRAPPER_AUDIO_RESULT_TYPE oswrapper_audio_probe_callbacks(OSWrapper_audio_read_callback read, OSWrapper_audio_seek_callback seek, OSWrapper_audio_tell_callback tell, void* user_data, OSWrapper_audio_info* info) {
+    OSWRAPPER_AUDIO_RESULT_TYPE result = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    oswrapper_audio__callbacks callbacks;
+    oswrapper_audio__source_info source;
+    oswrapper_audio__reader reader;
+#ifndef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+    OSWrapper_audio_spec audio;
+#endif
 
-OSWRAPPER_AUDIO_DEF void oswrapper_audio_seek(OSWrapper_audio_spec* audio, OSWRAPPER_AUDIO_SEEK_TYPE pos) {
-    /* Nothing */
-}
-#endif /* OSWRAPPER_AUDIO_EXPERIMENTAL */
+    if (!oswrapper_audio__callbacks_init(&callbacks, read, seek, tell, user_data)) {
+        return OSWRAPPER_AUDIO_RESULT_FAILURE;
+    }
 
-OSWRAPPER_AUDIO_DEF void oswrapper_audio_rewind(OSWrapper_audio_spec* audio) {
-    /* Nothing */
-}
+    if (oswrapper_audio__reader_init_callbacks(&reader, &callbacks, NULL) && oswrapper_audio__parse_header(&reader, &source)) {
+        oswrapper_audio__info_from_source(&source, info);
+        result = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+    }
+
+    oswrapper_audio__reader_uninit(&reader);
+#ifndef OSWRAPPER_AUDIO_USE_PORTABLE_IMPL
+
+    if (!result) {
+        audio.internal_data = NULL;
+        audio.sample_rate = 0;
+        audio.channel_count = 0;
+        audio.bits_per_channel = 0;
+        audio.audio_type = OSWRAPPER_AUDIO_FORMAT_NOT_SET;
+        audio.endianness_type = OSWRAPPER_AUDIO_ENDIANNESS_USE_SYSTEM_DEFAULT;
+        audio.resample_quality = OSWRAPPER_AUDIO_RESAMPLE_QUALITY_DEFAULT;
+        audio.channel_matrix = NULL;
+        audio.allocator = NULL;
+
+        if (oswrapper_audio_load_from_callbacks(read, seek, tell, user_data, &audio)) {
+            oswrapper_audio__info_from_spec(&audio, info);
+            result = OSWRAPPER_AUDIO_RESULT_SUCCESS;
+        }
+    }
 
-OSWRAPPER_AUDIO_DEF size_t oswrapper_audio_get_samples(OSWrapper_audio_spec* audio, short* buffer, size_t frames_to_do) {
-    return 0;
-}
-/* End no audio loader implementation */
 #endif
+    return result;
+}
+/* End shared probe implementation */
 #endif /* OSWRAPPER_AUDIO_IMPLEMENTATION */
 #endif /* OSWRAPPER_INCLUDE_OSWRAPPER_AUDIO_H */
 
@@ -184,21 +184,15 @@ int main(int argc, char** argv) {
     }
 
     pthread_mutex_unlock(&pthread_mutex);
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
     /* Print current location for test purposes */
     OSWRAPPER_AUDIO_SEEK_TYPE pos = 0;
     int didGetPos = oswrapper_audio_get_pos(audio_spec, &pos);
     FAIL_WITH_MESSAGE_ON_COND((!didGetPos), "Failed to get current position!");
     printf("End of sound position was %lli\n", pos);
-#endif
     /* Replay sound */
     AudioOutputUnitStop(audio_unit);
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
     /* For testing purposes. Equivalent to oswrapper_audio_rewind */
-    oswrapper_audio_seek(audio_spec, 0);
-#else
-    oswrapper_audio_rewind(audio_spec);
-#endif
+    FAIL_WITH_MESSAGE_ON_COND((!oswrapper_audio_seek(audio_spec, 0)), "Failed to seek to the start!");
     audio_done = 0;
     AudioOutputUnitStart(audio_unit);
     puts("Playing sound again...");
@@ -9,9 +9,6 @@ The latest version of this file can be found at
 https://github.com/NeRdTheNed/OSWrapper/blob/main/test/demo_oswrapper_audio_miniaudio.c
 */
 
-#define OSWRAPPER_AUDIO_IMPLEMENTATION
-#include "oswrapper_audio.h"
-
 #define MA_NO_DECODING
 #define MA_NO_ENCODING
 #define MA_NO_RESOURCE_MANAGER
@@ -21,6 +18,10 @@ https://github.com/NeRdTheNed/OSWrapper/blob/main/test/demo_oswrapper_audio_mini
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
 
+#define OSWRAPPER_AUDIO_USE_MINIAUDIO_DATA_SOURCE
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
 #include <objbase.h>
 #pragma comment(lib, "mfplat.lib")
@@ -46,20 +47,43 @@ https://github.com/NeRdTheNed/OSWrapper/blob/main/test/demo_oswrapper_audio_mini
 #endif
 
 static ma_event stop_audio_cond;
+/* The amount of times left to play the sound */
+static int plays_left = 2;
 
 #define FAIL_WITH_MESSAGE_ON_COND(cond, message) if ((cond)) { puts(message); return EXIT_FAILURE; }
 #define EXIT_WITH_MESSAGE_ON_COND(cond, message) if ((cond)) { puts(message); exit(EXIT_FAILURE); }
 
 static void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
-    OSWrapper_audio_spec* audio_spec = (OSWrapper_audio_spec*)pDevice->pUserData;
+    ma_data_source* data_source = (ma_data_source*)pDevice->pUserData;
+    ma_uint32 frame_size = ma_get_bytes_per_frame(pDevice->playback.format, pDevice->playback.channels);
+    ma_uint64 frames_done = 0;
 
-    if (audio_spec == NULL) {
+    if (data_source == NULL) {
         EXIT_WITH_MESSAGE_ON_COND((ma_event_signal(&stop_audio_cond) != MA_SUCCESS), "Could not send signal to main thread!");
         return;
     }
 
-    if (oswrapper_audio_get_samples(audio_spec, (short*) pOutput, frameCount) == 0) {
-        EXIT_WITH_MESSAGE_ON_COND((ma_event_signal(&stop_audio_cond) != MA_SUCCESS), "Could not send signal to main thread!");
+    /* miniaudio reads straight from the audio context into the output buffer */
+    while (frames_done < frameCount) {
+        ma_uint64 this_iter = 0;
+        ma_data_source_read_pcm_frames(data_source, (ma_uint8*) pOutput + (frames_done * frame_size), frameCount - frames_done, &this_iter);
+        frames_done += this_iter;
+
+        if (this_iter == 0) {
+            if (plays_left > 1) {
+                /* Replay sound, without stopping the device */
+                plays_left--;
+                EXIT_WITH_MESSAGE_ON_COND((ma_data_source_seek_to_pcm_frame(data_source, 0) != MA_SUCCESS), "Failed to seek to the start!");
+            } else {
+                /* The rest of the output buffer is already silent */
+                if (plays_left == 1) {
+                    plays_left = 0;
+                    EXIT_WITH_MESSAGE_ON_COND((ma_event_signal(&stop_audio_cond) != MA_SUCCESS), "Could not send signal to main thread!");
+                }
+
+                break;
+            }
+        }
     }
 
     (void)pInput;
@@ -86,40 +110,23 @@ int main(int argc, char** argv) {
     int did_load_audio = oswrapper_audio_load_from_path(argc < 2 ? "noise.wav" : argv[argc - 1], audio_spec);
     FAIL_WITH_MESSAGE_ON_COND((did_load_audio == 0), "oswrapper_audio_load_from_path failed!");
     /* audio_spec now contains the output format values. */
-    /* miniaudio: Find a suitable output format */
+    /* Wrap the audio context as a miniaudio data source.
+    The output format must be 16, 24, or 32 bit integer PCM, or 32 bit floating point PCM. */
+    OSWrapper_audio_ma_data_source data_source;
+    FAIL_WITH_MESSAGE_ON_COND((!oswrapper_audio_ma_data_source_init(audio_spec, &data_source)), "No suitable output format for miniaudio!");
+    /* miniaudio: Find the output format */
     ma_format format;
-
-    if (audio_spec->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
-        FAIL_WITH_MESSAGE_ON_COND((audio_spec->bits_per_channel != 32), "Only 32 bit floating point PCM is supported with miniaudio!");
-        format = ma_format_f32;
-    } else {
-        switch (audio_spec->bits_per_channel) {
-        case 32:
-            format = ma_format_s32;
-            break;
-
-        case 24:
-            format = ma_format_s24;
-            break;
-
-        case 16:
-            format = ma_format_s16;
-            break;
-
-        default:
-            puts("No suitable output format for miniaudio!");
-            return EXIT_FAILURE;
-        }
-    }
-
+    ma_uint32 channels;
+    ma_uint32 sample_rate;
+    FAIL_WITH_MESSAGE_ON_COND((ma_data_source_get_data_format(&data_source, &format, &channels, &sample_rate, NULL, 0) != MA_SUCCESS), "Failed to get the data source format!");
     /* miniaudio: Create a suitable device config */
     ma_device_config device_config;
     device_config = ma_device_config_init(ma_device_type_playback);
     device_config.playback.format   = format;
-    device_config.playback.channels = audio_spec->channel_count;
-    device_config.sampleRate        = audio_spec->sample_rate;
+    device_config.playback.channels = channels;
+    device_config.sampleRate        = sample_rate;
     device_config.dataCallback      = data_callback;
-    device_config.pUserData         = audio_spec;
+    device_config.pUserData         = &data_source;
     /* miniaudio: Initialise the device */
     ma_device device;
     FAIL_WITH_MESSAGE_ON_COND((ma_device_init(NULL, &device_config, &device) != MA_SUCCESS), "Failed to open miniaudio playback device!");
@@ -127,31 +134,18 @@ int main(int argc, char** argv) {
     FAIL_WITH_MESSAGE_ON_COND((ma_event_init(&stop_audio_cond) != MA_SUCCESS), "Failed to initialise miniaudio event!");
     /* miniaudio: Start the device */
     FAIL_WITH_MESSAGE_ON_COND((ma_device_start(&device) != MA_SUCCESS), "Failed to start miniaudio playback device!");
-    /* Wait until audio playback is done */
-    puts("Playing sound...");
+    /* Wait until audio playback is done. The sound is rewound from the data callback when it ends the first time. */
+    puts("Playing sound twice...");
     ma_event_wait(&stop_audio_cond);
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
+    puts("Finished playing sound!");
+    /* Cleanup */
+    ma_device_uninit(&device);
     /* Print current location for test purposes */
     OSWRAPPER_AUDIO_SEEK_TYPE pos = 0;
     int didGetPos = oswrapper_audio_get_pos(audio_spec, &pos);
     FAIL_WITH_MESSAGE_ON_COND((!didGetPos), "Failed to get current position!");
     printf("End of sound position was %lli\n", pos);
-#endif
-    /* Replay sound */
-    ma_device_stop(&device);
-#ifdef OSWRAPPER_AUDIO_EXPERIMENTAL
-    /* For testing purposes. Equivalent to oswrapper_audio_rewind */
-    oswrapper_audio_seek(audio_spec, 0);
-#else
-    oswrapper_audio_rewind(audio_spec);
-#endif
-    FAIL_WITH_MESSAGE_ON_COND((ma_event_init(&stop_audio_cond) != MA_SUCCESS), "Failed to reinitialise miniaudio event!");
-    FAIL_WITH_MESSAGE_ON_COND((ma_device_start(&device) != MA_SUCCESS), "Failed to restart miniaudio playback device!");
-    puts("Playing sound again...");
-    ma_event_wait(&stop_audio_cond);
-    puts("Finished playing sound!");
-    /* Cleanup */
-    ma_device_uninit(&device);
+    oswrapper_audio_ma_data_source_uninit(&data_source);
     /* Free audio file */
     int did_close = oswrapper_audio_free_context(audio_spec);
     FAIL_WITH_MESSAGE_ON_COND((!did_close), "Failed to free sound context!");
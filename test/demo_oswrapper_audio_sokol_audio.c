@@ -1,6 +1,8 @@
 /*
 This program uses oswrapper_audio to decode and play an audio file twice,
 using sokol_audio for sound output.
+The audio is decoded ahead of time on a worker thread by an OSWrapper_audio_stream,
+which sokol_audio's audio thread reads from without waiting for the decoder.
 
 Usage: demo_oswrapper_audio_sokol_audio (audio_file.ext)
 If no input is provided, it will play the file named noise.wav in this folder.
@@ -9,6 +11,7 @@ The latest version of this file can be found at
 https://github.com/NeRdTheNed/OSWrapper/blob/main/test/demo_oswrapper_audio_sokol_audio.c
 */
 
+#define OSWRAPPER_AUDIO_USE_THREADS
 #define OSWRAPPER_AUDIO_IMPLEMENTATION
 #include "oswrapper_audio.h"
 
@@ -47,11 +50,20 @@ https://github.com/NeRdTheNed/OSWrapper/blob/main/test/demo_oswrapper_audio_soko
 #define ENDIANNESS_TYPE OSWRAPPER_AUDIO_ENDIANNESS_LITTLE
 #endif
 
-#define FLOAT_BUFFER_SIZE 0x4000
+/* The size of the stream's ring buffer, in frames */
+#define STREAM_BUFFER_FRAMES 0x4000
 #define SLEEP_TIME 100
 
 #define FAIL_WITH_MESSAGE_ON_COND(cond, message) if ((cond)) { puts(message); return EXIT_FAILURE; }
 
+/* sokol_audio: Called on the audio thread, which must never wait for the decoder */
+static void stream_callback(float* buffer, int num_frames, int num_channels, void* user_data) {
+    OSWrapper_audio_stream* stream = (OSWrapper_audio_stream*) user_data;
+    size_t frames_read = oswrapper_audio_stream_read(stream, buffer, (size_t) num_frames);
+    /* Fill any frames which weren't decoded in time with silence */
+    memset(buffer + (frames_read * num_channels), 0, ((size_t) num_frames - frames_read) * num_channels * sizeof(float));
+}
+
 int main(int argc, char** argv) {
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
     FAIL_WITH_MESSAGE_ON_COND(FAILED(CoInitialize(NULL)), "CoInitialize failed!");
@@ -75,6 +87,9 @@ int main(int argc, char** argv) {
     /* audio_spec now contains the output format values. */
     /* sokol_audio: Assert that we're decoding to 32 bit float */
     FAIL_WITH_MESSAGE_ON_COND((audio_spec->audio_type != OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT || audio_spec->bits_per_channel != 32), "Only 32 bit floating point PCM is supported with sokol_audio!");
+    /* Decode the audio on a worker thread */
+    OSWrapper_audio_stream* stream = oswrapper_audio_stream_create(audio_spec, STREAM_BUFFER_FRAMES, false);
+    FAIL_WITH_MESSAGE_ON_COND((stream == NULL), "oswrapper_audio_stream_create failed!");
     /* sokol_audio: Create a suitable config */
 #ifdef __cplusplus
     saudio_desc format = { };
@@ -83,36 +98,30 @@ int main(int argc, char** argv) {
 #endif
     format.num_channels = audio_spec->channel_count;
     format.sample_rate = audio_spec->sample_rate;
+    format.stream_userdata_cb = stream_callback;
+    format.user_data = stream;
     /* sokol_audio: Initialise sokol_audio */
     saudio_setup(&format);
     FAIL_WITH_MESSAGE_ON_COND((saudio_isvalid() == false), "Failed to initialise sokol_audio!");
     FAIL_WITH_MESSAGE_ON_COND((saudio_sample_rate() != (int) audio_spec->sample_rate), "Output sample rate was not the same as requested sample rate!");
     FAIL_WITH_MESSAGE_ON_COND((saudio_channels() != (int) audio_spec->channel_count), "Output channel count was not the same as requested channel count!");
-    float float_buffer[FLOAT_BUFFER_SIZE];
     bool first_time = true;
     puts("Playing sound...");
 
-    /* sokol_audio: Push samples until the file has been decoded twice */
+    /* Wait until the file has been played twice */
     while (true) {
-        const int num_frames = saudio_expect();
-
-        if (num_frames > 0) {
-            FAIL_WITH_MESSAGE_ON_COND((saudio_sample_rate() != (int) audio_spec->sample_rate), "Output sample rate was not the same as requested sample rate!");
-            FAIL_WITH_MESSAGE_ON_COND((saudio_channels() != (int) audio_spec->channel_count), "Output channel count was not the same as requested channel count!");
-            const int num_samples = num_frames > (FLOAT_BUFFER_SIZE / saudio_channels()) ? FLOAT_BUFFER_SIZE / saudio_channels() : num_frames;
-            size_t decoded_samples = oswrapper_audio_get_samples(audio_spec, (short*) &float_buffer, num_samples);
-
-            if (decoded_samples == 0) {
-                if (first_time) {
-                    puts("Playing sound again...");
-                    oswrapper_audio_rewind(audio_spec);
-                    first_time = false;
-                } else {
-                    puts("Finished playing sound!");
-                    break;
-                }
+        OSWrapper_audio_stream_stats stats;
+        oswrapper_audio_stream_get_stats(stream, &stats);
+
+        if (stats.ended) {
+            if (first_time) {
+                puts("Playing sound again...");
+                /* Rewinding is done by the worker thread */
+                oswrapper_audio_stream_seek(stream, 0);
+                first_time = false;
             } else {
-                saudio_push(float_buffer, decoded_samples);
+                printf("Finished playing sound! The decoder fell behind %lu times.\n", stats.underruns);
+                break;
             }
         }
 
@@ -125,6 +134,7 @@ int main(int argc, char** argv) {
 
     /* Cleanup */
     saudio_shutdown();
+    oswrapper_audio_stream_destroy(stream);
     /* Free audio file */
     int did_close = oswrapper_audio_free_context(audio_spec);
     FAIL_WITH_MESSAGE_ON_COND((!did_close), "Failed to free sound context!");
@@ -10,6 +10,18 @@ The latest version of this file can be found at
 https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio.c
 */
 
+#ifdef OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL
+/* Decode audio with miniaudio instead of the OS audio decoders */
+#define MA_NO_DEVICE_IO
+#define MA_NO_ENCODING
+#define MA_NO_RESOURCE_MANAGER
+#define MA_NO_NODE_GRAPH
+#define MA_NO_ENGINE
+#define MA_NO_GENERATION
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+#endif
+
 #define OSWRAPPER_AUDIO_STATIC
 #define OSWRAPPER_AUDIO_IMPLEMENTATION
 #include "oswrapper_audio.h"
@@ -41,6 +53,22 @@ https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio.c
 
 #define TEST_PROGRAM_BUFFER_SIZE 0x50
 
+#ifdef LOAD_FROM_CALLBACKS
+/* Callbacks for reading the input file with stdio, to test oswrapper_audio_load_from_callbacks */
+static size_t test_read_callback(void* user_data, void* buffer, size_t bytes_to_read) {
+    return fread(buffer, 1, bytes_to_read, (FILE*) user_data);
+}
+
+static OSWRAPPER_AUDIO_RESULT_TYPE test_seek_callback(void* user_data, OSWRAPPER_AUDIO_SEEK_TYPE offset, OSWrapper_audio_seek_origin origin) {
+    int whence = origin == OSWRAPPER_AUDIO_SEEK_ORIGIN_END ? SEEK_END : origin == OSWRAPPER_AUDIO_SEEK_ORIGIN_CURRENT ? SEEK_CUR : SEEK_SET;
+    return fseek((FILE*) user_data, (long) offset, whence) == 0;
+}
+
+static OSWRAPPER_AUDIO_SEEK_TYPE test_tell_callback(void* user_data) {
+    return ftell((FILE*) user_data);
+}
+#endif
+
 /* Decodes a given audio file to raw PCM data */
 int main(int argc, char** argv) {
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
@@ -54,7 +82,11 @@ int main(int argc, char** argv) {
 #endif
     int returnVal = EXIT_FAILURE;
     FILE* output_file = NULL;
+#ifdef LOAD_FROM_CALLBACKS
+    FILE* input_file = NULL;
+#endif
     OSWrapper_audio_spec* audio_spec = NULL;
+    OSWrapper_audio_info info;
     char* output_path = NULL;
     short* buffer = NULL;
     const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
@@ -97,13 +129,35 @@ int main(int argc, char** argv) {
         goto exit;
     }
 
+#ifdef LOAD_FROM_CALLBACKS
+    input_file = fopen(path, "rb");
+
+    if (input_file == NULL) {
+        printf("Input file %s could not be opened for reading!\n", path);
+        goto exit;
+    }
+
+#endif
+
+    if (oswrapper_audio_probe_path(path, &info)) {
+        printf("Probed sample rate: %lu\nProbed channels: %d\nProbed bit depth: %d\nProbed length: %lld frames\n", info.sample_rate, info.channel_count, info.bits_per_channel, (long long) info.total_frames);
+    } else {
+        puts("Could not probe file, trying to load it anyway");
+    }
+
     audio_spec->sample_rate = SAMPLE_RATE;
     audio_spec->channel_count = CHANNEL_COUNT;
     audio_spec->bits_per_channel = BITS_PER_CHANNEL;
     audio_spec->audio_type = AUDIO_FORMAT;
     audio_spec->endianness_type = ENDIANNESS_TYPE;
 
+#ifdef LOAD_FROM_CALLBACKS
+
+    if (oswrapper_audio_load_from_callbacks(test_read_callback, test_seek_callback, test_tell_callback, input_file, audio_spec)) {
+#else
+
     if (oswrapper_audio_load_from_path(path, audio_spec)) {
+#endif
         printf("Path: %s\nOutput path: %s\nSample rate: %lu\nChannels: %d\nBit depth: %d\n", path, output_path, audio_spec->sample_rate, audio_spec->channel_count, audio_spec->bits_per_channel);
 
         if (audio_spec->audio_type == OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) {
@@ -118,6 +172,17 @@ int main(int argc, char** argv) {
             puts("Little-endian\n");
         }
 
+        OSWRAPPER_AUDIO_SEEK_TYPE length = 0;
+        OSWrapper_audio_length_type length_type = oswrapper_audio_get_length(audio_spec, &length);
+
+        if (length_type == OSWRAPPER_AUDIO_LENGTH_EXACT) {
+            printf("Length: %lld frames\n", (long long) length);
+        } else if (length_type == OSWRAPPER_AUDIO_LENGTH_ESTIMATED) {
+            printf("Estimated length: %lld frames\n", (long long) length);
+        } else {
+            puts("Unknown length");
+        }
+
         size_t frame_size = (audio_spec->bits_per_channel / 8) * (audio_spec->channel_count);
         buffer = (short*) calloc(TEST_PROGRAM_BUFFER_SIZE, frame_size);
         size_t frames_done = 0;
@@ -141,6 +206,38 @@ int main(int argc, char** argv) {
         fclose(output_file);
         output_file = NULL;
         printf("Decoded %zu frames of audio, with frame size %zu\n", frames_done, frame_size);
+
+        if (length_type == OSWRAPPER_AUDIO_LENGTH_EXACT && (OSWRAPPER_AUDIO_SEEK_TYPE) frames_done != length) {
+            puts("Decoded length did not match the exact length!");
+            goto audio_cleanup;
+        }
+
+        /* Seek to the middle of the file, and check that the rest of the file decodes to the expected length */
+        if (frames_done > 0) {
+            OSWRAPPER_AUDIO_SEEK_TYPE pos = 0;
+            size_t frames_after_seek = 0;
+
+            if (!oswrapper_audio_seek(audio_spec, (OSWRAPPER_AUDIO_SEEK_TYPE) (frames_done / 2)) || !oswrapper_audio_get_pos(audio_spec, &pos) || pos != (OSWRAPPER_AUDIO_SEEK_TYPE) (frames_done / 2)) {
+                puts("Could not seek to the middle of the file!");
+                goto audio_cleanup;
+            }
+
+            while (1) {
+                size_t this_iter = oswrapper_audio_get_samples(audio_spec, buffer, TEST_PROGRAM_BUFFER_SIZE);
+
+                if (this_iter == 0) {
+                    break;
+                }
+
+                frames_after_seek += this_iter;
+            }
+
+            if (frames_after_seek != frames_done - (frames_done / 2)) {
+                printf("Decoded %zu frames after seeking, expected %zu!\n", frames_after_seek, frames_done - (frames_done / 2));
+                goto audio_cleanup;
+            }
+        }
+
         returnVal = EXIT_SUCCESS;
 audio_cleanup:
 
@@ -166,6 +263,15 @@ exit:
         output_file = NULL;
     }
 
+#ifdef LOAD_FROM_CALLBACKS
+
+    if (input_file != NULL) {
+        fclose(input_file);
+        input_file = NULL;
+    }
+
+#endif
+
     if (audio_spec != NULL) {
         free(audio_spec);
         audio_spec = NULL;
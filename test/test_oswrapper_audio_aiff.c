@@ -0,0 +1,505 @@
+/*
+This program uses oswrapper_audio to decode AIFF and AIFC files with the portable decoder.
+An audio file is decoded to 16 bit stereo PCM, which is stored in AIFF and AIFC files in memory
+with a variety of sample formats, byte orders, and chunk layouts.
+Each file is decoded again, and checked against the samples it was made from.
+mu-law and A-law files are checked to decode every possible value correctly,
+and files with unsupported compression types are checked to fail.
+
+Usage: test_oswrapper_audio_aiff (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_aiff.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The amount of channels the test files have */
+#define TEST_PROGRAM_CHANNELS 2
+
+/* How the samples in a test file are stored */
+typedef enum {
+    TEST_FORMAT_TWOS_8 = 0,
+    TEST_FORMAT_TWOS_12,
+    TEST_FORMAT_TWOS_16,
+    TEST_FORMAT_TWOS_24,
+    TEST_FORMAT_TWOS_32,
+    TEST_FORMAT_SOWT_16,
+    TEST_FORMAT_SOWT_24,
+    TEST_FORMAT_RAW_8,
+    TEST_FORMAT_FL32,
+    TEST_FORMAT_FL64,
+    TEST_FORMAT_ULAW,
+    TEST_FORMAT_ALAW,
+    TEST_FORMAT_COUNT
+} test_format;
+
+typedef struct test_format_info {
+    const char* name;
+    /* NULL for AIFF files */
+    const char* compression;
+    /* The sample size written to the COMM chunk */
+    unsigned int bits;
+    /* The size of each stored sample in bytes */
+    unsigned int bytes;
+    int big_endian;
+} test_format_info;
+
+static const test_format_info test_formats[TEST_FORMAT_COUNT] = {
+    { "AIFF 8 bit", NULL, 8, 1, 1 },
+    { "AIFF 12 bit", NULL, 12, 2, 1 },
+    { "AIFF 16 bit", NULL, 16, 2, 1 },
+    { "AIFC twos 24 bit", "twos", 24, 3, 1 },
+    { "AIFC in32", "in32", 32, 4, 1 },
+    { "AIFC sowt 16 bit", "sowt", 16, 2, 0 },
+    { "AIFC sowt 24 bit", "sowt", 24, 3, 0 },
+    { "AIFC raw", "raw ", 8, 1, 0 },
+    { "AIFC fl32", "fl32", 32, 4, 1 },
+    { "AIFC FL64", "FL64", 64, 8, 1 },
+    { "AIFC ulaw", "ulaw", 16, 1, 0 },
+    { "AIFC alaw", "alaw", 16, 1, 0 }
+};
+
+/* Reads the whole file at the given path into memory */
+static unsigned char* read_file(const char* path, size_t* size) {
+    unsigned char* data = NULL;
+    long file_size;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char*) malloc((size_t) file_size);
+
+        if (data != NULL && fread(data, 1, (size_t) file_size, file) != (size_t) file_size) {
+            free(data);
+            data = NULL;
+        }
+
+        *size = (size_t) file_size;
+    }
+
+    fclose(file);
+    return data;
+}
+
+static void write_u16_be(unsigned char* data, unsigned int value) {
+    data[0] = (unsigned char) (value >> 8);
+    data[1] = (unsigned char) value;
+}
+
+static void write_u32_be(unsigned char* data, unsigned long value) {
+    write_u16_be(data, (unsigned int) (value >> 16) & 0xFFFF);
+    write_u16_be(data + 2, (unsigned int) value & 0xFFFF);
+}
+
+/* Writes a whole number sample rate as an 80 bit extended precision float */
+static void write_extended_rate(unsigned char* data, unsigned long rate) {
+    unsigned int exponent = 0;
+    unsigned long long mantissa;
+
+    while ((rate >> exponent) > 1) {
+        exponent++;
+    }
+
+    mantissa = (unsigned long long) rate << (63 - exponent);
+    write_u16_be(data, 16383 + exponent);
+    write_u32_be(data + 2, (unsigned long) (mantissa >> 32));
+    write_u32_be(data + 6, (unsigned long) (mantissa & 0xFFFFFFFF));
+}
+
+/* The integer sample stored for a given source sample, left-justified in 32 bits.
+Extra low bits are filled from the sample index, so that every stored byte is checked. */
+static int get_expected_s32(test_format format, short sample, size_t index) {
+    unsigned int value = (unsigned int) (unsigned short) sample << 16;
+
+    switch (format) {
+    case TEST_FORMAT_TWOS_8:
+    case TEST_FORMAT_RAW_8:
+        value &= 0xFF000000;
+        break;
+
+    case TEST_FORMAT_TWOS_12:
+        value &= 0xFFF00000;
+        break;
+
+    case TEST_FORMAT_TWOS_24:
+    case TEST_FORMAT_SOWT_24:
+        value |= (unsigned int) (index & 0xFF) << 8;
+        break;
+
+    case TEST_FORMAT_TWOS_32:
+        value |= (unsigned int) (index & 0xFFFF);
+        break;
+
+    default:
+        break;
+    }
+
+    return (int) value;
+}
+
+/* Writes one sample in the given format */
+static void write_sample(test_format format, unsigned char* output, short sample, size_t index) {
+    unsigned int value = (unsigned int) get_expected_s32(format, sample, index);
+    const test_format_info* info = &test_formats[format];
+    unsigned int i;
+
+    if (format == TEST_FORMAT_FL32) {
+        float float_sample = (float) sample / 32768.0f;
+        memcpy(&value, &float_sample, 4);
+    } else if (format == TEST_FORMAT_FL64) {
+        double double_sample = (double) sample / 32768.0;
+        unsigned long long double_value;
+        memcpy(&double_value, &double_sample, 8);
+        write_u32_be(output, (unsigned long) (double_value >> 32));
+        write_u32_be(output + 4, (unsigned long) (double_value & 0xFFFFFFFF));
+        return;
+    } else if (format == TEST_FORMAT_ULAW || format == TEST_FORMAT_ALAW) {
+        /* Every possible value */
+        output[0] = (unsigned char) index;
+        return;
+    } else if (format == TEST_FORMAT_RAW_8) {
+        value ^= 0x80000000;
+    }
+
+    for (i = 0; i < info->bytes; i++) {
+        unsigned int shift = 24 - (8 * (info->big_endian ? i : info->bytes - 1 - i));
+        output[i] = (unsigned char) (value >> shift);
+    }
+}
+
+/* Creates an AIFF or AIFC file in memory from 16 bit stereo samples.
+The layout of the chunks is changed depending on the layout number,
+to check that chunks in different orders, unknown chunks, and padding are handled. */
+static unsigned char* create_aiff(test_format format, const short* samples, size_t frames, unsigned int layout, size_t* size) {
+    const test_format_info* info = &test_formats[format];
+    size_t frame_size = info->bytes * TEST_PROGRAM_CHANNELS;
+    size_t comm_size = info->compression != NULL ? 24 : 18;
+    /* The SSND chunk can have an offset before the audio data, and data after it which isn't part of any frame */
+    size_t ssnd_offset = (layout & 1) ? 4 : 0;
+    size_t ssnd_extra = (layout & 2) ? 3 : 0;
+    size_t ssnd_size = 8 + ssnd_offset + (frames * frame_size) + ssnd_extra;
+    /* An unknown chunk with an odd size */
+    size_t anno_size = 5;
+    size_t total_size = 12 + (8 + comm_size) + (8 + anno_size + 1) + (8 + ssnd_size + (ssnd_size & 1));
+    unsigned char* data = (unsigned char*) calloc(1, total_size);
+    unsigned char* chunk;
+    unsigned char* ssnd;
+    size_t i;
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    memcpy(data, "FORM", 4);
+    write_u32_be(data + 4, (unsigned long) (total_size - 8));
+    memcpy(data + 8, info->compression != NULL ? "AIFC" : "AIFF", 4);
+    chunk = data + 12;
+    memcpy(chunk, "ANNO", 4);
+    write_u32_be(chunk + 4, (unsigned long) anno_size);
+    memcpy(chunk + 8, "test", 4);
+    chunk += 8 + anno_size + 1;
+
+    /* The COMM chunk comes after the SSND chunk for some layouts */
+    if (layout & 4) {
+        ssnd = chunk;
+        chunk += 8 + ssnd_size + (ssnd_size & 1);
+    } else {
+        ssnd = chunk + 8 + comm_size;
+    }
+
+    memcpy(chunk, "COMM", 4);
+    write_u32_be(chunk + 4, (unsigned long) comm_size);
+    write_u16_be(chunk + 8, TEST_PROGRAM_CHANNELS);
+    write_u32_be(chunk + 10, (unsigned long) frames);
+    write_u16_be(chunk + 14, info->bits);
+    write_extended_rate(chunk + 16, 44100);
+
+    if (info->compression != NULL) {
+        memcpy(chunk + 26, info->compression, 4);
+    }
+
+    memcpy(ssnd, "SSND", 4);
+    write_u32_be(ssnd + 4, (unsigned long) ssnd_size);
+    write_u32_be(ssnd + 8, (unsigned long) ssnd_offset);
+
+    for (i = 0; i < frames * TEST_PROGRAM_CHANNELS; i++) {
+        write_sample(format, ssnd + 16 + ssnd_offset + (i * info->bytes), samples[i], i);
+    }
+
+    /* Fill the extra data, so that reading it by mistake would be noticed */
+    for (i = 0; i < ssnd_extra; i++) {
+        ssnd[16 + ssnd_offset + (frames * frame_size) + i] = 0x55;
+    }
+
+    *size = total_size;
+    return data;
+}
+
+/* Checks that the decoded companded samples are the standard G.711 values,
+which are symmetrical around silence, and get louder with each step of the encoded magnitude */
+static int check_companded(test_format format, const short* decoded, size_t sample_count) {
+    int is_ulaw = format == TEST_FORMAT_ULAW;
+    /* mu-law stores the inverted magnitude, A-law inverts every other bit */
+    unsigned int code_mask = is_ulaw ? 0x7F : 0x55;
+    unsigned int code;
+    size_t i;
+
+    if (decoded[is_ulaw ? 0x00 : 0x2A] != (is_ulaw ? -32124 : -32256) || decoded[is_ulaw ? 0xFF : 0xD5] != (is_ulaw ? 0 : 8)) {
+        printf("%s decoded to the wrong values!\n", test_formats[format].name);
+        return EXIT_FAILURE;
+    }
+
+    for (code = 0; code < 0x80; code++) {
+        unsigned int value = code ^ code_mask;
+
+        if (decoded[value] != -decoded[value ^ 0x80]) {
+            printf("%s sample 0x%02X was not symmetrical!\n", test_formats[format].name, value);
+            return EXIT_FAILURE;
+        }
+
+        if (code > 0 && !(abs(decoded[value]) > abs(decoded[(code - 1) ^ code_mask]))) {
+            printf("%s sample 0x%02X was out of order!\n", test_formats[format].name, value);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* The file has every value repeatedly */
+    for (i = 0; i < sample_count; i++) {
+        if (decoded[i] != decoded[i & 0xFF]) {
+            printf("%s did not match at sample %zu!\n", test_formats[format].name, i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Creates a file in the given format, then decodes it and checks the result */
+static int test_format_decode(test_format format, const short* samples, size_t frames, unsigned int layout) {
+    int returnVal = EXIT_FAILURE;
+    const test_format_info* info = &test_formats[format];
+    int is_companded = format == TEST_FORMAT_ULAW || format == TEST_FORMAT_ALAW;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_info probe_info;
+    size_t file_size = 0;
+    size_t sample_count = frames * TEST_PROGRAM_CHANNELS;
+    unsigned char* file;
+    void* pcm = NULL;
+    size_t pcm_frames = 0;
+    size_t i;
+    file = create_aiff(format, samples, frames, layout, &file_size);
+
+    if (file == NULL) {
+        puts("malloc failed for test file!");
+        return EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_probe(file, file_size, &probe_info) || probe_info.sample_rate != 44100 || probe_info.channel_count != TEST_PROGRAM_CHANNELS
+            || probe_info.total_frames != (OSWRAPPER_AUDIO_SEEK_TYPE) frames || probe_info.bits_per_channel != (is_companded ? 0 : info->bytes * 8)
+            || probe_info.audio_type != (format == TEST_FORMAT_FL32 || format == TEST_FORMAT_FL64 ? OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT : OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER)
+            || (!is_companded && info->bytes > 1 && probe_info.endianness_type != (info->big_endian ? OSWRAPPER_AUDIO_ENDIANNESS_BIG : OSWRAPPER_AUDIO_ENDIANNESS_LITTLE))) {
+        printf("%s was probed incorrectly!\n", info->name);
+        goto exit;
+    }
+
+    /* Decode to the format which can hold every stored sample exactly */
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    audio_spec.audio_type = format == TEST_FORMAT_FL32 || format == TEST_FORMAT_FL64 ? OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT : OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    audio_spec.bits_per_channel = format == TEST_FORMAT_FL64 ? 64 : is_companded ? 16 : 32;
+
+    if (!oswrapper_audio_decode_all(file, file_size, &audio_spec, &pcm, &pcm_frames)) {
+        printf("Could not decode %s!\n", info->name);
+        goto exit;
+    }
+
+    if (pcm_frames != frames || audio_spec.sample_rate != 44100 || audio_spec.channel_count != TEST_PROGRAM_CHANNELS) {
+        printf("%s decoded to %zu frames, expected %zu!\n", info->name, pcm_frames, frames);
+        goto exit;
+    }
+
+    if (is_companded) {
+        if (check_companded(format, (const short*) pcm, sample_count) != EXIT_SUCCESS) {
+            goto exit;
+        }
+    } else {
+        for (i = 0; i < sample_count; i++) {
+            int matches;
+
+            if (format == TEST_FORMAT_FL32) {
+                matches = ((const float*) pcm)[i] == (float) samples[i] / 32768.0f;
+            } else if (format == TEST_FORMAT_FL64) {
+                matches = ((const double*) pcm)[i] == (double) samples[i] / 32768.0;
+            } else {
+                matches = ((const int*) pcm)[i] == get_expected_s32(format, samples[i], i);
+            }
+
+            if (!matches) {
+                printf("%s did not match at sample %zu!\n", info->name, i);
+                goto exit;
+            }
+        }
+    }
+
+    printf("Decoded %zu frames of %s with layout %u\n", pcm_frames, info->name, layout);
+    returnVal = EXIT_SUCCESS;
+exit:
+    oswrapper_audio_free_pcm(&audio_spec, pcm);
+    free(file);
+    return returnVal;
+}
+
+/* Decodes a big-endian 16 bit file to 32 bit float PCM and to big-endian 16 bit PCM,
+which converts each chunk of samples after swapping their byte order */
+static int test_big_endian_conversions(const short* samples, size_t frames) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec float_spec;
+    OSWrapper_audio_spec big_endian_spec;
+    size_t file_size = 0;
+    size_t sample_count = frames * TEST_PROGRAM_CHANNELS;
+    unsigned char* file = create_aiff(TEST_FORMAT_TWOS_16, samples, frames, 0, &file_size);
+    void* float_pcm = NULL;
+    void* big_endian_pcm = NULL;
+    size_t float_frames = 0;
+    size_t big_endian_frames = 0;
+    size_t i;
+
+    if (file == NULL) {
+        puts("malloc failed for test file!");
+        return EXIT_FAILURE;
+    }
+
+    memset(&float_spec, 0, sizeof(float_spec));
+    float_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
+    float_spec.bits_per_channel = 32;
+    big_endian_spec = float_spec;
+    big_endian_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    big_endian_spec.bits_per_channel = 16;
+    big_endian_spec.endianness_type = OSWRAPPER_AUDIO_ENDIANNESS_BIG;
+
+    if (!oswrapper_audio_decode_all(file, file_size, &float_spec, &float_pcm, &float_frames) || float_frames != frames
+            || !oswrapper_audio_decode_all(file, file_size, &big_endian_spec, &big_endian_pcm, &big_endian_frames) || big_endian_frames != frames) {
+        puts("Could not decode big-endian AIFF!");
+        goto exit;
+    }
+
+    for (i = 0; i < sample_count; i++) {
+        const unsigned char* big_endian_sample = (const unsigned char*) big_endian_pcm + (i * 2);
+
+        if (((const float*) float_pcm)[i] != (float) samples[i] / 32768.0f
+                || big_endian_sample[0] != (unsigned char) ((unsigned short) samples[i] >> 8) || big_endian_sample[1] != (unsigned char) samples[i]) {
+            printf("Converted big-endian AIFF did not match at sample %zu!\n", i);
+            goto exit;
+        }
+    }
+
+    puts("Converted big-endian AIFF to float and big-endian PCM");
+    returnVal = EXIT_SUCCESS;
+exit:
+    oswrapper_audio_free_pcm(&float_spec, float_pcm);
+    oswrapper_audio_free_pcm(&big_endian_spec, big_endian_pcm);
+    free(file);
+    return returnVal;
+}
+
+/* Checks that AIFC files with unsupported compression types fail to load */
+static int test_unsupported(const short* samples, size_t frames) {
+    OSWrapper_audio_spec audio_spec;
+    size_t file_size = 0;
+    unsigned char* file = create_aiff(TEST_FORMAT_SOWT_16, samples, frames, 0, &file_size);
+    int returnVal = EXIT_SUCCESS;
+
+    if (file == NULL) {
+        puts("malloc failed for test file!");
+        return EXIT_FAILURE;
+    }
+
+    /* Change the compression type to IMA ADPCM */
+    memcpy(file + 12 + 8 + 6 + 26, "ima4", 4);
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (oswrapper_audio_load_from_memory(file, file_size, &audio_spec)) {
+        puts("AIFC with an unsupported compression type was decoded!");
+        oswrapper_audio_free_context(&audio_spec);
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(file);
+    return returnVal;
+}
+
+/* Decodes a given audio file, and stores it in a variety of AIFF and AIFC formats */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    OSWrapper_audio_spec source_spec;
+    void* samples = NULL;
+    size_t frames = 0;
+    size_t data_size = 0;
+    unsigned char* data;
+    unsigned int format;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    memset(&source_spec, 0, sizeof(source_spec));
+    source_spec.channel_count = TEST_PROGRAM_CHANNELS;
+    source_spec.bits_per_channel = 16;
+    source_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    data = read_file(path, &data_size);
+
+    /* Enough samples for every mu-law and A-law value */
+    if (data == NULL || !oswrapper_audio_decode_all(data, data_size, &source_spec, &samples, &frames) || frames * TEST_PROGRAM_CHANNELS < 256) {
+        puts("Could not decode audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(data);
+
+    for (format = 0; returnVal == EXIT_SUCCESS && format < TEST_FORMAT_COUNT; format++) {
+        if (test_format_decode((test_format) format, (const short*) samples, frames, format % 8) != EXIT_SUCCESS) {
+            returnVal = EXIT_FAILURE;
+        }
+    }
+
+    if (returnVal == EXIT_SUCCESS && (test_big_endian_conversions((const short*) samples, frames) != EXIT_SUCCESS || test_unsupported((const short*) samples, frames) != EXIT_SUCCESS)) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    oswrapper_audio_free_pcm(&source_spec, samples);
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,818 @@
+/*
+This program uses oswrapper_audio to decode M4A files with Apple Lossless (ALAC) audio with the portable decoder.
+An audio file is decoded to 16 bit stereo PCM, which is extended to a variety of bit depths and channel counts,
+then encoded to M4A files in memory with a simple encoder which uses every kind of ALAC packet
+(adaptive prediction with and without a running sum, stereo mixing, shifted low bytes, uncompressed packets,
+partial packets, and skipped fill and data elements), with a variety of MP4 layouts.
+Each file is decoded again, and checked against the samples it was made from.
+Every file is also checked when seeking, loading from callbacks, pushing the file in pieces, and loading it in place.
+Files are split into small pieces when decoded with oswrapper_audio_decode_all and oswrapper_audio_decode_batch,
+so decoding them on several threads is checked as well, including with a damaged packet.
+
+Usage: test_oswrapper_audio_alac (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_alac.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_USE_THREADS
+/* Split the test files into many pieces */
+#define OSWRAPPER_AUDIO_PIECE_MIN_FRAMES 0x2000
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+/* The test files are written to these paths to be decoded with oswrapper_audio_decode_batch */
+#define TEST_PROGRAM_BATCH_PATH "test_oswrapper_audio_alac_batch.m4a"
+#define TEST_PROGRAM_DAMAGED_PATH "test_oswrapper_audio_alac_damaged.m4a"
+/* What a damaged part of a test file is called */
+#define TEST_PROGRAM_DAMAGED_NAME "packet"
+
+/* The adaptive Rice coding parameters of the test files, which are the ones Apple's encoder uses */
+#define TEST_ALAC_HISTORY_MULT 40
+#define TEST_ALAC_INITIAL_HISTORY 10
+#define TEST_ALAC_RICE_LIMIT 14
+
+/* ALAC element types */
+#define TEST_ALAC_SCE 0
+#define TEST_ALAC_CPE 1
+#define TEST_ALAC_LFE 3
+#define TEST_ALAC_DSE 4
+#define TEST_ALAC_FIL 6
+#define TEST_ALAC_END 7
+
+/* Changes to the layout of the test files */
+#define TEST_LAYOUT_MOOV_AT_END 1
+/* 64 bit chunk offsets, and a 64 bit media data box size */
+#define TEST_LAYOUT_CO64 2
+/* Chunks with different amounts of packets, with other data between them */
+#define TEST_LAYOUT_CHUNK_GAPS 4
+/* A text track before the audio track */
+#define TEST_LAYOUT_EXTRA_TRACK 8
+/* Every packet is uncompressed, so every packet has the same size */
+#define TEST_LAYOUT_UNCOMPRESSED 16
+/* Version 1 sound sample description and media header */
+#define TEST_LAYOUT_VERSION_1 32
+/* Packet durations are in units of half a frame */
+#define TEST_LAYOUT_DOUBLE_TIMESCALE 64
+
+typedef struct test_file_info {
+    const char* name;
+    unsigned int channel_count;
+    unsigned int bits_per_sample;
+    unsigned int frame_length;
+    unsigned int layout;
+} test_file_info;
+
+static const test_file_info test_files[] = {
+    { "16 bit stereo", 2, 16, 4096, 0 },
+    { "16 bit mono with the movie box at the end", 1, 16, 4096, TEST_LAYOUT_MOOV_AT_END },
+    { "20 bit 3 channel", 3, 20, 4096, TEST_LAYOUT_CHUNK_GAPS },
+    { "24 bit stereo", 2, 24, 4096, TEST_LAYOUT_CO64 | TEST_LAYOUT_EXTRA_TRACK },
+    { "24 bit stereo without compression", 2, 24, 4096, TEST_LAYOUT_UNCOMPRESSED | TEST_LAYOUT_MOOV_AT_END },
+    { "32 bit stereo", 2, 32, 4096, TEST_LAYOUT_VERSION_1 },
+    { "16 bit 6 channel", 6, 16, 1024, TEST_LAYOUT_CHUNK_GAPS | TEST_LAYOUT_MOOV_AT_END },
+    { "24 bit 8 channel", 8, 24, 2048, TEST_LAYOUT_DOUBLE_TIMESCALE | TEST_LAYOUT_CO64 },
+    { "16 bit stereo with small packets", 2, 16, 352, TEST_LAYOUT_CHUNK_GAPS | TEST_LAYOUT_EXTRA_TRACK }
+};
+
+#define TEST_FILE_COUNT (sizeof(test_files) / sizeof(test_files[0]))
+
+/* The elements of each packet for each channel count, ending with TEST_ALAC_END */
+static const unsigned char test_element_layouts[8][6] = {
+    { TEST_ALAC_SCE, TEST_ALAC_END },
+    { TEST_ALAC_CPE, TEST_ALAC_END },
+    { TEST_ALAC_SCE, TEST_ALAC_CPE, TEST_ALAC_END },
+    { TEST_ALAC_SCE, TEST_ALAC_CPE, TEST_ALAC_SCE, TEST_ALAC_END },
+    { TEST_ALAC_SCE, TEST_ALAC_CPE, TEST_ALAC_CPE, TEST_ALAC_END },
+    { TEST_ALAC_SCE, TEST_ALAC_CPE, TEST_ALAC_CPE, TEST_ALAC_LFE, TEST_ALAC_END },
+    { TEST_ALAC_SCE, TEST_ALAC_CPE, TEST_ALAC_CPE, TEST_ALAC_SCE, TEST_ALAC_LFE, TEST_ALAC_END },
+    { TEST_ALAC_SCE, TEST_ALAC_CPE, TEST_ALAC_CPE, TEST_ALAC_CPE, TEST_ALAC_LFE, TEST_ALAC_END }
+};
+
+/* The decoded channel of each channel in a packet, which has the centre channel first and the LFE channel last */
+static const unsigned char test_channel_maps[8][8] = {
+    { 0 },
+    { 0, 1 },
+    { 2, 0, 1 },
+    { 2, 0, 1, 3 },
+    { 2, 0, 1, 3, 4 },
+    { 2, 0, 1, 4, 5, 3 },
+    { 2, 0, 1, 4, 5, 6, 3 },
+    { 2, 6, 7, 0, 1, 4, 5, 3 }
+};
+
+/* The packets in each chunk of files with chunk gaps, used in turn */
+static const unsigned int test_chunk_packets[] = { 1, 7, 3, 12 };
+
+#define TEST_CHUNK_PACKET_COUNT (sizeof(test_chunk_packets) / sizeof(test_chunk_packets[0]))
+
+#include "test_oswrapper_audio_codec.h"
+
+static void put_ones(test_bit_writer* writer, unsigned int count) {
+    put_bits(writer, ((unsigned long long) 1 << count) - 1, count);
+}
+
+/* Writes any amount of 0 bits, for reserved and unused fields */
+static void put_zeros(test_bit_writer* writer, unsigned int count) {
+    while (count > 32) {
+        put_bits(writer, 0, 32);
+        count -= 32;
+    }
+
+    put_bits(writer, 0, count);
+}
+
+static void put_tag(test_bit_writer* writer, const char* tag) {
+    memcpy(writer->data + writer->size, tag, 4);
+    writer->size += 4;
+}
+
+/* Starts an MP4 box, and returns where it starts so its size can be set when it ends */
+static size_t begin_box(test_bit_writer* writer, const char* type) {
+    size_t start = writer->size;
+    put_bits(writer, 0, 32);
+    put_tag(writer, type);
+    return start;
+}
+
+static void end_box(test_bit_writer* writer, size_t start) {
+    size_t size = writer->size - start;
+    writer->data[start] = (unsigned char) (size >> 24);
+    writer->data[start + 1] = (unsigned char) (size >> 16);
+    writer->data[start + 2] = (unsigned char) (size >> 8);
+    writer->data[start + 3] = (unsigned char) size;
+}
+
+static unsigned int leading_zeros(unsigned int value) {
+    unsigned int count = 0;
+
+    while (count < 32 && !(value & (0x80000000u >> count))) {
+        count++;
+    }
+
+    return count;
+}
+
+static int sign_extend(unsigned int value, unsigned int bits) {
+    return (int) (value << (32 - bits)) >> (32 - bits);
+}
+
+/* Writes a value with a Rice parameter of k, or escaped as sample_bits bits when the prefix would be too long */
+static void encode_value(test_bit_writer* writer, unsigned int value, unsigned int k, unsigned int sample_bits) {
+    unsigned int modulus = (1u << k) - 1;
+    unsigned int prefix = k == 1 ? value : value / modulus;
+
+    if (prefix >= 9) {
+        put_ones(writer, 9);
+        put_bits(writer, value, sample_bits);
+        return;
+    }
+
+    put_ones(writer, prefix);
+    put_bits(writer, 0, 1);
+
+    if (k != 1) {
+        /* Remainders of 0 are one bit shorter */
+        if (value % modulus == 0) {
+            put_bits(writer, 0, k - 1);
+        } else {
+            put_bits(writer, (value % modulus) + 1, k);
+        }
+    }
+}
+
+/* Writes the residual of one channel with adaptive Rice coding, and runs of zeros when the running average is small */
+static void encode_residual(test_bit_writer* writer, const int* residual, size_t count, unsigned int sample_bits, unsigned int history_mult) {
+    unsigned int history = TEST_ALAC_INITIAL_HISTORY;
+    unsigned int after_zeros = 0;
+    size_t i = 0;
+
+    while (i < count) {
+        unsigned int k = 31 - leading_zeros((history >> 9) + 3);
+        unsigned int mapped = residual[i] >= 0 ? (unsigned int) residual[i] * 2 : ((unsigned int) -(residual[i] + 1) * 2) + 1;
+        unsigned int value = mapped - after_zeros;
+        encode_value(writer, value, k < TEST_ALAC_RICE_LIMIT ? k : TEST_ALAC_RICE_LIMIT, sample_bits);
+        history = (history_mult * mapped) + history - ((history_mult * history) >> 9);
+        after_zeros = 0;
+        i++;
+
+        if (value > 0xFFFF) {
+            history = 0xFFFF;
+        }
+
+        if ((history << 2) < 512 && i < count) {
+            unsigned int zero_k = leading_zeros(history) - 24 + ((history + 16) >> 6);
+            unsigned int modulus = ((1u << zero_k) - 1) & ((1u << TEST_ALAC_RICE_LIMIT) - 1);
+            size_t run = 0;
+
+            while (i + run < count && residual[i + run] == 0 && run < 65535) {
+                run++;
+            }
+
+            if (run / modulus >= 9) {
+                put_ones(writer, 9);
+                put_bits(writer, run, 16);
+            } else {
+                put_ones(writer, (unsigned int) (run / modulus));
+                put_bits(writer, 0, 1);
+
+                if (run % modulus == 0) {
+                    put_bits(writer, 0, zero_k - 1);
+                } else {
+                    put_bits(writer, (run % modulus) + 1, zero_k);
+                }
+            }
+
+            i += run;
+            after_zeros = run < 65535 ? 1 : 0;
+            history = 0;
+        }
+    }
+}
+
+/* Removes the adaptive prediction from one channel, adapting the coefficients the same way the decoder does */
+static void predict(const int* samples, int* residual, size_t count, const short* initial_coefficients, unsigned int order, unsigned int sample_bits, unsigned int den_shift) {
+    short coefficients[32];
+    size_t j;
+    memcpy(coefficients, initial_coefficients, order * sizeof(short));
+
+    /* Samples are stored as they are without prediction */
+    if (order == 0) {
+        memcpy(residual, samples, count * sizeof(int));
+        return;
+    }
+
+    for (j = 0; j < count; j++) {
+        int top;
+        unsigned int sum = 0;
+        unsigned int k;
+
+        if (j <= order) {
+            residual[j] = j == 0 ? samples[0] : sign_extend((unsigned int) samples[j] - (unsigned int) samples[j - 1], sample_bits);
+            continue;
+        }
+
+        top = samples[j - order - 1];
+
+        for (k = 0; k < order; k++) {
+            sum += (unsigned int) (int) coefficients[k] * ((unsigned int) samples[j - 1 - k] - (unsigned int) top);
+        }
+
+        residual[j] = sign_extend((unsigned int) samples[j] - (unsigned int) top - (unsigned int) ((int) (sum + (1u << (den_shift - 1))) >> den_shift), sample_bits);
+
+        if (residual[j] != 0) {
+            int remaining = residual[j];
+
+            for (k = order; k > 0; k--) {
+                int difference = (int) ((unsigned int) top - (unsigned int) samples[j - k]);
+                unsigned int magnitude = difference < 0 ? 0u - (unsigned int) difference : (unsigned int) difference;
+                int sign = difference > 0 ? 1 : difference < 0 ? -1 : 0;
+
+                if (residual[j] > 0) {
+                    coefficients[k - 1] = (short) (coefficients[k - 1] - sign);
+                    remaining = (int) ((unsigned int) remaining - ((order - k + 1) * (magnitude >> den_shift)));
+
+                    if (remaining <= 0) {
+                        break;
+                    }
+                } else {
+                    coefficients[k - 1] = (short) (coefficients[k - 1] + sign);
+                    remaining = (int) ((unsigned int) remaining - ((order - k + 1) * (unsigned int) ((int) (0u - magnitude) >> den_shift)));
+
+                    if (remaining >= 0) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Writes an SCE, LFE, or CPE element with one or two channels, encoded with a mode chosen by the packet index */
+static void encode_element(test_bit_writer* writer, const test_file_info* info, unsigned int tag, const int* const* channels, size_t frames, size_t packet_index) {
+    static const short linear[16] = { 1024, -512 };
+    static const short previous[16] = { 512 };
+    unsigned int channel_count = tag == TEST_ALAC_CPE ? 2 : 1;
+    unsigned int mode = info->layout & TEST_LAYOUT_UNCOMPRESSED ? 3 : (unsigned int) (packet_index % 4);
+    unsigned int shift = mode == 3 ? 0 : info->bits_per_sample == 32 ? 16 : info->bits_per_sample == 24 ? 8 : 0;
+    unsigned int sample_bits = info->bits_per_sample - shift + (channel_count - 1);
+    int mix_res = channel_count == 2 && mode != 2 ? 2 : 0;
+    int* samples[2];
+    int* residual;
+    unsigned int channel;
+    size_t i;
+    put_bits(writer, tag, 3);
+    put_bits(writer, 0, 4);
+    put_bits(writer, 0, 12);
+    put_bits(writer, ((frames != info->frame_length) << 3) | ((shift / 8) << 1) | (mode == 3), 4);
+
+    if (frames != info->frame_length) {
+        put_bits(writer, frames, 32);
+    }
+
+    if (mode == 3) {
+        for (i = 0; i < frames; i++) {
+            for (channel = 0; channel < channel_count; channel++) {
+                put_signed(writer, channels[channel][i], info->bits_per_sample);
+            }
+        }
+
+        return;
+    }
+
+    samples[0] = (int*) malloc(frames * sizeof(int));
+    samples[1] = (int*) malloc(frames * sizeof(int));
+    residual = (int*) malloc(frames * sizeof(int));
+
+    for (i = 0; i < frames; i++) {
+        for (channel = 0; channel < channel_count; channel++) {
+            samples[channel][i] = channels[channel][i] >> shift;
+        }
+
+        /* Stored as a weighted mid channel and a difference channel */
+        if (mix_res != 0) {
+            int difference = samples[0][i] - samples[1][i];
+            samples[0][i] = samples[1][i] + ((mix_res * difference) >> 2);
+            samples[1][i] = difference;
+        }
+    }
+
+    put_bits(writer, mix_res != 0 ? 2 : 0, 8);
+    put_signed(writer, mix_res, 8);
+
+    for (channel = 0; channel < channel_count; channel++) {
+        /* Mode 1 also stores the differences between the predicted samples, and the second channel has a different rice parameter */
+        unsigned int order = mode == 2 ? 0 : mode == 1 ? 1 : packet_index % 8 == 4 ? 16 : 2;
+        put_bits(writer, ((mode == 1) << 4) | 9, 8);
+        put_bits(writer, ((channel == 0 ? 4u : 2u) << 5) | order, 8);
+
+        for (i = 0; i < order; i++) {
+            put_signed(writer, mode == 1 ? previous[i] : linear[i], 16);
+        }
+    }
+
+    /* The low bytes of each sample come before the residuals */
+    for (i = 0; i < frames && shift != 0; i++) {
+        for (channel = 0; channel < channel_count; channel++) {
+            put_bits(writer, (unsigned int) channels[channel][i] & ((1u << shift) - 1), shift);
+        }
+    }
+
+    for (channel = 0; channel < channel_count; channel++) {
+        unsigned int order = mode == 2 ? 0 : mode == 1 ? 1 : packet_index % 8 == 4 ? 16 : 2;
+        predict(samples[channel], residual, frames, mode == 1 ? previous : linear, order, sample_bits, 9);
+
+        if (mode == 1) {
+            /* The decoder adds up the residuals before undoing the prediction */
+            for (i = frames; i > 1; i--) {
+                residual[i - 1] = sign_extend((unsigned int) residual[i - 1] - (unsigned int) residual[i - 2], sample_bits);
+            }
+        }
+
+        encode_residual(writer, residual, frames, sample_bits, (TEST_ALAC_HISTORY_MULT * (channel == 0 ? 4u : 2u)) / 4);
+    }
+
+    free(samples[0]);
+    free(samples[1]);
+    free(residual);
+}
+
+/* Writes an ALAC packet, with fill and data stream elements in some packets */
+static void encode_packet(test_bit_writer* writer, const test_file_info* info, int* const* channels, size_t frames, size_t packet_index) {
+    const unsigned char* layout = test_element_layouts[info->channel_count - 1];
+    const unsigned char* map = test_channel_maps[info->channel_count - 1];
+    unsigned int channel = 0;
+    unsigned int element;
+
+    if (packet_index % 5 == 2 && !(info->layout & TEST_LAYOUT_UNCOMPRESSED)) {
+        put_bits(writer, TEST_ALAC_FIL, 3);
+        put_bits(writer, 2, 4);
+        put_bits(writer, 0xABCD, 16);
+        put_bits(writer, TEST_ALAC_DSE, 3);
+        put_bits(writer, 0, 4);
+        put_bits(writer, 1, 1);
+        put_bits(writer, 3, 8);
+        align_bits(writer);
+        put_bits(writer, 0x123456, 24);
+    }
+
+    for (element = 0; layout[element] != TEST_ALAC_END; element++) {
+        const int* element_channels[2];
+        element_channels[0] = channels[map[channel]] + (packet_index * info->frame_length);
+        element_channels[1] = layout[element] == TEST_ALAC_CPE ? channels[map[channel + 1]] + (packet_index * info->frame_length) : NULL;
+        encode_element(writer, info, layout[element], element_channels, frames, packet_index);
+        channel += layout[element] == TEST_ALAC_CPE ? 2 : 1;
+    }
+
+    put_bits(writer, TEST_ALAC_END, 3);
+    align_bits(writer);
+}
+
+/* The sample stored for a channel of a source frame, which is 16 bit stereo. The bits below the source samples are filled. */
+static int get_sample(const test_file_info* info, const short* source, size_t frame, unsigned int channel) {
+    int base = source[(frame * 2) + (channel % 2)];
+    unsigned int bits = info->bits_per_sample;
+
+    if (channel >= 2) {
+        base = (short) (base + (channel * 1000));
+    }
+
+    if (bits == 16) {
+        return base;
+    }
+
+    return (int) (((unsigned int) base << (bits - 16)) | ((frame * 7 + channel) & ((1u << (bits - 16)) - 1)));
+}
+
+/* Writes a track with a text sample description, which isn't decoded */
+static void write_text_track(test_bit_writer* writer) {
+    size_t trak = begin_box(writer, "trak");
+    size_t box = begin_box(writer, "mdia");
+    size_t inner = begin_box(writer, "mdhd");
+    size_t table;
+    put_bits(writer, 0, 32);
+    put_bits(writer, 0, 64);
+    put_bits(writer, 1000, 32);
+    put_bits(writer, 0, 64);
+    end_box(writer, inner);
+    inner = begin_box(writer, "hdlr");
+    put_bits(writer, 0, 64);
+    put_tag(writer, "text");
+    put_zeros(writer, 32 * 3);
+    put_bits(writer, 0, 8);
+    end_box(writer, inner);
+    inner = begin_box(writer, "minf");
+    table = begin_box(writer, "stbl");
+    box = begin_box(writer, "stsd");
+    put_bits(writer, 0, 32);
+    put_bits(writer, 1, 32);
+    put_bits(writer, 16, 32);
+    put_tag(writer, "tx3g");
+    put_bits(writer, 1, 64);
+    end_box(writer, box);
+    box = begin_box(writer, "stts");
+    put_bits(writer, 0, 64);
+    end_box(writer, box);
+    end_box(writer, table);
+    end_box(writer, inner);
+    end_box(writer, trak + 8);
+    end_box(writer, trak);
+}
+
+/* Writes the movie box, with the audio data starting at data_offset */
+static void write_moov(test_bit_writer* writer, const test_file_info* info, size_t frames, const unsigned long* packet_sizes, size_t packet_count, const unsigned long long* chunk_offsets, const unsigned int* chunk_packets, size_t chunk_count, unsigned long long data_offset) {
+    unsigned int timescale_mult = info->layout & TEST_LAYOUT_DOUBLE_TIMESCALE ? 2 : 1;
+    unsigned int version = info->layout & TEST_LAYOUT_VERSION_1 ? 1 : 0;
+    size_t last_frames = frames - ((packet_count - 1) * info->frame_length);
+    size_t moov = begin_box(writer, "moov");
+    size_t trak;
+    size_t mdia;
+    size_t minf;
+    size_t stbl;
+    size_t box;
+    size_t entry;
+    size_t i;
+    box = begin_box(writer, "mvhd");
+    put_zeros(writer, 32 * 3);
+    put_bits(writer, TEST_PROGRAM_SAMPLE_RATE, 32);
+    put_bits(writer, frames, 32);
+    put_bits(writer, 0x00010000, 32);
+    put_bits(writer, 0x0100, 16);
+    put_zeros(writer, 16 + (32 * 2) + (32 * 9) + (32 * 6));
+    put_bits(writer, 3, 32);
+    end_box(writer, box);
+
+    if (info->layout & TEST_LAYOUT_EXTRA_TRACK) {
+        write_text_track(writer);
+    }
+
+    trak = begin_box(writer, "trak");
+    box = begin_box(writer, "tkhd");
+    put_bits(writer, 7, 32);
+    put_bits(writer, 0, 64);
+    put_bits(writer, 1, 32);
+    put_bits(writer, 0, 32);
+    put_bits(writer, frames, 32);
+    put_zeros(writer, 64 + 16 + 16);
+    put_bits(writer, 0x0100, 16);
+    put_zeros(writer, 16 + (32 * 9) + 64);
+    end_box(writer, box);
+    mdia = begin_box(writer, "mdia");
+    box = begin_box(writer, "mdhd");
+
+    if (version == 1) {
+        put_bits(writer, 0x01000000, 32);
+        put_zeros(writer, 128);
+        put_bits(writer, TEST_PROGRAM_SAMPLE_RATE * timescale_mult, 32);
+        put_bits(writer, (unsigned long long) frames * timescale_mult, 64);
+    } else {
+        put_zeros(writer, 64 + 32);
+        put_bits(writer, TEST_PROGRAM_SAMPLE_RATE * timescale_mult, 32);
+        put_bits(writer, frames * timescale_mult, 32);
+    }
+
+    put_bits(writer, 0x55C4, 16);
+    put_bits(writer, 0, 16);
+    end_box(writer, box);
+    box = begin_box(writer, "hdlr");
+    put_bits(writer, 0, 64);
+    put_tag(writer, "soun");
+    put_zeros(writer, 32 * 3);
+    put_bits(writer, 0, 8);
+    end_box(writer, box);
+    minf = begin_box(writer, "minf");
+    box = begin_box(writer, "smhd");
+    put_bits(writer, 0, 64);
+    end_box(writer, box);
+    stbl = begin_box(writer, "stbl");
+    box = begin_box(writer, "stsd");
+    put_bits(writer, 0, 32);
+    put_bits(writer, 1, 32);
+    entry = begin_box(writer, "alac");
+    put_bits(writer, 0, 48);
+    put_bits(writer, 1, 16);
+    put_bits(writer, version, 16);
+    put_bits(writer, 0, 16 + 32);
+    put_bits(writer, info->channel_count, 16);
+    put_bits(writer, info->bits_per_sample, 16);
+    put_bits(writer, 0, 32);
+    put_bits(writer, (unsigned long long) TEST_PROGRAM_SAMPLE_RATE << 16, 32);
+
+    if (version == 1) {
+        put_bits(writer, info->frame_length, 32);
+        put_zeros(writer, 32 * 3);
+    }
+
+    i = begin_box(writer, "alac");
+    put_bits(writer, 0, 32);
+    put_bits(writer, info->frame_length, 32);
+    put_bits(writer, 0, 8);
+    put_bits(writer, info->bits_per_sample, 8);
+    put_bits(writer, TEST_ALAC_HISTORY_MULT, 8);
+    put_bits(writer, TEST_ALAC_INITIAL_HISTORY, 8);
+    put_bits(writer, TEST_ALAC_RICE_LIMIT, 8);
+    put_bits(writer, info->channel_count, 8);
+    put_bits(writer, 255, 16);
+    put_bits(writer, 0, 32 * 2);
+    put_bits(writer, TEST_PROGRAM_SAMPLE_RATE, 32);
+    end_box(writer, i);
+    end_box(writer, entry);
+    end_box(writer, box);
+    /* Every packet but the last has the frame length */
+    box = begin_box(writer, "stts");
+    put_bits(writer, 0, 32);
+    put_bits(writer, last_frames != info->frame_length && packet_count > 1 ? 2 : 1, 32);
+
+    if (last_frames != info->frame_length && packet_count > 1) {
+        put_bits(writer, packet_count - 1, 32);
+        put_bits(writer, info->frame_length * timescale_mult, 32);
+        put_bits(writer, 1, 32);
+        put_bits(writer, last_frames * timescale_mult, 32);
+    } else {
+        put_bits(writer, packet_count, 32);
+        put_bits(writer, last_frames * timescale_mult, 32);
+    }
+
+    end_box(writer, box);
+    /* One entry for each change in the amount of packets in each chunk */
+    box = begin_box(writer, "stsc");
+    put_bits(writer, 0, 32);
+    entry = writer->size;
+    put_bits(writer, 0, 32);
+
+    for (i = 0; i < chunk_count; i++) {
+        if (i == 0 || chunk_packets[i] != chunk_packets[i - 1]) {
+            put_bits(writer, i + 1, 32);
+            put_bits(writer, chunk_packets[i], 32);
+            put_bits(writer, 1, 32);
+            writer->data[entry + 3]++;
+        }
+    }
+
+    end_box(writer, box);
+    box = begin_box(writer, "stsz");
+    put_bits(writer, 0, 32);
+    put_bits(writer, info->layout & TEST_LAYOUT_UNCOMPRESSED ? packet_sizes[0] : 0, 32);
+    put_bits(writer, packet_count, 32);
+
+    for (i = 0; i < packet_count && !(info->layout & TEST_LAYOUT_UNCOMPRESSED); i++) {
+        put_bits(writer, packet_sizes[i], 32);
+    }
+
+    end_box(writer, box);
+    box = begin_box(writer, info->layout & TEST_LAYOUT_CO64 ? "co64" : "stco");
+    put_bits(writer, 0, 32);
+    put_bits(writer, chunk_count, 32);
+
+    for (i = 0; i < chunk_count; i++) {
+        put_bits(writer, data_offset + chunk_offsets[i], info->layout & TEST_LAYOUT_CO64 ? 64 : 32);
+    }
+
+    end_box(writer, box);
+    end_box(writer, stbl);
+    end_box(writer, minf);
+    end_box(writer, mdia);
+    end_box(writer, trak);
+    end_box(writer, moov);
+}
+
+/* Creates an M4A file in memory. expected is set to the samples which should be decoded, as 32 bit samples. */
+static unsigned char* create_m4a(const test_file_info* info, const short* source, size_t frames, int* expected, test_damage_location* middle, size_t* size) {
+    size_t packet_count = (frames + info->frame_length - 1) / info->frame_length;
+    size_t chunk_count = 0;
+    unsigned long* packet_sizes = (unsigned long*) malloc(packet_count * sizeof(unsigned long));
+    unsigned long long* packet_offsets = (unsigned long long*) malloc(packet_count * sizeof(unsigned long long));
+    unsigned long long* chunk_offsets = (unsigned long long*) malloc(packet_count * sizeof(unsigned long long));
+    unsigned int* chunk_packets = (unsigned int*) malloc(packet_count * sizeof(unsigned int));
+    size_t capacity = 0x10000 + (frames * info->channel_count * 6) + (packet_count * 64);
+    unsigned char* file = (unsigned char*) malloc(capacity);
+    int* channels[8];
+    test_bit_writer audio;
+    test_bit_writer writer;
+    size_t moov_size;
+    size_t mdat_header = info->layout & TEST_LAYOUT_CO64 ? 16 : 8;
+    size_t header_size;
+    size_t packet;
+    unsigned int channel;
+    size_t i;
+    audio.data = (unsigned char*) malloc(capacity);
+    audio.size = 0;
+    audio.bit = 0;
+
+    for (channel = 0; channel < info->channel_count; channel++) {
+        channels[channel] = (int*) malloc(packet_count * info->frame_length * sizeof(int));
+
+        for (i = 0; i < frames; i++) {
+            channels[channel][i] = get_sample(info, source, i, channel);
+            expected[(i * info->channel_count) + channel] = (int) ((unsigned int) channels[channel][i] << (32 - info->bits_per_sample));
+        }
+    }
+
+    /* Packets are grouped into chunks, with other data between them when there are gaps */
+    for (packet = 0; packet < packet_count; chunk_count++) {
+        unsigned int chunk_size = info->layout & TEST_LAYOUT_CHUNK_GAPS ? test_chunk_packets[chunk_count % TEST_CHUNK_PACKET_COUNT] : 20;
+        chunk_packets[chunk_count] = chunk_size < packet_count - packet ? chunk_size : (unsigned int) (packet_count - packet);
+
+        /* The data between chunks ends a packet straight away, so it can't be decoded by mistake */
+        if (info->layout & TEST_LAYOUT_CHUNK_GAPS && chunk_count != 0) {
+            put_bits(&audio, 0xE0E0E0E0E0E0ull, 48);
+        }
+
+        chunk_offsets[chunk_count] = audio.size;
+
+        for (i = 0; i < chunk_packets[chunk_count]; i++, packet++) {
+            size_t packet_frames = frames - (packet * info->frame_length) < info->frame_length ? frames - (packet * info->frame_length) : info->frame_length;
+            packet_offsets[packet] = audio.size;
+            encode_packet(&audio, info, channels, packet_frames, packet);
+            packet_sizes[packet] = (unsigned long) (audio.size - packet_offsets[packet]);
+        }
+    }
+
+    /* The movie box is written once to find its size, then again with the real chunk offsets */
+    writer.data = file;
+    writer.size = 0;
+    writer.bit = 0;
+    begin_box(&writer, "ftyp");
+    put_tag(&writer, "M4A ");
+    put_bits(&writer, 0, 32);
+    put_tag(&writer, "M4A ");
+    put_tag(&writer, "isom");
+    end_box(&writer, 0);
+    end_box(&writer, begin_box(&writer, "free"));
+    header_size = writer.size;
+    write_moov(&writer, info, frames, packet_sizes, packet_count, chunk_offsets, chunk_packets, chunk_count, 0);
+    moov_size = writer.size - header_size;
+    writer.size = header_size;
+
+    if (!(info->layout & TEST_LAYOUT_MOOV_AT_END)) {
+        write_moov(&writer, info, frames, packet_sizes, packet_count, chunk_offsets, chunk_packets, chunk_count, header_size + moov_size + mdat_header);
+    }
+
+    middle->offset = writer.size + mdat_header + (size_t) packet_offsets[packet_count / 2];
+    middle->first_frame = (packet_count / 2) * info->frame_length;
+    middle->frames = info->frame_length;
+
+    if (mdat_header == 16) {
+        put_bits(&writer, 1, 32);
+        put_tag(&writer, "mdat");
+        put_bits(&writer, audio.size + 16, 64);
+    } else {
+        put_bits(&writer, audio.size + 8, 32);
+        put_tag(&writer, "mdat");
+    }
+
+    memcpy(writer.data + writer.size, audio.data, audio.size);
+    writer.size += audio.size;
+
+    if (info->layout & TEST_LAYOUT_MOOV_AT_END) {
+        write_moov(&writer, info, frames, packet_sizes, packet_count, chunk_offsets, chunk_packets, chunk_count, header_size + mdat_header);
+    }
+
+    for (channel = 0; channel < info->channel_count; channel++) {
+        free(channels[channel]);
+    }
+
+    free(audio.data);
+    free(packet_sizes);
+    free(packet_offsets);
+    free(chunk_offsets);
+    free(chunk_packets);
+    *size = writer.size;
+    return file;
+}
+
+/* Creates a test file, then decodes it and checks the result */
+static int test_file(const test_file_info* info, const short* source, size_t frames) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_info probe_info;
+    test_damage_location middle;
+    size_t file_size = 0;
+    int* expected;
+    unsigned char* file = NULL;
+    void* pcm = NULL;
+    size_t pcm_frames = 0;
+    init_spec(&audio_spec);
+
+    /* Uncompressed files only have whole packets, so every packet has the same size */
+    if (info->layout & TEST_LAYOUT_UNCOMPRESSED) {
+        frames -= frames % info->frame_length;
+    }
+
+    expected = (int*) malloc(frames * info->channel_count * sizeof(int));
+
+    if (expected == NULL) {
+        puts("malloc failed for expected samples!");
+        return EXIT_FAILURE;
+    }
+
+    file = create_m4a(info, source, frames, expected, &middle, &file_size);
+
+    if (file == NULL) {
+        puts("malloc failed for test file!");
+        goto exit;
+    }
+
+    if (!oswrapper_audio_probe(file, file_size, &probe_info) || probe_info.sample_rate != TEST_PROGRAM_SAMPLE_RATE || probe_info.channel_count != info->channel_count || probe_info.bits_per_channel != 0
+            || probe_info.total_frames != (OSWRAPPER_AUDIO_SEEK_TYPE) frames) {
+        printf("%s was probed incorrectly!\n", info->name);
+        goto exit;
+    }
+
+    if (!oswrapper_audio_decode_all(file, file_size, &audio_spec, &pcm, &pcm_frames)) {
+        printf("Could not decode %s!\n", info->name);
+        goto exit;
+    }
+
+    if (pcm_frames != frames || audio_spec.sample_rate != TEST_PROGRAM_SAMPLE_RATE || audio_spec.channel_count != info->channel_count) {
+        printf("%s decoded to %zu frames, expected %zu!\n", info->name, pcm_frames, frames);
+        goto exit;
+    }
+
+    if (check_samples(info, (const int*) pcm, expected, 0, frames, "when decoded") != EXIT_SUCCESS || test_access(info, file, file_size, expected, frames) != EXIT_SUCCESS
+            || write_file(TEST_PROGRAM_BATCH_PATH, file, file_size) != EXIT_SUCCESS) {
+        goto exit;
+    }
+
+    /* The frames of a damaged packet are skipped, and the frames after it are still decoded.
+    The packet is damaged by ending it before its first element. */
+    file[middle.offset] = TEST_ALAC_END << 5;
+
+    if (test_damaged(info, file, file_size, expected, frames, &middle) != EXIT_SUCCESS) {
+        goto exit;
+    }
+
+    printf("Decoded %zu frames of %s from %zu bytes\n", frames, info->name, file_size);
+    returnVal = EXIT_SUCCESS;
+exit:
+    remove(TEST_PROGRAM_BATCH_PATH);
+    remove(TEST_PROGRAM_DAMAGED_PATH);
+    oswrapper_audio_free_pcm(&audio_spec, pcm);
+    free(expected);
+    free(file);
+    return returnVal;
+}
+
+/* Decodes a given audio file, and encodes it as ALAC in a variety of formats */
+int main(int argc, char** argv) {
+    return run_tests(argc, argv, test_files, TEST_FILE_COUNT, test_file);
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
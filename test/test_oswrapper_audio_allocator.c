@@ -0,0 +1,424 @@
+/*
+This program uses oswrapper_audio to decode an audio file with a custom allocator,
+from a path, from memory, from callbacks, by pushing it in pieces, and with oswrapper_audio_decode_all,
+in a variety of output formats.
+The allocator counts every allocation, and checks that each one is aligned, freed once, and freed with the same user data.
+The decoded audio is checked against the same file decoded without a custom allocator.
+
+Usage: test_oswrapper_audio_allocator (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_allocator.c
+*/
+
+#ifdef OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL
+/* Decode audio with miniaudio instead of the OS audio decoders */
+#define MA_NO_DEVICE_IO
+#define MA_NO_ENCODING
+#define MA_NO_RESOURCE_MANAGER
+#define MA_NO_NODE_GRAPH
+#define MA_NO_ENGINE
+#define MA_NO_GENERATION
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+#endif
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The largest amount of frames decoded at once */
+#define TEST_PROGRAM_BUFFER_SIZE 0x50
+/* The size of each piece of the file pushed to the decoder */
+#define TEST_PROGRAM_PIECE_SIZE 0x301
+/* Stored before each allocation, to find the block returned by malloc and the size of the allocation */
+#define TEST_PROGRAM_HEADER_SIZE (sizeof(unsigned char*) + sizeof(size_t))
+
+typedef enum {
+    TEST_LOAD_FROM_PATH,
+    TEST_LOAD_FROM_MEMORY,
+    TEST_LOAD_FROM_CALLBACKS,
+    TEST_LOAD_PUSH
+} test_load_type;
+
+/* Passed to the allocator as user data */
+typedef struct test_allocator_stats {
+    size_t allocations;
+    size_t reallocations;
+    size_t live_allocations;
+    size_t live_bytes;
+    size_t errors;
+} test_allocator_stats;
+
+static void* test_alloc(size_t size, size_t alignment, void* user_data) {
+    test_allocator_stats* stats = (test_allocator_stats*) user_data;
+    unsigned char* block;
+    unsigned char* ptr;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        stats->errors++;
+        return NULL;
+    }
+
+    block = (unsigned char*) malloc(TEST_PROGRAM_HEADER_SIZE + alignment + size);
+
+    if (block == NULL) {
+        return NULL;
+    }
+
+    ptr = block + TEST_PROGRAM_HEADER_SIZE;
+    ptr += (alignment - ((size_t) ptr % alignment)) % alignment;
+    memcpy(ptr - sizeof(unsigned char*), &block, sizeof(unsigned char*));
+    memcpy(ptr - TEST_PROGRAM_HEADER_SIZE, &size, sizeof(size_t));
+    stats->allocations++;
+    stats->live_allocations++;
+    stats->live_bytes += size;
+    return ptr;
+}
+
+static void test_free(void* ptr, void* user_data) {
+    test_allocator_stats* stats = (test_allocator_stats*) user_data;
+    unsigned char* block;
+    size_t size;
+
+    if (ptr == NULL || stats->live_allocations == 0) {
+        stats->errors++;
+        return;
+    }
+
+    memcpy(&block, (unsigned char*) ptr - sizeof(unsigned char*), sizeof(unsigned char*));
+    memcpy(&size, (unsigned char*) ptr - TEST_PROGRAM_HEADER_SIZE, sizeof(size_t));
+    stats->live_allocations--;
+    stats->live_bytes -= size;
+    free(block);
+}
+
+static void* test_realloc(void* ptr, size_t old_size, size_t new_size, size_t alignment, void* user_data) {
+    test_allocator_stats* stats = (test_allocator_stats*) user_data;
+    void* new_ptr;
+    stats->reallocations++;
+
+    if (ptr != NULL) {
+        size_t size;
+        memcpy(&size, (unsigned char*) ptr - TEST_PROGRAM_HEADER_SIZE, sizeof(size_t));
+
+        /* The old size must be the size the memory was allocated with */
+        if (size != old_size) {
+            stats->errors++;
+        }
+    }
+
+    new_ptr = test_alloc(new_size, alignment, user_data);
+
+    if (new_ptr != NULL && ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        test_free(ptr, user_data);
+    }
+
+    return new_ptr;
+}
+
+/* Callbacks for reading the input file with stdio, to test oswrapper_audio_load_from_callbacks */
+static size_t test_read_callback(void* user_data, void* buffer, size_t bytes_to_read) {
+    return fread(buffer, 1, bytes_to_read, (FILE*) user_data);
+}
+
+static OSWRAPPER_AUDIO_RESULT_TYPE test_seek_callback(void* user_data, OSWRAPPER_AUDIO_SEEK_TYPE offset, OSWrapper_audio_seek_origin origin) {
+    int whence = origin == OSWRAPPER_AUDIO_SEEK_ORIGIN_END ? SEEK_END : origin == OSWRAPPER_AUDIO_SEEK_ORIGIN_CURRENT ? SEEK_CUR : SEEK_SET;
+    return fseek((FILE*) user_data, (long) offset, whence) == 0;
+}
+
+static OSWRAPPER_AUDIO_SEEK_TYPE test_tell_callback(void* user_data) {
+    return ftell((FILE*) user_data);
+}
+
+/* Reads the whole file at the given path into memory */
+static unsigned char* read_file(const char* path, size_t* size) {
+    unsigned char* data = NULL;
+    long file_size;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char*) malloc((size_t) file_size);
+
+        if (data != NULL && fread(data, 1, (size_t) file_size, file) != (size_t) file_size) {
+            free(data);
+            data = NULL;
+        }
+
+        *size = (size_t) file_size;
+    }
+
+    fclose(file);
+    return data;
+}
+
+/* Checks that the allocator was used, and that everything it allocated has been freed */
+static int check_stats(const test_allocator_stats* stats, const char* name) {
+    if (stats->errors != 0) {
+        printf("%s: the allocator was used incorrectly %zu times!\n", name, stats->errors);
+        return EXIT_FAILURE;
+    }
+
+    if (stats->allocations == 0) {
+        printf("%s: the allocator wasn't used!\n", name);
+        return EXIT_FAILURE;
+    }
+
+    if (stats->live_allocations != 0) {
+        printf("%s: %zu allocations (%zu bytes) were never freed!\n", name, stats->live_allocations, stats->live_bytes);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Loads the file in the given way with the given allocator, and checks the decoded audio against the reference audio */
+static int test_load(test_load_type load_type, const char* path, const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints, OSWrapper_audio_allocator* allocator, const unsigned char* reference, size_t reference_frames) {
+    static const char* const load_names[] = { "path", "memory", "callbacks", "push" };
+    int returnVal = EXIT_FAILURE;
+    test_allocator_stats stats;
+    OSWrapper_audio_spec audio_spec = *hints;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded = OSWRAPPER_AUDIO_RESULT_FAILURE;
+    unsigned char* buffer = NULL;
+    FILE* input_file = NULL;
+    size_t frame_size = 0;
+    size_t frames_done = 0;
+    size_t data_pos = 0;
+    memset(&stats, 0, sizeof(stats));
+    allocator->user_data = &stats;
+    audio_spec.allocator = allocator;
+
+    if (load_type == TEST_LOAD_FROM_PATH) {
+        loaded = oswrapper_audio_load_from_path(path, &audio_spec);
+    } else if (load_type == TEST_LOAD_FROM_MEMORY) {
+        loaded = oswrapper_audio_load_from_memory(data, data_size, &audio_spec);
+    } else if (load_type == TEST_LOAD_FROM_CALLBACKS) {
+        input_file = fopen(path, "rb");
+        loaded = input_file != NULL && oswrapper_audio_load_from_callbacks(test_read_callback, test_seek_callback, test_tell_callback, input_file, &audio_spec);
+    } else {
+        loaded = oswrapper_audio_load_push(&audio_spec);
+    }
+
+    if (!loaded) {
+        printf("Could not decode audio from %s!\n", load_names[load_type]);
+        goto exit;
+    }
+
+    while (1) {
+        size_t this_iter;
+
+        if (buffer == NULL && audio_spec.sample_rate != 0) {
+            frame_size = (audio_spec.bits_per_channel / 8) * audio_spec.channel_count;
+            buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+
+            if (buffer == NULL) {
+                puts("malloc failed for audio decoding buffer!");
+                goto exit;
+            }
+        }
+
+        this_iter = buffer != NULL ? oswrapper_audio_get_samples(&audio_spec, (short*) buffer, TEST_PROGRAM_BUFFER_SIZE) : OSWRAPPER_AUDIO_NEED_MORE_DATA;
+
+        if (this_iter == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            size_t piece_size = data_size - data_pos < TEST_PROGRAM_PIECE_SIZE ? data_size - data_pos : TEST_PROGRAM_PIECE_SIZE;
+
+            if (piece_size == 0) {
+                oswrapper_audio_push_end(&audio_spec);
+            } else if (!oswrapper_audio_push_bytes(&audio_spec, data + data_pos, piece_size)) {
+                printf("Could not push %zu bytes at offset %zu!\n", piece_size, data_pos);
+                goto exit;
+            }
+
+            data_pos += piece_size;
+            continue;
+        }
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        if (frames_done + this_iter > reference_frames || memcmp(buffer, reference + (frames_done * frame_size), this_iter * frame_size) != 0) {
+            printf("Audio decoded from %s did not match at frame %zu!\n", load_names[load_type], frames_done);
+            goto exit;
+        }
+
+        frames_done += this_iter;
+    }
+
+    if (frames_done != reference_frames) {
+        printf("Decoded %zu frames from %s, expected %zu!\n", frames_done, load_names[load_type], reference_frames);
+        goto exit;
+    }
+
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded && !oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (input_file != NULL) {
+        fclose(input_file);
+    }
+
+    free(buffer);
+
+    if (returnVal == EXIT_SUCCESS) {
+        returnVal = check_stats(&stats, load_names[load_type]);
+    }
+
+    if (returnVal == EXIT_SUCCESS) {
+        printf("Decoded from %s with %zu allocations and %zu reallocations\n", load_names[load_type], stats.allocations, stats.reallocations);
+    }
+
+    return returnVal;
+}
+
+/* Fully decodes the file with the given allocator, and checks the decoded audio against the reference audio */
+static int test_decode_all(const unsigned char* data, size_t data_size, const OSWrapper_audio_spec* hints, OSWrapper_audio_allocator* allocator, const unsigned char* reference, size_t reference_frames, size_t frame_size) {
+    int returnVal = EXIT_FAILURE;
+    test_allocator_stats stats;
+    OSWrapper_audio_spec audio_spec = *hints;
+    void* pcm = NULL;
+    size_t pcm_frames = 0;
+    memset(&stats, 0, sizeof(stats));
+    allocator->user_data = &stats;
+    audio_spec.allocator = allocator;
+
+    if (!oswrapper_audio_decode_all(data, data_size, &audio_spec, &pcm, &pcm_frames)) {
+        puts("Could not decode audio with oswrapper_audio_decode_all!");
+        return EXIT_FAILURE;
+    }
+
+    if (stats.live_allocations != 1 || ((size_t) pcm % (allocator->alignment != 0 ? allocator->alignment : 16)) != 0) {
+        puts("oswrapper_audio_decode_all didn't return one aligned allocation!");
+    } else if (pcm_frames != reference_frames || memcmp(pcm, reference, reference_frames * frame_size) != 0) {
+        puts("Audio decoded with oswrapper_audio_decode_all did not match!");
+    } else {
+        returnVal = EXIT_SUCCESS;
+    }
+
+    oswrapper_audio_free_pcm(&audio_spec, pcm);
+
+    if (returnVal == EXIT_SUCCESS) {
+        returnVal = check_stats(&stats, "decode_all");
+    }
+
+    return returnVal;
+}
+
+/* Decodes the file in every way with the given output format hints and allocator */
+static int test_allocator(const char* path, const unsigned char* data, size_t data_size, unsigned long sample_rate, unsigned int channel_count, unsigned int bits_per_channel, OSWrapper_audio_type audio_type, OSWrapper_audio_allocator* allocator) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec hints;
+    OSWrapper_audio_spec reference_spec;
+    void* reference = NULL;
+    size_t reference_frames = 0;
+    size_t frame_size;
+    memset(&hints, 0, sizeof(hints));
+    hints.sample_rate = sample_rate;
+    hints.channel_count = channel_count;
+    hints.bits_per_channel = bits_per_channel;
+    hints.audio_type = audio_type;
+    reference_spec = hints;
+
+    /* The reference audio is decoded without a custom allocator */
+    if (!oswrapper_audio_decode_all(data, data_size, &reference_spec, &reference, &reference_frames)) {
+        puts("Could not decode reference audio!");
+        return EXIT_FAILURE;
+    }
+
+    frame_size = (reference_spec.bits_per_channel / 8) * reference_spec.channel_count;
+    printf("Testing %u channels of %u bit samples at %lu Hz, %s realloc_func, with %lu byte alignment\n", reference_spec.channel_count, reference_spec.bits_per_channel, reference_spec.sample_rate,
+           allocator->realloc_func != NULL ? "with" : "without", (unsigned long) (allocator->alignment != 0 ? allocator->alignment : 16));
+
+    if (test_load(TEST_LOAD_FROM_PATH, path, data, data_size, &hints, allocator, (const unsigned char*) reference, reference_frames) == EXIT_SUCCESS
+            && test_load(TEST_LOAD_FROM_MEMORY, path, data, data_size, &hints, allocator, (const unsigned char*) reference, reference_frames) == EXIT_SUCCESS
+            && test_load(TEST_LOAD_FROM_CALLBACKS, path, data, data_size, &hints, allocator, (const unsigned char*) reference, reference_frames) == EXIT_SUCCESS
+#ifndef OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL
+            && test_load(TEST_LOAD_PUSH, path, data, data_size, &hints, allocator, (const unsigned char*) reference, reference_frames) == EXIT_SUCCESS
+#endif
+            && test_decode_all(data, data_size, &hints, allocator, (const unsigned char*) reference, reference_frames, frame_size) == EXIT_SUCCESS) {
+        returnVal = EXIT_SUCCESS;
+    }
+
+    oswrapper_audio_free_pcm(&reference_spec, reference);
+    return returnVal;
+}
+
+/* Decodes a given audio file with custom allocators */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    OSWrapper_audio_allocator allocators[2];
+    size_t data_size = 0;
+    unsigned char* data;
+    int i;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    /* Without realloc_func, and with the default alignment */
+    allocators[0].alloc_func = test_alloc;
+    allocators[0].realloc_func = NULL;
+    allocators[0].free_func = test_free;
+    allocators[0].user_data = NULL;
+    allocators[0].alignment = 0;
+    /* With realloc_func, and with a larger alignment */
+    allocators[1] = allocators[0];
+    allocators[1].realloc_func = test_realloc;
+    allocators[1].alignment = 64;
+    data = read_file(path, &data_size);
+
+    if (data == NULL) {
+        puts("Could not read file!");
+        returnVal = EXIT_FAILURE;
+    } else {
+        for (i = 0; i < 2; i++) {
+            if (test_allocator(path, data, data_size, 0, 0, 0, OSWRAPPER_AUDIO_FORMAT_NOT_SET, &allocators[i]) != EXIT_SUCCESS
+                    || test_allocator(path, data, data_size, 0, 6, 24, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER, &allocators[i]) != EXIT_SUCCESS
+                    || test_allocator(path, data, data_size, 48000, 2, 32, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT, &allocators[i]) != EXIT_SUCCESS) {
+                returnVal = EXIT_FAILURE;
+                break;
+            }
+        }
+
+        free(data);
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
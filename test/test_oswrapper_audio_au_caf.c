@@ -0,0 +1,820 @@
+/*
+This program uses oswrapper_audio to decode AU and CAF files with the portable decoder.
+An audio file is decoded to 16 bit stereo PCM, which is stored in AU and CAF files in memory
+with a variety of sample formats, byte orders, and chunk layouts, including Apple IMA4 ADPCM.
+Each file is decoded again, and checked against the samples it was made from.
+IMA4 files are also checked when seeking, loading from callbacks, and pushing the file in pieces,
+and PCM files are checked to be read directly from memory with oswrapper_audio_peek_samples.
+
+Usage: test_oswrapper_audio_au_caf (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_au_caf.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The amount of channels the test files have */
+#define TEST_PROGRAM_CHANNELS 2
+/* The amount of frames in each IMA4 packet, and the size of each channel's part of the packet */
+#define TEST_PROGRAM_IMA4_FRAMES 64
+#define TEST_PROGRAM_IMA4_BYTES 34
+/* The largest piece of a file pushed at once */
+#define TEST_PROGRAM_MAX_PUSH 0x400
+
+/* How the samples in a test file are stored */
+typedef enum {
+    TEST_SAMPLE_INT = 0,
+    TEST_SAMPLE_FLOAT,
+    TEST_SAMPLE_ULAW,
+    TEST_SAMPLE_ALAW,
+    TEST_SAMPLE_IMA4
+} test_sample_type;
+
+typedef enum {
+    TEST_CONTAINER_AU = 0,
+    TEST_CONTAINER_CAF
+} test_container;
+
+/* Changes to the layout of the test files */
+#define TEST_LAYOUT_UNKNOWN_SIZE 1
+#define TEST_LAYOUT_EXTRA_HEADER 2
+#define TEST_LAYOUT_PACKET_TABLE_AFTER_DATA 4
+#define TEST_LAYOUT_PRIMING 8
+
+typedef struct test_file_info {
+    const char* name;
+    test_container container;
+    test_sample_type type;
+    /* The size of each stored sample in bytes, or 0 for IMA4 */
+    unsigned int bytes;
+    int big_endian;
+    unsigned int layout;
+} test_file_info;
+
+static const test_file_info test_files[] = {
+    { "AU 8 bit", TEST_CONTAINER_AU, TEST_SAMPLE_INT, 1, 1, 0 },
+    { "AU 16 bit", TEST_CONTAINER_AU, TEST_SAMPLE_INT, 2, 1, TEST_LAYOUT_EXTRA_HEADER },
+    { "AU 24 bit", TEST_CONTAINER_AU, TEST_SAMPLE_INT, 3, 1, TEST_LAYOUT_UNKNOWN_SIZE },
+    { "AU 32 bit", TEST_CONTAINER_AU, TEST_SAMPLE_INT, 4, 1, 0 },
+    { "AU float", TEST_CONTAINER_AU, TEST_SAMPLE_FLOAT, 4, 1, TEST_LAYOUT_EXTRA_HEADER | TEST_LAYOUT_UNKNOWN_SIZE },
+    { "AU double", TEST_CONTAINER_AU, TEST_SAMPLE_FLOAT, 8, 1, 0 },
+    { "AU mu-law", TEST_CONTAINER_AU, TEST_SAMPLE_ULAW, 1, 1, 0 },
+    { "AU A-law", TEST_CONTAINER_AU, TEST_SAMPLE_ALAW, 1, 1, 0 },
+    { "CAF 8 bit", TEST_CONTAINER_CAF, TEST_SAMPLE_INT, 1, 1, 0 },
+    { "CAF 16 bit big-endian", TEST_CONTAINER_CAF, TEST_SAMPLE_INT, 2, 1, 0 },
+    { "CAF 16 bit little-endian", TEST_CONTAINER_CAF, TEST_SAMPLE_INT, 2, 0, TEST_LAYOUT_UNKNOWN_SIZE },
+    { "CAF 24 bit little-endian", TEST_CONTAINER_CAF, TEST_SAMPLE_INT, 3, 0, TEST_LAYOUT_EXTRA_HEADER },
+    { "CAF 32 bit big-endian", TEST_CONTAINER_CAF, TEST_SAMPLE_INT, 4, 1, 0 },
+    { "CAF float little-endian", TEST_CONTAINER_CAF, TEST_SAMPLE_FLOAT, 4, 0, 0 },
+    { "CAF double big-endian", TEST_CONTAINER_CAF, TEST_SAMPLE_FLOAT, 8, 1, TEST_LAYOUT_EXTRA_HEADER },
+    { "CAF mu-law", TEST_CONTAINER_CAF, TEST_SAMPLE_ULAW, 1, 1, 0 },
+    { "CAF A-law", TEST_CONTAINER_CAF, TEST_SAMPLE_ALAW, 1, 1, TEST_LAYOUT_UNKNOWN_SIZE },
+    { "CAF IMA4", TEST_CONTAINER_CAF, TEST_SAMPLE_IMA4, 0, 1, 0 },
+    { "CAF IMA4 with priming", TEST_CONTAINER_CAF, TEST_SAMPLE_IMA4, 0, 1, TEST_LAYOUT_PRIMING | TEST_LAYOUT_EXTRA_HEADER },
+    { "CAF IMA4 with the packet table after the data", TEST_CONTAINER_CAF, TEST_SAMPLE_IMA4, 0, 1, TEST_LAYOUT_PACKET_TABLE_AFTER_DATA | TEST_LAYOUT_PRIMING }
+};
+
+#define TEST_FILE_COUNT (sizeof(test_files) / sizeof(test_files[0]))
+
+/* Priming frames added before the audio in IMA4 files */
+#define TEST_PROGRAM_PRIMING_FRAMES 100
+
+static int system_is_big_endian(void) {
+    unsigned int value = 1;
+    return *(unsigned char*) &value == 0;
+}
+
+/* Reads the whole file at the given path into memory */
+static unsigned char* read_file(const char* path, size_t* size) {
+    unsigned char* data = NULL;
+    long file_size;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char*) malloc((size_t) file_size);
+
+        if (data != NULL && fread(data, 1, (size_t) file_size, file) != (size_t) file_size) {
+            free(data);
+            data = NULL;
+        }
+
+        *size = (size_t) file_size;
+    }
+
+    fclose(file);
+    return data;
+}
+
+static void write_u16_be(unsigned char* data, unsigned int value) {
+    data[0] = (unsigned char) (value >> 8);
+    data[1] = (unsigned char) value;
+}
+
+static void write_u32_be(unsigned char* data, unsigned long value) {
+    write_u16_be(data, (unsigned int) (value >> 16) & 0xFFFF);
+    write_u16_be(data + 2, (unsigned int) value & 0xFFFF);
+}
+
+static void write_u64_be(unsigned char* data, unsigned long long value) {
+    write_u32_be(data, (unsigned long) (value >> 32));
+    write_u32_be(data + 4, (unsigned long) (value & 0xFFFFFFFF));
+}
+
+/* The integer sample stored for a given source sample, left-justified in 32 bits.
+Extra low bits are filled from the sample index, so that every stored byte is checked. */
+static int get_expected_s32(unsigned int bytes, short sample, size_t index) {
+    unsigned int value = (unsigned int) (unsigned short) sample << 16;
+
+    if (bytes == 1) {
+        value &= 0xFF000000;
+    } else if (bytes == 3) {
+        value |= (unsigned int) (index & 0xFF) << 8;
+    } else if (bytes == 4) {
+        value |= (unsigned int) (index & 0xFFFF);
+    }
+
+    return (int) value;
+}
+
+/* Writes one sample which isn't IMA4 */
+static void write_sample(const test_file_info* info, unsigned char* output, short sample, size_t index) {
+    unsigned long long value = (unsigned int) get_expected_s32(info->bytes, sample, index);
+    unsigned int i;
+
+    if (info->type == TEST_SAMPLE_FLOAT && info->bytes == 4) {
+        float float_sample = (float) sample / 32768.0f;
+        unsigned int float_value;
+        memcpy(&float_value, &float_sample, 4);
+        value = (unsigned long long) float_value << 32;
+    } else if (info->type == TEST_SAMPLE_FLOAT) {
+        double double_sample = (double) sample / 32768.0;
+        memcpy(&value, &double_sample, 8);
+    } else if (info->type == TEST_SAMPLE_ULAW || info->type == TEST_SAMPLE_ALAW) {
+        /* Every possible value */
+        output[0] = (unsigned char) index;
+        return;
+    } else {
+        value <<= 32;
+    }
+
+    /* value is now left-justified in 64 bits */
+    for (i = 0; i < info->bytes; i++) {
+        unsigned int shift = 56 - (8 * (info->big_endian ? i : info->bytes - 1 - i));
+        output[i] = (unsigned char) (value >> shift);
+    }
+}
+
+static const short test_ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int test_ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/* The state of an IMA4 encoder for one channel */
+typedef struct test_ima_state {
+    long predictor;
+    int index;
+} test_ima_state;
+
+/* Encodes one channel of an IMA4 packet. The samples which the decoder should output are written to decoded. */
+static void encode_ima4_block(test_ima_state* state, const short* input, size_t input_stride, unsigned char* block, short* decoded, size_t decoded_stride) {
+    unsigned int i;
+    /* The header only stores the top 9 bits of the predictor */
+    unsigned int header = ((unsigned int) (state->predictor & 0xFFFF) & 0xFF80) | (unsigned int) state->index;
+    state->predictor = (long) (header & 0xFF80) - ((header & 0x8000) ? 0x10000L : 0);
+    write_u16_be(block, header);
+    memset(block + 2, 0, TEST_PROGRAM_IMA4_BYTES - 2);
+
+    for (i = 0; i < TEST_PROGRAM_IMA4_FRAMES; i++) {
+        long step = test_ima_step_table[state->index];
+        long delta = (long) input[i * input_stride] - state->predictor;
+        long diff = step >> 3;
+        unsigned int nibble = 0;
+
+        if (delta < 0) {
+            nibble = 8;
+            delta = -delta;
+        }
+
+        if (delta >= step) {
+            nibble |= 4;
+            delta -= step;
+            diff += step;
+        }
+
+        if (delta >= step >> 1) {
+            nibble |= 2;
+            delta -= step >> 1;
+            diff += step >> 1;
+        }
+
+        if (delta >= step >> 2) {
+            nibble |= 1;
+            diff += step >> 2;
+        }
+
+        state->predictor += (nibble & 8) ? -diff : diff;
+
+        if (state->predictor > 32767) {
+            state->predictor = 32767;
+        } else if (state->predictor < -32768) {
+            state->predictor = -32768;
+        }
+
+        state->index += test_ima_index_table[nibble];
+
+        if (state->index < 0) {
+            state->index = 0;
+        } else if (state->index > 88) {
+            state->index = 88;
+        }
+
+        block[2 + (i / 2)] |= (unsigned char) (nibble << ((i & 1) * 4));
+        decoded[i * decoded_stride] = (short) state->predictor;
+    }
+}
+
+/* Encodes the samples as IMA4, with priming_frames frames of silence first.
+The samples which the decoder should output, without the priming frames, are written to decoded.
+Returns the amount of packets. */
+static size_t encode_ima4(const short* samples, size_t frames, size_t priming_frames, unsigned char* output, short* decoded) {
+    test_ima_state states[TEST_PROGRAM_CHANNELS];
+    short packet_input[TEST_PROGRAM_IMA4_FRAMES * TEST_PROGRAM_CHANNELS];
+    short packet_decoded[TEST_PROGRAM_IMA4_FRAMES * TEST_PROGRAM_CHANNELS];
+    size_t packet_count = (frames + priming_frames + TEST_PROGRAM_IMA4_FRAMES - 1) / TEST_PROGRAM_IMA4_FRAMES;
+    size_t packet;
+    unsigned int channel;
+    memset(states, 0, sizeof(states));
+
+    for (packet = 0; packet < packet_count; packet++) {
+        size_t i;
+
+        /* Silence before and after the samples */
+        for (i = 0; i < TEST_PROGRAM_IMA4_FRAMES; i++) {
+            size_t frame = (packet * TEST_PROGRAM_IMA4_FRAMES) + i;
+
+            for (channel = 0; channel < TEST_PROGRAM_CHANNELS; channel++) {
+                packet_input[(i * TEST_PROGRAM_CHANNELS) + channel] = frame >= priming_frames && frame - priming_frames < frames ? samples[((frame - priming_frames) * TEST_PROGRAM_CHANNELS) + channel] : 0;
+            }
+        }
+
+        for (channel = 0; channel < TEST_PROGRAM_CHANNELS; channel++) {
+            encode_ima4_block(&states[channel], packet_input + channel, TEST_PROGRAM_CHANNELS, output + (((packet * TEST_PROGRAM_CHANNELS) + channel) * TEST_PROGRAM_IMA4_BYTES), packet_decoded + channel, TEST_PROGRAM_CHANNELS);
+        }
+
+        for (i = 0; i < TEST_PROGRAM_IMA4_FRAMES; i++) {
+            size_t frame = (packet * TEST_PROGRAM_IMA4_FRAMES) + i;
+
+            if (frame >= priming_frames && frame - priming_frames < frames) {
+                memcpy(decoded + ((frame - priming_frames) * TEST_PROGRAM_CHANNELS), packet_decoded + (i * TEST_PROGRAM_CHANNELS), TEST_PROGRAM_CHANNELS * sizeof(short));
+            }
+        }
+    }
+
+    return packet_count;
+}
+
+/* Creates an AU file in memory from 16 bit stereo samples */
+static unsigned char* create_au(const test_file_info* info, const short* samples, size_t frames, size_t* size) {
+    static const unsigned long encodings[] = { 2, 3, 4, 5 };
+    size_t header_size = (info->layout & TEST_LAYOUT_EXTRA_HEADER) ? 32 : 24;
+    size_t data_size = frames * TEST_PROGRAM_CHANNELS * info->bytes;
+    unsigned char* data = (unsigned char*) calloc(1, header_size + data_size);
+    unsigned long encoding;
+    size_t i;
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    if (info->type == TEST_SAMPLE_FLOAT) {
+        encoding = info->bytes == 4 ? 6 : 7;
+    } else if (info->type == TEST_SAMPLE_ULAW) {
+        encoding = 1;
+    } else if (info->type == TEST_SAMPLE_ALAW) {
+        encoding = 27;
+    } else {
+        encoding = encodings[info->bytes - 1];
+    }
+
+    memcpy(data, ".snd", 4);
+    write_u32_be(data + 4, (unsigned long) header_size);
+    write_u32_be(data + 8, (info->layout & TEST_LAYOUT_UNKNOWN_SIZE) ? 0xFFFFFFFF : (unsigned long) data_size);
+    write_u32_be(data + 12, encoding);
+    write_u32_be(data + 16, 44100);
+    write_u32_be(data + 20, TEST_PROGRAM_CHANNELS);
+
+    for (i = 0; i < frames * TEST_PROGRAM_CHANNELS; i++) {
+        write_sample(info, data + header_size + (i * info->bytes), samples[i], i);
+    }
+
+    *size = header_size + data_size;
+    return data;
+}
+
+/* Writes a CAF chunk header, and returns where the chunk's data goes */
+static unsigned char* write_caf_chunk(unsigned char* data, const char* type, unsigned long long size) {
+    memcpy(data, type, 4);
+    write_u64_be(data + 4, size);
+    return data + 12;
+}
+
+/* Creates a CAF file in memory from 16 bit stereo samples.
+For IMA4 files, the samples which the decoder should output are written to ima4_decoded. */
+static unsigned char* create_caf(const test_file_info* info, const short* samples, size_t frames, short* ima4_decoded, size_t* size) {
+    size_t priming_frames = (info->layout & TEST_LAYOUT_PRIMING) ? TEST_PROGRAM_PRIMING_FRAMES : 0;
+    size_t max_packets = (frames + priming_frames + TEST_PROGRAM_IMA4_FRAMES - 1) / TEST_PROGRAM_IMA4_FRAMES;
+    size_t bytes_per_packet = info->type == TEST_SAMPLE_IMA4 ? TEST_PROGRAM_IMA4_BYTES * TEST_PROGRAM_CHANNELS : info->bytes * TEST_PROGRAM_CHANNELS;
+    size_t max_data_size = info->type == TEST_SAMPLE_IMA4 ? max_packets * bytes_per_packet : frames * bytes_per_packet;
+    /* The header, desc, free, pakt, and data chunks */
+    unsigned char* data = (unsigned char*) calloc(1, 8 + (12 + 32) + (12 + 5) + (12 + 24) + (12 + 4 + max_data_size));
+    unsigned char* chunk;
+    unsigned char* audio_data;
+    size_t data_size;
+    size_t packet_count = 0;
+    unsigned long format_flags = info->big_endian ? 0 : 2;
+    double sample_rate = 44100.0;
+    unsigned long long sample_rate_bits;
+    size_t i;
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    memcpy(data, "caff", 4);
+    write_u16_be(data + 4, 1);
+    write_u16_be(data + 6, 0);
+    chunk = write_caf_chunk(data + 8, "desc", 32);
+    memcpy(&sample_rate_bits, &sample_rate, 8);
+    write_u64_be(chunk, sample_rate_bits);
+
+    if (info->type == TEST_SAMPLE_IMA4) {
+        memcpy(chunk + 8, "ima4", 4);
+        format_flags = 0;
+    } else if (info->type == TEST_SAMPLE_ULAW) {
+        memcpy(chunk + 8, "ulaw", 4);
+        format_flags = 0;
+    } else if (info->type == TEST_SAMPLE_ALAW) {
+        memcpy(chunk + 8, "alaw", 4);
+        format_flags = 0;
+    } else {
+        memcpy(chunk + 8, "lpcm", 4);
+        format_flags |= info->type == TEST_SAMPLE_FLOAT ? 1 : 0;
+    }
+
+    write_u32_be(chunk + 12, format_flags);
+    write_u32_be(chunk + 16, (unsigned long) bytes_per_packet);
+    write_u32_be(chunk + 20, info->type == TEST_SAMPLE_IMA4 ? TEST_PROGRAM_IMA4_FRAMES : 1);
+    write_u32_be(chunk + 24, TEST_PROGRAM_CHANNELS);
+    write_u32_be(chunk + 28, info->type == TEST_SAMPLE_IMA4 ? 0 : info->bytes * 8);
+    chunk += 32;
+
+    /* An unknown chunk with an odd size, which isn't padded in CAF files */
+    if (info->layout & TEST_LAYOUT_EXTRA_HEADER) {
+        chunk = write_caf_chunk(chunk, "free", 5) + 5;
+    }
+
+    audio_data = chunk + 12 + 4;
+
+    if (info->type == TEST_SAMPLE_IMA4) {
+        packet_count = encode_ima4(samples, frames, priming_frames, info->layout & TEST_LAYOUT_PACKET_TABLE_AFTER_DATA ? audio_data : audio_data + 12 + 24, ima4_decoded);
+        data_size = packet_count * bytes_per_packet;
+
+        if (!(info->layout & TEST_LAYOUT_PACKET_TABLE_AFTER_DATA)) {
+            chunk = write_caf_chunk(chunk, "pakt", 24);
+            write_u64_be(chunk, packet_count);
+            write_u64_be(chunk + 8, frames);
+            write_u32_be(chunk + 16, (unsigned long) priming_frames);
+            write_u32_be(chunk + 20, (unsigned long) ((packet_count * TEST_PROGRAM_IMA4_FRAMES) - frames - priming_frames));
+            chunk += 24;
+        }
+    } else {
+        for (i = 0; i < frames * TEST_PROGRAM_CHANNELS; i++) {
+            write_sample(info, audio_data + (i * info->bytes), samples[i], i);
+        }
+
+        data_size = frames * bytes_per_packet;
+    }
+
+    /* The data chunk starts with the edit count */
+    write_caf_chunk(chunk, "data", (info->layout & TEST_LAYOUT_UNKNOWN_SIZE) ? (unsigned long long) -1 : 4 + data_size);
+    chunk += 12 + 4 + data_size;
+
+    if (info->type == TEST_SAMPLE_IMA4 && (info->layout & TEST_LAYOUT_PACKET_TABLE_AFTER_DATA)) {
+        chunk = write_caf_chunk(chunk, "pakt", 24);
+        write_u64_be(chunk, packet_count);
+        write_u64_be(chunk + 8, frames);
+        write_u32_be(chunk + 16, (unsigned long) priming_frames);
+        write_u32_be(chunk + 20, (unsigned long) ((packet_count * TEST_PROGRAM_IMA4_FRAMES) - frames - priming_frames));
+        chunk += 24;
+    }
+
+    *size = (size_t) (chunk - data);
+    return data;
+}
+
+/* Checks decoded audio against the samples the file was made from */
+static int check_samples(const test_file_info* info, const void* pcm, const short* samples, const short* ima4_decoded, size_t first_frame, size_t frames) {
+    size_t i;
+
+    for (i = first_frame * TEST_PROGRAM_CHANNELS; i < (first_frame + frames) * TEST_PROGRAM_CHANNELS; i++) {
+        size_t pcm_index = i - (first_frame * TEST_PROGRAM_CHANNELS);
+        int matches;
+
+        switch (info->type) {
+        case TEST_SAMPLE_FLOAT:
+            matches = info->bytes == 4 ? ((const float*) pcm)[pcm_index] == (float) samples[i] / 32768.0f : ((const double*) pcm)[pcm_index] == (double) samples[i] / 32768.0;
+            break;
+
+        case TEST_SAMPLE_ULAW:
+        case TEST_SAMPLE_ALAW:
+            /* The G.711 values are checked by test_oswrapper_audio_aiff, so just check that the right bytes were decoded */
+            matches = ((const short*) pcm)[pcm_index] == ((const short*) pcm)[(i & 0xFF) - (first_frame * TEST_PROGRAM_CHANNELS)]
+                      && ((const short*) pcm)[0] == (info->type == TEST_SAMPLE_ULAW ? -32124 : -5504);
+            break;
+
+        case TEST_SAMPLE_IMA4:
+            matches = ((const short*) pcm)[pcm_index] == ima4_decoded[i];
+            break;
+
+        default:
+            matches = ((const int*) pcm)[pcm_index] == get_expected_s32(info->bytes, samples[i], i);
+            break;
+        }
+
+        if (!matches) {
+            printf("%s did not match at sample %zu!\n", info->name, i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Reads from a test file in memory, for oswrapper_audio_load_from_callbacks */
+typedef struct test_memory_file {
+    const unsigned char* data;
+    size_t size;
+    size_t position;
+} test_memory_file;
+
+static size_t test_read(void* user_data, void* buffer, size_t size) {
+    test_memory_file* file = (test_memory_file*) user_data;
+    size_t remaining = file->size - file->position;
+
+    if (size > remaining) {
+        size = remaining;
+    }
+
+    memcpy(buffer, file->data + file->position, size);
+    file->position += size;
+    return size;
+}
+
+static int test_seek(void* user_data, OSWRAPPER_AUDIO_SEEK_TYPE offset, OSWrapper_audio_seek_origin origin) {
+    test_memory_file* file = (test_memory_file*) user_data;
+    OSWRAPPER_AUDIO_SEEK_TYPE base = origin == OSWRAPPER_AUDIO_SEEK_ORIGIN_START ? 0 : origin == OSWRAPPER_AUDIO_SEEK_ORIGIN_CURRENT ? (OSWRAPPER_AUDIO_SEEK_TYPE) file->position : (OSWRAPPER_AUDIO_SEEK_TYPE) file->size;
+
+    if (base + offset < 0 || base + offset > (OSWRAPPER_AUDIO_SEEK_TYPE) file->size) {
+        return 0;
+    }
+
+    file->position = (size_t) (base + offset);
+    return 1;
+}
+
+static OSWRAPPER_AUDIO_SEEK_TYPE test_tell(void* user_data) {
+    return (OSWRAPPER_AUDIO_SEEK_TYPE) ((test_memory_file*) user_data)->position;
+}
+
+/* Decodes an IMA4 file after seeking, from callbacks, and by pushing it in pieces */
+static int test_ima4_access(const test_file_info* info, const unsigned char* file, size_t file_size, const short* samples, const short* ima4_decoded, size_t frames) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    test_memory_file memory_file;
+    short* buffer = (short*) malloc(frames * TEST_PROGRAM_CHANNELS * sizeof(short));
+    /* Seek to positions in the middle of packets */
+    size_t seek_frames[] = { frames / 2 + 7, 65, frames - 3, 0 };
+    size_t frames_done;
+    size_t file_pos;
+    size_t i;
+
+    if (buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        return EXIT_FAILURE;
+    }
+
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (!oswrapper_audio_load_from_memory(file, file_size, &audio_spec)) {
+        printf("Could not decode %s!\n", info->name);
+        goto exit;
+    }
+
+    for (i = 0; i < sizeof(seek_frames) / sizeof(seek_frames[0]); i++) {
+        size_t frames_read;
+
+        if (!oswrapper_audio_seek(&audio_spec, (OSWRAPPER_AUDIO_SEEK_TYPE) seek_frames[i])) {
+            printf("Could not seek %s!\n", info->name);
+            oswrapper_audio_free_context(&audio_spec);
+            goto exit;
+        }
+
+        frames_read = oswrapper_audio_get_samples(&audio_spec, buffer, frames);
+
+        if (frames_read != frames - seek_frames[i] || check_samples(info, buffer, samples, ima4_decoded, seek_frames[i], frames_read) != EXIT_SUCCESS) {
+            printf("%s did not match after seeking to frame %zu!\n", info->name, seek_frames[i]);
+            oswrapper_audio_free_context(&audio_spec);
+            goto exit;
+        }
+    }
+
+    oswrapper_audio_free_context(&audio_spec);
+    memory_file.data = file;
+    memory_file.size = file_size;
+    memory_file.position = 0;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (!oswrapper_audio_load_from_callbacks(test_read, test_seek, test_tell, &memory_file, &audio_spec)) {
+        printf("Could not decode %s from callbacks!\n", info->name);
+        goto exit;
+    }
+
+    frames_done = oswrapper_audio_get_samples(&audio_spec, buffer, frames);
+    oswrapper_audio_free_context(&audio_spec);
+
+    if (frames_done != frames || check_samples(info, buffer, samples, ima4_decoded, 0, frames) != EXIT_SUCCESS) {
+        printf("%s did not match when decoding from callbacks!\n", info->name);
+        goto exit;
+    }
+
+    /* The packet table can't be used by the push decoder if it's after the data */
+    if (info->layout & TEST_LAYOUT_PACKET_TABLE_AFTER_DATA) {
+        returnVal = EXIT_SUCCESS;
+        goto exit;
+    }
+
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (!oswrapper_audio_load_push(&audio_spec)) {
+        puts("Could not create push decoder!");
+        goto exit;
+    }
+
+    frames_done = 0;
+    file_pos = 0;
+
+    while (frames_done < frames) {
+        size_t frames_read = oswrapper_audio_get_samples(&audio_spec, buffer + (frames_done * TEST_PROGRAM_CHANNELS), frames - frames_done);
+
+        if (frames_read == OSWRAPPER_AUDIO_NEED_MORE_DATA || frames_read == 0) {
+            size_t push_size = file_size - file_pos < TEST_PROGRAM_MAX_PUSH ? file_size - file_pos : (size_t) (rand() % TEST_PROGRAM_MAX_PUSH) + 1;
+
+            if (push_size == 0) {
+                oswrapper_audio_push_end(&audio_spec);
+                break;
+            }
+
+            if (!oswrapper_audio_push_bytes(&audio_spec, file + file_pos, push_size)) {
+                printf("Could not push %s!\n", info->name);
+                oswrapper_audio_free_context(&audio_spec);
+                goto exit;
+            }
+
+            file_pos += push_size;
+            continue;
+        }
+
+        frames_done += frames_read;
+    }
+
+    oswrapper_audio_free_context(&audio_spec);
+
+    if (frames_done != frames || check_samples(info, buffer, samples, ima4_decoded, 0, frames) != EXIT_SUCCESS) {
+        printf("%s did not match when pushed in pieces!\n", info->name);
+        goto exit;
+    }
+
+    returnVal = EXIT_SUCCESS;
+exit:
+    free(buffer);
+    return returnVal;
+}
+
+/* Checks that a CAF file with a chunk size which would wrap the offset around to an earlier chunk fails,
+instead of parsing the same chunks forever */
+static int test_malformed_caf(void) {
+    int returnVal = EXIT_FAILURE;
+    unsigned char file[64];
+    unsigned char* chunk;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_info probe_info;
+    double sample_rate = 44100.0;
+    unsigned long long sample_rate_bits;
+    memset(file, 0, sizeof(file));
+    memcpy(file, "caff", 4);
+    write_u16_be(file + 4, 1);
+    chunk = write_caf_chunk(file + 8, "desc", 32);
+    memcpy(&sample_rate_bits, &sample_rate, 8);
+    write_u64_be(chunk, sample_rate_bits);
+    memcpy(chunk + 8, "lpcm", 4);
+    write_u32_be(chunk + 16, 2 * TEST_PROGRAM_CHANNELS);
+    write_u32_be(chunk + 20, 1);
+    write_u32_be(chunk + 24, TEST_PROGRAM_CHANNELS);
+    write_u32_be(chunk + 28, 16);
+    /* The end of this chunk wraps around to the desc chunk */
+    write_caf_chunk(chunk + 32, "free", ((unsigned long long) -1) - (8 + 12 + 32 + 12) + 1 + 8);
+
+    if (oswrapper_audio_probe(file, sizeof(file), &probe_info)) {
+        puts("A CAF file with a wrapping chunk size was probed!");
+        return EXIT_FAILURE;
+    }
+
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (!oswrapper_audio_load_push(&audio_spec)) {
+        puts("Could not create push decoder!");
+        return EXIT_FAILURE;
+    }
+
+    if (oswrapper_audio_push_bytes(&audio_spec, file, sizeof(file))) {
+        puts("A CAF file with a wrapping chunk size was pushed!");
+    } else {
+        returnVal = EXIT_SUCCESS;
+    }
+
+    oswrapper_audio_free_context(&audio_spec);
+    return returnVal;
+}
+
+/* Creates a test file, then decodes it and checks the result */
+static int test_file(const test_file_info* info, const short* samples, size_t frames) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_info probe_info;
+    size_t file_size = 0;
+    short* ima4_decoded = NULL;
+    unsigned char* file;
+    void* pcm = NULL;
+    size_t pcm_frames = 0;
+
+    if (info->type == TEST_SAMPLE_IMA4) {
+        ima4_decoded = (short*) malloc(frames * TEST_PROGRAM_CHANNELS * sizeof(short));
+
+        if (ima4_decoded == NULL) {
+            puts("malloc failed for IMA4 samples!");
+            return EXIT_FAILURE;
+        }
+    }
+
+    file = info->container == TEST_CONTAINER_AU ? create_au(info, samples, frames, &file_size) : create_caf(info, samples, frames, ima4_decoded, &file_size);
+
+    if (file == NULL) {
+        puts("malloc failed for test file!");
+        free(ima4_decoded);
+        return EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_probe(file, file_size, &probe_info) || probe_info.sample_rate != 44100 || probe_info.channel_count != TEST_PROGRAM_CHANNELS || probe_info.total_frames != (OSWRAPPER_AUDIO_SEEK_TYPE) frames
+            || probe_info.bits_per_channel != (info->type == TEST_SAMPLE_INT || info->type == TEST_SAMPLE_FLOAT ? info->bytes * 8 : 0)
+            || probe_info.audio_type != (info->type == TEST_SAMPLE_FLOAT ? OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT : OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER)) {
+        printf("%s was probed incorrectly!\n", info->name);
+        goto exit;
+    }
+
+    /* Decode to the format which can hold every stored sample exactly */
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    audio_spec.audio_type = info->type == TEST_SAMPLE_FLOAT ? OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT : OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    audio_spec.bits_per_channel = info->type == TEST_SAMPLE_FLOAT ? info->bytes * 8 : info->type == TEST_SAMPLE_INT ? 32 : 16;
+
+    if (!oswrapper_audio_decode_all(file, file_size, &audio_spec, &pcm, &pcm_frames)) {
+        printf("Could not decode %s!\n", info->name);
+        goto exit;
+    }
+
+    if (pcm_frames != frames || audio_spec.sample_rate != 44100 || audio_spec.channel_count != TEST_PROGRAM_CHANNELS) {
+        printf("%s decoded to %zu frames, expected %zu!\n", info->name, pcm_frames, frames);
+        goto exit;
+    }
+
+    if (check_samples(info, pcm, samples, ima4_decoded, 0, frames) != EXIT_SUCCESS) {
+        goto exit;
+    }
+
+    if (info->type == TEST_SAMPLE_IMA4) {
+        if (test_ima4_access(info, file, file_size, samples, ima4_decoded, frames) != EXIT_SUCCESS) {
+            goto exit;
+        }
+    } else if (info->bytes == 2 && info->big_endian == system_is_big_endian()) {
+        /* PCM in the byte order of this system is read without copying it */
+        const void* peeked;
+        size_t peeked_frames;
+        OSWrapper_audio_spec peek_spec;
+        memset(&peek_spec, 0, sizeof(peek_spec));
+
+        if (!oswrapper_audio_load_from_memory(file, file_size, &peek_spec)) {
+            printf("Could not decode %s!\n", info->name);
+            goto exit;
+        }
+
+        if (!oswrapper_audio_peek_samples(&peek_spec, &peeked, &peeked_frames) || peeked_frames != frames || (const unsigned char*) peeked < file || (const unsigned char*) peeked >= file + file_size) {
+            printf("%s could not be read directly from memory!\n", info->name);
+            oswrapper_audio_free_context(&peek_spec);
+            goto exit;
+        }
+
+        oswrapper_audio_free_context(&peek_spec);
+    }
+
+    printf("Decoded %zu frames of %s\n", pcm_frames, info->name);
+    returnVal = EXIT_SUCCESS;
+exit:
+    oswrapper_audio_free_pcm(&audio_spec, pcm);
+    free(ima4_decoded);
+    free(file);
+    return returnVal;
+}
+
+/* Decodes a given audio file, and stores it in a variety of AU and CAF formats */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    OSWrapper_audio_spec source_spec;
+    void* samples = NULL;
+    size_t frames = 0;
+    size_t data_size = 0;
+    unsigned char* data;
+    size_t i;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    memset(&source_spec, 0, sizeof(source_spec));
+    source_spec.channel_count = TEST_PROGRAM_CHANNELS;
+    source_spec.bits_per_channel = 16;
+    source_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    data = read_file(path, &data_size);
+
+    /* Enough samples for every mu-law and A-law value */
+    if (data == NULL || !oswrapper_audio_decode_all(data, data_size, &source_spec, &samples, &frames) || frames * TEST_PROGRAM_CHANNELS < 256) {
+        puts("Could not decode audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(data);
+
+    for (i = 0; returnVal == EXIT_SUCCESS && i < TEST_FILE_COUNT; i++) {
+        if (test_file(&test_files[i], (const short*) samples, frames) != EXIT_SUCCESS) {
+            returnVal = EXIT_FAILURE;
+        }
+    }
+
+    if (returnVal == EXIT_SUCCESS && test_malformed_caf() != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    oswrapper_audio_free_pcm(&source_spec, samples);
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,203 @@
+/*
+This program uses oswrapper_audio to decode the same audio file many times with oswrapper_audio_decode_batch,
+with a variety of thread counts and output format hints.
+The decoded audio is checked against the same file decoded with oswrapper_audio_get_samples.
+A path which doesn't exist is also included, which should fail without affecting the other files.
+
+Usage: test_oswrapper_audio_batch (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_batch.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_USE_THREADS
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+#include <objbase.h>
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfreadwrite.lib")
+#pragma comment(lib, "shlwapi.lib")
+#pragma comment(lib, "Ole32.lib")
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_PROGRAM_FILE_COUNT 64
+#define TEST_PROGRAM_MISSING_INDEX 5
+#define TEST_PROGRAM_MISSING_PATH "this_file_does_not_exist.wav"
+
+/* Decodes the whole file with oswrapper_audio_get_samples, with the given output format hints */
+static unsigned char* decode_reference(const char* path, const OSWrapper_audio_spec* spec_hint, OSWrapper_audio_spec* output_spec, size_t* frames) {
+    OSWrapper_audio_spec audio_spec = *spec_hint;
+    OSWRAPPER_AUDIO_SEEK_TYPE length = 0;
+    unsigned char* decoded = NULL;
+    size_t frame_size;
+
+    if (!oswrapper_audio_load_from_path(path, &audio_spec)) {
+        puts("Could not decode audio!");
+        return NULL;
+    }
+
+    if (oswrapper_audio_get_length(&audio_spec, &length) == OSWRAPPER_AUDIO_LENGTH_UNKNOWN || length <= 0) {
+        puts("Could not get the length of the audio!");
+        goto exit;
+    }
+
+    frame_size = (audio_spec.bits_per_channel / 8) * audio_spec.channel_count;
+    decoded = (unsigned char*) malloc((size_t) length * frame_size);
+
+    if (decoded == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    *frames = oswrapper_audio_get_samples(&audio_spec, (short*) decoded, (size_t) length);
+    *output_spec = audio_spec;
+exit:
+
+    if (!oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+    }
+
+    return decoded;
+}
+
+/* Decodes the file many times with the given thread count and output format hints, and checks every result */
+static int test_batch(const char* path, unsigned int threads, const OSWrapper_audio_spec* spec_hint, int include_missing) {
+    int returnVal = EXIT_FAILURE;
+    const char* paths[TEST_PROGRAM_FILE_COUNT];
+    OSWrapper_audio_batch_result results[TEST_PROGRAM_FILE_COUNT];
+    OSWrapper_audio_spec reference_spec;
+    unsigned char* reference = NULL;
+    size_t reference_frames = 0;
+    size_t frame_size;
+    size_t i;
+    OSWRAPPER_AUDIO_RESULT_TYPE batch_result;
+    memset(&reference_spec, 0, sizeof(reference_spec));
+    reference = decode_reference(path, spec_hint, &reference_spec, &reference_frames);
+
+    if (reference == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    frame_size = (reference_spec.bits_per_channel / 8) * reference_spec.channel_count;
+
+    for (i = 0; i < TEST_PROGRAM_FILE_COUNT; i++) {
+        paths[i] = include_missing && i == TEST_PROGRAM_MISSING_INDEX ? TEST_PROGRAM_MISSING_PATH : path;
+    }
+
+    batch_result = oswrapper_audio_decode_batch(paths, TEST_PROGRAM_FILE_COUNT, spec_hint, results, threads);
+
+    if (batch_result != (include_missing ? OSWRAPPER_AUDIO_RESULT_FAILURE : OSWRAPPER_AUDIO_RESULT_SUCCESS)) {
+        printf("Batch decoding returned %d with %u threads!\n", (int) batch_result, threads);
+        goto exit;
+    }
+
+    for (i = 0; i < TEST_PROGRAM_FILE_COUNT; i++) {
+        if (include_missing && i == TEST_PROGRAM_MISSING_INDEX) {
+            if (results[i].decoded || results[i].frames != 0) {
+                puts("Missing file was decoded!");
+                goto exit;
+            }
+
+            continue;
+        }
+
+        if (!results[i].decoded || results[i].samples == NULL) {
+            printf("File %zu wasn't decoded!\n", i);
+            goto exit;
+        }
+
+        if (results[i].spec.internal_data != NULL || results[i].spec.sample_rate != reference_spec.sample_rate || results[i].spec.channel_count != reference_spec.channel_count
+                || results[i].spec.bits_per_channel != reference_spec.bits_per_channel || results[i].spec.audio_type != reference_spec.audio_type) {
+            printf("File %zu had the wrong output format!\n", i);
+            goto exit;
+        }
+
+        if (((size_t) results[i].samples % sizeof(double)) != 0) {
+            printf("File %zu wasn't aligned!\n", i);
+            goto exit;
+        }
+
+        if (results[i].frames != reference_frames || memcmp(results[i].samples, reference, reference_frames * frame_size) != 0) {
+            printf("File %zu did not match!\n", i);
+            goto exit;
+        }
+    }
+
+    printf("Decoded %d files of %zu frames with %u threads\n", TEST_PROGRAM_FILE_COUNT, reference_frames, threads);
+    returnVal = EXIT_SUCCESS;
+exit:
+    oswrapper_audio_free_batch(results, TEST_PROGRAM_FILE_COUNT);
+    free(reference);
+    return returnVal;
+}
+
+/* Decodes a given audio file many times at once with a variety of thread counts */
+int main(int argc, char** argv) {
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    HRESULT result = CoInitialize(NULL);
+
+    if (FAILED(result)) {
+        puts("CoInitialize failed!");
+        return EXIT_FAILURE;
+    }
+
+#endif
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    OSWrapper_audio_spec default_hint;
+    OSWrapper_audio_spec converted_hint;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    memset(&default_hint, 0, sizeof(default_hint));
+    memset(&converted_hint, 0, sizeof(converted_hint));
+    converted_hint.sample_rate = 48000;
+    converted_hint.channel_count = 2;
+    converted_hint.bits_per_channel = 32;
+    converted_hint.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
+
+    if (test_batch(path, 1, &default_hint, 0) != EXIT_SUCCESS
+            || test_batch(path, 4, &default_hint, 1) != EXIT_SUCCESS
+            || test_batch(path, 0, &default_hint, 0) != EXIT_SUCCESS
+            || test_batch(path, 1, &converted_hint, 1) != EXIT_SUCCESS
+            || test_batch(path, 0, &converted_hint, 1) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    CoUninitialize();
+#endif
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
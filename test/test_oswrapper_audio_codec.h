@@ -0,0 +1,505 @@
+/*
+The parts of the tests for the portable decoder's compressed formats which don't depend on the format
+(test_oswrapper_audio_flac.c and test_oswrapper_audio_alac.c).
+Each test encodes test files in memory, then uses these functions to check that they decode correctly
+after seeking, from callbacks, when pushed in pieces, when loaded in place, with a damaged part of the file,
+and when decoded in pieces on several threads.
+
+Include this after the oswrapper_audio.h implementation (with OSWRAPPER_AUDIO_USE_THREADS),
+after defining test_file_info with a name and a channel_count,
+and after defining TEST_PROGRAM_BATCH_PATH and TEST_PROGRAM_DAMAGED_PATH to the paths the test files are written to,
+and TEST_PROGRAM_DAMAGED_NAME to what a damaged part of the file is called in messages.
+Every decoded sample is 32 bit.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_codec.h
+*/
+
+#ifndef TEST_OSWRAPPER_AUDIO_CODEC_H
+#define TEST_OSWRAPPER_AUDIO_CODEC_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The sample rate of the test files */
+#define TEST_PROGRAM_SAMPLE_RATE 44100
+/* The source audio is repeated this many times, so the test files are long enough to be split into pieces */
+#define TEST_PROGRAM_REPEATS 4
+/* The largest piece of a file pushed at once */
+#define TEST_PROGRAM_MAX_PUSH 0x1000
+/* The threads used to decode the test files with oswrapper_audio_decode_batch */
+#define TEST_PROGRAM_BATCH_THREADS 4
+
+/* Reads the whole file at the given path into memory */
+static unsigned char* read_file(const char* path, size_t* size) {
+    unsigned char* data = NULL;
+    long file_size;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char*) malloc((size_t) file_size);
+
+        if (data != NULL && fread(data, 1, (size_t) file_size, file) != (size_t) file_size) {
+            free(data);
+            data = NULL;
+        }
+
+        *size = (size_t) file_size;
+    }
+
+    fclose(file);
+    return data;
+}
+
+/* Writes bits to a buffer, most significant bit first */
+typedef struct test_bit_writer {
+    unsigned char* data;
+    size_t size;
+    /* The amount of bits used in the last byte, or 0 if it's full */
+    unsigned int bit;
+} test_bit_writer;
+
+static void put_bits(test_bit_writer* writer, unsigned long long value, unsigned int count) {
+    while (count > 0) {
+        count--;
+
+        if (writer->bit == 0) {
+            writer->data[writer->size++] = 0;
+        }
+
+        if ((value >> count) & 1) {
+            writer->data[writer->size - 1] |= (unsigned char) (0x80 >> writer->bit);
+        }
+
+        writer->bit = (writer->bit + 1) & 7;
+    }
+}
+
+static void put_signed(test_bit_writer* writer, long long value, unsigned int count) {
+    put_bits(writer, (unsigned long long) value & (count < 64 ? ((unsigned long long) 1 << count) - 1 : (unsigned long long) -1), count);
+}
+
+/* Pads to a whole byte with 0 bits */
+static void align_bits(test_bit_writer* writer) {
+    writer->bit = 0;
+}
+
+/* A part in the middle of a test file which is damaged, and the frames which are lost because of it */
+typedef struct test_damage_location {
+    size_t offset;
+    size_t first_frame;
+    size_t frames;
+} test_damage_location;
+
+/* Checks decoded 32 bit audio against the expected samples */
+static int check_samples(const test_file_info* info, const int* pcm, const int* expected, size_t first_frame, size_t frames, const char* when) {
+    size_t i;
+
+    for (i = 0; i < frames * info->channel_count; i++) {
+        if (pcm[i] != expected[(first_frame * info->channel_count) + i]) {
+            printf("%s did not match %s at sample %zu!\n", info->name, when, (first_frame * info->channel_count) + i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Reads from a test file in memory, for oswrapper_audio_load_from_callbacks */
+typedef struct test_memory_file {
+    const unsigned char* data;
+    size_t size;
+    size_t position;
+} test_memory_file;
+
+static size_t test_read(void* user_data, void* buffer, size_t size) {
+    test_memory_file* file = (test_memory_file*) user_data;
+    size_t remaining = file->size - file->position;
+
+    if (size > remaining) {
+        size = remaining;
+    }
+
+    memcpy(buffer, file->data + file->position, size);
+    file->position += size;
+    return size;
+}
+
+static int test_seek(void* user_data, OSWRAPPER_AUDIO_SEEK_TYPE offset, OSWrapper_audio_seek_origin origin) {
+    test_memory_file* file = (test_memory_file*) user_data;
+    OSWRAPPER_AUDIO_SEEK_TYPE base = origin == OSWRAPPER_AUDIO_SEEK_ORIGIN_START ? 0 : origin == OSWRAPPER_AUDIO_SEEK_ORIGIN_CURRENT ? (OSWRAPPER_AUDIO_SEEK_TYPE) file->position : (OSWRAPPER_AUDIO_SEEK_TYPE) file->size;
+
+    if (base + offset < 0 || base + offset > (OSWRAPPER_AUDIO_SEEK_TYPE) file->size) {
+        return 0;
+    }
+
+    file->position = (size_t) (base + offset);
+    return 1;
+}
+
+static OSWRAPPER_AUDIO_SEEK_TYPE test_tell(void* user_data) {
+    return (OSWRAPPER_AUDIO_SEEK_TYPE) ((test_memory_file*) user_data)->position;
+}
+
+/* Sets up a decoder which outputs 32 bit samples */
+static void init_spec(OSWrapper_audio_spec* audio_spec) {
+    memset(audio_spec, 0, sizeof(*audio_spec));
+    audio_spec->bits_per_channel = 32;
+    audio_spec->audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+}
+
+/* Seeks to a variety of frames, going back and jumping far ahead, and checks the frames after each one */
+static int test_seeking(const test_file_info* info, OSWrapper_audio_spec* audio_spec, int* buffer, const int* expected, size_t frames, const char* when) {
+    /* Frames in the middle of blocks of audio, and at the start of the last blocks */
+    size_t seek_frames[] = { frames / 2 + 7, 65, frames - 3, frames / 5, frames - 1, (frames * 3) / 4 + 1000, 0, frames };
+    size_t i;
+
+    for (i = 0; i < sizeof(seek_frames) / sizeof(seek_frames[0]); i++) {
+        size_t check_frames = frames - seek_frames[i] < 5000 ? frames - seek_frames[i] : 5000;
+        size_t frames_done = 0;
+
+        if (!oswrapper_audio_seek(audio_spec, (OSWRAPPER_AUDIO_SEEK_TYPE) seek_frames[i])) {
+            printf("Could not seek %s %s!\n", info->name, when);
+            return EXIT_FAILURE;
+        }
+
+        while (frames_done < check_frames) {
+            size_t frames_read = oswrapper_audio_get_samples(audio_spec, (short*) (buffer + (frames_done * info->channel_count)), check_frames - frames_done);
+
+            if (frames_read == 0) {
+                break;
+            }
+
+            frames_done += frames_read;
+        }
+
+        if (frames_done != check_frames || check_samples(info, buffer, expected, seek_frames[i], check_frames, when) != EXIT_SUCCESS) {
+            printf("%s did not match after seeking to frame %zu %s!\n", info->name, seek_frames[i], when);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Loads a file in storage of the size from oswrapper_audio_context_size_from_memory, which includes any index the format needs, such as the sample tables of M4A files */
+static int test_inplace(const test_file_info* info, const unsigned char* file, size_t file_size, const int* expected, size_t frames) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    size_t storage_size;
+    void* storage;
+    int* buffer;
+    size_t frames_done = 0;
+    init_spec(&audio_spec);
+    storage_size = oswrapper_audio_context_size_from_memory(file, file_size, &audio_spec);
+
+    if (storage_size == 0) {
+        printf("Could not get the context size of %s!\n", info->name);
+        return EXIT_FAILURE;
+    }
+
+    storage = malloc(storage_size);
+    buffer = (int*) malloc(frames * info->channel_count * sizeof(int));
+
+    if (storage == NULL || buffer == NULL) {
+        puts("malloc failed for in place loading!");
+    } else if (!oswrapper_audio_load_from_memory_inplace(file, file_size, &audio_spec, storage, storage_size)) {
+        printf("Could not load %s in place!\n", info->name);
+    } else {
+        while (frames_done < frames) {
+            size_t frames_read = oswrapper_audio_get_samples(&audio_spec, (short*) (buffer + (frames_done * info->channel_count)), frames - frames_done);
+
+            if (frames_read == 0) {
+                break;
+            }
+
+            frames_done += frames_read;
+        }
+
+        oswrapper_audio_free_context(&audio_spec);
+
+        if (frames_done != frames || check_samples(info, buffer, expected, 0, frames, "when loaded in place") != EXIT_SUCCESS) {
+            printf("%s did not match when loaded in place!\n", info->name);
+        } else {
+            returnVal = EXIT_SUCCESS;
+        }
+    }
+
+    free(storage);
+    free(buffer);
+    return returnVal;
+}
+
+/* Decodes a file after seeking, from callbacks, by pushing it in pieces, and when loaded in place */
+static int test_access(const test_file_info* info, const unsigned char* file, size_t file_size, const int* expected, size_t frames) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWRAPPER_AUDIO_SEEK_TYPE length;
+    test_memory_file memory_file;
+    int* buffer = (int*) malloc(frames * info->channel_count * sizeof(int));
+    size_t frames_done;
+    size_t file_pos;
+
+    if (buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        return EXIT_FAILURE;
+    }
+
+    init_spec(&audio_spec);
+
+    if (!oswrapper_audio_load_from_memory(file, file_size, &audio_spec)) {
+        printf("Could not decode %s!\n", info->name);
+        goto exit;
+    }
+
+    if (oswrapper_audio_get_length(&audio_spec, &length) != OSWRAPPER_AUDIO_LENGTH_EXACT || length != (OSWRAPPER_AUDIO_SEEK_TYPE) frames) {
+        printf("%s had the wrong length!\n", info->name);
+        oswrapper_audio_free_context(&audio_spec);
+        goto exit;
+    }
+
+    if (test_seeking(info, &audio_spec, buffer, expected, frames, "from memory") != EXIT_SUCCESS) {
+        oswrapper_audio_free_context(&audio_spec);
+        goto exit;
+    }
+
+    oswrapper_audio_free_context(&audio_spec);
+    memory_file.data = file;
+    memory_file.size = file_size;
+    memory_file.position = 0;
+    init_spec(&audio_spec);
+
+    if (!oswrapper_audio_load_from_callbacks(test_read, test_seek, test_tell, &memory_file, &audio_spec)) {
+        printf("Could not decode %s from callbacks!\n", info->name);
+        goto exit;
+    }
+
+    frames_done = oswrapper_audio_get_samples(&audio_spec, (short*) buffer, frames);
+
+    if (frames_done != frames || check_samples(info, buffer, expected, 0, frames, "when decoding from callbacks") != EXIT_SUCCESS
+            || test_seeking(info, &audio_spec, buffer, expected, frames, "from callbacks") != EXIT_SUCCESS) {
+        printf("%s did not match when decoding from callbacks!\n", info->name);
+        oswrapper_audio_free_context(&audio_spec);
+        goto exit;
+    }
+
+    oswrapper_audio_free_context(&audio_spec);
+    init_spec(&audio_spec);
+
+    if (!oswrapper_audio_load_push(&audio_spec)) {
+        puts("Could not create push decoder!");
+        goto exit;
+    }
+
+    frames_done = 0;
+    file_pos = 0;
+
+    while (frames_done < frames) {
+        size_t frames_read = oswrapper_audio_get_samples(&audio_spec, (short*) (buffer + (frames_done * info->channel_count)), frames - frames_done);
+
+        if (frames_read == OSWRAPPER_AUDIO_NEED_MORE_DATA || frames_read == 0) {
+            size_t push_size = file_size - file_pos < TEST_PROGRAM_MAX_PUSH ? file_size - file_pos : (size_t) (rand() % TEST_PROGRAM_MAX_PUSH) + 1;
+
+            if (push_size == 0) {
+                oswrapper_audio_push_end(&audio_spec);
+
+                if (frames_read == 0) {
+                    break;
+                }
+
+                continue;
+            }
+
+            if (!oswrapper_audio_push_bytes(&audio_spec, file + file_pos, push_size)) {
+                printf("Could not push %s!\n", info->name);
+                oswrapper_audio_free_context(&audio_spec);
+                goto exit;
+            }
+
+            file_pos += push_size;
+            continue;
+        }
+
+        frames_done += frames_read;
+    }
+
+    oswrapper_audio_free_context(&audio_spec);
+
+    if (frames_done != frames || check_samples(info, buffer, expected, 0, frames, "when pushed in pieces") != EXIT_SUCCESS) {
+        printf("%s did not match when pushed in pieces!\n", info->name);
+        goto exit;
+    }
+
+    returnVal = test_inplace(info, file, file_size, expected, frames);
+exit:
+    free(buffer);
+    return returnVal;
+}
+
+static int write_file(const char* path, const unsigned char* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    int returnVal = EXIT_FAILURE;
+
+    if (file == NULL) {
+        printf("Could not open %s for writing!\n", path);
+        return EXIT_FAILURE;
+    }
+
+    if (fwrite(data, 1, size, file) == size) {
+        returnVal = EXIT_SUCCESS;
+    } else {
+        printf("Could not write %s!\n", path);
+    }
+
+    fclose(file);
+    return returnVal;
+}
+
+/* Decodes the written test file and its damaged copy at the same time, which are both split between the threads */
+static int test_batch(const test_file_info* info, const int* expected, size_t frames, const test_damage_location* middle) {
+    const char* paths[2] = { TEST_PROGRAM_BATCH_PATH, TEST_PROGRAM_DAMAGED_PATH };
+    OSWrapper_audio_batch_result results[2];
+    OSWrapper_audio_spec spec_hint;
+    int returnVal = EXIT_FAILURE;
+    init_spec(&spec_hint);
+
+    if (!oswrapper_audio_decode_batch(paths, 2, &spec_hint, results, TEST_PROGRAM_BATCH_THREADS)) {
+        printf("Could not decode %s with oswrapper_audio_decode_batch!\n", info->name);
+    } else if (results[0].frames != frames || check_samples(info, (const int*) results[0].samples, expected, 0, frames, "when decoded in a batch") != EXIT_SUCCESS) {
+        printf("%s decoded to %zu frames in a batch, expected %zu!\n", info->name, results[0].frames, frames);
+    } else if (results[1].frames != frames - middle->frames || check_samples(info, (const int*) results[1].samples, expected, 0, middle->first_frame, "before a damaged " TEST_PROGRAM_DAMAGED_NAME " in a batch") != EXIT_SUCCESS
+               || check_samples(info, (const int*) results[1].samples + (middle->first_frame * info->channel_count), expected, middle->first_frame + middle->frames, frames - (middle->first_frame + middle->frames), "after a damaged " TEST_PROGRAM_DAMAGED_NAME " in a batch") != EXIT_SUCCESS) {
+        printf("%s did not skip a damaged " TEST_PROGRAM_DAMAGED_NAME " in a batch!\n", info->name);
+    } else {
+        returnVal = EXIT_SUCCESS;
+    }
+
+    oswrapper_audio_free_batch(results, 2);
+    return returnVal;
+}
+
+/* Decodes a test file which has been damaged at the given location, and checks that only the damaged frames are skipped.
+The damaged file is also decoded in a batch with the undamaged file, which must already be written to TEST_PROGRAM_BATCH_PATH. */
+static int test_damaged(const test_file_info* info, const unsigned char* file, size_t file_size, const int* expected, size_t frames, const test_damage_location* middle) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    void* pcm = NULL;
+    size_t pcm_frames = 0;
+    init_spec(&audio_spec);
+
+    if (!oswrapper_audio_decode_all(file, file_size, &audio_spec, &pcm, &pcm_frames)) {
+        printf("Could not decode %s with a damaged " TEST_PROGRAM_DAMAGED_NAME "!\n", info->name);
+        return EXIT_FAILURE;
+    }
+
+    if (pcm_frames != frames - middle->frames || check_samples(info, (const int*) pcm, expected, 0, middle->first_frame, "before a damaged " TEST_PROGRAM_DAMAGED_NAME) != EXIT_SUCCESS
+            || check_samples(info, (const int*) pcm + (middle->first_frame * info->channel_count), expected, middle->first_frame + middle->frames, frames - (middle->first_frame + middle->frames), "after a damaged " TEST_PROGRAM_DAMAGED_NAME) != EXIT_SUCCESS) {
+        printf("%s did not skip a damaged " TEST_PROGRAM_DAMAGED_NAME "!\n", info->name);
+    } else if (write_file(TEST_PROGRAM_DAMAGED_PATH, file, file_size) == EXIT_SUCCESS && test_batch(info, expected, frames, middle) == EXIT_SUCCESS) {
+        returnVal = EXIT_SUCCESS;
+    }
+
+    oswrapper_audio_free_pcm(&audio_spec, pcm);
+    return returnVal;
+}
+
+/* Decodes the audio file at the given path to 16 bit stereo, and repeats it TEST_PROGRAM_REPEATS times.
+The second repeat starts with silence, and the fourth with a constant value, which encoders store differently to other audio. */
+static short* load_source(const char* path, size_t* frames) {
+    OSWrapper_audio_spec source_spec;
+    void* samples = NULL;
+    short* source = NULL;
+    size_t data_size = 0;
+    unsigned char* data;
+    size_t i;
+    *frames = 0;
+    memset(&source_spec, 0, sizeof(source_spec));
+    source_spec.channel_count = 2;
+    source_spec.bits_per_channel = 16;
+    source_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    data = read_file(path, &data_size);
+
+    if (data == NULL || !oswrapper_audio_decode_all(data, data_size, &source_spec, &samples, frames) || *frames < 0x1000) {
+        puts("Could not decode audio!");
+    } else {
+        source = (short*) malloc(*frames * TEST_PROGRAM_REPEATS * 2 * sizeof(short));
+
+        if (source == NULL) {
+            puts("malloc failed for source samples!");
+        } else {
+            for (i = 0; i < TEST_PROGRAM_REPEATS; i++) {
+                memcpy(source + (i * *frames * 2), samples, *frames * 2 * sizeof(short));
+            }
+
+            memset(source + (*frames * 2), 0, 0x2000 * 2 * sizeof(short));
+
+            for (i = *frames * 3; i < (*frames * 3) + 0x2000; i++) {
+                source[i * 2] = 1234;
+                source[(i * 2) + 1] = -77;
+            }
+
+            *frames *= TEST_PROGRAM_REPEATS;
+        }
+    }
+
+    free(data);
+    oswrapper_audio_free_pcm(&source_spec, samples);
+    return source;
+}
+
+/* Decodes the audio file given on the command line (or noise.wav), and runs the given test on each test file with it */
+static int run_tests(int argc, char** argv, const test_file_info* files, size_t file_count, int (*test_file)(const test_file_info* info, const short* source, size_t frames)) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    short* source;
+    size_t frames;
+    size_t i;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    source = load_source(path, &frames);
+
+    if (source == NULL) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    for (i = 0; returnVal == EXIT_SUCCESS && i < file_count; i++) {
+        if (test_file(&files[i], source, frames) != EXIT_SUCCESS) {
+            returnVal = EXIT_FAILURE;
+        }
+    }
+
+    free(source);
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+#endif /* TEST_OSWRAPPER_AUDIO_CODEC_H */
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,194 @@
+/*
+This program uses oswrapper_audio to fully decode an audio file in memory with oswrapper_audio_decode_all,
+in a variety of output formats.
+The decoded audio is checked against the same file decoded with oswrapper_audio_get_samples.
+Data which isn't a sound file is also checked to fail.
+
+Usage: test_oswrapper_audio_decode_all (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_decode_all.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The largest amount of frames decoded at once for the reference audio */
+#define TEST_PROGRAM_BUFFER_SIZE 0x50
+
+/* Reads the whole file at the given path into memory */
+static unsigned char* read_file(const char* path, size_t* size) {
+    unsigned char* data = NULL;
+    long file_size;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char*) malloc((size_t) file_size);
+
+        if (data != NULL && fread(data, 1, (size_t) file_size, file) != (size_t) file_size) {
+            free(data);
+            data = NULL;
+        }
+
+        *size = (size_t) file_size;
+    }
+
+    fclose(file);
+    return data;
+}
+
+/* Decodes the file with the given output format hints, and checks that oswrapper_audio_decode_all matches oswrapper_audio_get_samples */
+static int test_decode_all(const unsigned char* data, size_t data_size, unsigned long sample_rate, unsigned int channel_count, unsigned int bits_per_channel, OSWrapper_audio_type audio_type) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec reference_spec;
+    OSWrapper_audio_spec decode_all_spec;
+    unsigned char* buffer = NULL;
+    void* pcm = NULL;
+    size_t pcm_frames = 0;
+    size_t frame_size;
+    size_t frames_done = 0;
+    memset(&reference_spec, 0, sizeof(reference_spec));
+    reference_spec.sample_rate = sample_rate;
+    reference_spec.channel_count = channel_count;
+    reference_spec.bits_per_channel = bits_per_channel;
+    reference_spec.audio_type = audio_type;
+    decode_all_spec = reference_spec;
+
+    if (!oswrapper_audio_decode_all(data, data_size, &decode_all_spec, &pcm, &pcm_frames)) {
+        puts("Could not decode audio with oswrapper_audio_decode_all!");
+        return EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_load_from_memory(data, data_size, &reference_spec)) {
+        puts("Could not decode audio!");
+        oswrapper_audio_free_pcm(&decode_all_spec, pcm);
+        return EXIT_FAILURE;
+    }
+
+    if (decode_all_spec.internal_data != NULL || decode_all_spec.sample_rate != reference_spec.sample_rate || decode_all_spec.channel_count != reference_spec.channel_count
+            || decode_all_spec.bits_per_channel != reference_spec.bits_per_channel || decode_all_spec.audio_type != reference_spec.audio_type) {
+        puts("oswrapper_audio_decode_all set the wrong output format!");
+        goto exit;
+    }
+
+    frame_size = (reference_spec.bits_per_channel / 8) * reference_spec.channel_count;
+    buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+
+    if (buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    while (1) {
+        size_t this_iter = oswrapper_audio_get_samples(&reference_spec, (short*) buffer, TEST_PROGRAM_BUFFER_SIZE);
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        if (frames_done + this_iter > pcm_frames || memcmp(buffer, (unsigned char*) pcm + (frames_done * frame_size), this_iter * frame_size) != 0) {
+            printf("Decoded audio did not match at frame %zu!\n", frames_done);
+            goto exit;
+        }
+
+        frames_done += this_iter;
+    }
+
+    if (frames_done != pcm_frames) {
+        printf("Decoded %zu frames, expected %zu!\n", pcm_frames, frames_done);
+        goto exit;
+    }
+
+    printf("Decoded %zu frames at once, with %u channels of %u bit samples at %lu Hz\n", pcm_frames, reference_spec.channel_count, reference_spec.bits_per_channel, reference_spec.sample_rate);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (!oswrapper_audio_free_context(&reference_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    oswrapper_audio_free_pcm(&decode_all_spec, pcm);
+    free(buffer);
+    return returnVal;
+}
+
+/* Checks that data which isn't a sound file fails to decode */
+static int test_invalid(void) {
+    static const unsigned char not_audio[] = "This isn't a sound file, it's just some text which is long enough to be mistaken for a header.";
+    OSWrapper_audio_spec audio_spec;
+    void* pcm = &audio_spec;
+    size_t frames = 1;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (oswrapper_audio_decode_all(not_audio, sizeof(not_audio), &audio_spec, &pcm, &frames) || pcm != NULL || frames != 0) {
+        puts("Data which isn't a sound file was decoded!");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Fully decodes a given audio file in a variety of formats */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    size_t data_size = 0;
+    unsigned char* data;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    data = read_file(path, &data_size);
+
+    if (data == NULL) {
+        puts("Could not read file!");
+        returnVal = EXIT_FAILURE;
+    } else {
+        if (test_decode_all(data, data_size, 0, 0, 0, OSWRAPPER_AUDIO_FORMAT_NOT_SET) != EXIT_SUCCESS
+                || test_decode_all(data, data_size, 0, 2, 16, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) != EXIT_SUCCESS
+                || test_decode_all(data, data_size, 0, 6, 24, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) != EXIT_SUCCESS
+                || test_decode_all(data, data_size, 48000, 2, 32, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) != EXIT_SUCCESS
+                || test_decode_all(data, data_size, 22050, 1, 64, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) != EXIT_SUCCESS
+                || test_invalid() != EXIT_SUCCESS) {
+            returnVal = EXIT_FAILURE;
+        }
+
+        free(data);
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,814 @@
+/*
+This program uses oswrapper_audio to decode FLAC files with the portable decoder.
+An audio file is decoded to 16 bit stereo PCM, which is extended to a variety of bit depths and channel counts,
+then encoded to FLAC files in memory with a simple encoder which uses every subframe type, residual coding method,
+and stereo decorrelation mode, with both fixed and variable block sizes.
+Each file is decoded again, and checked against the samples it was made from.
+Every file is also checked when seeking with and without a seek table, loading from callbacks, pushing the file in pieces, and loading it in place.
+The length is checked while the file is pushed, including for files without a length in STREAMINFO.
+Files are split into small pieces when decoded with oswrapper_audio_decode_all and oswrapper_audio_decode_batch,
+so decoding them on several threads is checked as well, including with a damaged frame.
+
+Usage: test_oswrapper_audio_flac (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_flac.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_USE_THREADS
+/* Split the test files into many pieces */
+#define OSWRAPPER_AUDIO_PIECE_MIN_FRAMES 0x2000
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+/* Placeholder seek points added after the real ones */
+#define TEST_PROGRAM_PLACEHOLDERS 2
+/* The test files are written to these paths to be decoded with oswrapper_audio_decode_batch */
+#define TEST_PROGRAM_BATCH_PATH "test_oswrapper_audio_flac_batch.flac"
+#define TEST_PROGRAM_DAMAGED_PATH "test_oswrapper_audio_flac_damaged.flac"
+/* What a damaged part of a test file is called */
+#define TEST_PROGRAM_DAMAGED_NAME "frame"
+
+/* Changes to the layout of the test files */
+#define TEST_LAYOUT_SEEK_TABLE 1
+#define TEST_LAYOUT_ID3 2
+#define TEST_LAYOUT_UNKNOWN_LENGTH 4
+#define TEST_LAYOUT_NO_MAX_FRAME_SIZE 8
+#define TEST_LAYOUT_EXTRA_METADATA 16
+/* Fills the bits below the source samples, otherwise they're 0 and stored as wasted bits */
+#define TEST_LAYOUT_FILL_LOW_BITS 32
+/* STREAMINFO has the smallest frame size as the largest frame size */
+#define TEST_LAYOUT_SMALL_MAX_FRAME_SIZE 64
+
+typedef struct test_file_info {
+    const char* name;
+    unsigned int channel_count;
+    unsigned int bits_per_sample;
+    /* The block size of every frame except the last, or 0 for variable block sizes */
+    unsigned int block_size;
+    unsigned int layout;
+} test_file_info;
+
+static const test_file_info test_files[] = {
+    { "16 bit stereo", 2, 16, 4096, TEST_LAYOUT_SEEK_TABLE },
+    { "16 bit stereo with variable block sizes", 2, 16, 0, TEST_LAYOUT_EXTRA_METADATA },
+    { "8 bit mono", 1, 8, 1152, TEST_LAYOUT_ID3 },
+    { "12 bit stereo with an unknown length", 2, 12, 576, TEST_LAYOUT_UNKNOWN_LENGTH | TEST_LAYOUT_NO_MAX_FRAME_SIZE },
+    { "20 bit 3 channel", 3, 20, 4608, TEST_LAYOUT_FILL_LOW_BITS | TEST_LAYOUT_SEEK_TABLE },
+    { "24 bit stereo with wasted bits", 2, 24, 4096, TEST_LAYOUT_SEEK_TABLE | TEST_LAYOUT_ID3 | TEST_LAYOUT_EXTRA_METADATA },
+    { "24 bit stereo", 2, 24, 1152, TEST_LAYOUT_FILL_LOW_BITS | TEST_LAYOUT_SMALL_MAX_FRAME_SIZE },
+    { "24 bit stereo with variable block sizes", 2, 24, 0, TEST_LAYOUT_FILL_LOW_BITS | TEST_LAYOUT_SEEK_TABLE | TEST_LAYOUT_UNKNOWN_LENGTH },
+    { "32 bit stereo", 2, 32, 4096, TEST_LAYOUT_FILL_LOW_BITS },
+    { "16 bit 6 channel", 6, 16, 192, TEST_LAYOUT_SMALL_MAX_FRAME_SIZE },
+    { "16 bit stereo with large blocks", 2, 16, 16384, TEST_LAYOUT_SEEK_TABLE }
+};
+
+#define TEST_FILE_COUNT (sizeof(test_files) / sizeof(test_files[0]))
+
+/* The block sizes of files with variable block sizes, used in turn */
+static const unsigned int test_variable_block_sizes[] = { 1000, 4608, 17, 2304, 4096, 333, 9999 };
+
+#define TEST_VARIABLE_BLOCK_SIZE_COUNT (sizeof(test_variable_block_sizes) / sizeof(test_variable_block_sizes[0]))
+
+#include "test_oswrapper_audio_codec.h"
+
+static unsigned int test_crc8(const unsigned char* data, size_t size) {
+    unsigned int crc = 0;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < size; i++) {
+        crc ^= data[i];
+
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+        }
+    }
+
+    return crc;
+}
+
+static unsigned int test_crc16(const unsigned char* data, size_t size) {
+    unsigned int crc = 0;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < size; i++) {
+        crc ^= (unsigned int) data[i] << 8;
+
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) & 0xFFFF : (crc << 1) & 0xFFFF;
+        }
+    }
+
+    return crc;
+}
+
+/* The bits needed to store a value as two's complement */
+static unsigned int signed_bits(long long value) {
+    unsigned int bits = 1;
+
+    if (value < 0) {
+        value = ~value;
+    }
+
+    while (value != 0) {
+        value >>= 1;
+        bits++;
+    }
+
+    return bits;
+}
+
+/* Writes the residual of a subframe, with a partition order, coding method and escaped partitions chosen by the frame index */
+static void encode_residual(test_bit_writer* writer, const long long* residual, unsigned int block_size, unsigned int order, unsigned int frame_index) {
+    unsigned int partition_order = frame_index % 6;
+    unsigned int parameters[64];
+    unsigned int escape_bits[64];
+    unsigned int method = frame_index & 1;
+    unsigned int partition;
+    unsigned int sample = order;
+
+    while (partition_order > 0 && ((block_size % (1u << partition_order)) != 0 || (block_size >> partition_order) < order)) {
+        partition_order--;
+    }
+
+    for (partition = 0; partition < (1u << partition_order); partition++) {
+        unsigned int start = partition == 0 ? order : partition * (block_size >> partition_order);
+        unsigned int end = (partition + 1) * (block_size >> partition_order);
+        unsigned long long sum = 0;
+        unsigned int i;
+        escape_bits[partition] = 0;
+
+        for (i = start; i < end; i++) {
+            unsigned long long zigzag = residual[i] < 0 ? ((unsigned long long) -residual[i] * 2) - 1 : (unsigned long long) residual[i] * 2;
+            unsigned int bits = signed_bits(residual[i]);
+            sum += zigzag;
+
+            if (bits > escape_bits[partition]) {
+                escape_bits[partition] = bits;
+            }
+        }
+
+        /* All 0 residuals are escaped with 0 bits */
+        if (sum == 0) {
+            escape_bits[partition] = 0;
+        }
+
+        parameters[partition] = 0;
+
+        while (end > start && parameters[partition] < 30 && ((unsigned long long) 2 << parameters[partition]) <= sum / (end - start)) {
+            parameters[partition]++;
+        }
+
+        if (parameters[partition] > 14) {
+            method = 1;
+        }
+    }
+
+    put_bits(writer, method, 2);
+    put_bits(writer, partition_order, 4);
+
+    for (partition = 0; partition < (1u << partition_order); partition++) {
+        unsigned int count = (block_size >> partition_order) - (partition == 0 ? order : 0);
+        unsigned int i;
+
+        if (escape_bits[partition] <= 31 && (escape_bits[partition] == 0 || (partition + frame_index) % 7 == 3)) {
+            put_bits(writer, method == 1 ? 31 : 15, method == 1 ? 5 : 4);
+            put_bits(writer, escape_bits[partition], 5);
+
+            for (i = 0; i < count; i++) {
+                put_signed(writer, residual[sample + i], escape_bits[partition]);
+            }
+        } else {
+            unsigned int parameter = parameters[partition];
+            put_bits(writer, parameter, method == 1 ? 5 : 4);
+
+            for (i = 0; i < count; i++) {
+                long long value = residual[sample + i];
+                unsigned long long zigzag = value < 0 ? ((unsigned long long) -value * 2) - 1 : (unsigned long long) value * 2;
+                unsigned long long quotient = zigzag >> parameter;
+
+                while (quotient > 0) {
+                    put_bits(writer, 0, 1);
+                    quotient--;
+                }
+
+                put_bits(writer, 1, 1);
+                put_bits(writer, zigzag, parameter);
+            }
+        }
+
+        sample += count;
+    }
+}
+
+/* Writes a subframe, with the type chosen by the selector. Constant samples are always stored as a constant subframe,
+and low bits which are 0 in every sample are stored as wasted bits. */
+static void encode_subframe(test_bit_writer* writer, const long long* samples, unsigned int block_size, unsigned int sample_bits, unsigned int selector, unsigned int frame_index) {
+    long long* shifted = (long long*) malloc(block_size * sizeof(long long));
+    long long* residual = (long long*) malloc(block_size * sizeof(long long));
+    unsigned int wasted_bits = 0;
+    long long low_bits = 0;
+    int constant = 1;
+    unsigned int i;
+
+    if (shifted == NULL || residual == NULL) {
+        puts("malloc failed for subframe!");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < block_size; i++) {
+        low_bits |= samples[i];
+        constant = constant && samples[i] == samples[0];
+    }
+
+    if (constant) {
+        put_bits(writer, 0, 8);
+        put_signed(writer, samples[0], sample_bits);
+        free(shifted);
+        free(residual);
+        return;
+    }
+
+    while (!(low_bits & 1)) {
+        low_bits >>= 1;
+        wasted_bits++;
+    }
+
+    for (i = 0; i < block_size; i++) {
+        shifted[i] = samples[i] >> wasted_bits;
+    }
+
+    sample_bits -= wasted_bits;
+    selector %= 8;
+
+    if (selector >= 1 && selector <= 5 && selector - 1 <= block_size) {
+        /* Fixed predictor */
+        unsigned int order = selector - 1;
+        int fits = 1;
+
+        for (i = order; i < block_size; i++) {
+            long long prediction = order == 0 ? 0 : order == 1 ? shifted[i - 1] : order == 2 ? (2 * shifted[i - 1]) - shifted[i - 2]
+                                   : order == 3 ? (3 * (shifted[i - 1] - shifted[i - 2])) + shifted[i - 3] : (4 * (shifted[i - 1] + shifted[i - 3])) - (6 * shifted[i - 2]) - shifted[i - 4];
+            residual[i] = shifted[i] - prediction;
+            fits = fits && signed_bits(residual[i]) <= 32;
+        }
+
+        if (fits) {
+            put_bits(writer, (8 + order) << 1 | (wasted_bits != 0), 8);
+
+            if (wasted_bits != 0) {
+                put_bits(writer, 1, wasted_bits);
+            }
+
+            for (i = 0; i < order; i++) {
+                put_signed(writer, shifted[i], sample_bits);
+            }
+
+            encode_residual(writer, residual, block_size, order, frame_index);
+            free(shifted);
+            free(residual);
+            return;
+        }
+    } else if (selector >= 6) {
+        /* Linear predictor with made up coefficients, which are still good enough to keep the residual small */
+        unsigned int order = ((frame_index * 5) + (selector * 3)) % 32 + 1;
+        unsigned int precision = 15 - ((frame_index % 4) * 3);
+        unsigned int shift = precision - 2;
+        long long coefficients[32];
+        int fits = 1;
+        unsigned int j;
+
+        if (order > block_size) {
+            order = block_size;
+        }
+
+        coefficients[0] = ((long long) 1 << shift) - 1;
+
+        for (j = 1; j < order; j++) {
+            coefficients[j] = (long long) ((j * 13) + frame_index) % 7 - 3;
+        }
+
+        for (i = order; i < block_size; i++) {
+            long long prediction = 0;
+
+            for (j = 0; j < order; j++) {
+                prediction += coefficients[j] * shifted[i - 1 - j];
+            }
+
+            residual[i] = shifted[i] - (prediction >> shift);
+            fits = fits && signed_bits(residual[i]) <= 32;
+        }
+
+        if (fits) {
+            put_bits(writer, (32 + order - 1) << 1 | (wasted_bits != 0), 8);
+
+            if (wasted_bits != 0) {
+                put_bits(writer, 1, wasted_bits);
+            }
+
+            for (i = 0; i < order; i++) {
+                put_signed(writer, shifted[i], sample_bits);
+            }
+
+            put_bits(writer, precision - 1, 4);
+            put_bits(writer, shift, 5);
+
+            for (j = 0; j < order; j++) {
+                put_signed(writer, coefficients[j], precision);
+            }
+
+            encode_residual(writer, residual, block_size, order, frame_index);
+            free(shifted);
+            free(residual);
+            return;
+        }
+    }
+
+    /* Verbatim */
+    put_bits(writer, (1 << 1) | (wasted_bits != 0), 8);
+
+    if (wasted_bits != 0) {
+        put_bits(writer, 1, wasted_bits);
+    }
+
+    for (i = 0; i < block_size; i++) {
+        put_signed(writer, shifted[i], sample_bits);
+    }
+
+    free(shifted);
+    free(residual);
+}
+
+/* The code for a block size in a frame header, and how many bytes of block size are after the frame number */
+static unsigned int block_size_code(unsigned int block_size, unsigned int* extra_bytes) {
+    unsigned int code;
+    *extra_bytes = 0;
+
+    if (block_size == 192) {
+        return 1;
+    }
+
+    for (code = 2; code <= 5; code++) {
+        if (block_size == 576u << (code - 2)) {
+            return code;
+        }
+    }
+
+    for (code = 8; code <= 15; code++) {
+        if (block_size == 256u << (code - 8)) {
+            return code;
+        }
+    }
+
+    *extra_bytes = block_size <= 256 ? 1 : 2;
+    return block_size <= 256 ? 6 : 7;
+}
+
+/* Writes a frame. Header fields which can be written in more than one way are chosen by the frame index. */
+static void encode_frame(test_bit_writer* writer, const test_file_info* info, long long* const* channels, unsigned int block_size, unsigned long long number, unsigned int frame_index) {
+    static const unsigned int sample_bits_codes[33] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 4, 0, 0, 0, 5, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 7 };
+    size_t frame_start = writer->size;
+    size_t header_start;
+    unsigned int extra_block_bytes;
+    unsigned int block_code = block_size_code(block_size, &extra_block_bytes);
+    unsigned int rate_code = frame_index % 3 == 0 ? 0 : frame_index % 3 == 1 ? 9 : 13;
+    /* The side channel of 32 bit audio needs 33 bits, which FLAC can't store */
+    unsigned int assignment = info->channel_count == 2 && info->bits_per_sample < 32 ? (frame_index % 4 == 0 ? 1 : 7 + (frame_index % 4)) : info->channel_count - 1;
+    long long* coded[8];
+    long long* side = NULL;
+    unsigned int channel;
+    unsigned int i;
+    header_start = writer->size;
+    put_bits(writer, 0xFFF8 | (info->block_size == 0), 16);
+    put_bits(writer, block_code, 4);
+    put_bits(writer, rate_code, 4);
+    put_bits(writer, assignment, 4);
+    put_bits(writer, frame_index % 2 == 0 ? 0 : sample_bits_codes[info->bits_per_sample], 3);
+    put_bits(writer, 0, 1);
+
+    /* The frame or sample number is coded like UTF-8 */
+    if (number < 0x80) {
+        put_bits(writer, number, 8);
+    } else {
+        unsigned int length = 2;
+
+        while (length < 7 && number >= (unsigned long long) 1 << ((5 * length) + 1)) {
+            length++;
+        }
+
+        /* The first byte starts with a 1 bit for each byte, then a 0 bit */
+        put_bits(writer, ((1u << length) - 1) << 1, length + 1);
+        put_bits(writer, number >> (6 * (length - 1)), 8 - (length + 1));
+
+        for (i = length - 1; i > 0; i--) {
+            put_bits(writer, 2, 2);
+            put_bits(writer, (number >> (6 * (i - 1))) & 0x3F, 6);
+        }
+    }
+
+    if (extra_block_bytes != 0) {
+        put_bits(writer, block_size - 1, extra_block_bytes * 8);
+    }
+
+    if (rate_code == 13) {
+        put_bits(writer, TEST_PROGRAM_SAMPLE_RATE, 16);
+    }
+
+    put_bits(writer, test_crc8(writer->data + header_start, writer->size - header_start), 8);
+
+    for (channel = 0; channel < info->channel_count; channel++) {
+        coded[channel] = channels[channel];
+    }
+
+    if (assignment >= 8) {
+        side = (long long*) malloc(block_size * 2 * sizeof(long long));
+
+        if (side == NULL) {
+            puts("malloc failed for side channel!");
+            exit(EXIT_FAILURE);
+        }
+
+        for (i = 0; i < block_size; i++) {
+            side[i] = channels[0][i] - channels[1][i];
+            /* Mid */
+            side[block_size + i] = (channels[0][i] + channels[1][i]) >> 1;
+        }
+
+        if (assignment == 8) {
+            coded[1] = side;
+        } else if (assignment == 9) {
+            coded[0] = side;
+        } else {
+            coded[0] = side + block_size;
+            coded[1] = side;
+        }
+    }
+
+    for (channel = 0; channel < info->channel_count; channel++) {
+        unsigned int extra_bit = coded[channel] == side;
+        encode_subframe(writer, coded[channel], block_size, info->bits_per_sample + extra_bit, frame_index + (channel * 3), frame_index);
+    }
+
+    free(side);
+    align_bits(writer);
+    put_bits(writer, test_crc16(writer->data + frame_start, writer->size - frame_start), 16);
+}
+
+/* The sample stored for a channel of a source frame, which is 16 bit stereo */
+static long long get_sample(const test_file_info* info, const short* source, size_t frame, unsigned int channel) {
+    long long base = source[(frame * 2) + (channel % 2)];
+    unsigned int bits = info->bits_per_sample;
+
+    if (channel >= 2) {
+        base = (short) (base + (channel * 1000));
+    }
+
+    if (bits <= 16) {
+        return base >> (16 - bits);
+    }
+
+    base *= (long long) 1 << (bits - 16);
+    return info->layout & TEST_LAYOUT_FILL_LOW_BITS ? base | (long long) ((frame * 7 + channel) & ((1u << (bits - 16)) - 1)) : base;
+}
+
+/* Creates a FLAC file in memory. expected is set to the samples which should be decoded, as 32 bit samples. */
+static unsigned char* create_flac(const test_file_info* info, const short* source, size_t frames, int* expected, test_damage_location* middle, size_t* size) {
+    test_bit_writer writer;
+    long long* channels[8];
+    size_t capacity = 0x1000 + (frames * info->channel_count * 6) + (frames / 8);
+    unsigned char* streaminfo;
+    unsigned char* seek_table = NULL;
+    size_t data_start;
+    unsigned int min_block = 0xFFFF;
+    unsigned int max_block = 0;
+    size_t min_frame_size = (size_t) -1;
+    size_t max_frame_size = 0;
+    unsigned long seek_points = 0;
+    unsigned long max_seek_points = 0;
+    size_t frame = 0;
+    unsigned int frame_index = 0;
+    unsigned int channel;
+    size_t i;
+    writer.data = (unsigned char*) malloc(capacity);
+    writer.size = 0;
+    writer.bit = 0;
+
+    if (writer.data == NULL) {
+        return NULL;
+    }
+
+    for (channel = 0; channel < info->channel_count; channel++) {
+        channels[channel] = (long long*) malloc(65536 * sizeof(long long));
+
+        if (channels[channel] == NULL) {
+            puts("malloc failed for channel!");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (i = 0; i < frames * info->channel_count; i++) {
+        expected[i] = (int) ((unsigned long) get_sample(info, source, i / info->channel_count, (unsigned int) (i % info->channel_count)) << (32 - info->bits_per_sample));
+    }
+
+    if (info->layout & TEST_LAYOUT_ID3) {
+        /* An ID3v2 tag with 100 bytes of padding */
+        memcpy(writer.data, "ID3\x04\x00\x00\x00\x00\x00\x64", 10);
+        memset(writer.data + 10, 0, 100);
+        writer.size = 110;
+    }
+
+    memcpy(writer.data + writer.size, "fLaC", 4);
+    writer.size += 4;
+    put_bits(&writer, (info->layout & (TEST_LAYOUT_SEEK_TABLE | TEST_LAYOUT_EXTRA_METADATA)) ? 0 : 0x80, 8);
+    put_bits(&writer, 34, 24);
+    streaminfo = writer.data + writer.size;
+    memset(streaminfo, 0, 34);
+    writer.size += 34;
+
+    if (info->layout & TEST_LAYOUT_EXTRA_METADATA) {
+        /* A comment block, which the decoder skips */
+        put_bits(&writer, (info->layout & TEST_LAYOUT_SEEK_TABLE) ? 4 : 0x84, 8);
+        put_bits(&writer, 8, 24);
+        memcpy(writer.data + writer.size, "\x04\x00\x00\x00test", 8);
+        writer.size += 8;
+    }
+
+    if (info->layout & TEST_LAYOUT_SEEK_TABLE) {
+        max_seek_points = (unsigned long) (frames / 1024 + TEST_PROGRAM_PLACEHOLDERS);
+        put_bits(&writer, 0x83, 8);
+        put_bits(&writer, max_seek_points * 18, 24);
+        seek_table = writer.data + writer.size;
+        memset(seek_table, 0xFF, max_seek_points * 18);
+        writer.size += max_seek_points * 18;
+    }
+
+    data_start = writer.size;
+
+    while (frame < frames) {
+        unsigned int block_size = info->block_size != 0 ? info->block_size : test_variable_block_sizes[frame_index % TEST_VARIABLE_BLOCK_SIZE_COUNT];
+        size_t frame_start = writer.size;
+        size_t frame_size;
+
+        if (block_size > frames - frame) {
+            block_size = (unsigned int) (frames - frame);
+        }
+
+        for (channel = 0; channel < info->channel_count; channel++) {
+            for (i = 0; i < block_size; i++) {
+                channels[channel][i] = get_sample(info, source, frame + i, channel);
+            }
+        }
+
+        /* Every third frame has a seek point */
+        if (seek_table != NULL && frame_index % 3 == 0 && seek_points < max_seek_points - TEST_PROGRAM_PLACEHOLDERS) {
+            unsigned char* point = seek_table + (seek_points * 18);
+            unsigned long long offset = frame_start - data_start;
+            unsigned int byte;
+
+            for (byte = 0; byte < 8; byte++) {
+                point[byte] = (unsigned char) (frame >> (56 - (byte * 8)));
+                point[8 + byte] = (unsigned char) (offset >> (56 - (byte * 8)));
+            }
+
+            point[16] = (unsigned char) (block_size >> 8);
+            point[17] = (unsigned char) block_size;
+            seek_points++;
+        }
+
+        if (middle->frames == 0 && frame >= frames / 2) {
+            middle->offset = frame_start;
+            middle->first_frame = frame;
+            middle->frames = block_size;
+        }
+
+        encode_frame(&writer, info, channels, block_size, info->block_size != 0 ? frame_index : frame, frame_index);
+        frame_size = writer.size - frame_start;
+
+        if (writer.size > capacity) {
+            puts("Test file was larger than expected!");
+            exit(EXIT_FAILURE);
+        }
+
+        /* The last block can be smaller than the others */
+        if (frame + block_size < frames || frame_index == 0) {
+            min_block = block_size < min_block ? block_size : min_block;
+        }
+
+        max_block = block_size > max_block ? block_size : max_block;
+        min_frame_size = frame_size < min_frame_size ? frame_size : min_frame_size;
+        max_frame_size = frame_size > max_frame_size ? frame_size : max_frame_size;
+        frame += block_size;
+        frame_index++;
+    }
+
+    /* Unused seek points are placeholders, which are already filled with 0xFF */
+    if (seek_table != NULL) {
+        for (i = seek_points * 18; i < max_seek_points * 18; i += 18) {
+            memset(seek_table + i + 8, 0, 10);
+        }
+    }
+
+    streaminfo[0] = (unsigned char) (min_block >> 8);
+    streaminfo[1] = (unsigned char) min_block;
+    streaminfo[2] = (unsigned char) (max_block >> 8);
+    streaminfo[3] = (unsigned char) max_block;
+    streaminfo[4] = (unsigned char) (min_frame_size >> 16);
+    streaminfo[5] = (unsigned char) (min_frame_size >> 8);
+    streaminfo[6] = (unsigned char) min_frame_size;
+
+    if (info->layout & TEST_LAYOUT_SMALL_MAX_FRAME_SIZE) {
+        max_frame_size = min_frame_size;
+    }
+
+    if (!(info->layout & TEST_LAYOUT_NO_MAX_FRAME_SIZE)) {
+        streaminfo[7] = (unsigned char) (max_frame_size >> 16);
+        streaminfo[8] = (unsigned char) (max_frame_size >> 8);
+        streaminfo[9] = (unsigned char) max_frame_size;
+    }
+
+    {
+        unsigned long long total = info->layout & TEST_LAYOUT_UNKNOWN_LENGTH ? 0 : frames;
+        unsigned long long packed = ((unsigned long long) TEST_PROGRAM_SAMPLE_RATE << 44) | ((unsigned long long) (info->channel_count - 1) << 41) | ((unsigned long long) (info->bits_per_sample - 1) << 36) | total;
+        unsigned int byte;
+
+        for (byte = 0; byte < 8; byte++) {
+            streaminfo[10 + byte] = (unsigned char) (packed >> (56 - (byte * 8)));
+        }
+    }
+
+    for (channel = 0; channel < info->channel_count; channel++) {
+        free(channels[channel]);
+    }
+
+    *size = writer.size;
+    return writer.data;
+}
+
+/* Pushes a file in pieces, and checks the length while it's received and decoded.
+Files without a length in STREAMINFO have no length until the last frame is decoded, other files have an estimated length until all of the file is pushed. */
+static int test_pushed_length(const test_file_info* info, const unsigned char* file, size_t file_size, size_t frames) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_length_type length_type;
+    OSWrapper_audio_length_type expected_type;
+    OSWRAPPER_AUDIO_SEEK_TYPE length = 0;
+    int* buffer = (int*) malloc(TEST_PROGRAM_MAX_PUSH * info->channel_count * sizeof(int));
+    size_t file_pos = 0;
+    size_t frames_done = 0;
+
+    if (buffer == NULL) {
+        puts("malloc failed for decoding buffer!");
+        return EXIT_FAILURE;
+    }
+
+    init_spec(&audio_spec);
+
+    if (!oswrapper_audio_load_push(&audio_spec)) {
+        puts("Could not create push decoder!");
+        free(buffer);
+        return EXIT_FAILURE;
+    }
+
+    while (1) {
+        size_t frames_read = oswrapper_audio_get_samples(&audio_spec, (short*) buffer, TEST_PROGRAM_MAX_PUSH);
+
+        if (frames_read == 0) {
+            break;
+        }
+
+        if (frames_read == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            size_t push_size = file_size - file_pos < TEST_PROGRAM_MAX_PUSH ? file_size - file_pos : (size_t) (rand() % TEST_PROGRAM_MAX_PUSH) + 1;
+
+            if (push_size == 0 || !oswrapper_audio_push_bytes(&audio_spec, file + file_pos, push_size)) {
+                printf("Could not push %s!\n", info->name);
+                goto exit;
+            }
+
+            file_pos += push_size;
+
+            if (file_pos == file_size) {
+                oswrapper_audio_push_end(&audio_spec);
+            }
+        } else {
+            frames_done += frames_read;
+        }
+
+        length_type = oswrapper_audio_get_length(&audio_spec, &length);
+        expected_type = file_pos == file_size ? OSWRAPPER_AUDIO_LENGTH_EXACT : OSWRAPPER_AUDIO_LENGTH_ESTIMATED;
+
+        /* The length of a file without one is found when the last frame is decoded */
+        if (info->layout & TEST_LAYOUT_UNKNOWN_LENGTH) {
+            expected_type = frames_done == frames && length_type == OSWRAPPER_AUDIO_LENGTH_EXACT ? OSWRAPPER_AUDIO_LENGTH_EXACT : OSWRAPPER_AUDIO_LENGTH_UNKNOWN;
+        }
+
+        if (audio_spec.sample_rate != 0 && (length_type != expected_type || (length_type != OSWRAPPER_AUDIO_LENGTH_UNKNOWN && length != (OSWRAPPER_AUDIO_SEEK_TYPE) frames))) {
+            printf("%s had the wrong length after %zu frames were pushed!\n", info->name, frames_done);
+            goto exit;
+        }
+    }
+
+    if (frames_done != frames || oswrapper_audio_get_length(&audio_spec, &length) != OSWRAPPER_AUDIO_LENGTH_EXACT || length != (OSWRAPPER_AUDIO_SEEK_TYPE) frames) {
+        printf("%s had the wrong length after it was pushed!\n", info->name);
+        goto exit;
+    }
+
+    returnVal = EXIT_SUCCESS;
+exit:
+    oswrapper_audio_free_context(&audio_spec);
+    free(buffer);
+    return returnVal;
+}
+
+/* Creates a test file, then decodes it and checks the result */
+static int test_file(const test_file_info* info, const short* source, size_t frames) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_info probe_info;
+    test_damage_location middle;
+    size_t file_size = 0;
+    int* expected = (int*) malloc(frames * info->channel_count * sizeof(int));
+    unsigned char* file = NULL;
+    void* pcm = NULL;
+    size_t pcm_frames = 0;
+    init_spec(&audio_spec);
+
+    if (expected == NULL) {
+        puts("malloc failed for expected samples!");
+        return EXIT_FAILURE;
+    }
+
+    middle.offset = 0;
+    middle.first_frame = 0;
+    middle.frames = 0;
+    file = create_flac(info, source, frames, expected, &middle, &file_size);
+
+    if (file == NULL) {
+        puts("malloc failed for test file!");
+        goto exit;
+    }
+
+    if (!oswrapper_audio_probe(file, file_size, &probe_info) || probe_info.sample_rate != TEST_PROGRAM_SAMPLE_RATE || probe_info.channel_count != info->channel_count || probe_info.bits_per_channel != 0
+            || probe_info.total_frames != (info->layout & TEST_LAYOUT_UNKNOWN_LENGTH ? -1 : (OSWRAPPER_AUDIO_SEEK_TYPE) frames)) {
+        printf("%s was probed incorrectly!\n", info->name);
+        goto exit;
+    }
+
+    if (!oswrapper_audio_decode_all(file, file_size, &audio_spec, &pcm, &pcm_frames)) {
+        printf("Could not decode %s!\n", info->name);
+        goto exit;
+    }
+
+    if (pcm_frames != frames || audio_spec.sample_rate != TEST_PROGRAM_SAMPLE_RATE || audio_spec.channel_count != info->channel_count) {
+        printf("%s decoded to %zu frames, expected %zu!\n", info->name, pcm_frames, frames);
+        goto exit;
+    }
+
+    if (check_samples(info, (const int*) pcm, expected, 0, frames, "when decoded") != EXIT_SUCCESS || test_access(info, file, file_size, expected, frames) != EXIT_SUCCESS
+            || test_pushed_length(info, file, file_size, frames) != EXIT_SUCCESS
+            || write_file(TEST_PROGRAM_BATCH_PATH, file, file_size) != EXIT_SUCCESS) {
+        goto exit;
+    }
+
+    /* The frames of a damaged frame are skipped, and the frames after it are still decoded */
+    file[middle.offset] = 0;
+
+    if (test_damaged(info, file, file_size, expected, frames, &middle) != EXIT_SUCCESS) {
+        goto exit;
+    }
+
+    printf("Decoded %zu frames of %s from %zu bytes\n", frames, info->name, file_size);
+    returnVal = EXIT_SUCCESS;
+exit:
+    remove(TEST_PROGRAM_BATCH_PATH);
+    remove(TEST_PROGRAM_DAMAGED_PATH);
+    oswrapper_audio_free_pcm(&audio_spec, pcm);
+    free(expected);
+    free(file);
+    return returnVal;
+}
+
+/* Decodes a given audio file, and encodes it as FLAC in a variety of formats */
+int main(int argc, char** argv) {
+    return run_tests(argc, argv, test_files, TEST_FILE_COUNT, test_file);
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
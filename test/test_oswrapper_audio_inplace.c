@@ -0,0 +1,249 @@
+/*
+This program uses oswrapper_audio to decode an audio file in caller provided storage
+with oswrapper_audio_load_from_memory_inplace, in a variety of output formats,
+using the storage size from oswrapper_audio_context_size.
+Every allocation made by the library is counted, to check that loading and decoding in place never allocates.
+The decoded audio is checked against the same file decoded with oswrapper_audio_load_from_memory.
+Storage which is too small is also checked to fail.
+
+Usage: test_oswrapper_audio_inplace (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_inplace.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Counts every allocation made by the library */
+static size_t test_malloc_count = 0;
+
+static void* test_counting_malloc(size_t size) {
+    test_malloc_count++;
+    return malloc(size);
+}
+
+#define OSWRAPPER_AUDIO_MALLOC(x) test_counting_malloc(x)
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+/* The largest amount of frames decoded at once */
+#define TEST_PROGRAM_BUFFER_SIZE 0x50
+/* The amount of voices which share one block of storage */
+#define TEST_PROGRAM_VOICES 4
+
+/* Reads the whole file at the given path into memory */
+static unsigned char* read_file(const char* path, size_t* size) {
+    unsigned char* data = NULL;
+    long file_size;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char*) malloc((size_t) file_size);
+
+        if (data != NULL && fread(data, 1, (size_t) file_size, file) != (size_t) file_size) {
+            free(data);
+            data = NULL;
+        }
+
+        *size = (size_t) file_size;
+    }
+
+    fclose(file);
+    return data;
+}
+
+/* Decodes the file in several voices at once, each in its own part of one block of storage,
+and checks that each voice matches the reference audio without allocating */
+static int test_inplace(const unsigned char* data, size_t data_size, const OSWrapper_audio_info* info, unsigned long sample_rate, unsigned int channel_count, unsigned int bits_per_channel, OSWrapper_audio_type audio_type, OSWrapper_audio_resample_quality quality) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec hints;
+    OSWrapper_audio_spec reference_spec;
+    OSWrapper_audio_spec voices[TEST_PROGRAM_VOICES];
+    unsigned char* storage = NULL;
+    unsigned char* reference_buffer = NULL;
+    unsigned char* voice_buffer = NULL;
+    size_t storage_size;
+    size_t frame_size;
+    size_t frames_done = 0;
+    size_t malloc_count;
+    int loaded_voices = 0;
+    int loaded_reference = 0;
+    int i;
+    memset(&hints, 0, sizeof(hints));
+    hints.sample_rate = sample_rate;
+    hints.channel_count = channel_count;
+    hints.bits_per_channel = bits_per_channel;
+    hints.audio_type = audio_type;
+    hints.resample_quality = quality;
+    reference_spec = hints;
+    /* Enough for this file, and sized to leave each voice's storage unaligned */
+    storage_size = oswrapper_audio_context_size(&hints, info->channel_count, info->sample_rate) | 1;
+
+    if (storage_size <= 1 || storage_size > oswrapper_audio_context_size(&hints, info->channel_count, 0) + 1 || storage_size > oswrapper_audio_context_size(&hints, 8, 192000) + 1) {
+        puts("oswrapper_audio_context_size returned the wrong size!");
+        return EXIT_FAILURE;
+    }
+
+    storage = (unsigned char*) malloc(storage_size * TEST_PROGRAM_VOICES);
+
+    if (storage == NULL) {
+        puts("malloc failed for storage!");
+        return EXIT_FAILURE;
+    }
+
+    loaded_reference = oswrapper_audio_load_from_memory(data, data_size, &reference_spec);
+
+    if (!loaded_reference) {
+        puts("Could not decode audio!");
+        goto exit;
+    }
+
+    frame_size = (reference_spec.bits_per_channel / 8) * reference_spec.channel_count;
+    reference_buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+    voice_buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+
+    if (reference_buffer == NULL || voice_buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    malloc_count = test_malloc_count;
+
+    for (; loaded_voices < TEST_PROGRAM_VOICES; loaded_voices++) {
+        voices[loaded_voices] = hints;
+
+        if (!oswrapper_audio_load_from_memory_inplace(data, data_size, &voices[loaded_voices], storage + (loaded_voices * storage_size), storage_size)) {
+            printf("Could not decode audio in place for voice %d!\n", loaded_voices);
+            goto exit;
+        }
+    }
+
+    while (1) {
+        size_t this_iter = oswrapper_audio_get_samples(&reference_spec, (short*) reference_buffer, TEST_PROGRAM_BUFFER_SIZE);
+
+        for (i = 0; i < TEST_PROGRAM_VOICES; i++) {
+            if (oswrapper_audio_get_samples(&voices[i], (short*) voice_buffer, TEST_PROGRAM_BUFFER_SIZE) != this_iter || memcmp(reference_buffer, voice_buffer, this_iter * frame_size) != 0) {
+                printf("Audio decoded in place did not match for voice %d at frame %zu!\n", i, frames_done);
+                goto exit;
+            }
+        }
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        frames_done += this_iter;
+    }
+
+    if (test_malloc_count != malloc_count) {
+        printf("Loading and decoding in place allocated %zu times!\n", test_malloc_count - malloc_count);
+        goto exit;
+    }
+
+    printf("Decoded %zu frames in %d voices of %zu bytes, with %u channels of %u bit samples at %lu Hz\n", frames_done, TEST_PROGRAM_VOICES, storage_size, reference_spec.channel_count, reference_spec.bits_per_channel, reference_spec.sample_rate);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    for (i = 0; i < loaded_voices; i++) {
+        if (!oswrapper_audio_free_context(&voices[i])) {
+            puts("Could not free audio context!");
+            returnVal = EXIT_FAILURE;
+        }
+    }
+
+    if (loaded_reference && !oswrapper_audio_free_context(&reference_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(storage);
+    free(reference_buffer);
+    free(voice_buffer);
+    return returnVal;
+}
+
+/* Checks that storage which is too small fails to load, without allocating */
+static int test_too_small(const unsigned char* data, size_t data_size) {
+    unsigned char storage[64];
+    OSWrapper_audio_spec audio_spec;
+    size_t malloc_count = test_malloc_count;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (oswrapper_audio_load_from_memory_inplace(data, data_size, &audio_spec, storage, sizeof(storage))
+            || oswrapper_audio_load_from_memory_inplace(data, data_size, &audio_spec, storage, 0)
+            || oswrapper_audio_load_from_memory_inplace(data, data_size, &audio_spec, NULL, 0x10000)) {
+        puts("Audio was decoded in storage which is too small!");
+        return EXIT_FAILURE;
+    }
+
+    if (test_malloc_count != malloc_count) {
+        puts("Loading in storage which is too small allocated!");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Decodes a given audio file in place in a variety of formats */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    OSWrapper_audio_info info;
+    size_t data_size = 0;
+    unsigned char* data;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    data = read_file(path, &data_size);
+
+    if (data == NULL) {
+        puts("Could not read file!");
+        returnVal = EXIT_FAILURE;
+    } else {
+        if (!oswrapper_audio_probe(data, data_size, &info)
+                || test_inplace(data, data_size, &info, 0, 0, 0, OSWRAPPER_AUDIO_FORMAT_NOT_SET, OSWRAPPER_AUDIO_RESAMPLE_QUALITY_DEFAULT) != EXIT_SUCCESS
+                || test_inplace(data, data_size, &info, 0, 6, 24, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER, OSWRAPPER_AUDIO_RESAMPLE_QUALITY_DEFAULT) != EXIT_SUCCESS
+                || test_inplace(data, data_size, &info, 48000, 2, 32, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT, OSWRAPPER_AUDIO_RESAMPLE_QUALITY_DEFAULT) != EXIT_SUCCESS
+                || test_inplace(data, data_size, &info, 8000, 2, 16, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER, OSWRAPPER_AUDIO_RESAMPLE_QUALITY_HIGH) != EXIT_SUCCESS
+                || test_inplace(data, data_size, &info, 22050, 1, 64, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT, OSWRAPPER_AUDIO_RESAMPLE_QUALITY_LINEAR) != EXIT_SUCCESS
+                || test_too_small(data, data_size) != EXIT_SUCCESS) {
+            returnVal = EXIT_FAILURE;
+        }
+
+        free(data);
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,165 @@
+/*
+This program uses oswrapper_audio to decode an audio file into a ring buffer with oswrapper_audio_get_samples_iov,
+writing to both halves of the ring buffer in one call when it wraps around.
+The decoded audio is checked against the same file decoded with oswrapper_audio_get_samples.
+
+Usage: test_oswrapper_audio_iov (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_iov.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The size of the ring buffer, in frames */
+#define TEST_PROGRAM_RING_SIZE 1000
+#define TEST_PROGRAM_SEED 1234
+
+/* Decodes the given file into a ring buffer, and checks that it matches the decoded audio */
+static int test_iov(const char* path, unsigned int bits_per_channel, OSWrapper_audio_type audio_type) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec decoded_spec;
+    OSWrapper_audio_spec ring_spec;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_decoded = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_ring = 0;
+    unsigned char* ring = NULL;
+    unsigned char* buffer = NULL;
+    size_t frame_size = 0;
+    size_t write_pos = 0;
+    size_t frames_done = 0;
+    memset(&decoded_spec, 0, sizeof(decoded_spec));
+    decoded_spec.bits_per_channel = bits_per_channel;
+    decoded_spec.audio_type = audio_type;
+    ring_spec = decoded_spec;
+    loaded_decoded = oswrapper_audio_load_from_path(path, &decoded_spec);
+    loaded_ring = oswrapper_audio_load_from_path(path, &ring_spec);
+
+    if (!loaded_decoded || !loaded_ring) {
+        puts("Could not decode audio!");
+        goto exit;
+    }
+
+    frame_size = (ring_spec.bits_per_channel / 8) * ring_spec.channel_count;
+    ring = (unsigned char*) malloc(TEST_PROGRAM_RING_SIZE * frame_size);
+    buffer = (unsigned char*) malloc(TEST_PROGRAM_RING_SIZE * frame_size);
+
+    if (ring == NULL || buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    while (1) {
+        OSWrapper_audio_iovec iov[2];
+        size_t frames_requested = 1 + (size_t) rand() % TEST_PROGRAM_RING_SIZE;
+        size_t first_frames = TEST_PROGRAM_RING_SIZE - write_pos < frames_requested ? TEST_PROGRAM_RING_SIZE - write_pos : frames_requested;
+        size_t this_iter;
+        iov[0].buffer = ring + (write_pos * frame_size);
+        iov[0].frames = first_frames;
+        iov[1].buffer = ring;
+        iov[1].frames = frames_requested - first_frames;
+        this_iter = oswrapper_audio_get_samples_iov(&ring_spec, iov, iov[1].frames > 0 ? 2 : 1);
+
+        if (this_iter > frames_requested) {
+            puts("Too many frames were decoded!");
+            goto exit;
+        }
+
+        if (oswrapper_audio_get_samples(&decoded_spec, (short*) buffer, this_iter) != this_iter) {
+            printf("Decoded audio ended early, after %zu frames!\n", frames_done);
+            goto exit;
+        }
+
+        first_frames = this_iter < first_frames ? this_iter : first_frames;
+
+        if (memcmp(ring + (write_pos * frame_size), buffer, first_frames * frame_size) != 0
+                || memcmp(ring, buffer + (first_frames * frame_size), (this_iter - first_frames) * frame_size) != 0) {
+            printf("Ring buffer audio did not match after frame %zu!\n", frames_done);
+            goto exit;
+        }
+
+        frames_done += this_iter;
+        write_pos = (write_pos + this_iter) % TEST_PROGRAM_RING_SIZE;
+
+        if (this_iter < frames_requested) {
+            break;
+        }
+    }
+
+    if (oswrapper_audio_get_samples(&decoded_spec, (short*) buffer, TEST_PROGRAM_RING_SIZE) != 0) {
+        printf("Ring buffer audio ended early, after %zu frames!\n", frames_done);
+        goto exit;
+    }
+
+    printf("Decoded %zu frames of %u bit audio into a ring buffer\n", frames_done, ring_spec.bits_per_channel);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded_ring && !oswrapper_audio_free_context(&ring_spec)) {
+        puts("Could not free ring buffer audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (loaded_decoded && !oswrapper_audio_free_context(&decoded_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (ring != NULL) {
+        free(ring);
+        ring = NULL;
+    }
+
+    if (buffer != NULL) {
+        free(buffer);
+        buffer = NULL;
+    }
+
+    return returnVal;
+}
+
+/* Decodes a given audio file into a ring buffer */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    srand(TEST_PROGRAM_SEED);
+
+    if (test_iov(path, 0, OSWRAPPER_AUDIO_FORMAT_NOT_SET) != EXIT_SUCCESS || test_iov(path, 32, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,446 @@
+/*
+This program uses oswrapper_audio to decode an audio file through OSWrapper_audio_ma_data_source,
+without opening an audio device.
+The audio read from the data source is checked against the same file decoded with oswrapper_audio_get_samples,
+after reading it from the start, seeking, looping, and playing it through a miniaudio engine.
+
+Usage: test_oswrapper_audio_ma_data_source (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_ma_data_source.c
+*/
+
+#define MA_NO_DEVICE_IO
+#define MA_NO_DECODING
+#define MA_NO_ENCODING
+#define MA_NO_RESOURCE_MANAGER
+#define MA_NO_GENERATION
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_USE_MINIAUDIO_DATA_SOURCE
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+#include <objbase.h>
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfreadwrite.lib")
+#pragma comment(lib, "shlwapi.lib")
+#pragma comment(lib, "Ole32.lib")
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_PROGRAM_BUFFER_SIZE 0x500
+
+/* Decodes the whole file with oswrapper_audio_get_samples, with the given output format hints */
+static unsigned char* decode_reference(const char* path, unsigned int bits_per_channel, OSWrapper_audio_type audio_type, size_t* frames) {
+    OSWrapper_audio_spec audio_spec;
+    OSWRAPPER_AUDIO_SEEK_TYPE length = 0;
+    unsigned char* decoded = NULL;
+    size_t frame_size;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    audio_spec.bits_per_channel = bits_per_channel;
+    audio_spec.audio_type = audio_type;
+
+    if (!oswrapper_audio_load_from_path(path, &audio_spec)) {
+        puts("Could not decode audio!");
+        return NULL;
+    }
+
+    if (oswrapper_audio_get_length(&audio_spec, &length) == OSWRAPPER_AUDIO_LENGTH_UNKNOWN || length <= 0) {
+        puts("Could not get the length of the audio!");
+        goto exit;
+    }
+
+    frame_size = (audio_spec.bits_per_channel / 8) * audio_spec.channel_count;
+    decoded = (unsigned char*) malloc((size_t) length * frame_size);
+
+    if (decoded == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    *frames = oswrapper_audio_get_samples(&audio_spec, (short*) decoded, (size_t) length);
+exit:
+
+    if (!oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+    }
+
+    return decoded;
+}
+
+/* Reads the file through a data source with the given output format hints, and checks it against the reference audio */
+static int test_data_source(const char* path, unsigned int bits_per_channel, OSWrapper_audio_type audio_type, ma_format expected_format) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_ma_data_source data_source;
+    OSWRAPPER_AUDIO_RESULT_TYPE did_init_data_source = 0;
+    unsigned char* reference = NULL;
+    unsigned char* buffer = NULL;
+    size_t reference_frames = 0;
+    size_t frame_size;
+    size_t frames_done = 0;
+    ma_format format;
+    ma_uint32 channels;
+    ma_uint32 sample_rate;
+    ma_uint64 length = 0;
+    ma_uint64 cursor = 0;
+    ma_uint64 middle;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    audio_spec.bits_per_channel = bits_per_channel;
+    audio_spec.audio_type = audio_type;
+    reference = decode_reference(path, bits_per_channel, audio_type, &reference_frames);
+
+    if (reference == NULL || !oswrapper_audio_load_from_path(path, &audio_spec)) {
+        puts("Could not decode audio!");
+        free(reference);
+        return EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_ma_data_source_init(&audio_spec, &data_source)) {
+        puts("Could not create data source!");
+        goto exit;
+    }
+
+    did_init_data_source = 1;
+    frame_size = (audio_spec.bits_per_channel / 8) * audio_spec.channel_count;
+    buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+
+    if (buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    if (ma_data_source_get_data_format(&data_source, &format, &channels, &sample_rate, NULL, 0) != MA_SUCCESS
+            || format != expected_format || channels != audio_spec.channel_count || sample_rate != audio_spec.sample_rate) {
+        puts("Data source had the wrong format!");
+        goto exit;
+    }
+
+    if (ma_data_source_get_length_in_pcm_frames(&data_source, &length) != MA_SUCCESS || length != reference_frames) {
+        printf("Data source had length %llu, expected %zu!\n", (unsigned long long) length, reference_frames);
+        goto exit;
+    }
+
+    /* Read the whole file */
+    while (1) {
+        ma_uint64 this_iter = 0;
+        ma_result result = ma_data_source_read_pcm_frames(&data_source, buffer, 1 + (ma_uint64) rand() % TEST_PROGRAM_BUFFER_SIZE, &this_iter);
+
+        if (this_iter == 0) {
+            if (result != MA_AT_END) {
+                puts("Data source didn't return MA_AT_END at the end of the audio!");
+                goto exit;
+            }
+
+            break;
+        }
+
+        if (frames_done + this_iter > reference_frames || memcmp(buffer, reference + (frames_done * frame_size), (size_t) this_iter * frame_size) != 0) {
+            printf("Data source audio did not match at frame %zu!\n", frames_done);
+            goto exit;
+        }
+
+        frames_done += (size_t) this_iter;
+    }
+
+    if (frames_done != reference_frames) {
+        printf("Data source audio ended early, after %zu frames!\n", frames_done);
+        goto exit;
+    }
+
+    /* Seek to the middle */
+    middle = length / 2;
+
+    if (ma_data_source_seek_to_pcm_frame(&data_source, middle) != MA_SUCCESS
+            || ma_data_source_get_cursor_in_pcm_frames(&data_source, &cursor) != MA_SUCCESS || cursor != middle) {
+        puts("Could not seek to the middle of the data source!");
+        goto exit;
+    }
+
+    frames_done = (size_t) middle;
+
+    while (1) {
+        ma_uint64 this_iter = 0;
+        ma_data_source_read_pcm_frames(&data_source, buffer, TEST_PROGRAM_BUFFER_SIZE, &this_iter);
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        if (memcmp(buffer, reference + (frames_done * frame_size), (size_t) this_iter * frame_size) != 0) {
+            printf("Data source audio after seeking did not match at frame %zu!\n", frames_done);
+            goto exit;
+        }
+
+        frames_done += (size_t) this_iter;
+    }
+
+    if (frames_done != reference_frames) {
+        puts("Data source audio after seeking ended early!");
+        goto exit;
+    }
+
+    /* Loop the audio, reading it twice */
+    if (ma_data_source_set_looping(&data_source, MA_TRUE) != MA_SUCCESS) {
+        puts("Could not loop the data source!");
+        goto exit;
+    }
+
+    frames_done = 0;
+
+    while (frames_done < reference_frames * 2) {
+        ma_uint64 frames_left = (ma_uint64) (reference_frames * 2 - frames_done);
+        ma_uint64 this_iter = 0;
+        ma_uint64 i;
+        ma_data_source_read_pcm_frames(&data_source, buffer, frames_left < TEST_PROGRAM_BUFFER_SIZE ? frames_left : TEST_PROGRAM_BUFFER_SIZE, &this_iter);
+
+        if (this_iter == 0) {
+            printf("Looping data source ended after %zu frames!\n", frames_done);
+            goto exit;
+        }
+
+        for (i = 0; i < this_iter; i++, frames_done++) {
+            if (memcmp(buffer + ((size_t) i * frame_size), reference + ((frames_done % reference_frames) * frame_size), frame_size) != 0) {
+                printf("Looping data source audio did not match at frame %zu!\n", frames_done);
+                goto exit;
+            }
+        }
+    }
+
+    printf("Read %zu frames from a data source, with %u channels of %u bit samples\n", reference_frames, audio_spec.channel_count, audio_spec.bits_per_channel);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (did_init_data_source) {
+        oswrapper_audio_ma_data_source_uninit(&data_source);
+    }
+
+    if (!oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(reference);
+    free(buffer);
+    return returnVal;
+}
+
+/* Plays the file through a miniaudio engine without a device, and checks it against the reference audio */
+static int test_engine(const char* path) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_ma_data_source data_source;
+    OSWRAPPER_AUDIO_RESULT_TYPE did_init_data_source = 0;
+    ma_engine_config engine_config;
+    ma_engine engine;
+    ma_sound sound;
+    int did_init_engine = 0;
+    int did_init_sound = 0;
+    float* reference = NULL;
+    float* buffer = NULL;
+    size_t reference_frames = 0;
+    size_t frames_done = 0;
+    size_t i;
+    float max_error = 0;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    audio_spec.bits_per_channel = 32;
+    audio_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
+    reference = (float*) decode_reference(path, 32, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT, &reference_frames);
+
+    if (reference == NULL || !oswrapper_audio_load_from_path(path, &audio_spec)) {
+        puts("Could not decode audio!");
+        free(reference);
+        return EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_ma_data_source_init(&audio_spec, &data_source)) {
+        puts("Could not create data source!");
+        goto exit;
+    }
+
+    did_init_data_source = 1;
+    buffer = (float*) malloc(TEST_PROGRAM_BUFFER_SIZE * audio_spec.channel_count * sizeof(float));
+
+    if (buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    /* Mix at the same format as the audio, and disable pitch and spatialization, so the engine passes it through unchanged */
+    engine_config = ma_engine_config_init();
+    engine_config.noDevice = MA_TRUE;
+    engine_config.channels = audio_spec.channel_count;
+    engine_config.sampleRate = (ma_uint32) audio_spec.sample_rate;
+
+    if (ma_engine_init(&engine_config, &engine) != MA_SUCCESS) {
+        puts("Could not create miniaudio engine!");
+        goto exit;
+    }
+
+    did_init_engine = 1;
+
+    if (ma_sound_init_from_data_source(&engine, &data_source, MA_SOUND_FLAG_NO_SPATIALIZATION | MA_SOUND_FLAG_NO_PITCH, NULL, &sound) != MA_SUCCESS
+            || ma_sound_start(&sound) != MA_SUCCESS) {
+        puts("Could not play data source with miniaudio engine!");
+        goto exit;
+    }
+
+    did_init_sound = 1;
+
+    while (frames_done < reference_frames) {
+        size_t frames_left = reference_frames - frames_done;
+        ma_uint64 this_iter = 0;
+
+        if (ma_engine_read_pcm_frames(&engine, buffer, frames_left < TEST_PROGRAM_BUFFER_SIZE ? frames_left : TEST_PROGRAM_BUFFER_SIZE, &this_iter) != MA_SUCCESS || this_iter == 0) {
+            printf("Engine stopped after %zu frames!\n", frames_done);
+            goto exit;
+        }
+
+        for (i = 0; i < (size_t) this_iter * audio_spec.channel_count; i++) {
+            float error = buffer[i] - reference[(frames_done * audio_spec.channel_count) + i];
+            error = error < 0 ? -error : error;
+            max_error = error > max_error ? error : max_error;
+        }
+
+        frames_done += (size_t) this_iter;
+    }
+
+    if (max_error > 0.0001f) {
+        printf("Engine audio differed by up to %f!\n", max_error);
+        goto exit;
+    }
+
+    if (!ma_sound_at_end(&sound)) {
+        /* The engine only notices the end after trying to read past it */
+        ma_uint64 this_iter = 0;
+        ma_engine_read_pcm_frames(&engine, buffer, 1, &this_iter);
+
+        if (!ma_sound_at_end(&sound)) {
+            puts("Engine didn't reach the end of the sound!");
+            goto exit;
+        }
+    }
+
+    printf("Played %zu frames through a miniaudio engine\n", frames_done);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (did_init_sound) {
+        ma_sound_uninit(&sound);
+    }
+
+    if (did_init_engine) {
+        ma_engine_uninit(&engine);
+    }
+
+    if (did_init_data_source) {
+        oswrapper_audio_ma_data_source_uninit(&data_source);
+    }
+
+    if (!oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(reference);
+    free(buffer);
+    return returnVal;
+}
+
+/* Checks that output formats which miniaudio can't use are rejected */
+static int test_unsupported(const char* path, unsigned int bits_per_channel, OSWrapper_audio_type audio_type) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_ma_data_source data_source;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    audio_spec.bits_per_channel = bits_per_channel;
+    audio_spec.audio_type = audio_type;
+
+    if (!oswrapper_audio_load_from_path(path, &audio_spec)) {
+        puts("Could not decode audio!");
+        return EXIT_FAILURE;
+    }
+
+    if (audio_spec.bits_per_channel != bits_per_channel) {
+        /* The decoder didn't use the hinted format */
+        returnVal = EXIT_SUCCESS;
+    } else if (oswrapper_audio_ma_data_source_init(&audio_spec, &data_source)) {
+        printf("Data source was created with unsupported %u bit samples!\n", bits_per_channel);
+        oswrapper_audio_ma_data_source_uninit(&data_source);
+    } else {
+        returnVal = EXIT_SUCCESS;
+    }
+
+    if (!oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/* Reads a given audio file through a miniaudio data source in a variety of formats */
+int main(int argc, char** argv) {
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    HRESULT result = CoInitialize(NULL);
+
+    if (FAILED(result)) {
+        puts("CoInitialize failed!");
+        return EXIT_FAILURE;
+    }
+
+#endif
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    srand(1234);
+
+    if (test_data_source(path, 16, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER, ma_format_s16) != EXIT_SUCCESS
+            || test_data_source(path, 24, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER, ma_format_s24) != EXIT_SUCCESS
+            || test_data_source(path, 32, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER, ma_format_s32) != EXIT_SUCCESS
+            || test_data_source(path, 32, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT, ma_format_f32) != EXIT_SUCCESS
+            || test_engine(path) != EXIT_SUCCESS
+            || test_unsupported(path, 8, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) != EXIT_SUCCESS
+            || test_unsupported(path, 64, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    CoUninitialize();
+#endif
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,247 @@
+/*
+This program uses oswrapper_audio to read an audio file with oswrapper_audio_peek_samples and oswrapper_audio_consume,
+which give access to the decoded samples without copying them when they're already in the output format.
+The audio is checked against the same file decoded with oswrapper_audio_get_samples.
+When the audio has to be converted, it checks that peeking fails and consuming still skips audio.
+
+Usage: test_oswrapper_audio_peek (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_peek.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The largest amount of frames consumed at once */
+#define TEST_PROGRAM_BUFFER_SIZE 0x500
+#define TEST_PROGRAM_SEED 1234
+
+/* Reads the given file without copying it, and checks that it matches the decoded audio */
+static int test_peek(const char* path) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec decoded_spec;
+    OSWrapper_audio_spec peek_spec;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_decoded = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_peek = 0;
+    unsigned char* buffer = NULL;
+    size_t frame_size = 0;
+    size_t frames_done = 0;
+    memset(&decoded_spec, 0, sizeof(decoded_spec));
+    memset(&peek_spec, 0, sizeof(peek_spec));
+    loaded_decoded = oswrapper_audio_load_from_path(path, &decoded_spec);
+    loaded_peek = oswrapper_audio_load_from_path(path, &peek_spec);
+
+    if (!loaded_decoded || !loaded_peek) {
+        puts("Could not decode audio!");
+        goto exit;
+    }
+
+    frame_size = (peek_spec.bits_per_channel / 8) * peek_spec.channel_count;
+    buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+
+    if (buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    while (1) {
+        const void* samples = NULL;
+        size_t frames_available = 0;
+        size_t this_iter = 1 + (size_t) rand() % TEST_PROGRAM_BUFFER_SIZE;
+
+        if (!oswrapper_audio_peek_samples(&peek_spec, &samples, &frames_available)) {
+            puts("Could not peek at the audio!");
+            goto exit;
+        }
+
+        if (frames_available == 0) {
+            break;
+        }
+
+        if (((size_t) samples % (peek_spec.bits_per_channel / 8)) != 0) {
+            puts("Samples were not aligned!");
+            goto exit;
+        }
+
+        this_iter = this_iter < frames_available ? this_iter : frames_available;
+
+        if (oswrapper_audio_get_samples(&decoded_spec, (short*) buffer, this_iter) != this_iter) {
+            printf("Decoded audio ended early, after %zu frames!\n", frames_done);
+            goto exit;
+        }
+
+        if (memcmp(samples, buffer, this_iter * frame_size) != 0) {
+            printf("Peeked audio did not match at frame %zu!\n", frames_done);
+            goto exit;
+        }
+
+        if (!oswrapper_audio_consume(&peek_spec, this_iter)) {
+            puts("Could not consume audio!");
+            goto exit;
+        }
+
+        frames_done += this_iter;
+    }
+
+    if (oswrapper_audio_get_samples(&decoded_spec, (short*) buffer, TEST_PROGRAM_BUFFER_SIZE) != 0) {
+        printf("Peeked audio ended early, after %zu frames!\n", frames_done);
+        goto exit;
+    }
+
+    /* Consuming past the end stops at the end */
+    if (!oswrapper_audio_consume(&peek_spec, TEST_PROGRAM_BUFFER_SIZE) || oswrapper_audio_get_samples(&peek_spec, (short*) buffer, TEST_PROGRAM_BUFFER_SIZE) != 0) {
+        puts("Consuming past the end failed!");
+        goto exit;
+    }
+
+    printf("Peeked at %zu frames of audio\n", frames_done);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded_peek && !oswrapper_audio_free_context(&peek_spec)) {
+        puts("Could not free peeked audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (loaded_decoded && !oswrapper_audio_free_context(&decoded_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (buffer != NULL) {
+        free(buffer);
+        buffer = NULL;
+    }
+
+    return returnVal;
+}
+
+/* Decodes the given file as floating point PCM, which can't be peeked at,
+and checks that consuming frames skips the same audio as decoding them */
+static int test_consume_converted(const char* path) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec decoded_spec;
+    OSWrapper_audio_spec consumed_spec;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_decoded = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_consumed = 0;
+    const void* samples = NULL;
+    size_t frames_available = 0;
+    unsigned char* decoded_buffer = NULL;
+    unsigned char* consumed_buffer = NULL;
+    size_t frame_size = 0;
+    size_t frames_decoded;
+    size_t frames_consumed;
+    memset(&decoded_spec, 0, sizeof(decoded_spec));
+    decoded_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
+    decoded_spec.bits_per_channel = 32;
+    consumed_spec = decoded_spec;
+    loaded_decoded = oswrapper_audio_load_from_path(path, &decoded_spec);
+    loaded_consumed = oswrapper_audio_load_from_path(path, &consumed_spec);
+
+    if (!loaded_decoded || !loaded_consumed) {
+        puts("Could not decode audio!");
+        goto exit;
+    }
+
+    if (oswrapper_audio_peek_samples(&consumed_spec, &samples, &frames_available)) {
+        puts("Peeking at converted audio should fail!");
+        goto exit;
+    }
+
+    frame_size = (consumed_spec.bits_per_channel / 8) * consumed_spec.channel_count;
+    decoded_buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+    consumed_buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+
+    if (decoded_buffer == NULL || consumed_buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    frames_decoded = oswrapper_audio_get_samples(&decoded_spec, (short*) decoded_buffer, TEST_PROGRAM_BUFFER_SIZE);
+    frames_decoded += oswrapper_audio_get_samples(&decoded_spec, (short*) decoded_buffer, TEST_PROGRAM_BUFFER_SIZE);
+
+    if (!oswrapper_audio_consume(&consumed_spec, frames_decoded)) {
+        puts("Could not consume converted audio!");
+        goto exit;
+    }
+
+    frames_decoded = oswrapper_audio_get_samples(&decoded_spec, (short*) decoded_buffer, TEST_PROGRAM_BUFFER_SIZE);
+    frames_consumed = oswrapper_audio_get_samples(&consumed_spec, (short*) consumed_buffer, TEST_PROGRAM_BUFFER_SIZE);
+
+    if (frames_decoded != frames_consumed || memcmp(decoded_buffer, consumed_buffer, frames_decoded * frame_size) != 0) {
+        puts("Audio after consuming did not match!");
+        goto exit;
+    }
+
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded_consumed && !oswrapper_audio_free_context(&consumed_spec)) {
+        puts("Could not free consumed audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (loaded_decoded && !oswrapper_audio_free_context(&decoded_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (decoded_buffer != NULL) {
+        free(decoded_buffer);
+        decoded_buffer = NULL;
+    }
+
+    if (consumed_buffer != NULL) {
+        free(consumed_buffer);
+        consumed_buffer = NULL;
+    }
+
+    return returnVal;
+}
+
+/* Reads a given audio file without copying it */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    srand(TEST_PROGRAM_SEED);
+
+    if (test_peek(path) != EXIT_SUCCESS || test_consume_converted(path) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
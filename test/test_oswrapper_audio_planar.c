@@ -0,0 +1,206 @@
+/*
+This program uses oswrapper_audio to decode an audio file with oswrapper_audio_get_samples_planar,
+in a variety of output formats and channel counts.
+The decoded audio is checked against the same file decoded with oswrapper_audio_get_samples.
+
+Usage: test_oswrapper_audio_planar (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_planar.c
+*/
+
+#ifdef OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL
+/* Decode audio with miniaudio instead of the OS audio decoders */
+#define MA_NO_DEVICE_IO
+#define MA_NO_ENCODING
+#define MA_NO_RESOURCE_MANAGER
+#define MA_NO_NODE_GRAPH
+#define MA_NO_ENGINE
+#define MA_NO_GENERATION
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+#endif
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+#include <objbase.h>
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfreadwrite.lib")
+#pragma comment(lib, "shlwapi.lib")
+#pragma comment(lib, "Ole32.lib")
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The largest amount of frames decoded at once */
+#define TEST_PROGRAM_BUFFER_SIZE 0x500
+#define TEST_PROGRAM_MAX_CHANNELS 8
+#define TEST_PROGRAM_SEED 1234
+
+/* Decodes the given file with the given output format hints, and checks that the planar audio matches the interleaved audio */
+static int test_planar(const char* path, unsigned int channel_count, unsigned int bits_per_channel, OSWrapper_audio_type audio_type) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec interleaved_spec;
+    OSWrapper_audio_spec planar_spec;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_interleaved = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_planar = 0;
+    unsigned char* interleaved_buffer = NULL;
+    unsigned char* planar_buffer = NULL;
+    void* channels[TEST_PROGRAM_MAX_CHANNELS];
+    size_t sample_size = 0;
+    size_t frame_size = 0;
+    size_t frames_done = 0;
+    unsigned int channel;
+    memset(&interleaved_spec, 0, sizeof(interleaved_spec));
+    interleaved_spec.channel_count = channel_count;
+    interleaved_spec.bits_per_channel = bits_per_channel;
+    interleaved_spec.audio_type = audio_type;
+    planar_spec = interleaved_spec;
+    loaded_interleaved = oswrapper_audio_load_from_path(path, &interleaved_spec);
+    loaded_planar = oswrapper_audio_load_from_path(path, &planar_spec);
+
+    if (!loaded_interleaved || !loaded_planar) {
+        puts("Could not decode audio!");
+        goto exit;
+    }
+
+    if (planar_spec.channel_count > TEST_PROGRAM_MAX_CHANNELS) {
+        printf("Skipped decoding %u channels\n", planar_spec.channel_count);
+        returnVal = EXIT_SUCCESS;
+        goto exit;
+    }
+
+    sample_size = planar_spec.bits_per_channel / 8;
+    frame_size = sample_size * planar_spec.channel_count;
+    interleaved_buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+    planar_buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+
+    if (interleaved_buffer == NULL || planar_buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    for (channel = 0; channel < planar_spec.channel_count; channel++) {
+        channels[channel] = planar_buffer + (channel * TEST_PROGRAM_BUFFER_SIZE * sample_size);
+    }
+
+    while (1) {
+        size_t frames_requested = 1 + (size_t) rand() % TEST_PROGRAM_BUFFER_SIZE;
+        size_t this_iter = oswrapper_audio_get_samples_planar(&planar_spec, channels, frames_requested);
+        size_t i;
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        if (oswrapper_audio_get_samples(&interleaved_spec, (short*) interleaved_buffer, this_iter) != this_iter) {
+            printf("Interleaved audio ended early, after %zu frames!\n", frames_done);
+            goto exit;
+        }
+
+        for (i = 0; i < this_iter; i++) {
+            for (channel = 0; channel < planar_spec.channel_count; channel++) {
+                if (memcmp((unsigned char*) channels[channel] + (i * sample_size), interleaved_buffer + (i * frame_size) + (channel * sample_size), sample_size) != 0) {
+                    printf("Planar audio did not match at frame %zu, channel %u!\n", frames_done + i, channel);
+                    goto exit;
+                }
+            }
+        }
+
+        frames_done += this_iter;
+    }
+
+    if (oswrapper_audio_get_samples(&interleaved_spec, (short*) interleaved_buffer, TEST_PROGRAM_BUFFER_SIZE) != 0) {
+        printf("Planar audio ended early, after %zu frames!\n", frames_done);
+        goto exit;
+    }
+
+    printf("Decoded %zu frames of planar audio, with %u channels of %u bit samples\n", frames_done, planar_spec.channel_count, planar_spec.bits_per_channel);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded_planar && !oswrapper_audio_free_context(&planar_spec)) {
+        puts("Could not free planar audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (loaded_interleaved && !oswrapper_audio_free_context(&interleaved_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (interleaved_buffer != NULL) {
+        free(interleaved_buffer);
+        interleaved_buffer = NULL;
+    }
+
+    if (planar_buffer != NULL) {
+        free(planar_buffer);
+        planar_buffer = NULL;
+    }
+
+    return returnVal;
+}
+
+/* Decodes a given audio file to planar audio in a variety of formats */
+int main(int argc, char** argv) {
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    HRESULT result = CoInitialize(NULL);
+
+    if (FAILED(result)) {
+        puts("CoInitialize failed!");
+        return EXIT_FAILURE;
+    }
+
+#endif
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    srand(TEST_PROGRAM_SEED);
+
+    if (test_planar(path, 0, 0, OSWRAPPER_AUDIO_FORMAT_NOT_SET) != EXIT_SUCCESS
+            || test_planar(path, 2, 8, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) != EXIT_SUCCESS
+            || test_planar(path, 2, 16, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) != EXIT_SUCCESS
+            || test_planar(path, 6, 24, OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER) != EXIT_SUCCESS
+            || test_planar(path, 2, 32, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) != EXIT_SUCCESS
+            || test_planar(path, 2, 64, OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    CoUninitialize();
+#endif
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,236 @@
+/*
+This program uses oswrapper_audio to decode an audio file which is passed to the decoder
+in randomly sized pieces with oswrapper_audio_push_bytes, as if it was being received over a network.
+The decoded audio is checked against the same file decoded with oswrapper_audio_load_from_memory.
+The file is pushed once in small pieces when the decoder needs more data,
+and once in large pieces which are pushed before the decoder needs them.
+
+Usage: test_oswrapper_audio_push (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_push.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The largest piece of the file passed to the decoder at once */
+#define TEST_PROGRAM_MAX_PIECE_SIZE 0x400
+/* The size of each piece when pushing ahead of decoding, which is most of the decoder's starting buffer */
+#define TEST_PROGRAM_AHEAD_PIECE_SIZE 0xA000
+/* When pushing ahead of decoding, the next piece is pushed after this many frames have been decoded */
+#define TEST_PROGRAM_AHEAD_FRAMES 0x2000
+/* The largest amount of frames decoded at once */
+#define TEST_PROGRAM_BUFFER_SIZE 0x50
+#define TEST_PROGRAM_SEED 1234
+
+/* Reads the whole file at the given path into memory */
+static unsigned char* read_file(const char* path, size_t* size) {
+    unsigned char* data = NULL;
+    long file_size;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char*) malloc((size_t) file_size);
+
+        if (data != NULL && fread(data, 1, (size_t) file_size, file) != (size_t) file_size) {
+            free(data);
+            data = NULL;
+        }
+
+        *size = (size_t) file_size;
+    }
+
+    fclose(file);
+    return data;
+}
+
+/* Decodes a file by pushing it to the decoder in pieces, and checks it against the file decoded from memory.
+Pieces are either randomly sized and pushed when the decoder needs more data,
+or are large and pushed ahead of decoding, so data is added while part of the buffer has already been decoded. */
+static int test_push(const unsigned char* file_data, size_t file_size, int push_ahead) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec reference_spec;
+    OSWrapper_audio_spec push_spec;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_reference = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_push = 0;
+    unsigned char* reference_buffer = NULL;
+    unsigned char* push_buffer = NULL;
+    size_t file_pos = 0;
+    size_t frame_size = 0;
+    size_t frames_done = 0;
+    size_t frames_at_push = 0;
+    size_t pieces = 0;
+    size_t first_audio_at = 0;
+    memset(&reference_spec, 0, sizeof(reference_spec));
+    memset(&push_spec, 0, sizeof(push_spec));
+    loaded_reference = oswrapper_audio_load_from_memory(file_data, file_size, &reference_spec);
+
+    if (!loaded_reference) {
+        puts("Could not decode audio!");
+        goto exit;
+    }
+
+    loaded_push = oswrapper_audio_load_push(&push_spec);
+
+    if (!loaded_push) {
+        puts("Could not create push decoder!");
+        goto exit;
+    }
+
+    frame_size = (reference_spec.bits_per_channel / 8) * reference_spec.channel_count;
+    reference_buffer = (unsigned char*) calloc(TEST_PROGRAM_BUFFER_SIZE, frame_size);
+    push_buffer = (unsigned char*) calloc(TEST_PROGRAM_BUFFER_SIZE, frame_size);
+
+    if (reference_buffer == NULL || push_buffer == NULL) {
+        puts("calloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    srand(TEST_PROGRAM_SEED);
+
+    while (1) {
+        size_t frames_requested = 1 + (size_t) rand() % TEST_PROGRAM_BUFFER_SIZE;
+        size_t this_iter;
+
+        if (push_ahead && file_pos != file_size && frames_done - frames_at_push >= TEST_PROGRAM_AHEAD_FRAMES) {
+            this_iter = OSWRAPPER_AUDIO_NEED_MORE_DATA;
+        } else {
+            this_iter = oswrapper_audio_get_samples(&push_spec, (short*) push_buffer, frames_requested);
+        }
+
+        if (this_iter == OSWRAPPER_AUDIO_NEED_MORE_DATA) {
+            /* Pass the next piece of the file to the decoder */
+            size_t piece_size = push_ahead ? TEST_PROGRAM_AHEAD_PIECE_SIZE : 1 + (size_t) rand() % TEST_PROGRAM_MAX_PIECE_SIZE;
+
+            if (file_pos == file_size) {
+                oswrapper_audio_push_end(&push_spec);
+                continue;
+            }
+
+            if (piece_size > file_size - file_pos) {
+                piece_size = file_size - file_pos;
+            }
+
+            if (!oswrapper_audio_push_bytes(&push_spec, file_data + file_pos, piece_size)) {
+                printf("Could not push %zu bytes at offset %zu!\n", piece_size, file_pos);
+                goto exit;
+            }
+
+            file_pos += piece_size;
+            frames_at_push = frames_done;
+            pieces++;
+            continue;
+        }
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        if (frames_done == 0) {
+            first_audio_at = file_pos;
+
+            if (push_spec.sample_rate != reference_spec.sample_rate || push_spec.channel_count != reference_spec.channel_count || push_spec.bits_per_channel != reference_spec.bits_per_channel) {
+                puts("Pushed audio format did not match!");
+                goto exit;
+            }
+        }
+
+        if (oswrapper_audio_get_samples(&reference_spec, (short*) reference_buffer, this_iter) != this_iter || memcmp(reference_buffer, push_buffer, this_iter * frame_size) != 0) {
+            printf("Pushed audio did not match at frame %zu!\n", frames_done);
+            goto exit;
+        }
+
+        frames_done += this_iter;
+    }
+
+    if (oswrapper_audio_get_samples(&reference_spec, (short*) reference_buffer, TEST_PROGRAM_BUFFER_SIZE) != 0) {
+        printf("Pushed audio ended early, after %zu frames!\n", frames_done);
+        goto exit;
+    }
+
+    printf("Decoded %zu frames of audio from %zu pieces, first audio after %zu of %zu bytes\n", frames_done, pieces, first_audio_at, file_size);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded_push && !oswrapper_audio_free_context(&push_spec)) {
+        puts("Could not free push audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (loaded_reference && !oswrapper_audio_free_context(&reference_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (reference_buffer != NULL) {
+        free(reference_buffer);
+        reference_buffer = NULL;
+    }
+
+    if (push_buffer != NULL) {
+        free(push_buffer);
+        push_buffer = NULL;
+    }
+
+    return returnVal;
+}
+
+/* Decodes a given audio file by pushing it to the decoder in pieces */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_FAILURE;
+    unsigned char* file_data = NULL;
+    size_t file_size = 0;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    file_data = read_file(path, &file_size);
+
+    if (file_data == NULL) {
+        printf("Could not read %s!\n", path);
+    } else if (test_push(file_data, file_size, 0) == EXIT_SUCCESS && test_push(file_data, file_size, 1) == EXIT_SUCCESS) {
+        returnVal = EXIT_SUCCESS;
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (file_data != NULL) {
+        free(file_data);
+        file_data = NULL;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
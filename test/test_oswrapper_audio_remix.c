@@ -0,0 +1,427 @@
+/*
+This program uses oswrapper_audio to remix audio to a different channel count.
+Constant signals with each common channel layout are remixed with the standard matrices and with custom matrices,
+with and without resampling, and checked against the expected mix.
+An audio file is also remixed to 16 bit PCM, and checked against remixing the decoded audio by hand.
+
+Usage: test_oswrapper_audio_remix (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_remix.c
+*/
+
+#ifdef OSWRAPPER_AUDIO_USE_MINIAUDIO_IMPL
+/* Decode audio with miniaudio instead of the OS audio decoders */
+#define MA_NO_DEVICE_IO
+#define MA_NO_ENCODING
+#define MA_NO_RESOURCE_MANAGER
+#define MA_NO_NODE_GRAPH
+#define MA_NO_ENGINE
+#define MA_NO_GENERATION
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+#endif
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_PROGRAM_SAMPLE_RATE 44100
+#define TEST_PROGRAM_RESAMPLE_RATE 48000
+#define TEST_PROGRAM_BUFFER_SIZE 0x50
+#define TEST_PROGRAM_CONSTANT_FRAMES 4000
+/* Resampling fades in and out at the start and end, because the audio is treated as silent outside of the file */
+#define TEST_PROGRAM_FADE_FRAMES 200
+#define TEST_PROGRAM_MAX_CHANNELS 8
+/* -3 dB */
+#define TEST_PROGRAM_QUIET 0.70710678f
+
+static const float test_values[TEST_PROGRAM_MAX_CHANNELS] = { 0.1f, -0.2f, 0.3f, 0.9f, -0.5f, 0.6f, 0.25f, -0.35f };
+
+/* Writes a little-endian value of the given size */
+static void write_le(unsigned char* data, unsigned long value, size_t size) {
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        data[i] = (unsigned char) (value >> (i * 8));
+    }
+}
+
+/* Creates a 32 bit floating point WAVE file in memory, where each channel has a constant value from test_values */
+static unsigned char* create_constant_wave(unsigned int channel_count, size_t* size) {
+    size_t data_size = TEST_PROGRAM_CONSTANT_FRAMES * channel_count * sizeof(float);
+    unsigned char* wave = (unsigned char*) malloc(44 + data_size);
+    size_t i;
+
+    if (wave == NULL) {
+        return NULL;
+    }
+
+    memcpy(wave, "RIFF", 4);
+    write_le(wave + 4, (unsigned long) (36 + data_size), 4);
+    memcpy(wave + 8, "WAVEfmt ", 8);
+    write_le(wave + 16, 16, 4);
+    write_le(wave + 20, 3, 2);
+    write_le(wave + 22, channel_count, 2);
+    write_le(wave + 24, TEST_PROGRAM_SAMPLE_RATE, 4);
+    write_le(wave + 28, (unsigned long) (TEST_PROGRAM_SAMPLE_RATE * channel_count * sizeof(float)), 4);
+    write_le(wave + 32, (unsigned long) (channel_count * sizeof(float)), 2);
+    write_le(wave + 34, 32, 2);
+    memcpy(wave + 36, "data", 4);
+    write_le(wave + 40, (unsigned long) data_size, 4);
+
+    for (i = 0; i < TEST_PROGRAM_CONSTANT_FRAMES * channel_count; i++) {
+        memcpy(wave + 44 + (i * sizeof(float)), &test_values[i % channel_count], sizeof(float));
+    }
+
+    *size = 44 + data_size;
+    return wave;
+}
+
+/* Remixes a constant signal with the given channel count, and checks that each output channel has the expected value.
+Either the output channel count or a custom matrix is hinted. */
+static int test_remix_constant(const char* name, unsigned int input_channels, unsigned int output_channels, const OSWrapper_audio_channel_matrix* matrix, unsigned long sample_rate, const float* expected) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    unsigned char* wave;
+    size_t wave_size = 0;
+    size_t frames_done = 0;
+    float max_error = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded = 0;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    wave = create_constant_wave(input_channels, &wave_size);
+
+    if (wave == NULL) {
+        puts("malloc failed for test audio!");
+        return EXIT_FAILURE;
+    }
+
+    audio_spec.sample_rate = sample_rate;
+    audio_spec.channel_count = matrix == NULL ? output_channels : 0;
+    audio_spec.bits_per_channel = 32;
+    audio_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
+    audio_spec.channel_matrix = matrix;
+    loaded = oswrapper_audio_load_from_memory(wave, wave_size, &audio_spec);
+
+    if (!loaded) {
+        printf("Could not decode test audio for %s!\n", name);
+        goto exit;
+    }
+
+    if (audio_spec.channel_count != output_channels) {
+        printf("Channel count for %s was %u, expected %u!\n", name, audio_spec.channel_count, output_channels);
+        goto exit;
+    }
+
+    while (1) {
+        float buffer[TEST_PROGRAM_BUFFER_SIZE * TEST_PROGRAM_MAX_CHANNELS];
+        size_t this_iter = oswrapper_audio_get_samples(&audio_spec, (short*) buffer, TEST_PROGRAM_BUFFER_SIZE);
+        size_t i;
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        for (i = 0; i < this_iter; i++, frames_done++) {
+            unsigned int channel;
+
+            if (sample_rate != 0 && (frames_done < TEST_PROGRAM_FADE_FRAMES || frames_done >= TEST_PROGRAM_CONSTANT_FRAMES - TEST_PROGRAM_FADE_FRAMES)) {
+                continue;
+            }
+
+            for (channel = 0; channel < output_channels; channel++) {
+                float error = buffer[(i * output_channels) + channel] - expected[channel];
+                error = error < 0 ? -error : error;
+                max_error = error > max_error ? error : max_error;
+            }
+        }
+    }
+
+    if (frames_done < TEST_PROGRAM_CONSTANT_FRAMES || max_error > 0.0001f) {
+        printf("Remixing %s was off by up to %f, after %zu frames!\n", name, max_error, frames_done);
+        goto exit;
+    }
+
+    printf("Remixed %s\n", name);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded && !oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(wave);
+    return returnVal;
+}
+
+/* Checks the standard matrices for each channel layout */
+static int test_standard_matrices(void) {
+    int returnVal = EXIT_SUCCESS;
+    const float* v = test_values;
+    const float q = TEST_PROGRAM_QUIET;
+    float expected[TEST_PROGRAM_MAX_CHANNELS];
+    /* Mono to stereo */
+    expected[0] = v[0];
+    expected[1] = v[0];
+
+    if (test_remix_constant("mono to stereo", 1, 2, NULL, 0, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    /* Stereo to mono */
+    expected[0] = (v[0] + v[1]) * 0.5f;
+
+    if (test_remix_constant("stereo to mono", 2, 1, NULL, 0, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    /* Quad to stereo: front left, front right, back left, back right */
+    expected[0] = (v[0] + (q * v[2])) / (1 + q);
+    expected[1] = (v[1] + (q * v[3])) / (1 + q);
+
+    if (test_remix_constant("quad to stereo", 4, 2, NULL, 0, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    /* 5.1 to stereo: front left, front right, centre, LFE, back left, back right */
+    expected[0] = (v[0] + (q * v[2]) + (q * v[4])) / (1 + (2 * q));
+    expected[1] = (v[1] + (q * v[2]) + (q * v[5])) / (1 + (2 * q));
+
+    if (test_remix_constant("5.1 to stereo", 6, 2, NULL, 0, expected) != EXIT_SUCCESS || test_remix_constant("5.1 to stereo, resampled", 6, 2, NULL, TEST_PROGRAM_RESAMPLE_RATE, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    expected[0] = (expected[0] + expected[1]) * 0.5f;
+
+    if (test_remix_constant("5.1 to mono", 6, 1, NULL, 0, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    /* 7.1 to stereo: front left, front right, centre, LFE, back left, back right, side left, side right */
+    expected[0] = (v[0] + (q * v[2]) + (q * v[4]) + (q * v[6])) / (1 + (3 * q));
+    expected[1] = (v[1] + (q * v[2]) + (q * v[5]) + (q * v[7])) / (1 + (3 * q));
+
+    if (test_remix_constant("7.1 to stereo", 8, 2, NULL, 0, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    /* Stereo to 5.1 only uses the front channels */
+    expected[0] = v[0];
+    expected[1] = v[1];
+    expected[2] = 0;
+    expected[3] = 0;
+    expected[4] = 0;
+    expected[5] = 0;
+
+    if (test_remix_constant("stereo to 5.1", 2, 6, NULL, 0, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/* Checks custom matrices, and that a matrix which doesn't fit the audio is rejected */
+static int test_custom_matrices(void) {
+    int returnVal = EXIT_SUCCESS;
+    const float* v = test_values;
+    float expected[TEST_PROGRAM_MAX_CHANNELS];
+    /* Pick out the centre channel, swap the front channels, and add the back channels together */
+    static const float downmix_coefficients[3 * 6] = {
+        0, 0, 1, 0, 0, 0,
+        0, 1, 0, 0, 0, 0,
+        1, 0, 0, 0, 0, 0
+    };
+    static const float upmix_coefficients[5] = { 1, -1, 0.5f, 0, 0.25f };
+    OSWrapper_audio_channel_matrix matrix;
+    OSWrapper_audio_spec audio_spec;
+    unsigned char* wave;
+    size_t wave_size = 0;
+    matrix.input_channel_count = 6;
+    matrix.output_channel_count = 3;
+    matrix.coefficients = downmix_coefficients;
+    expected[0] = v[2];
+    expected[1] = v[1];
+    expected[2] = v[0];
+
+    if (test_remix_constant("5.1 with a custom matrix", 6, 3, &matrix, 0, expected) != EXIT_SUCCESS || test_remix_constant("5.1 with a custom matrix, resampled", 6, 3, &matrix, TEST_PROGRAM_RESAMPLE_RATE, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    /* Upmixing is done after resampling */
+    matrix.input_channel_count = 1;
+    matrix.output_channel_count = 5;
+    matrix.coefficients = upmix_coefficients;
+    expected[0] = v[0];
+    expected[1] = -v[0];
+    expected[2] = v[0] * 0.5f;
+    expected[3] = 0;
+    expected[4] = v[0] * 0.25f;
+
+    if (test_remix_constant("mono with a custom matrix", 1, 5, &matrix, 0, expected) != EXIT_SUCCESS || test_remix_constant("mono with a custom matrix, resampled", 1, 5, &matrix, TEST_PROGRAM_RESAMPLE_RATE, expected) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    wave = create_constant_wave(2, &wave_size);
+
+    if (wave == NULL) {
+        puts("malloc failed for test audio!");
+        return EXIT_FAILURE;
+    }
+
+    /* The matrix is for mono audio */
+    audio_spec.channel_matrix = &matrix;
+
+    if (oswrapper_audio_load_from_memory(wave, wave_size, &audio_spec)) {
+        puts("Loaded stereo audio with a matrix for mono audio!");
+        oswrapper_audio_free_context(&audio_spec);
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(wave);
+    return returnVal;
+}
+
+/* Remixes the given file from stereo to mono or mono to stereo as 16 bit PCM,
+and checks the result against remixing the file decoded as floating point PCM */
+static int test_remix_file(const char* path) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec float_spec;
+    OSWrapper_audio_spec remix_spec;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_float = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded_remix = 0;
+    float* float_buffer = NULL;
+    short remix_buffer[TEST_PROGRAM_BUFFER_SIZE * 2];
+    size_t frames_done = 0;
+    int max_error = 0;
+    memset(&float_spec, 0, sizeof(float_spec));
+    memset(&remix_spec, 0, sizeof(remix_spec));
+    float_spec.bits_per_channel = 32;
+    float_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
+    loaded_float = oswrapper_audio_load_from_path(path, &float_spec);
+
+    if (!loaded_float) {
+        puts("Could not decode audio!");
+        goto exit;
+    }
+
+    if (float_spec.channel_count != 1 && float_spec.channel_count != 2) {
+        printf("Skipped remixing %s, which has %u channels\n", path, float_spec.channel_count);
+        returnVal = EXIT_SUCCESS;
+        goto exit;
+    }
+
+    remix_spec.channel_count = float_spec.channel_count == 1 ? 2 : 1;
+    remix_spec.bits_per_channel = 16;
+    remix_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_INTEGER;
+    loaded_remix = oswrapper_audio_load_from_path(path, &remix_spec);
+
+    if (!loaded_remix || remix_spec.channel_count != (float_spec.channel_count == 1 ? 2u : 1u) || remix_spec.bits_per_channel != 16) {
+        puts("Could not decode remixed audio!");
+        goto exit;
+    }
+
+    float_buffer = (float*) malloc(TEST_PROGRAM_BUFFER_SIZE * float_spec.channel_count * sizeof(float));
+
+    if (float_buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    while (1) {
+        size_t this_iter = oswrapper_audio_get_samples(&float_spec, (short*) float_buffer, TEST_PROGRAM_BUFFER_SIZE);
+        size_t i;
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        if (oswrapper_audio_get_samples(&remix_spec, remix_buffer, this_iter) != this_iter) {
+            printf("Remixed audio ended early, after %zu frames!\n", frames_done);
+            goto exit;
+        }
+
+        for (i = 0; i < this_iter; i++) {
+            unsigned int channel;
+            float mixed = float_spec.channel_count == 1 ? float_buffer[i] : (float_buffer[i * 2] + float_buffer[(i * 2) + 1]) * 0.5f;
+
+            for (channel = 0; channel < remix_spec.channel_count; channel++) {
+                int error = (int) remix_buffer[(i * remix_spec.channel_count) + channel] - (int) (mixed * 32768.0f);
+                error = error < 0 ? -error : error;
+                max_error = error > max_error ? error : max_error;
+            }
+        }
+
+        frames_done += this_iter;
+    }
+
+    if (oswrapper_audio_get_samples(&remix_spec, remix_buffer, TEST_PROGRAM_BUFFER_SIZE) != 0 || max_error > 1) {
+        printf("Remixed audio did not match, with an error of up to %d!\n", max_error);
+        goto exit;
+    }
+
+    printf("Remixed %zu frames of %s from %u to %u channels\n", frames_done, path, float_spec.channel_count, remix_spec.channel_count);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded_remix && !oswrapper_audio_free_context(&remix_spec)) {
+        puts("Could not free remixed audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (loaded_float && !oswrapper_audio_free_context(&float_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (float_buffer != NULL) {
+        free(float_buffer);
+        float_buffer = NULL;
+    }
+
+    return returnVal;
+}
+
+/* Remixes constant signals and a given audio file */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    if (test_standard_matrices() != EXIT_SUCCESS || test_custom_matrices() != EXIT_SUCCESS || test_remix_file(path) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,260 @@
+/*
+This program uses oswrapper_audio to resample an audio file to a different sample rate,
+with each resampling quality. It checks that the length of the resampled audio is correct,
+and that seeking gives the same audio as decoding from the start.
+A short constant signal is also resampled, which should stay constant.
+
+Usage: test_oswrapper_audio_resample (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_resample.c
+*/
+
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_PROGRAM_SAMPLE_RATE 48000
+#define TEST_PROGRAM_BUFFER_SIZE 0x50
+#define TEST_PROGRAM_CONSTANT_FRAMES 4000
+#define TEST_PROGRAM_CONSTANT_VALUE 0.25f
+
+/* Resamples the given file with the given quality, and checks the result */
+static int test_resample_file(const char* path, OSWrapper_audio_resample_quality quality) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWRAPPER_AUDIO_SEEK_TYPE length = 0;
+    OSWRAPPER_AUDIO_SEEK_TYPE middle;
+    unsigned char* decoded = NULL;
+    unsigned char* buffer = NULL;
+    size_t frame_size;
+    size_t frames_done = 0;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    audio_spec.sample_rate = TEST_PROGRAM_SAMPLE_RATE;
+    audio_spec.resample_quality = quality;
+
+    if (!oswrapper_audio_load_from_path(path, &audio_spec)) {
+        puts("Could not decode audio!");
+        return EXIT_FAILURE;
+    }
+
+    if (audio_spec.sample_rate != TEST_PROGRAM_SAMPLE_RATE) {
+        printf("Sample rate was %lu, expected %d!\n", audio_spec.sample_rate, TEST_PROGRAM_SAMPLE_RATE);
+        goto exit;
+    }
+
+    if (oswrapper_audio_get_length(&audio_spec, &length) != OSWRAPPER_AUDIO_LENGTH_EXACT || length <= 0) {
+        puts("Could not get the length of the resampled audio!");
+        goto exit;
+    }
+
+    frame_size = (audio_spec.bits_per_channel / 8) * audio_spec.channel_count;
+    decoded = (unsigned char*) malloc((size_t) length * frame_size);
+    buffer = (unsigned char*) malloc(TEST_PROGRAM_BUFFER_SIZE * frame_size);
+
+    if (decoded == NULL || buffer == NULL) {
+        puts("malloc failed for audio decoding buffer!");
+        goto exit;
+    }
+
+    while (1) {
+        size_t this_iter = oswrapper_audio_get_samples(&audio_spec, (short*) (decoded + (frames_done * frame_size)), (size_t) length - frames_done < TEST_PROGRAM_BUFFER_SIZE ? (size_t) length - frames_done : TEST_PROGRAM_BUFFER_SIZE);
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        frames_done += this_iter;
+    }
+
+    if ((OSWRAPPER_AUDIO_SEEK_TYPE) frames_done != length || oswrapper_audio_get_samples(&audio_spec, (short*) decoded, 1) != 0) {
+        printf("Decoded %zu frames, expected %lld!\n", frames_done, (long long) length);
+        goto exit;
+    }
+
+    /* Seeking needs the resampler to read the audio before the new position again */
+    middle = length / 2;
+
+    if (!oswrapper_audio_seek(&audio_spec, middle)) {
+        puts("Could not seek to the middle of the file!");
+        goto exit;
+    }
+
+    while (1) {
+        size_t this_iter = oswrapper_audio_get_samples(&audio_spec, (short*) buffer, TEST_PROGRAM_BUFFER_SIZE);
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        if (memcmp(buffer, decoded + ((size_t) middle * frame_size), this_iter * frame_size) != 0) {
+            printf("Audio after seeking did not match at frame %lld!\n", (long long) middle);
+            goto exit;
+        }
+
+        middle += this_iter;
+    }
+
+    if (middle != length) {
+        puts("Audio after seeking ended early!");
+        goto exit;
+    }
+
+    printf("Resampled %lld frames with quality %d\n", (long long) length, (int) quality);
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (!oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (decoded != NULL) {
+        free(decoded);
+        decoded = NULL;
+    }
+
+    if (buffer != NULL) {
+        free(buffer);
+        buffer = NULL;
+    }
+
+    return returnVal;
+}
+
+/* Writes a little-endian value of the given size */
+static void write_le(unsigned char* data, unsigned long value, size_t size) {
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        data[i] = (unsigned char) (value >> (i * 8));
+    }
+}
+
+/* Resamples a constant signal with the given quality, and checks that it stays constant */
+static int test_resample_constant(OSWrapper_audio_resample_quality quality) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    unsigned char* wave = NULL;
+    size_t data_size = TEST_PROGRAM_CONSTANT_FRAMES * sizeof(float);
+    size_t frames_done = 0;
+    size_t i;
+    float max_error = 0;
+    OSWRAPPER_AUDIO_RESULT_TYPE loaded;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+    wave = (unsigned char*) malloc(44 + data_size);
+
+    if (wave == NULL) {
+        puts("malloc failed for test audio!");
+        return EXIT_FAILURE;
+    }
+
+    /* Mono 32 bit floating point PCM at 44100 Hz */
+    memcpy(wave, "RIFF", 4);
+    write_le(wave + 4, (unsigned long) (36 + data_size), 4);
+    memcpy(wave + 8, "WAVEfmt ", 8);
+    write_le(wave + 16, 16, 4);
+    write_le(wave + 20, 3, 2);
+    write_le(wave + 22, 1, 2);
+    write_le(wave + 24, 44100, 4);
+    write_le(wave + 28, 44100 * sizeof(float), 4);
+    write_le(wave + 32, sizeof(float), 2);
+    write_le(wave + 34, 32, 2);
+    memcpy(wave + 36, "data", 4);
+    write_le(wave + 40, (unsigned long) data_size, 4);
+
+    for (i = 0; i < TEST_PROGRAM_CONSTANT_FRAMES; i++) {
+        float value = TEST_PROGRAM_CONSTANT_VALUE;
+        memcpy(wave + 44 + (i * sizeof(float)), &value, sizeof(float));
+    }
+
+    audio_spec.sample_rate = TEST_PROGRAM_SAMPLE_RATE;
+    audio_spec.audio_type = OSWRAPPER_AUDIO_FORMAT_PCM_FLOAT;
+    audio_spec.resample_quality = quality;
+    loaded = oswrapper_audio_load_from_memory(wave, 44 + data_size, &audio_spec);
+
+    if (!loaded) {
+        puts("Could not decode test audio!");
+        goto exit;
+    }
+
+    while (1) {
+        float buffer[TEST_PROGRAM_BUFFER_SIZE];
+        size_t this_iter = oswrapper_audio_get_samples(&audio_spec, (short*) buffer, TEST_PROGRAM_BUFFER_SIZE);
+
+        if (this_iter == 0) {
+            break;
+        }
+
+        /* The start and end fade in and out, because the audio is treated as silent outside of the file */
+        for (i = 0; i < this_iter; i++, frames_done++) {
+            if (frames_done >= 200 && frames_done < TEST_PROGRAM_CONSTANT_FRAMES - 200) {
+                float error = buffer[i] - TEST_PROGRAM_CONSTANT_VALUE;
+                error = error < 0 ? -error : error;
+                max_error = error > max_error ? error : max_error;
+            }
+        }
+    }
+
+    if (max_error > 0.0001f) {
+        printf("Constant signal changed by up to %f with quality %d!\n", max_error, (int) quality);
+        goto exit;
+    }
+
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (loaded && !oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    free(wave);
+    return returnVal;
+}
+
+/* Resamples a given audio file with every resampling quality */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    int quality;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    for (quality = OSWRAPPER_AUDIO_RESAMPLE_QUALITY_DEFAULT; quality <= OSWRAPPER_AUDIO_RESAMPLE_QUALITY_HIGH; quality++) {
+        if (test_resample_file(path, (OSWrapper_audio_resample_quality) quality) != EXIT_SUCCESS || test_resample_constant((OSWrapper_audio_resample_quality) quality) != EXIT_SUCCESS) {
+            returnVal = EXIT_FAILURE;
+        }
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
@@ -0,0 +1,225 @@
+/*
+This program uses oswrapper_audio to decode an audio file on a worker thread with OSWrapper_audio_stream,
+reading it back in randomly sized pieces like a real-time audio callback would.
+The streamed audio is checked against the same file decoded with oswrapper_audio_get_samples,
+including after seeking, and when looping.
+
+Usage: test_oswrapper_audio_stream (audio_file.ext)
+If no input is provided, it will decode the file named noise.wav in this folder.
+
+The latest version of this file can be found at
+https://github.com/NeRdTheNed/OSWrapper/blob/main/test/test_oswrapper_audio_stream.c
+*/
+
+#define OSWRAPPER_AUDIO_USE_THREADS
+#define OSWRAPPER_AUDIO_STATIC
+#define OSWRAPPER_AUDIO_IMPLEMENTATION
+#include "oswrapper_audio.h"
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+/* Sleep function */
+#include <windows.h>
+#define TEST_PROGRAM_SLEEP_MS(ms) Sleep(ms)
+#else
+/* Sleep function */
+#include <unistd.h>
+#define TEST_PROGRAM_SLEEP_MS(ms) usleep((ms) * 1000)
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The size of the stream's ring buffer, in frames */
+#define TEST_PROGRAM_STREAM_SIZE 0x1000
+/* The largest amount of frames read at once */
+#define TEST_PROGRAM_BUFFER_SIZE 0x200
+#define TEST_PROGRAM_SEED 1234
+
+/* Decodes the whole file, so streamed audio can be checked against it */
+static unsigned char* decode_file(const char* path, size_t* frame_size, size_t* total_frames) {
+    OSWrapper_audio_spec audio_spec;
+    OSWRAPPER_AUDIO_SEEK_TYPE length = 0;
+    unsigned char* decoded = NULL;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (!oswrapper_audio_load_from_path(path, &audio_spec)) {
+        return NULL;
+    }
+
+    *frame_size = (audio_spec.bits_per_channel / 8) * audio_spec.channel_count;
+
+    if (oswrapper_audio_get_length(&audio_spec, &length) && length > 0) {
+        decoded = (unsigned char*) malloc((size_t) length * *frame_size);
+
+        if (decoded != NULL) {
+            *total_frames = oswrapper_audio_get_samples(&audio_spec, (short*) decoded, (size_t) length);
+        }
+    }
+
+    oswrapper_audio_free_context(&audio_spec);
+    return decoded;
+}
+
+/* Reads frames from the stream until the buffer is full or the stream ends, waiting for the worker thread as needed */
+static size_t read_stream(OSWrapper_audio_stream* stream, unsigned char* buffer, size_t frame_size, size_t frames_to_do) {
+    size_t frames_done = 0;
+
+    while (frames_done < frames_to_do) {
+        OSWrapper_audio_stream_stats stats;
+        size_t this_iter = oswrapper_audio_stream_read(stream, buffer + (frames_done * frame_size), frames_to_do - frames_done);
+        frames_done += this_iter;
+
+        if (this_iter == 0) {
+            oswrapper_audio_stream_get_stats(stream, &stats);
+
+            if (stats.ended) {
+                break;
+            }
+
+            TEST_PROGRAM_SLEEP_MS(1);
+        }
+    }
+
+    return frames_done;
+}
+
+/* Streams the given file, and checks it against the decoded audio.
+When looping, it reads the audio twice. Otherwise it seeks to the middle of the audio, and reads it from there. */
+static int test_stream(const char* path, const unsigned char* decoded, size_t frame_size, size_t total_frames, OSWRAPPER_AUDIO_RESULT_TYPE loop) {
+    int returnVal = EXIT_FAILURE;
+    OSWrapper_audio_spec audio_spec;
+    OSWrapper_audio_stream* stream = NULL;
+    OSWrapper_audio_stream_stats stats;
+    unsigned char buffer[TEST_PROGRAM_BUFFER_SIZE * 8 * 8];
+    size_t frames_to_do = loop ? total_frames * 2 : total_frames;
+    size_t frames_done = 0;
+    size_t start_frame = 0;
+    memset(&audio_spec, 0, sizeof(audio_spec));
+
+    if (!oswrapper_audio_load_from_path(path, &audio_spec)) {
+        puts("Could not decode audio!");
+        return EXIT_FAILURE;
+    }
+
+    if (frame_size > 8 * 8) {
+        puts("Frame size was too large!");
+        goto exit;
+    }
+
+    stream = oswrapper_audio_stream_create(&audio_spec, TEST_PROGRAM_STREAM_SIZE, loop);
+
+    if (stream == NULL) {
+        puts("Could not create stream!");
+        goto exit;
+    }
+
+    while (frames_done < frames_to_do) {
+        size_t frames_requested = 1 + (size_t) rand() % TEST_PROGRAM_BUFFER_SIZE;
+        size_t this_iter;
+        size_t i;
+        frames_requested = frames_requested < frames_to_do - frames_done ? frames_requested : frames_to_do - frames_done;
+        this_iter = read_stream(stream, buffer, frame_size, frames_requested);
+
+        for (i = 0; i < this_iter; i++) {
+            if (memcmp(buffer + (i * frame_size), decoded + (((start_frame + frames_done + i) % total_frames) * frame_size), frame_size) != 0) {
+                printf("Streamed audio did not match at frame %zu!\n", start_frame + frames_done + i);
+                goto exit;
+            }
+        }
+
+        frames_done += this_iter;
+
+        if (this_iter < frames_requested) {
+            break;
+        }
+
+        if (!loop && start_frame == 0 && frames_done >= total_frames / 4) {
+            /* Skip to the middle, which discards any frames which have already been decoded */
+            start_frame = total_frames / 2;
+            frames_to_do = total_frames - start_frame;
+            frames_done = 0;
+            oswrapper_audio_stream_seek(stream, (OSWRAPPER_AUDIO_SEEK_TYPE) start_frame);
+        }
+    }
+
+    if (frames_done != frames_to_do) {
+        printf("Streamed %zu frames, expected %zu!\n", frames_done, frames_to_do);
+        goto exit;
+    }
+
+    /* Waits for the worker thread to reach the end */
+    if (!loop && read_stream(stream, buffer, frame_size, 1) != 0) {
+        puts("Stream did not end!");
+        goto exit;
+    }
+
+    oswrapper_audio_stream_get_stats(stream, &stats);
+
+    printf("Streamed %zu frames with %lu underruns, looping %s\n", frames_done, stats.underruns, loop ? "on" : "off");
+    returnVal = EXIT_SUCCESS;
+exit:
+
+    if (stream != NULL) {
+        oswrapper_audio_stream_destroy(stream);
+    }
+
+    if (!oswrapper_audio_free_context(&audio_spec)) {
+        puts("Could not free audio context!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/* Streams a given audio file */
+int main(int argc, char** argv) {
+    int returnVal = EXIT_SUCCESS;
+    const char* path = argc < 2 ? "noise.wav" : argv[argc - 1];
+    unsigned char* decoded;
+    size_t frame_size = 0;
+    size_t total_frames = 0;
+
+    if (!oswrapper_audio_init()) {
+        puts("Could not initialise oswrapper_audio!");
+        return EXIT_FAILURE;
+    }
+
+    srand(TEST_PROGRAM_SEED);
+    decoded = decode_file(path, &frame_size, &total_frames);
+
+    if (decoded == NULL || total_frames == 0) {
+        puts("Could not decode audio!");
+        returnVal = EXIT_FAILURE;
+    } else if (test_stream(path, decoded, frame_size, total_frames, OSWRAPPER_AUDIO_RESULT_FAILURE) != EXIT_SUCCESS
+               || test_stream(path, decoded, frame_size, total_frames, OSWRAPPER_AUDIO_RESULT_SUCCESS) != EXIT_SUCCESS) {
+        returnVal = EXIT_FAILURE;
+    }
+
+    if (decoded != NULL) {
+        free(decoded);
+    }
+
+    if (!oswrapper_audio_uninit()) {
+        puts("Could not uninitialise oswrapper_audio!");
+        returnVal = EXIT_FAILURE;
+    }
+
+    return returnVal;
+}
+
+/*
+BSD Zero Clause License
+
+Copyright (c) 2023 Ned Loynd
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/